@@ -0,0 +1,468 @@
+/** @file
+ *  Provides implementation for the vehicle archive.
+ *
+ *  The fixes go to a regular store file (nmea0183_store.h), a batch at a
+ *  time sorted by vehicle so that every block holds a single vehicle. The
+ *  index file at the store path plus NMEA_ARCHIVE_INDEX_SUFFIX lists one
+ *  entry per block, sorted by vehicle and earliest fix. A query finds the
+ *  first block of the vehicle that may reach into the range by binary search,
+ *  going back by the longest time span of a block, and decodes only the
+ *  blocks overlapping the range.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "nmea0183_archive.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define MIN_ENTRIES					256
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static int write_block(nmea_archive_writer_t *writer, uint32_t vehicle, size_t begin, size_t end);
+static int write_index(nmea_archive_writer_t *writer);
+static char *index_path(const char *path);
+static const nmea_archive_entry_t *lower_bound(const nmea_archive_reader_t *reader, uint32_t vehicle, int64_t time);
+static int compare_order(const void *a, const void *b);
+static int compare_entries(const void *a, const void *b);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Create an archive, truncating any existing store and index files
+* @param  writer: Writer to initialize
+* @param  path: Path of the store file
+* @param  batch: Fixes sorted by vehicle per write, 0 for NMEA_ARCHIVE_BATCH
+* @return 0 on success, -1 on error
+********************************************************************************/
+int nmea_archive_create(nmea_archive_writer_t *writer, const char *path, size_t batch)
+{
+	if (batch == 0 || batch > UINT32_MAX) {
+		batch = NMEA_ARCHIVE_BATCH;
+	}
+
+	writer->count = 0;
+	writer->capacity = batch;
+	writer->num_entries = 0;
+	writer->max_entries = 0;
+	writer->max_span = 0;
+	writer->entries = NULL;
+	writer->index_path = index_path(path);
+	writer->pending = malloc(batch * sizeof(nmea_rmc_data_t));
+	writer->order = malloc(batch * sizeof(uint64_t));
+	if (!writer->index_path || !writer->pending || !writer->order || nmea_store_create(&writer->store, path)) {
+		free(writer->index_path);
+		free(writer->pending);
+		free(writer->order);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+********************************************************************************
+* Append a fix of a vehicle; the batch is written when it is full
+* @param  writer: Writer of the archive
+* @param  vehicle: Vehicle the fix belongs to
+* @param  fix: Fix to append, as filled in by parse_rmc()
+* @return 0 on success, -1 on write error
+********************************************************************************/
+int nmea_archive_append(nmea_archive_writer_t *writer, uint32_t vehicle, const nmea_rmc_data_t *fix)
+{
+	writer->pending[writer->count] = *fix;
+	writer->order[writer->count] = (uint64_t)vehicle << 32 | writer->count;
+
+	if (++writer->count == writer->capacity) {
+		return nmea_archive_flush(writer);
+	}
+	return 0;
+}
+
+/**
+********************************************************************************
+* Write the pending fixes, a block per vehicle, even if the batch is not full
+* @param  writer: Writer of the archive
+* @return 0 on success, -1 on write error
+********************************************************************************/
+int nmea_archive_flush(nmea_archive_writer_t *writer)
+{
+	size_t begin, end;
+	uint32_t vehicle;
+
+	// arrival is the low half of the key, so each vehicle keeps its order
+	qsort(writer->order, writer->count, sizeof(uint64_t), compare_order);
+	for (begin = 0; begin < writer->count; begin = end) {
+		vehicle = writer->order[begin] >> 32;
+		for (end = begin + 1; end < writer->count && end - begin < NMEA_STORE_BLOCK_SIZE &&
+				(uint32_t)(writer->order[end] >> 32) == vehicle; end++) {
+		}
+		if (write_block(writer, vehicle, begin, end)) {
+			writer->count = 0;
+			return -1;
+		}
+	}
+	writer->count = 0;
+
+	return 0;
+}
+
+/**
+********************************************************************************
+* Write the pending fixes, close the store file and write the index file
+* @param  writer: Writer of the archive
+* @return 0 on success, -1 on write error
+********************************************************************************/
+int nmea_archive_close(nmea_archive_writer_t *writer)
+{
+	int result = nmea_archive_flush(writer);
+
+	if (nmea_store_close(&writer->store)) {
+		result = -1;
+	}
+	if (result == 0) {
+		result = write_index(writer);
+	}
+	free(writer->index_path);
+	free(writer->pending);
+	free(writer->order);
+	free(writer->entries);
+	writer->index_path = NULL;
+	writer->pending = NULL;
+	writer->order = NULL;
+	writer->entries = NULL;
+
+	return result;
+}
+
+/**
+********************************************************************************
+* Map an archive for queries
+* @param  reader: Reader to initialize
+* @param  path: Path of the store file, the index file is found next to it
+* @return 0 on success, -1 if either file cannot be mapped or is not valid
+********************************************************************************/
+int nmea_archive_map(nmea_archive_reader_t *reader, const char *path)
+{
+	const nmea_archive_index_header_t *header;
+	char *name = index_path(path);
+	struct stat st;
+	int fd = -1;
+
+	memset(reader, 0, sizeof(*reader));
+	if (!name || nmea_store_map(&reader->store, path)) {
+		free(name);
+		return -1;
+	}
+	fd = open(name, O_RDONLY);
+	free(name);
+	if (fd < 0 || fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(nmea_archive_index_header_t)) {
+		goto map_failed;
+	}
+	reader->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (reader->map == MAP_FAILED) {
+		reader->map = NULL;
+		goto map_failed;
+	}
+	close(fd);
+	fd = -1;
+	reader->len = st.st_size;
+
+	header = (const nmea_archive_index_header_t *)reader->map;
+	if (header->magic != NMEA_ARCHIVE_INDEX_MAGIC || header->version != NMEA_ARCHIVE_INDEX_VERSION ||
+			header->entries > (reader->len - sizeof(*header)) / sizeof(nmea_archive_entry_t) || header->max_span < 0) {
+		goto map_failed;
+	}
+	reader->entries = (const nmea_archive_entry_t *)(header + 1);
+	reader->num_entries = header->entries;
+	reader->max_span = header->max_span;
+
+	reader->columns = malloc(sizeof(nmea_fix_columns_t));
+	reader->fixes = malloc(NMEA_STORE_BLOCK_SIZE * sizeof(nmea_rmc_data_t));
+	if (!reader->columns || !reader->fixes) {
+		goto map_failed;
+	}
+
+	return 0;
+
+map_failed:
+	if (fd >= 0) {
+		close(fd);
+	}
+	nmea_archive_unmap(reader);
+	return -1;
+}
+
+/**
+********************************************************************************
+* Unmap an archive
+* @param  reader: Reader of the archive
+********************************************************************************/
+void nmea_archive_unmap(nmea_archive_reader_t *reader)
+{
+	if (reader->map) {
+		munmap((void *)reader->map, reader->len);
+	}
+	if (reader->store.map) {
+		nmea_store_unmap(&reader->store);
+	}
+	free(reader->columns);
+	free(reader->fixes);
+	reader->map = NULL;
+	reader->len = 0;
+	reader->entries = NULL;
+	reader->num_entries = 0;
+	reader->columns = NULL;
+	reader->fixes = NULL;
+}
+
+/**
+********************************************************************************
+* Find the fixes of a vehicle within a time range, decoding only the blocks
+* that overlap it
+* @param  reader: Reader of the archive
+* @param  vehicle: Vehicle to look up
+* @param  from_ms: Start of the range, UTC epoch milliseconds
+* @param  to_ms: End of the range, included
+* @param  callback: Called with the fixes of each block within the range, in
+*         the order they were appended
+* @param  user_data: Passed to the callback
+* @return Number of fixes found, -1 on a corrupted index or block
+********************************************************************************/
+int nmea_archive_query(nmea_archive_reader_t *reader, uint32_t vehicle, int64_t from_ms, int64_t to_ms,
+		nmea_archive_callback_t callback, void *user_data)
+{
+	const nmea_archive_entry_t *entry, *end = reader->entries + reader->num_entries;
+	const nmea_store_block_header_t *header;
+	nmea_fix_columns_t *columns = reader->columns;
+	int64_t earliest = from_ms > INT64_MIN + reader->max_span ? from_ms - reader->max_span : INT64_MIN;
+	size_t i, n;
+	int found = 0;
+
+	reader->stats.queries++;
+	for (entry = lower_bound(reader, vehicle, earliest); entry < end && entry->vehicle == vehicle &&
+			entry->min_time <= to_ms; entry++) {
+		if (entry->max_time < from_ms) {
+			continue;
+		}
+		if (entry->offset < sizeof(nmea_store_file_header_t) || entry->offset > reader->store.len ||
+				(entry->offset & 7)) {
+			return -1;
+		}
+		reader->store.offset = entry->offset;
+		header = nmea_store_next_block(&reader->store);
+		if (!header || header->count != entry->count || nmea_store_decode_block(header, columns) < 0) {
+			return -1;
+		}
+		reader->stats.blocks++;
+
+		for (i = n = 0; i < columns->count; i++) {
+			if (columns->time[i] >= from_ms && columns->time[i] <= to_ms) {
+				nmea_fix_columns_get(columns, i, &reader->fixes[n++]);
+			}
+		}
+		if (n) {
+			callback(vehicle, reader->fixes, n, user_data);
+			found += n;
+		}
+	}
+	reader->stats.fixes += found;
+
+	return found;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Write a run of pending fixes of one vehicle as a block and index it
+* @param  writer: Writer of the archive
+* @param  vehicle: Vehicle of the run
+* @param  begin: First entry of the run in writer->order
+* @param  end: Entry after the run, at most NMEA_STORE_BLOCK_SIZE further
+* @return 0 on success, -1 on write error
+********************************************************************************/
+static int write_block(nmea_archive_writer_t *writer, uint32_t vehicle, size_t begin, size_t end)
+{
+	off_t offset = ftello(writer->store.file);
+	nmea_archive_entry_t *entry;
+	size_t i;
+
+	if (offset < 0) {
+		return -1;
+	}
+	if (writer->num_entries == writer->max_entries) {
+		size_t max_entries = writer->max_entries ? writer->max_entries * 2 : MIN_ENTRIES;
+		nmea_archive_entry_t *entries = realloc(writer->entries, max_entries * sizeof(nmea_archive_entry_t));
+
+		if (!entries) {
+			return -1;
+		}
+		writer->entries = entries;
+		writer->max_entries = max_entries;
+	}
+
+	entry = &writer->entries[writer->num_entries];
+	entry->vehicle = vehicle;
+	entry->count = end - begin;
+	entry->offset = offset;
+	entry->min_time = INT64_MAX;
+	entry->max_time = INT64_MIN;
+	for (i = begin; i < end; i++) {
+		const nmea_rmc_data_t *fix = &writer->pending[(uint32_t)writer->order[i]];
+
+		if (fix->epoch_ms < entry->min_time) entry->min_time = fix->epoch_ms;
+		if (fix->epoch_ms > entry->max_time) entry->max_time = fix->epoch_ms;
+		if (nmea_store_append(&writer->store, fix)) {
+			return -1;
+		}
+	}
+	// a full block was written by the last append already
+	if (nmea_store_flush(&writer->store)) {
+		return -1;
+	}
+
+	if (entry->max_time - entry->min_time > writer->max_span) {
+		writer->max_span = entry->max_time - entry->min_time;
+	}
+	writer->num_entries++;
+	return 0;
+}
+
+/**
+********************************************************************************
+* Sort the entries and write them to the index file
+* @param  writer: Writer of the archive, with every block written
+* @return 0 on success, -1 on write error
+********************************************************************************/
+static int write_index(nmea_archive_writer_t *writer)
+{
+	nmea_archive_index_header_t header = { NMEA_ARCHIVE_INDEX_MAGIC, NMEA_ARCHIVE_INDEX_VERSION,
+			writer->num_entries, writer->max_span };
+	FILE *file = fopen(writer->index_path, "wb");
+	int result = 0;
+
+	if (!file) {
+		return -1;
+	}
+	if (writer->num_entries) {
+		qsort(writer->entries, writer->num_entries, sizeof(nmea_archive_entry_t), compare_entries);
+	}
+	if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+			fwrite(writer->entries, sizeof(nmea_archive_entry_t), writer->num_entries, file) != writer->num_entries) {
+		result = -1;
+	}
+	if (fclose(file)) {
+		result = -1;
+	}
+	return result;
+}
+
+/**
+********************************************************************************
+* Path of the index file of a store file
+* @param  path: Path of the store file
+* @return Allocated path, NULL when out of memory
+********************************************************************************/
+static char *index_path(const char *path)
+{
+	size_t len = strlen(path);
+	char *name = malloc(len + sizeof(NMEA_ARCHIVE_INDEX_SUFFIX));
+
+	if (name) {
+		memcpy(name, path, len);
+		memcpy(name + len, NMEA_ARCHIVE_INDEX_SUFFIX, sizeof(NMEA_ARCHIVE_INDEX_SUFFIX));
+	}
+	return name;
+}
+
+/**
+********************************************************************************
+* First entry of a vehicle whose earliest fix is not before a time
+* @param  reader: Reader of the archive
+* @param  vehicle: Vehicle to look up
+* @param  time: UTC epoch milliseconds
+* @return Entry, or the end of the entries
+********************************************************************************/
+static const nmea_archive_entry_t *lower_bound(const nmea_archive_reader_t *reader, uint32_t vehicle, int64_t time)
+{
+	const nmea_archive_entry_t *entries = reader->entries;
+	size_t low = 0, high = reader->num_entries, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (entries[mid].vehicle < vehicle || (entries[mid].vehicle == vehicle && entries[mid].min_time < time)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return entries + low;
+}
+
+static int compare_order(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+	const nmea_archive_entry_t *x = a, *y = b;
+
+	if (x->vehicle != y->vehicle) {
+		return x->vehicle < y->vehicle ? -1 : 1;
+	}
+	if (x->min_time != y->min_time) {
+		return x->min_time < y->min_time ? -1 : 1;
+	}
+	return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
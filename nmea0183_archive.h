@@ -0,0 +1,145 @@
+/** @file
+ *  Provides prototypes for the vehicle archive: a store file of the fixes of
+ *  many vehicles with a sparse index alongside, so that the track of one
+ *  vehicle over a time range is read without decoding the rest.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_ARCHIVE_H__
+#define __NMEA0183_ARCHIVE_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nmea0183_parser.h"
+#include "nmea0183_store.h"
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_ARCHIVE_INDEX_MAGIC	0x58434d52		/**< "RMCX", start of the index file. */
+#define NMEA_ARCHIVE_INDEX_VERSION	1
+#define NMEA_ARCHIVE_INDEX_SUFFIX	".idx"			/**< Appended to the store path for the index path. */
+#define NMEA_ARCHIVE_BATCH			(64 * 1024)		/**< Default fixes sorted by vehicle per write. */
+
+/**
+ * Index file header, followed by the entries sorted by vehicle, then time
+ */
+typedef struct nmea_archive_index_header_t
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t entries;
+	int64_t max_span;							/**< Longest max_time - min_time of an entry. */
+} nmea_archive_index_header_t;
+
+/**
+ * Index entry: a block of the store file holding the fixes of one vehicle
+ */
+typedef struct nmea_archive_entry_t
+{
+	uint32_t vehicle;
+	uint32_t count;								/**< Number of fixes. */
+	int64_t min_time;							/**< Earliest fix, UTC epoch milliseconds. */
+	int64_t max_time;							/**< Latest fix, UTC epoch milliseconds. */
+	uint64_t offset;							/**< Of the block header in the store file. */
+} nmea_archive_entry_t;
+
+/**
+ * Callback receiving the fixes of a query, one decoded block at a time
+ */
+typedef void (*nmea_archive_callback_t)(uint32_t vehicle, const nmea_rmc_data_t *fixes, size_t count,
+		void *user_data);
+
+/**
+ * Writer of an archive. Fixes are held until a batch is full, then written
+ * sorted by vehicle in arrival order, one block per vehicle and up to
+ * NMEA_STORE_BLOCK_SIZE fixes; the batch size thus sets how many fixes a
+ * vehicle gets per block when many vehicles report at once.
+ */
+typedef struct nmea_archive_writer_t
+{
+	nmea_store_writer_t store;
+	char *index_path;
+	nmea_rmc_data_t *pending;					/**< Fixes of the batch, in arrival order. */
+	uint64_t *order;							/**< vehicle << 32 | arrival, of each pending fix. */
+	size_t count;
+	size_t capacity;
+	nmea_archive_entry_t *entries;				/**< One per block written. */
+	size_t num_entries;
+	size_t max_entries;
+	int64_t max_span;
+} nmea_archive_writer_t;
+
+/**
+ * Work done by the queries of a reader
+ */
+typedef struct nmea_archive_stats_t
+{
+	uint64_t queries;
+	uint64_t blocks;							/**< Blocks decoded. */
+	uint64_t fixes;								/**< Fixes handed to the callback. */
+} nmea_archive_stats_t;
+
+/**
+ * Reader of a memory-mapped archive
+ */
+typedef struct nmea_archive_reader_t
+{
+	nmea_store_reader_t store;
+	const unsigned char *map;					/**< Of the index file. */
+	size_t len;
+	const nmea_archive_entry_t *entries;
+	size_t num_entries;
+	int64_t max_span;
+	nmea_fix_columns_t *columns;				/**< Scratch space for one decoded block. */
+	nmea_rmc_data_t *fixes;						/**< Fixes of that block in the queried range. */
+	nmea_archive_stats_t stats;
+} nmea_archive_reader_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_archive_create(nmea_archive_writer_t *writer, const char *path, size_t batch);
+int nmea_archive_append(nmea_archive_writer_t *writer, uint32_t vehicle, const nmea_rmc_data_t *fix);
+int nmea_archive_flush(nmea_archive_writer_t *writer);
+int nmea_archive_close(nmea_archive_writer_t *writer);
+
+int nmea_archive_map(nmea_archive_reader_t *reader, const char *path);
+void nmea_archive_unmap(nmea_archive_reader_t *reader);
+int nmea_archive_query(nmea_archive_reader_t *reader, uint32_t vehicle, int64_t from_ms, int64_t to_ms,
+		nmea_archive_callback_t callback, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
@@ -0,0 +1,494 @@
+/** @file
+ *  Provides the benchmark harness for the GPS NMEA parser. A generated
+ *  workload is run thru each parsing entry point, reporting ns/sentence,
+ *  MB/s and, where perf_event_open() is allowed, cycles and branch misses.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "nmea0183_parser.h"
+#include "nmea0183_scan.h"
+#include "nmea0183_parallel.h"
+#include "nmea0183_packed.h"
+#include "nmea0183_geodesic.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define BENCH_BATCH_SIZE			4096
+#define BENCH_CHUNK_SIZE			(64 * 1024)
+
+/**
+ * Workload and run settings from the command line
+ */
+typedef struct bench_config_t
+{
+	long sentences;
+	int pct_void;				// 'V' status
+	int pct_bad_checksum;
+	int pct_malformed;			// the rest is valid with fix
+	int threads;
+	int repeat;
+	unsigned int seed;
+} bench_config_t;
+
+/**
+ * Hardware counters of one run, -1 when not available
+ */
+typedef struct bench_counters_t
+{
+	int fd_cycles;
+	int fd_branch_misses;
+	long long cycles;
+	long long branch_misses;
+} bench_counters_t;
+
+/**
+ * One parsing entry point under test
+ */
+typedef struct bench_entry_t
+{
+	const char *name;
+	size_t (*run)(const bench_config_t *config);
+	nmea_scan_kernel kernel;
+} bench_entry_t;
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static void usage(char *arg);
+static void generate_workload(const bench_config_t *config);
+static void check_workload(const bench_config_t *config);
+static size_t run_parse_rmc(const bench_config_t *config);
+static size_t run_stream(const bench_config_t *config);
+static size_t run_buffer(const bench_config_t *config);
+static size_t run_buffer_position(const bench_config_t *config);
+static size_t run_fix_batch(const bench_config_t *config);
+static size_t run_geodesic(nmea_geo_kernel kernel);
+static size_t run_geodesic_scalar(const bench_config_t *config);
+static size_t run_geodesic_avx2(const bench_config_t *config);
+static size_t run_parallel(const bench_config_t *config);
+static void on_stream_sentence(const nmea_rmc_data_t *data, rmc_parse_result result, void *user_data);
+static int perf_open(uint32_t type, uint64_t config);
+static void counters_open(bench_counters_t *counters);
+static void counters_start(bench_counters_t *counters);
+static void counters_stop(bench_counters_t *counters);
+static double now_ns(void);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+static char *workload;			// sentences, one per line
+static size_t workload_len;
+static char *workload_lines;	// the same, NUL-terminated for parse_rmc()
+static size_t *line_offsets;
+static long num_lines;
+static nmea_fix_batch_t fix_batch;	// fixes of the workload, shared by the geodesic runs
+static double *geo_out[4];			// distance, odometer, bearing and speed
+
+static const bench_entry_t entries[] = {
+	{ "parse_rmc",				run_parse_rmc,	NMEA_SCAN_KERNEL_AUTO },
+	{ "nmea_stream_feed",		run_stream,		NMEA_SCAN_KERNEL_AUTO },
+	{ "parse_rmc_buffer",		run_buffer,		NMEA_SCAN_KERNEL_AUTO },
+	{ "  scalar scan",			run_buffer,		NMEA_SCAN_KERNEL_SCALAR },
+	{ "  sse2 scan",			run_buffer,		NMEA_SCAN_KERNEL_SSE2 },
+	{ "  avx2 scan",			run_buffer,		NMEA_SCAN_KERNEL_AVX2 },
+	{ "  position only",		run_buffer_position,	NMEA_SCAN_KERNEL_AUTO },
+	{ "nmea_fix_batch_parse",	run_fix_batch,	NMEA_SCAN_KERNEL_AUTO },
+	{ "  scalar geodesic",		run_geodesic_scalar,	NMEA_SCAN_KERNEL_AUTO },
+	{ "  avx2 geodesic",		run_geodesic_avx2,	NMEA_SCAN_KERNEL_AUTO },
+	{ "parse_rmc_parallel",		run_parallel,	NMEA_SCAN_KERNEL_AUTO },
+};
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+int main(int argc, char **argv)
+{
+	bench_config_t config = { 2000000, 10, 5, 5, 0, 3, 1 };
+	bench_counters_t counters;
+	size_t i;
+	int opt, r;
+
+	while ((opt = getopt(argc, argv, "n:V:c:m:t:r:s:h")) != -1) {
+		switch (opt) {
+			case 'n': config.sentences = atol(optarg); break;
+			case 'V': config.pct_void = atoi(optarg); break;
+			case 'c': config.pct_bad_checksum = atoi(optarg); break;
+			case 'm': config.pct_malformed = atoi(optarg); break;
+			case 't': config.threads = atoi(optarg); break;
+			case 'r': config.repeat = atoi(optarg); break;
+			case 's': config.seed = atoi(optarg); break;
+			default:
+				usage(argv[0]);
+				exit(0);
+		}
+	}
+	if (config.sentences <= 0 || config.repeat <= 0 ||
+			config.pct_void + config.pct_bad_checksum + config.pct_malformed > 100) {
+		usage(argv[0]);
+		exit(-1);
+	}
+
+	generate_workload(&config);
+	check_workload(&config);
+	counters_open(&counters);
+
+	printf("%ld sentences, %.1f MB: %d%% valid, %d%% V-status, %d%% bad checksum, %d%% malformed\n",
+			config.sentences, workload_len / 1e6,
+			100 - config.pct_void - config.pct_bad_checksum - config.pct_malformed,
+			config.pct_void, config.pct_bad_checksum, config.pct_malformed);
+	printf("%-22s %12s %10s %10s %14s %14s\n", "entry point", "sentences", "ns/sent", "MB/s", "cycles/sent", "br-miss/sent");
+
+	for (i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+		double best = 0;
+		long long best_cycles = -1, best_misses = -1;
+		size_t count = 0;
+
+		if (!nmea_scan_select(entries[i].kernel)) {
+			continue;
+		}
+		for (r = 0; r < config.repeat; r++) {
+			double start;
+
+			counters_start(&counters);
+			start = now_ns();
+			count = entries[i].run(&config);
+			start = now_ns() - start;
+			counters_stop(&counters);
+			if (!count) {
+				break;
+			}
+
+			if (r == 0 || start < best) {
+				best = start;
+				best_cycles = counters.cycles;
+				best_misses = counters.branch_misses;
+			}
+		}
+
+		if (!count) {
+			// nothing to time, e.g. a track of fewer than 2 fixes
+			printf("%-22s %12s\n", entries[i].name, "skipped");
+			continue;
+		}
+		printf("%-22s %12zu %10.1f %10.1f", entries[i].name, count,
+				best / count, workload_len / best * 1e3);
+		if (best_cycles >= 0) printf(" %14.1f", (double)best_cycles / count); else printf(" %14s", "n/a");
+		if (best_misses >= 0) printf(" %14.3f\n", (double)best_misses / count); else printf(" %14s\n", "n/a");
+	}
+	nmea_scan_select(NMEA_SCAN_KERNEL_AUTO);
+
+	return 0;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+static void usage(char *arg)
+{
+	printf("%s [-n sentences] [-V pct] [-c pct] [-m pct] [-t threads] [-r repeat] [-s seed]\n", arg);
+	printf("    -n  Number of sentences to generate (2000000)\n");
+	printf("    -V  Percentage of V-status sentences (10)\n");
+	printf("    -c  Percentage of sentences with a wrong checksum (5)\n");
+	printf("    -m  Percentage of malformed sentences (5)\n");
+	printf("    -t  Threads of parse_rmc_parallel, 0 for one per CPU (0)\n");
+	printf("    -r  Runs per entry point, the best one is reported (3)\n");
+	printf("    -s  Seed of the generator (1)\n");
+}
+
+/**
+********************************************************************************
+* Generate the workload: a random walk of fixes, with the configured share
+* of V-status, bad checksum and malformed sentences
+********************************************************************************/
+static void generate_workload(const bench_config_t *config)
+{
+	double latitude = 3623.3452323, longitude = 12438.242425, speed = 3.728, heading = 54.0897;
+	long seconds = 0, i;
+	size_t len = 0;
+
+	srand(config->seed);
+	workload = malloc(config->sentences * 128);
+	workload_lines = malloc(config->sentences * 128);
+	line_offsets = malloc(config->sentences * sizeof(size_t));
+	if (!workload || !workload_lines || !line_offsets) {
+		printf("Failed to allocate the workload!\n");
+		exit(-2);
+	}
+
+	for (i = 0; i < config->sentences; i++) {
+		char *line = workload + len;
+		int pick = rand() % 100;
+		int n = sprintf(line, "$GPRMC,%02ld%02ld%02ld.%02d,%c,%.7f,N,%.7f,W,%.3f,%.4f,%02d%02d%02d,%.2f,%c*",
+				seconds / 3600 % 24, seconds / 60 % 60, seconds % 60, rand() % 100,
+				pick < config->pct_void ? 'V' : 'A',
+				latitude, longitude, speed, heading,
+				(int)(seconds / 86400 % 28) + 1, 7, 13, 12.44, 'E');
+		unsigned char checksum = 0;
+		char *p;
+
+		for (p = line + 1; *p != '*'; p++) {
+			checksum ^= *p;
+		}
+		pick -= config->pct_void;
+		if (pick >= 0 && pick < config->pct_bad_checksum) {
+			checksum ^= 0x5a;
+		}
+		n += sprintf(line + n, "%02X", checksum);
+		pick -= config->pct_bad_checksum;
+		if (pick >= 0 && pick < config->pct_malformed) {
+			// truncate, as a receiver dropping bytes would
+			n = 10 + rand() % (n - 10);
+		}
+		line[n++] = '\n';
+
+		line_offsets[i] = len;
+		len += n;
+
+		seconds++;
+		latitude += 0.002 * ((double)rand() / RAND_MAX - 0.5);
+		longitude += 0.002 * ((double)rand() / RAND_MAX - 0.5);
+		speed = 3 + 2 * ((double)rand() / RAND_MAX);
+		heading = 360 * ((double)rand() / RAND_MAX);
+	}
+
+	workload_len = len;
+	num_lines = config->sentences;
+	memcpy(workload_lines, workload, len);
+	for (i = 0; i < num_lines; i++) {
+		size_t end = i + 1 < num_lines ? line_offsets[i + 1] : len;
+		workload_lines[end - 1] = '\0';
+	}
+}
+
+/**
+********************************************************************************
+* Check that the workload parses into the configured share of fixes, so that
+* the entry points are not timed on failures only
+********************************************************************************/
+static void check_workload(const bench_config_t *config)
+{
+	nmea_parse_stats_t stats;
+	long expected = config->sentences * (100 - config->pct_void - config->pct_bad_checksum - config->pct_malformed) / 100;
+	long fixes;
+
+	memset(&stats, 0, sizeof(stats));
+	nmea_fix_batch_parse(&fix_batch, workload, workload_len, &stats);
+	fixes = (long)stats.fixes;
+	if (labs(fixes - expected) > config->sentences / 50 + 50) {
+		printf("The workload has %ld fixes, %ld expected!\n", fixes, expected);
+		exit(-2);
+	}
+}
+
+static size_t run_parse_rmc(const bench_config_t *config)
+{
+	nmea_rmc_data_t data;
+	long i;
+
+	for (i = 0; i < num_lines; i++) {
+		parse_rmc(&data, workload_lines + line_offsets[i], 0);
+	}
+	return num_lines;
+}
+
+static void on_stream_sentence(const nmea_rmc_data_t *data, rmc_parse_result result, void *user_data)
+{
+	(*(size_t *)user_data)++;
+}
+
+static size_t run_stream(const bench_config_t *config)
+{
+	nmea_stream_t stream;
+	size_t count = 0, offset;
+
+	nmea_stream_init(&stream, on_stream_sentence, &count);
+	for (offset = 0; offset < workload_len; offset += BENCH_CHUNK_SIZE) {
+		size_t len = workload_len - offset < BENCH_CHUNK_SIZE ? workload_len - offset : BENCH_CHUNK_SIZE;
+		nmea_stream_feed(&stream, workload + offset, len);
+	}
+	return count;
+}
+
+static size_t run_buffer(const bench_config_t *config)
+{
+	static nmea_rmc_data_t fixes[BENCH_BATCH_SIZE];
+	static rmc_line_result_t results[BENCH_BATCH_SIZE];
+	size_t offset = 0, consumed, count = 0;
+
+	while (offset < workload_len) {
+		count += parse_rmc_buffer(workload + offset, workload_len - offset, fixes, results, BENCH_BATCH_SIZE, &consumed);
+		offset += consumed;
+	}
+	return count;
+}
+
+static size_t run_buffer_position(const bench_config_t *config)
+{
+	static nmea_rmc_data_t fixes[BENCH_BATCH_SIZE];
+	static rmc_line_result_t results[BENCH_BATCH_SIZE];
+	size_t offset = 0, consumed, count = 0;
+
+	while (offset < workload_len) {
+		count += parse_rmc_buffer_fields(workload + offset, workload_len - offset, RMC_FIELD_MASK_POSITION,
+				fixes, results, BENCH_BATCH_SIZE, &consumed);
+		offset += consumed;
+	}
+	return count;
+}
+
+static size_t run_fix_batch(const bench_config_t *config)
+{
+	nmea_parse_stats_t stats;
+
+	// the batch is kept across runs, so only the first one grows it
+	memset(&stats, 0, sizeof(stats));
+	fix_batch.count = 0;
+	nmea_fix_batch_parse(&fix_batch, workload, workload_len, &stats);
+	return stats.sentences;
+}
+
+static size_t run_geodesic(nmea_geo_kernel kernel)
+{
+	nmea_geo_segments_t segments;
+	nmea_parse_stats_t stats;
+	int i;
+
+	// the fixes of nmea_fix_batch_parse taken as one track, every output
+	if (!fix_batch.count) {
+		memset(&stats, 0, sizeof(stats));
+		nmea_fix_batch_parse(&fix_batch, workload, workload_len, &stats);
+	}
+	if (!nmea_geo_select(kernel) || fix_batch.count < 2) {
+		return 0;
+	}
+	for (i = 0; i < 4 && !geo_out[i]; i++) {
+		geo_out[i] = malloc(fix_batch.count * sizeof(double));
+	}
+	segments.distance = geo_out[0];
+	segments.odometer = geo_out[1];
+	segments.bearing = geo_out[2];
+	segments.speed = geo_out[3];
+	nmea_geo_track_e7(fix_batch.latitude_e7, fix_batch.longitude_e7, fix_batch.epoch_s, fix_batch.count, &segments);
+	nmea_geo_select(NMEA_GEO_KERNEL_AUTO);
+	return fix_batch.count - 1;
+}
+
+static size_t run_geodesic_scalar(const bench_config_t *config)
+{
+	return run_geodesic(NMEA_GEO_KERNEL_SCALAR);
+}
+
+static size_t run_geodesic_avx2(const bench_config_t *config)
+{
+	return run_geodesic(NMEA_GEO_KERNEL_AVX2);
+}
+
+static size_t run_parallel(const bench_config_t *config)
+{
+	nmea_parse_stats_t stats;
+
+	parse_rmc_parallel(workload, workload_len, config->threads, NULL, NULL, &stats);
+	return stats.sentences;
+}
+
+static int perf_open(uint32_t type, uint64_t config)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.inherit = 1;			// count the threads of parse_rmc_parallel too
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void counters_open(bench_counters_t *counters)
+{
+	counters->fd_cycles = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	counters->fd_branch_misses = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	counters->cycles = counters->branch_misses = -1;
+}
+
+static void counters_start(bench_counters_t *counters)
+{
+	if (counters->fd_cycles >= 0) {
+		ioctl(counters->fd_cycles, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counters->fd_cycles, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	if (counters->fd_branch_misses >= 0) {
+		ioctl(counters->fd_branch_misses, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counters->fd_branch_misses, PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+static void counters_stop(bench_counters_t *counters)
+{
+	long long value;
+
+	counters->cycles = counters->branch_misses = -1;
+	if (counters->fd_cycles >= 0) {
+		ioctl(counters->fd_cycles, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(counters->fd_cycles, &value, sizeof(value)) == sizeof(value)) {
+			counters->cycles = value;
+		}
+	}
+	if (counters->fd_branch_misses >= 0) {
+		ioctl(counters->fd_branch_misses, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(counters->fd_branch_misses, &value, sizeof(value)) == sizeof(value)) {
+			counters->branch_misses = value;
+		}
+	}
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
@@ -0,0 +1,610 @@
+/** @file
+ *  Provides implementation for the fleet index.
+ *
+ *  Every vehicle owns a slot of an open-addressed table, claimed with a
+ *  compare-and-swap on its first fix and kept for good, so looking a vehicle
+ *  up takes no lock. Grid cells of NMEA_FLEET_CELL_E7 are hashed onto a power
+ *  of two of buckets; a bucket lists the slots of the vehicles last seen in
+ *  its cells and has its own mutex, which guards the list and the positions
+ *  of the listed slots. An update locks the bucket the vehicle leaves and the
+ *  one it enters, lowest index first, so updates of distant vehicles never
+ *  contend.
+ *
+ *  A query locks every bucket its cells hash to, in the same order, before
+ *  it reads any of them. Each vehicle is then seen either before or after any
+ *  concurrent update, never halfway thru a move, so the result is a snapshot
+ *  of the covered area. The work is the number of cells covered plus the
+ *  vehicles listed in their buckets, not the size of the fleet; a query
+ *  covering more cells than there are buckets just locks all of them.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "nmea0183_fleet.h"
+#include "nmea0183_geodesic.h"
+#include "nmea0183_vehicle.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define CELLS_LATITUDE				((int64_t)1800000000 / NMEA_FLEET_CELL_E7)
+#define CELLS_LONGITUDE				((int64_t)3600000000LL / NMEA_FLEET_CELL_E7)
+#define MIN_BUCKETS					1024
+#define E7_PER_RADIAN				(1e7 * 180.0 / M_PI)
+
+/**
+ * Area of a query
+ */
+typedef struct fleet_area_t
+{
+	int32_t min_latitude_e7;
+	int32_t max_latitude_e7;
+	int64_t min_longitude_e7;					// west of max_longitude_e7 unless the
+	int64_t max_longitude_e7;					// area crosses the antimeridian
+	int32_t latitude_e7;						// center and radius of a radius query
+	int32_t longitude_e7;
+	double radius_m;							// < 0 for a box query
+} fleet_area_t;
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static uint32_t find_slot(nmea_fleet_t *fleet, uint32_t vehicle, int claim);
+static uint32_t bucket_of_cell(const nmea_fleet_t *fleet, int64_t cy, int64_t cx);
+static uint32_t bucket_of(const nmea_fleet_t *fleet, int32_t latitude_e7, int32_t longitude_e7);
+static int64_t cell_column(int64_t longitude_e7);
+static void lock_pair(nmea_fleet_t *fleet, uint32_t b1, uint32_t b2);
+static void unlock_pair(nmea_fleet_t *fleet, uint32_t b1, uint32_t b2);
+static void list_remove(nmea_fleet_t *fleet, uint32_t bucket, uint32_t slot);
+static void list_insert(nmea_fleet_t *fleet, uint32_t bucket, uint32_t slot);
+static size_t query_area(nmea_fleet_t *fleet, const fleet_area_t *area, nmea_fleet_position_t *positions,
+		size_t max_positions);
+static int in_area(const fleet_area_t *area, const nmea_fleet_position_t *position);
+static int compare_buckets(const void *a, const void *b);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Initialize an empty fleet index
+* @param  fleet: Index to initialize
+* @param  max_vehicles: Most vehicles held
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+int nmea_fleet_init(nmea_fleet_t *fleet, size_t max_vehicles)
+{
+	size_t slots = nmea_vehicle_slots(max_vehicles), buckets = MIN_BUCKETS, i;
+
+	while (buckets < max_vehicles) {
+		buckets <<= 1;
+	}
+	memset(fleet, 0, sizeof(*fleet));
+	fleet->slots = malloc(slots * sizeof(nmea_fleet_slot_t));
+	fleet->buckets = malloc(buckets * sizeof(nmea_fleet_bucket_t));
+	if (!fleet->slots || !fleet->buckets || slots > NMEA_FLEET_NO_SLOT) {
+		free(fleet->slots);
+		free(fleet->buckets);
+		fleet->slots = NULL;
+		fleet->buckets = NULL;
+		return -1;
+	}
+	fleet->slot_mask = slots - 1;
+	fleet->bucket_mask = buckets - 1;
+	for (i = 0; i < slots; i++) {
+		fleet->slots[i].key = 0;
+		fleet->slots[i].bucket = NMEA_FLEET_NO_BUCKET;
+		fleet->slots[i].prev = NMEA_FLEET_NO_SLOT;
+		fleet->slots[i].next = NMEA_FLEET_NO_SLOT;
+	}
+	for (i = 0; i < buckets; i++) {
+		pthread_mutex_init(&fleet->buckets[i].lock, NULL);
+		fleet->buckets[i].head = NMEA_FLEET_NO_SLOT;
+	}
+	return 0;
+}
+
+/**
+********************************************************************************
+* Free a fleet index
+* @param  fleet: Index to destroy
+********************************************************************************/
+void nmea_fleet_destroy(nmea_fleet_t *fleet)
+{
+	size_t i;
+
+	if (fleet->buckets) {
+		for (i = 0; i <= fleet->bucket_mask; i++) {
+			pthread_mutex_destroy(&fleet->buckets[i].lock);
+		}
+	}
+	free(fleet->slots);
+	free(fleet->buckets);
+	fleet->slots = NULL;
+	fleet->buckets = NULL;
+}
+
+/**
+********************************************************************************
+* Record the latest fix of a vehicle, from any thread. A fix older than the
+* one held is ignored, so fixes need RMC_FIELD_MASK_TIMESTAMP decoded.
+* @param  fleet: Index to update
+* @param  vehicle: Vehicle of the fix
+* @param  fix: Fix of the vehicle
+* @return 1 if the fix is now the latest, 0 if it is older, -1 if the index
+*         is full or the vehicle is above NMEA_VEHICLE_MAX
+********************************************************************************/
+int nmea_fleet_update(nmea_fleet_t *fleet, uint32_t vehicle, const nmea_rmc_data_t *fix)
+{
+	uint32_t slot = find_slot(fleet, vehicle, 1);
+	uint32_t to = bucket_of(fleet, fix->latitude_e7, fix->longitude_e7);
+	uint32_t from;
+
+	if (slot == NMEA_FLEET_NO_SLOT) {
+		return -1;
+	}
+	nmea_fleet_slot_t *s = &fleet->slots[slot];
+	for (;;) {
+		from = __atomic_load_n(&s->bucket, __ATOMIC_ACQUIRE);
+		if (from == NMEA_FLEET_NO_BUCKET) {
+			// first fix: of two racing updates, the one setting the bucket
+			// lists the slot and the other one retries as a move
+			lock_pair(fleet, to, to);
+			if (__atomic_compare_exchange_n(&s->bucket, &from, to, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				list_insert(fleet, to, slot);
+				from = to;
+				break;
+			}
+			unlock_pair(fleet, to, to);
+			continue;
+		}
+
+		// the bucket of a listed slot only changes under the lock of that bucket
+		lock_pair(fleet, from, to);
+		if (__atomic_load_n(&s->bucket, __ATOMIC_ACQUIRE) == from) {
+			if (fix->epoch_ms < s->position.epoch_ms) {
+				unlock_pair(fleet, from, to);
+				return 0;
+			}
+			if (from != to) {
+				list_remove(fleet, from, slot);
+				list_insert(fleet, to, slot);
+				__atomic_store_n(&s->bucket, to, __ATOMIC_RELEASE);
+			}
+			break;
+		}
+		unlock_pair(fleet, from, to);
+	}
+
+	// still under both locks, so no query sees the new bucket with the old position
+	s->position.vehicle = vehicle;
+	s->position.latitude_e7 = fix->latitude_e7;
+	s->position.longitude_e7 = fix->longitude_e7;
+	s->position.epoch_ms = fix->epoch_ms;
+	unlock_pair(fleet, from, to);
+	return 1;
+}
+
+/**
+********************************************************************************
+* Get the latest position of a vehicle
+* @param  fleet: Index to search
+* @param  vehicle: Vehicle to find
+* @param  position: Position of the vehicle
+* @return 1 if found, 0 if the vehicle has no fix, -1 if the vehicle is above
+*         NMEA_VEHICLE_MAX
+********************************************************************************/
+int nmea_fleet_get(nmea_fleet_t *fleet, uint32_t vehicle, nmea_fleet_position_t *position)
+{
+	uint32_t slot = find_slot(fleet, vehicle, 0);
+
+	if (!nmea_vehicle_key(vehicle)) {
+		return -1;
+	}
+	if (slot == NMEA_FLEET_NO_SLOT) {
+		return 0;
+	}
+	nmea_fleet_slot_t *s = &fleet->slots[slot];
+	for (;;) {
+		uint32_t bucket = __atomic_load_n(&s->bucket, __ATOMIC_ACQUIRE);
+
+		if (bucket == NMEA_FLEET_NO_BUCKET) {
+			return 0;
+		}
+		lock_pair(fleet, bucket, bucket);
+		if (__atomic_load_n(&s->bucket, __ATOMIC_ACQUIRE) == bucket) {
+			*position = s->position;
+			unlock_pair(fleet, bucket, bucket);
+			return 1;
+		}
+		unlock_pair(fleet, bucket, bucket);
+	}
+}
+
+/**
+********************************************************************************
+* Find the vehicles within a distance of a point
+* @param  fleet: Index to search
+* @param  latitude_e7: Latitude of the point, 1e-7 degree
+* @param  longitude_e7: Longitude of the point, 1e-7 degree
+* @param  radius_m: Great-circle distance in meters
+* @param  positions: Positions of the vehicles found, in no particular order
+* @param  max_positions: Capacity of positions
+* @return Number of vehicles found, only the first max_positions are given
+********************************************************************************/
+size_t nmea_fleet_query_radius(nmea_fleet_t *fleet, int32_t latitude_e7, int32_t longitude_e7, double radius_m,
+		nmea_fleet_position_t *positions, size_t max_positions)
+{
+	fleet_area_t area;
+	double distance = (radius_m < 0 ? 0 : radius_m) / NMEA_GEO_EARTH_RADIUS;
+	double dlat = distance * E7_PER_RADIAN;
+	double min_lat = latitude_e7 - dlat, max_lat = latitude_e7 + dlat;
+
+	area.latitude_e7 = latitude_e7;
+	area.longitude_e7 = longitude_e7;
+	area.radius_m = radius_m < 0 ? 0 : radius_m;
+	area.min_latitude_e7 = min_lat < -900000000 ? -900000000 : (int32_t)floor(min_lat);
+	area.max_latitude_e7 = max_lat > 900000000 ? 900000000 : (int32_t)ceil(max_lat);
+	area.min_longitude_e7 = -1800000000;
+	area.max_longitude_e7 = 1800000000;
+
+	// longitudes of the circle span asin(sin(d) / cos(latitude)) either way,
+	// all of them once it reaches a pole
+	double sin_dlon = sin(distance) / cos(latitude_e7 / E7_PER_RADIAN);
+	if (min_lat > -900000000 && max_lat < 900000000 && sin_dlon < 1) {
+		double dlon = asin(sin_dlon) * E7_PER_RADIAN;
+
+		area.min_longitude_e7 = (int64_t)floor(longitude_e7 - dlon);
+		area.max_longitude_e7 = (int64_t)ceil(longitude_e7 + dlon);
+	}
+	return query_area(fleet, &area, positions, max_positions);
+}
+
+/**
+********************************************************************************
+* Find the vehicles within a latitude/longitude box, bounds included
+* @param  fleet: Index to search
+* @param  min_latitude_e7: South bound, 1e-7 degree
+* @param  min_longitude_e7: West bound, 1e-7 degree
+* @param  max_latitude_e7: North bound, 1e-7 degree
+* @param  max_longitude_e7: East bound, 1e-7 degree; lower than
+*                           min_longitude_e7 for a box across the antimeridian
+* @param  positions: Positions of the vehicles found, in no particular order
+* @param  max_positions: Capacity of positions
+* @return Number of vehicles found, only the first max_positions are given
+********************************************************************************/
+size_t nmea_fleet_query_box(nmea_fleet_t *fleet, int32_t min_latitude_e7, int32_t min_longitude_e7,
+		int32_t max_latitude_e7, int32_t max_longitude_e7, nmea_fleet_position_t *positions, size_t max_positions)
+{
+	fleet_area_t area;
+
+	if (min_latitude_e7 > max_latitude_e7) {
+		return 0;
+	}
+	area.radius_m = -1;
+	area.min_latitude_e7 = min_latitude_e7;
+	area.max_latitude_e7 = max_latitude_e7;
+	area.min_longitude_e7 = min_longitude_e7;
+	area.max_longitude_e7 = max_longitude_e7;
+	return query_area(fleet, &area, positions, max_positions);
+}
+
+/**
+********************************************************************************
+* Great-circle distance between two points, by the haversine formula
+* @param  latitude1_e7: Latitude of the first point, 1e-7 degree
+* @param  longitude1_e7: Longitude of the first point, 1e-7 degree
+* @param  latitude2_e7: Latitude of the second point, 1e-7 degree
+* @param  longitude2_e7: Longitude of the second point, 1e-7 degree
+* @return Distance in meters
+********************************************************************************/
+double nmea_fleet_distance(int32_t latitude1_e7, int32_t longitude1_e7, int32_t latitude2_e7, int32_t longitude2_e7)
+{
+	double lat1 = latitude1_e7 / E7_PER_RADIAN, lat2 = latitude2_e7 / E7_PER_RADIAN;
+	double sin_dlat = sin((lat2 - lat1) / 2);
+	double sin_dlon = sin(((double)longitude2_e7 - longitude1_e7) / E7_PER_RADIAN / 2);
+	double h = sin_dlat * sin_dlat + cos(lat1) * cos(lat2) * sin_dlon * sin_dlon;
+
+	return 2 * NMEA_GEO_EARTH_RADIUS * asin(sqrt(fmin(h, 1.0)));
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Find the slot of a vehicle, lock-free
+* @param  fleet: Index to search
+* @param  vehicle: Vehicle to find
+* @param  claim: Claim a free slot for a vehicle not found
+* @return Index of the slot, NMEA_FLEET_NO_SLOT if not found, full or the
+*         vehicle is above NMEA_VEHICLE_MAX
+********************************************************************************/
+static uint32_t find_slot(nmea_fleet_t *fleet, uint32_t vehicle, int claim)
+{
+	uint32_t key = nmea_vehicle_key(vehicle);
+	size_t i = nmea_vehicle_home(key, fleet->slot_mask);
+	size_t probes;
+
+	if (!key) {
+		return NMEA_FLEET_NO_SLOT;
+	}
+	for (probes = 0; probes <= fleet->slot_mask; probes++, i = (i + 1) & fleet->slot_mask) {
+		uint32_t found = __atomic_load_n(&fleet->slots[i].key, __ATOMIC_ACQUIRE);
+
+		if (found == key) {
+			return (uint32_t)i;
+		}
+		if (found == 0) {
+			if (!claim) {
+				return NMEA_FLEET_NO_SLOT;
+			}
+			if (__atomic_compare_exchange_n(&fleet->slots[i].key, &found, key, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				__atomic_fetch_add(&fleet->vehicles, 1, __ATOMIC_RELAXED);
+				return (uint32_t)i;
+			}
+			if (found == key) {
+				return (uint32_t)i;
+			}
+		}
+	}
+	return NMEA_FLEET_NO_SLOT;
+}
+
+/**
+********************************************************************************
+* Bucket of a grid cell
+* @param  fleet: Index of the buckets
+* @param  cy: Cell row, from the south pole
+* @param  cx: Cell column, from the antimeridian
+* @return Index of the bucket
+********************************************************************************/
+static uint32_t bucket_of_cell(const nmea_fleet_t *fleet, int64_t cy, int64_t cx)
+{
+	uint64_t cell = (uint64_t)(cy * CELLS_LONGITUDE + cx);
+
+	return (uint32_t)(((cell * 0x9E3779B97F4A7C15ULL) >> 32) & fleet->bucket_mask);
+}
+
+/**
+********************************************************************************
+* Bucket of the grid cell holding a point
+* @param  fleet: Index of the buckets
+* @param  latitude_e7: Latitude of the point, 1e-7 degree
+* @param  longitude_e7: Longitude of the point, 1e-7 degree
+* @return Index of the bucket
+********************************************************************************/
+static uint32_t bucket_of(const nmea_fleet_t *fleet, int32_t latitude_e7, int32_t longitude_e7)
+{
+	int64_t cy = ((int64_t)latitude_e7 + 900000000) / NMEA_FLEET_CELL_E7;
+
+	return bucket_of_cell(fleet, cy < CELLS_LATITUDE ? cy : CELLS_LATITUDE - 1, cell_column(longitude_e7));
+}
+
+/**
+********************************************************************************
+* Grid column of a longitude, wrapped around the antimeridian
+* @param  longitude_e7: Longitude, 1e-7 degree, at most one turn off the range
+* @return Cell column, from the antimeridian
+********************************************************************************/
+static int64_t cell_column(int64_t longitude_e7)
+{
+	int64_t cx = (longitude_e7 + 1800000000 + 3600000000LL) / NMEA_FLEET_CELL_E7;
+
+	return cx % CELLS_LONGITUDE;
+}
+
+/**
+********************************************************************************
+* Lock two buckets, lowest index first, or one if they are the same
+* @param  fleet: Index of the buckets
+* @param  b1: One bucket
+* @param  b2: The other bucket
+********************************************************************************/
+static void lock_pair(nmea_fleet_t *fleet, uint32_t b1, uint32_t b2)
+{
+	pthread_mutex_lock(&fleet->buckets[b1 < b2 ? b1 : b2].lock);
+	if (b1 != b2) {
+		pthread_mutex_lock(&fleet->buckets[b1 < b2 ? b2 : b1].lock);
+	}
+}
+
+/**
+********************************************************************************
+* Unlock the buckets of lock_pair()
+* @param  fleet: Index of the buckets
+* @param  b1: One bucket
+* @param  b2: The other bucket
+********************************************************************************/
+static void unlock_pair(nmea_fleet_t *fleet, uint32_t b1, uint32_t b2)
+{
+	if (b1 != b2) {
+		pthread_mutex_unlock(&fleet->buckets[b1 < b2 ? b2 : b1].lock);
+	}
+	pthread_mutex_unlock(&fleet->buckets[b1 < b2 ? b1 : b2].lock);
+}
+
+/**
+********************************************************************************
+* Unlink a slot from the list of its bucket, which is locked
+* @param  fleet: Index of the bucket
+* @param  bucket: Bucket listing the slot
+* @param  slot: Slot to unlink
+********************************************************************************/
+static void list_remove(nmea_fleet_t *fleet, uint32_t bucket, uint32_t slot)
+{
+	nmea_fleet_slot_t *s = &fleet->slots[slot];
+
+	if (s->prev != NMEA_FLEET_NO_SLOT) {
+		fleet->slots[s->prev].next = s->next;
+	} else {
+		fleet->buckets[bucket].head = s->next;
+	}
+	if (s->next != NMEA_FLEET_NO_SLOT) {
+		fleet->slots[s->next].prev = s->prev;
+	}
+}
+
+/**
+********************************************************************************
+* Link a slot at the head of the list of a bucket, which is locked
+* @param  fleet: Index of the bucket
+* @param  bucket: Bucket to list the slot
+* @param  slot: Slot to link
+********************************************************************************/
+static void list_insert(nmea_fleet_t *fleet, uint32_t bucket, uint32_t slot)
+{
+	nmea_fleet_slot_t *s = &fleet->slots[slot];
+
+	s->prev = NMEA_FLEET_NO_SLOT;
+	s->next = fleet->buckets[bucket].head;
+	if (s->next != NMEA_FLEET_NO_SLOT) {
+		fleet->slots[s->next].prev = slot;
+	}
+	fleet->buckets[bucket].head = slot;
+}
+
+/**
+********************************************************************************
+* Lock the buckets of the cells of an area and collect the vehicles in it
+* @param  fleet: Index to search
+* @param  area: Area of the query
+* @param  positions: Positions of the vehicles found
+* @param  max_positions: Capacity of positions
+* @return Number of vehicles found
+********************************************************************************/
+static size_t query_area(nmea_fleet_t *fleet, const fleet_area_t *area, nmea_fleet_position_t *positions,
+		size_t max_positions)
+{
+	int64_t min_cy = ((int64_t)area->min_latitude_e7 + 900000000) / NMEA_FLEET_CELL_E7;
+	int64_t max_cy = ((int64_t)area->max_latitude_e7 + 900000000) / NMEA_FLEET_CELL_E7;
+	int64_t min_cx = cell_column(area->min_longitude_e7);
+	int64_t num_cx = (cell_column(area->max_longitude_e7) - min_cx + CELLS_LONGITUDE) % CELLS_LONGITUDE + 1;
+	int64_t cy, cx;
+	size_t num_buckets = fleet->bucket_mask + 1, num_locked = 0, found = 0, i;
+	uint32_t *locked, slot;
+
+	min_cy = min_cy > 0 ? min_cy : 0;
+	max_cy = max_cy < CELLS_LATITUDE ? max_cy : CELLS_LATITUDE - 1;
+	if (area->max_longitude_e7 - area->min_longitude_e7 >= 3600000000LL - NMEA_FLEET_CELL_E7) {
+		num_cx = CELLS_LONGITUDE;
+	}
+
+	// the buckets of every cell, or all of them when that is fewer
+	int64_t num_cells = (max_cy - min_cy + 1) * num_cx;
+	locked = malloc((num_cells < (int64_t)num_buckets ? (size_t)num_cells : num_buckets) * sizeof(uint32_t));
+	if (!locked) {
+		return 0;
+	}
+	if (num_cells < (int64_t)num_buckets) {
+		for (cy = min_cy; cy <= max_cy; cy++) {
+			for (cx = 0; cx < num_cx; cx++) {
+				locked[num_locked++] = bucket_of_cell(fleet, cy, (min_cx + cx) % CELLS_LONGITUDE);
+			}
+		}
+		qsort(locked, num_locked, sizeof(uint32_t), compare_buckets);
+		for (i = 1, num_cells = num_locked, num_locked = 1; i < (size_t)num_cells; i++) {
+			if (locked[i] != locked[num_locked - 1]) {
+				locked[num_locked++] = locked[i];
+			}
+		}
+	} else {
+		for (num_locked = 0; num_locked < num_buckets; num_locked++) {
+			locked[num_locked] = (uint32_t)num_locked;
+		}
+	}
+
+	for (i = 0; i < num_locked; i++) {
+		pthread_mutex_lock(&fleet->buckets[locked[i]].lock);
+	}
+	for (i = 0; i < num_locked; i++) {
+		for (slot = fleet->buckets[locked[i]].head; slot != NMEA_FLEET_NO_SLOT; slot = fleet->slots[slot].next) {
+			if (in_area(area, &fleet->slots[slot].position)) {
+				if (found < max_positions) {
+					positions[found] = fleet->slots[slot].position;
+				}
+				found++;
+			}
+		}
+	}
+	for (i = num_locked; i-- > 0;) {
+		pthread_mutex_unlock(&fleet->buckets[locked[i]].lock);
+	}
+	free(locked);
+
+	return found;
+}
+
+/**
+********************************************************************************
+* Check a position against the area of a query; buckets also list vehicles
+* of other cells hashed to them
+* @param  area: Area of the query
+* @param  position: Position to check
+* @return 1 if the position is in the area, 0 otherwise
+********************************************************************************/
+static int in_area(const fleet_area_t *area, const nmea_fleet_position_t *position)
+{
+	if (area->radius_m >= 0) {
+		return nmea_fleet_distance(area->latitude_e7, area->longitude_e7,
+				position->latitude_e7, position->longitude_e7) <= area->radius_m;
+	}
+	if (position->latitude_e7 < area->min_latitude_e7 || position->latitude_e7 > area->max_latitude_e7) {
+		return 0;
+	}
+	if (area->min_longitude_e7 <= area->max_longitude_e7) {
+		return position->longitude_e7 >= area->min_longitude_e7 && position->longitude_e7 <= area->max_longitude_e7;
+	}
+	return position->longitude_e7 >= area->min_longitude_e7 || position->longitude_e7 <= area->max_longitude_e7;
+}
+
+/**
+********************************************************************************
+* qsort() comparison of bucket indices
+* @param  a: One bucket index
+* @param  b: The other bucket index
+* @return <0, 0 or >0 as a is lower, equal or greater than b
+********************************************************************************/
+static int compare_buckets(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
@@ -0,0 +1,113 @@
+/** @file
+ *  Provides prototypes for the fleet index: the latest fix of every vehicle,
+ *  kept in grid cells for radius and bounding-box queries.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_FLEET_H__
+#define __NMEA0183_FLEET_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "nmea0183_parser.h"
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_FLEET_CELL_E7			100000			/**< Side of a grid cell, 1e-7 degree (0.01 degree). */
+
+/**
+ * Latest position of a vehicle, as returned by the queries
+ */
+typedef struct nmea_fleet_position_t
+{
+	uint32_t vehicle;
+	int32_t latitude_e7;
+	int32_t longitude_e7;
+	int64_t epoch_ms;							/**< Time of the fix. */
+} nmea_fleet_position_t;
+
+/**
+ * Slot of a vehicle. The vehicle lists of the buckets link slot indices.
+ */
+typedef struct nmea_fleet_slot_t
+{
+	uint32_t key;								/**< Vehicle + 1, 0 for a free slot. */
+	uint32_t bucket;							/**< Bucket listing the vehicle, or NMEA_FLEET_NO_BUCKET. */
+	uint32_t prev;								/**< Neighbours in the bucket list, or NMEA_FLEET_NO_SLOT. */
+	uint32_t next;
+	nmea_fleet_position_t position;
+} nmea_fleet_slot_t;
+
+#define NMEA_FLEET_NO_BUCKET		UINT32_MAX
+#define NMEA_FLEET_NO_SLOT			UINT32_MAX
+
+/**
+ * Grid cells hashed onto a power of two of buckets, each with its own lock
+ */
+typedef struct nmea_fleet_bucket_t
+{
+	pthread_mutex_t lock;
+	uint32_t head;								/**< First slot listed, or NMEA_FLEET_NO_SLOT. */
+} nmea_fleet_bucket_t;
+
+/**
+ * Fleet index
+ */
+typedef struct nmea_fleet_t
+{
+	nmea_fleet_slot_t *slots;					/**< Open-addressed by vehicle, never removed. */
+	size_t slot_mask;
+	nmea_fleet_bucket_t *buckets;
+	size_t bucket_mask;
+	size_t vehicles;							/**< Slots in use. */
+} nmea_fleet_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_fleet_init(nmea_fleet_t *fleet, size_t max_vehicles);
+void nmea_fleet_destroy(nmea_fleet_t *fleet);
+int nmea_fleet_update(nmea_fleet_t *fleet, uint32_t vehicle, const nmea_rmc_data_t *fix);
+int nmea_fleet_get(nmea_fleet_t *fleet, uint32_t vehicle, nmea_fleet_position_t *position);
+size_t nmea_fleet_query_radius(nmea_fleet_t *fleet, int32_t latitude_e7, int32_t longitude_e7, double radius_m,
+		nmea_fleet_position_t *positions, size_t max_positions);
+size_t nmea_fleet_query_box(nmea_fleet_t *fleet, int32_t min_latitude_e7, int32_t min_longitude_e7,
+		int32_t max_latitude_e7, int32_t max_longitude_e7, nmea_fleet_position_t *positions, size_t max_positions);
+double nmea_fleet_distance(int32_t latitude1_e7, int32_t longitude1_e7, int32_t latitude2_e7, int32_t longitude2_e7);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
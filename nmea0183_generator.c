@@ -0,0 +1,593 @@
+/** @file
+ *  Provides implementation for the fleet traffic generator.
+ *
+ *  Each vehicle drives in the area around NMEA_GENERATOR_LATITUDE_E7 and
+ *  NMEA_GENERATOR_LONGITUDE_E7: straight on at a speed easing to its target,
+ *  with a turn now and then, a stop of a few minutes now and then, and a
+ *  bounce off the sides of the area. A sentence reports the fix of a vehicle
+ *  and moves it on by NMEA_GENERATOR_INTERVAL_MS.
+ *
+ *  The sentences are formatted by hand from integers, with the checksum
+ *  folded 8 bytes at a time, and the randomness comes from two xorshift64*
+ *  draws per sentence, so that a generator per thread writes hundreds of
+ *  MB/s. Nothing is shared between generators.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "nmea0183_generator.h"
+#include "nmea0183_geodesic.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define METERS_PER_E7				(NMEA_GEO_EARTH_RADIUS * M_PI / 180.0 / 1e7)
+#define MS_PER_DAY					86400000LL
+#define KNOTS_PER_MPS				(3600.0 / 1852.0)
+#define KMH_PER_MPS					3.6
+
+/**
+ * Sentence types other than RMC, picked evenly
+ */
+typedef enum {
+	OTHER_GGA = 0,
+	OTHER_VTG,
+	OTHER_GLL,
+	OTHER_TYPES
+} other_type;
+
+/**
+ * Ways to corrupt a sentence, picked evenly
+ */
+typedef enum {
+	CORRUPT_CHECKSUM = 0,						/**< Checksum off by some bits. */
+	CORRUPT_FIELD,								/**< First field mangled, with a good checksum. */
+	CORRUPT_TRUNCATED,							/**< Cut short before the checksum. */
+	CORRUPT_KINDS
+} corrupt_kind;
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static uint64_t next_random(nmea_generator_t *gen);
+static void drive(nmea_generator_t *gen, nmea_generator_vehicle_t *vehicle);
+static void set_heading(nmea_generator_vehicle_t *vehicle, int heading_d10);
+static char *put_digits(char *p, uint32_t value, int width);
+static char *put_number(char *p, uint32_t value);
+static char *put_time(char *p, int64_t epoch_ms);
+static char *put_date(nmea_generator_t *gen, char *p, int64_t epoch_ms);
+static char *put_coordinate(char *p, int32_t value_e7, int degree_digits, char positive, char negative);
+static char *put_decimal(char *p, double value);
+static size_t finish(char *buf, char *p, unsigned char flip);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/**
+ * Turns of a move in 0.1 degree, for the 16 lowest of 256 draws: a vehicle
+ * drifts a little every 30 moves and turns a corner every 128
+ */
+static const int16_t turns[16] = {
+	20, -20, 20, -20, 20, -20, 50, -50, 50, -50, 100, -100, 900, -900, 900, -900
+};
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Initialize a generator, with vehicles spread over the area and their first
+* fixes spread over one interval from start_ms. No sentence is lost,
+* corrupted or of another type until nmea_generator_set_rates().
+* @param  gen: Generator to initialize
+* @param  vehicles: Number of vehicles, at least 1
+* @param  start_ms: Time of the first fix, UTC milliseconds since 1970-01-01
+* @param  seed: Seed of the tracks, give each generator its own
+* @return 0 on success, -1 if there is no vehicle or memory could not be allocated
+********************************************************************************/
+int nmea_generator_init(nmea_generator_t *gen, size_t vehicles, int64_t start_ms, uint64_t seed)
+{
+	size_t i;
+
+	memset(gen, 0, sizeof(*gen));
+	if (!vehicles) {
+		return -1;
+	}
+	gen->vehicles = calloc(vehicles, sizeof(nmea_generator_vehicle_t));
+	if (!gen->vehicles) {
+		return -1;
+	}
+	gen->num_vehicles = vehicles;
+	gen->state = (seed + 1) * 0x9E3779B97F4A7C15ULL;
+	if (!gen->state) {
+		gen->state = 1;
+	}
+	gen->date_day = -1;
+
+	for (i = 0; i < vehicles; i++) {
+		nmea_generator_vehicle_t *vehicle = &gen->vehicles[i];
+		uint64_t r = next_random(gen);
+
+		vehicle->epoch_ms = start_ms + (int64_t)(i * NMEA_GENERATOR_INTERVAL_MS / vehicles);
+		vehicle->latitude_e7 = NMEA_GENERATOR_LATITUDE_E7 +
+				(double)(r % (2 * NMEA_GENERATOR_SPREAD_E7 + 1)) - NMEA_GENERATOR_SPREAD_E7;
+		r = next_random(gen);
+		vehicle->longitude_e7 = NMEA_GENERATOR_LONGITUDE_E7 +
+				(double)(r % (2 * NMEA_GENERATOR_SPREAD_E7 + 1)) - NMEA_GENERATOR_SPREAD_E7;
+		vehicle->meters_per_e7_x = METERS_PER_E7 * cos(vehicle->latitude_e7 * (M_PI / 180.0 / 1e7));
+		vehicle->target_mps = vehicle->speed_mps = 5 + (r >> 32) % 26;
+		set_heading(vehicle, (r >> 40) % 3600);
+	}
+
+	return 0;
+}
+
+/**
+********************************************************************************
+* Free the vehicles of a generator
+* @param  gen: Generator to destroy
+********************************************************************************/
+void nmea_generator_destroy(nmea_generator_t *gen)
+{
+	free(gen->vehicles);
+	gen->vehicles = NULL;
+	gen->num_vehicles = 0;
+}
+
+/**
+********************************************************************************
+* Set the shares of the sentences generated from now on
+* @param  gen: Generator
+* @param  pct_void: Percentage of sentences without a fix (RMC and GLL status
+*                   'V', GGA quality 0, VTG mode 'N')
+* @param  pct_corrupt: Percentage of sentences with a bad checksum, a mangled
+*                      field or cut short
+* @param  pct_other: Percentage of GGA, VTG and GLL sentences, the rest are RMC
+********************************************************************************/
+void nmea_generator_set_rates(nmea_generator_t *gen, unsigned int pct_void, unsigned int pct_corrupt,
+		unsigned int pct_other)
+{
+	gen->pct_void = pct_void;
+	gen->pct_corrupt = pct_corrupt;
+	gen->pct_other = pct_other;
+}
+
+/**
+********************************************************************************
+* Generate the next sentence of a vehicle
+* @param  gen: Generator
+* @param  vehicle: Index of the vehicle, below the number of vehicles
+* @param  buf: Where the sentence goes, with CR LF and no NUL, room for
+*              NMEA_GENERATOR_MAX_SENTENCE bytes
+* @return Length of the sentence
+********************************************************************************/
+size_t nmea_generator_sentence(nmea_generator_t *gen, size_t vehicle, char *buf)
+{
+	nmea_generator_vehicle_t *state = &gen->vehicles[vehicle];
+	uint64_t r = next_random(gen);
+	int fix = (r & 0xffff) % 100 >= gen->pct_void;
+	int corrupt = (r >> 16 & 0xffff) % 100 < gen->pct_corrupt;
+	int other = (r >> 32 & 0xffff) % 100 < gen->pct_other;
+	int32_t latitude_e7 = (int32_t)lrint(state->latitude_e7);
+	int32_t longitude_e7 = (int32_t)lrint(state->longitude_e7);
+	unsigned char flip = 0;
+	char *p = buf;
+	size_t len;
+
+	if (!other) {
+		memcpy(p, "$GPRMC,", 7);
+		p = put_time(p + 7, state->epoch_ms);
+		if (fix) {
+			memcpy(p, "A,", 2);
+			p = put_coordinate(p + 2, latitude_e7, 2, 'N', 'S');
+			p = put_coordinate(p, longitude_e7, 3, 'E', 'W');
+			p = put_decimal(p, state->speed_mps * KNOTS_PER_MPS);
+			p = put_digits(p, state->heading_d10 / 10, 3);
+			*p++ = '.';
+			p = put_digits(p, state->heading_d10 % 10, 1);
+			*p++ = ',';
+			p = put_date(gen, p, state->epoch_ms);
+			memcpy(p, "003.1,E", 7);
+			p += 7;
+		} else {
+			memcpy(p, "V,,,,,,,", 8);
+			p = put_date(gen, p + 8, state->epoch_ms);
+			*p++ = ',';
+		}
+	} else switch ((r >> 48 & 0xff) % OTHER_TYPES) {
+		case OTHER_GGA: {
+			unsigned int satellites = 6 + (r >> 56) % 7;
+
+			memcpy(p, "$GPGGA,", 7);
+			p = put_time(p + 7, state->epoch_ms);
+			if (fix) {
+				p = put_coordinate(p, latitude_e7, 2, 'N', 'S');
+				p = put_coordinate(p, longitude_e7, 3, 'E', 'W');
+				memcpy(p, "1,", 2);
+				p = put_digits(p + 2, satellites, 2);
+				memcpy(p, ",0.", 3);
+				p = put_digits(p + 3, 6 + (12 - satellites) / 2, 1);
+				*p++ = ',';
+				// terrain from the position, 150 to 250 m
+				p = put_decimal(p, 150 + (double)((uint32_t)(latitude_e7 ^ longitude_e7) / 1000 % 1000) / 10);
+				memcpy(p, "M,44.2,M,,", 10);
+				p += 10;
+			} else {
+				memcpy(p, ",,,,0,00,99.9,,M,,M,,", 21);
+				p += 21;
+			}
+			break;
+		}
+		case OTHER_VTG:
+			memcpy(p, "$GPVTG,", 7);
+			p += 7;
+			if (fix) {
+				p = put_digits(p, state->heading_d10 / 10, 3);
+				*p++ = '.';
+				p = put_digits(p, state->heading_d10 % 10, 1);
+				memcpy(p, ",T,,M,", 6);
+				p = put_decimal(p + 6, state->speed_mps * KNOTS_PER_MPS);
+				memcpy(p, "N,", 2);
+				p = put_decimal(p + 2, state->speed_mps * KMH_PER_MPS);
+				memcpy(p, "K,A", 3);
+				p += 3;
+			} else {
+				memcpy(p, ",T,,M,,N,,K,N", 13);
+				p += 13;
+			}
+			break;
+		default:
+			memcpy(p, "$GPGLL,", 7);
+			p += 7;
+			if (fix) {
+				p = put_coordinate(p, latitude_e7, 2, 'N', 'S');
+				p = put_coordinate(p, longitude_e7, 3, 'E', 'W');
+			} else {
+				memcpy(p, ",,,,", 4);
+				p += 4;
+			}
+			p = put_time(p, state->epoch_ms);
+			memcpy(p, fix ? "A,A" : "V,N", 3);
+			p += 3;
+			break;
+	}
+
+	if (corrupt) {
+		uint64_t c = next_random(gen);
+
+		gen->stats.corrupted++;
+		switch (c % CORRUPT_KINDS) {
+			case CORRUPT_CHECKSUM:
+				flip = 1 + (c >> 8) % 255;
+				break;
+			case CORRUPT_FIELD:
+				buf[7] = 'X';
+				break;
+			default:
+				// the address and at least a byte of the first field, no checksum
+				p = buf + 8 + (c >> 8) % (p - buf - 8);
+				p[0] = '\r';
+				p[1] = '\n';
+				len = p + 2 - buf;
+				goto generated;
+		}
+	} else if (!fix) {
+		gen->stats.no_fixes++;
+	}
+	len = finish(buf, p, flip);
+
+generated:
+	drive(gen, state);
+	gen->stats.sentences++;
+	gen->stats.bytes += len;
+
+	return len;
+}
+
+/**
+********************************************************************************
+* Fill a buffer with whole sentences, one vehicle after the other
+* @param  gen: Generator
+* @param  buf: Buffer to fill
+* @param  len: Size of the buffer
+* @param  max_sentences: Most sentences to generate
+* @return Bytes of sentences written, len less under NMEA_GENERATOR_MAX_SENTENCE
+*         unless max_sentences are
+********************************************************************************/
+size_t nmea_generator_fill(nmea_generator_t *gen, char *buf, size_t len, size_t max_sentences)
+{
+	size_t used = 0;
+
+	while (max_sentences-- && len - used >= NMEA_GENERATOR_MAX_SENTENCE) {
+		used += nmea_generator_sentence(gen, gen->next_vehicle, buf + used);
+		if (++gen->next_vehicle == gen->num_vehicles) {
+			gen->next_vehicle = 0;
+		}
+	}
+	return used;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Next draw of the xorshift64* generator
+********************************************************************************/
+static uint64_t next_random(nmea_generator_t *gen)
+{
+	uint64_t x = gen->state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	gen->state = x;
+
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+********************************************************************************
+* Move a vehicle on to its next fix
+* @param  gen: Generator
+* @param  vehicle: Vehicle to move
+********************************************************************************/
+static void drive(nmea_generator_t *gen, nmea_generator_vehicle_t *vehicle)
+{
+	uint64_t r = next_random(gen);
+	double meters, dy, dx;
+	int turn = (r >> 16) & 0xff;
+
+	vehicle->epoch_ms += NMEA_GENERATOR_INTERVAL_MS;
+	if (vehicle->parked) {
+		vehicle->parked--;
+		return;
+	}
+	if ((r & 0x3ff) < 2) {
+		// a stop of half a minute to five minutes
+		vehicle->parked = 30 + (r >> 24) % 270;
+		vehicle->speed_mps = 0;
+		return;
+	}
+	if (((r >> 10) & 0x3f) == 0) {
+		vehicle->target_mps = 5 + (r >> 24) % 26;
+	}
+	if (turn < 16) {
+		set_heading(vehicle, vehicle->heading_d10 + turns[turn]);
+	}
+	vehicle->speed_mps += (vehicle->target_mps - vehicle->speed_mps) * 0.25;
+
+	meters = vehicle->speed_mps * (NMEA_GENERATOR_INTERVAL_MS / 1000.0);
+	dy = vehicle->north * meters / METERS_PER_E7;
+	dx = vehicle->east * meters / vehicle->meters_per_e7_x;
+	vehicle->latitude_e7 += dy;
+	vehicle->longitude_e7 += dx;
+
+	// bounce off the sides of the area
+	if ((vehicle->latitude_e7 > NMEA_GENERATOR_LATITUDE_E7 + NMEA_GENERATOR_SPREAD_E7 && dy > 0) ||
+			(vehicle->latitude_e7 < NMEA_GENERATOR_LATITUDE_E7 - NMEA_GENERATOR_SPREAD_E7 && dy < 0)) {
+		set_heading(vehicle, 1800 - vehicle->heading_d10);
+	}
+	if ((vehicle->longitude_e7 > NMEA_GENERATOR_LONGITUDE_E7 + NMEA_GENERATOR_SPREAD_E7 && dx > 0) ||
+			(vehicle->longitude_e7 < NMEA_GENERATOR_LONGITUDE_E7 - NMEA_GENERATOR_SPREAD_E7 && dx < 0)) {
+		set_heading(vehicle, -vehicle->heading_d10);
+	}
+	if (!(++vehicle->fixes & 0x3f)) {
+		vehicle->meters_per_e7_x = METERS_PER_E7 * cos(vehicle->latitude_e7 * (M_PI / 180.0 / 1e7));
+	}
+}
+
+/**
+********************************************************************************
+* Point a vehicle to a heading
+* @param  vehicle: Vehicle to turn
+* @param  heading_d10: Heading, 0.1 degree clockwise from north, any turn
+********************************************************************************/
+static void set_heading(nmea_generator_vehicle_t *vehicle, int heading_d10)
+{
+	double angle;
+
+	heading_d10 %= 3600;
+	if (heading_d10 < 0) {
+		heading_d10 += 3600;
+	}
+	vehicle->heading_d10 = heading_d10;
+	angle = heading_d10 * (M_PI / 1800.0);
+	vehicle->east = sin(angle);
+	vehicle->north = cos(angle);
+}
+
+/**
+********************************************************************************
+* Write the digits of a number, with leading zeros
+* @param  p: Where the digits go
+* @param  value: Number, below 10 ^ width
+* @param  width: Number of digits
+* @return One past the last digit
+********************************************************************************/
+static char *put_digits(char *p, uint32_t value, int width)
+{
+	char *end = p + width;
+
+	while (end > p) {
+		*--end = '0' + value % 10;
+		value /= 10;
+	}
+	return p + width;
+}
+
+/**
+********************************************************************************
+* Write the digits of a number, without leading zeros
+********************************************************************************/
+static char *put_number(char *p, uint32_t value)
+{
+	uint32_t rest = value;
+	int width = 1;
+
+	while (rest >= 10) {
+		rest /= 10;
+		width++;
+	}
+	return put_digits(p, value, width);
+}
+
+/**
+********************************************************************************
+* Write a time field, hhmmss.ss, and its comma
+********************************************************************************/
+static char *put_time(char *p, int64_t epoch_ms)
+{
+	uint32_t ms = (uint32_t)(epoch_ms % MS_PER_DAY);
+
+	p = put_digits(p, ms / 3600000, 2);
+	p = put_digits(p, ms / 60000 % 60, 2);
+	p = put_digits(p, ms / 1000 % 60, 2);
+	*p++ = '.';
+	p = put_digits(p, ms % 1000 / 10, 2);
+	*p++ = ',';
+
+	return p;
+}
+
+/**
+********************************************************************************
+* Write a date field, ddmmyy, and its comma. Vehicles are at most one
+* interval apart, so the date of the day is kept for the next sentences.
+********************************************************************************/
+static char *put_date(nmea_generator_t *gen, char *p, int64_t epoch_ms)
+{
+	int64_t day = epoch_ms / MS_PER_DAY;
+
+	if (day != gen->date_day) {
+		time_t seconds = (time_t)(day * 86400);
+		struct tm tm;
+
+		gmtime_r(&seconds, &tm);
+		put_digits(gen->date, tm.tm_mday, 2);
+		put_digits(gen->date + 2, tm.tm_mon + 1, 2);
+		put_digits(gen->date + 4, tm.tm_year % 100, 2);
+		gen->date_day = day;
+	}
+	memcpy(p, gen->date, 6);
+	p[6] = ',';
+
+	return p + 7;
+}
+
+/**
+********************************************************************************
+* Write a latitude or longitude, (d)ddmm.mmmmm, and its hemisphere
+* @param  p: Where the fields go
+* @param  value_e7: Coordinate in 1e-7 degree
+* @param  degree_digits: 2 for a latitude, 3 for a longitude
+* @param  positive: Hemisphere of positive values
+* @param  negative: Hemisphere of negative values
+* @return One past the comma after the hemisphere
+********************************************************************************/
+static char *put_coordinate(char *p, int32_t value_e7, int degree_digits, char positive, char negative)
+{
+	uint32_t magnitude = value_e7 < 0 ? -(uint32_t)value_e7 : (uint32_t)value_e7;
+	// 1e-7 degree is 6e-6 minute, so the fraction of a degree * 3 / 5 is in 1e-5 minute
+	uint32_t minutes_e5 = magnitude % 10000000 * 3 / 5;
+
+	p = put_digits(p, magnitude / 10000000, degree_digits);
+	p = put_digits(p, minutes_e5 / 100000, 2);
+	*p++ = '.';
+	p = put_digits(p, minutes_e5 % 100000, 5);
+	p[0] = ',';
+	p[1] = value_e7 < 0 ? negative : positive;
+	p[2] = ',';
+
+	return p + 3;
+}
+
+/**
+********************************************************************************
+* Write a non-negative number with 3 decimals, and its comma
+********************************************************************************/
+static char *put_decimal(char *p, double value)
+{
+	uint32_t value_e3 = (uint32_t)(value * 1000 + 0.5);
+
+	p = put_number(p, value_e3 / 1000);
+	*p++ = '.';
+	p = put_digits(p, value_e3 % 1000, 3);
+	*p++ = ',';
+
+	return p;
+}
+
+/**
+********************************************************************************
+* Append the checksum and CR LF to a sentence
+* @param  buf: Pointer to the '$' starting the sentence
+* @param  p: One past the last field
+* @param  flip: Bits to flip in the checksum, 0 for a good one
+* @return Length of the sentence
+********************************************************************************/
+static size_t finish(char *buf, char *p, unsigned char flip)
+{
+	const char *q = buf + 1;
+	uint64_t folded = 0;
+	unsigned char checksum;
+
+	for (; p - q >= 8; q += 8) {
+		uint64_t word;
+
+		memcpy(&word, q, 8);
+		folded ^= word;
+	}
+	folded ^= folded >> 32;
+	folded ^= folded >> 16;
+	folded ^= folded >> 8;
+	checksum = (unsigned char)folded ^ flip;
+	for (; q < p; q++) {
+		checksum ^= *q;
+	}
+
+	p[0] = '*';
+	p[1] = hex_digits[checksum >> 4];
+	p[2] = hex_digits[checksum & 0xf];
+	p[3] = '\r';
+	p[4] = '\n';
+
+	return p + 5 - buf;
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
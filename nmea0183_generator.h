@@ -0,0 +1,114 @@
+/** @file
+ *  Provides prototypes for the fleet traffic generator: the sentences of
+ *  many vehicles driving their own tracks, with a share of fixes lost, of
+ *  other sentence types and of corrupted sentences.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_GENERATOR_H__
+#define __NMEA0183_GENERATOR_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_GENERATOR_MAX_SENTENCE		96			/**< Room for the longest sentence generated, with CR LF. */
+#define NMEA_GENERATOR_INTERVAL_MS		1000		/**< Time between the fixes of a vehicle. */
+#define NMEA_GENERATOR_LATITUDE_E7		482299053	/**< Center of the area the vehicles drive in. */
+#define NMEA_GENERATOR_LONGITUDE_E7		163594883
+#define NMEA_GENERATOR_SPREAD_E7		5000000		/**< Half side of that area, 1e-7 degree. */
+
+/**
+ * Vehicle driven by the generator: straight lines at a speed easing to a
+ * target, turns now and then, and stops
+ */
+typedef struct nmea_generator_vehicle_t
+{
+	int64_t epoch_ms;							/**< Time of the next fix. */
+	double latitude_e7;
+	double longitude_e7;
+	double east;								/**< Unit vector of the heading. */
+	double north;
+	double meters_per_e7_x;						/**< At the latitude of the last update. */
+	double speed_mps;
+	double target_mps;
+	uint32_t parked;							/**< Fixes left before driving off. */
+	uint16_t heading_d10;						/**< Heading, 0.1 degree clockwise from north. */
+	uint16_t fixes;
+} nmea_generator_vehicle_t;
+
+/**
+ * Sentences generated since initialization. The uncorrupted ones parse
+ * with a fix, except no_fixes of them.
+ */
+typedef struct nmea_generator_stats_t
+{
+	uint64_t sentences;
+	uint64_t bytes;
+	uint64_t no_fixes;							/**< Uncorrupted sentences without a fix. */
+	uint64_t corrupted;							/**< Sentences that fail to parse. */
+} nmea_generator_stats_t;
+
+/**
+ * Generator of the sentences of a set of vehicles, from one thread at a time.
+ * Threads generating together each have their own generator and vehicles.
+ */
+typedef struct nmea_generator_t
+{
+	uint64_t state;								/**< xorshift64* state, never 0. */
+	nmea_generator_vehicle_t *vehicles;
+	size_t num_vehicles;
+	size_t next_vehicle;						/**< Of nmea_generator_fill(). */
+	unsigned int pct_void;
+	unsigned int pct_corrupt;
+	unsigned int pct_other;
+	int64_t date_day;							/**< Day of date, -1 before the first sentence. */
+	char date[6];								/**< ddmmyy of date_day. */
+	nmea_generator_stats_t stats;
+} nmea_generator_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_generator_init(nmea_generator_t *gen, size_t vehicles, int64_t start_ms, uint64_t seed);
+void nmea_generator_destroy(nmea_generator_t *gen);
+void nmea_generator_set_rates(nmea_generator_t *gen, unsigned int pct_void, unsigned int pct_corrupt,
+		unsigned int pct_other);
+size_t nmea_generator_sentence(nmea_generator_t *gen, size_t vehicle, char *buf);
+size_t nmea_generator_fill(nmea_generator_t *gen, char *buf, size_t len, size_t max_sentences);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
@@ -0,0 +1,481 @@
+/** @file
+ *  Provides implementation for the batch geodesic kernels.
+ *
+ *  Every segment takes the haversine of its two fixes,
+ *  h = sin^2(dlat / 2) + cos(lat1) cos(lat2) sin^2(dlon / 2), and turns it
+ *  into a central angle with 2 atan2(sqrt(h), sqrt(1 - h)), which keeps its
+ *  accuracy at both ends of the range, unlike asin or acos. The bearing is
+ *  atan2 of the usual east and north components.
+ *
+ *  The scalar kernel calls libm. The AVX2 kernel does 4 segments per step
+ *  with its own sine, cosine and arctangent: the argument is first reduced,
+ *  to [-pi/4, pi/4] by quarter turns for sine and cosine, and to
+ *  [-tan(pi/16), tan(pi/16)] by the pi/4 offset and a half-angle step for
+ *  the arctangent, where a Taylor series of 8 to 12 terms is exact to double
+ *  precision. The odometer of each step is a prefix sum across the lanes
+ *  plus the total so far. The last count % 4 segments go thru the scalar
+ *  kernel.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define NMEA_GEO_X86
+#endif
+
+#include "nmea0183_geodesic.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define RADIANS_PER_DEGREE			(M_PI / 180.0)
+#define RADIANS_PER_E7				(M_PI / 180.0 / 1e7)
+#define PI_2_HI						1.5707963267948966			// pi / 2 as two doubles,
+#define PI_2_LO						6.123233995736766e-17		// for the range reduction
+#define TAN_PI_8					0.41421356237309503
+
+/**
+ * Track of fixes, as degrees or 1e-7 degree
+ */
+typedef struct geo_track_t
+{
+	const double *latitude;
+	const double *longitude;
+	const double *time_s;
+	const int32_t *latitude_e7;
+	const int32_t *longitude_e7;
+	const uint32_t *epoch_s;
+	int fixed_point;
+} geo_track_t;
+
+typedef double (*geo_kernel_t)(const geo_track_t *track, size_t first, size_t last, double odometer,
+		const nmea_geo_segments_t *segments);
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static double geo_run(const geo_track_t *track, size_t count, const nmea_geo_segments_t *segments);
+static double geo_kernel_scalar(const geo_track_t *track, size_t first, size_t last, double odometer,
+		const nmea_geo_segments_t *segments);
+#ifdef NMEA_GEO_X86
+static double geo_kernel_avx2(const geo_track_t *track, size_t first, size_t last, double odometer,
+		const nmea_geo_segments_t *segments);
+#endif
+static nmea_geo_kernel geo_best_kernel(void);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+static geo_kernel_t geo_kernel;
+static nmea_geo_kernel geo_kernel_id;
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Measure the segments of a track given in degrees
+* @param  latitude: Latitude of each fix, degrees
+* @param  longitude: Longitude of each fix, degrees
+* @param  time_s: Time of each fix in seconds, NULL if segments->speed is NULL
+* @param  count: Number of fixes, giving count - 1 segments
+* @param  segments: Outputs of the segments
+* @return Length of the track in meters
+********************************************************************************/
+double nmea_geo_track(const double *latitude, const double *longitude, const double *time_s, size_t count,
+		const nmea_geo_segments_t *segments)
+{
+	geo_track_t track;
+
+	memset(&track, 0, sizeof(track));
+	track.latitude = latitude;
+	track.longitude = longitude;
+	track.time_s = time_s;
+	return geo_run(&track, count, segments);
+}
+
+/**
+********************************************************************************
+* Measure the segments of a track given in 1e-7 degree, e.g. the columns of a
+* nmea_fix_batch_t
+* @param  latitude_e7: Latitude of each fix, 1e-7 degree
+* @param  longitude_e7: Longitude of each fix, 1e-7 degree
+* @param  epoch_s: Time of each fix in seconds, NULL if segments->speed is NULL
+* @param  count: Number of fixes, giving count - 1 segments
+* @param  segments: Outputs of the segments
+* @return Length of the track in meters
+********************************************************************************/
+double nmea_geo_track_e7(const int32_t *latitude_e7, const int32_t *longitude_e7, const uint32_t *epoch_s,
+		size_t count, const nmea_geo_segments_t *segments)
+{
+	geo_track_t track;
+
+	memset(&track, 0, sizeof(track));
+	track.latitude_e7 = latitude_e7;
+	track.longitude_e7 = longitude_e7;
+	track.epoch_s = epoch_s;
+	track.fixed_point = 1;
+	return geo_run(&track, count, segments);
+}
+
+/**
+********************************************************************************
+* Select the geodesic kernel, e.g. to compare kernels in a benchmark
+* @param  kernel: Kernel to use, NMEA_GEO_KERNEL_AUTO for the best available
+* @return 1 on success, 0 if the CPU does not support the kernel
+********************************************************************************/
+int nmea_geo_select(nmea_geo_kernel kernel)
+{
+	geo_kernel_t fn;
+
+	if (kernel == NMEA_GEO_KERNEL_AUTO) {
+		kernel = geo_best_kernel();
+	}
+
+	switch (kernel) {
+		case NMEA_GEO_KERNEL_SCALAR:
+			fn = geo_kernel_scalar;
+			break;
+#ifdef NMEA_GEO_X86
+		case NMEA_GEO_KERNEL_AVX2:
+			if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma")) return 0;
+			fn = geo_kernel_avx2;
+			break;
+#endif
+		default:
+			return 0;
+	}
+	// threads racing on the first track all store the same kernel
+	__atomic_store_n(&geo_kernel_id, kernel, __ATOMIC_RELAXED);
+	__atomic_store_n(&geo_kernel, fn, __ATOMIC_RELEASE);
+
+	return 1;
+}
+
+/**
+********************************************************************************
+* Get the geodesic kernel in use
+* @return Kernel selected by nmea_geo_select() or picked on first use
+********************************************************************************/
+nmea_geo_kernel nmea_geo_kernel_in_use(void)
+{
+	if (!__atomic_load_n(&geo_kernel, __ATOMIC_ACQUIRE)) {
+		nmea_geo_select(NMEA_GEO_KERNEL_AUTO);
+	}
+	return __atomic_load_n(&geo_kernel_id, __ATOMIC_RELAXED);
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+static double geo_run(const geo_track_t *track, size_t count, const nmea_geo_segments_t *segments)
+{
+	geo_kernel_t kernel = __atomic_load_n(&geo_kernel, __ATOMIC_ACQUIRE);
+
+	if (count < 2) {
+		return 0;
+	}
+	if (!kernel) {
+		nmea_geo_select(NMEA_GEO_KERNEL_AUTO);
+		kernel = __atomic_load_n(&geo_kernel, __ATOMIC_ACQUIRE);
+	}
+	return kernel(track, 0, count - 1, 0, segments);
+}
+
+static nmea_geo_kernel geo_best_kernel(void)
+{
+#ifdef NMEA_GEO_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return NMEA_GEO_KERNEL_AVX2;
+	}
+#endif
+	return NMEA_GEO_KERNEL_SCALAR;
+}
+
+/**
+********************************************************************************
+* Segments first to last - 1 of a track, one at a time
+* @param  track: Fixes of the track
+* @param  first: First segment
+* @param  last: Segment after the last one
+* @param  odometer: Length of the track before the first segment
+* @param  segments: Outputs of the segments
+* @return Length of the track after the last segment
+********************************************************************************/
+static double geo_kernel_scalar(const geo_track_t *track, size_t first, size_t last, double odometer,
+		const nmea_geo_segments_t *segments)
+{
+	size_t i;
+
+	for (i = first; i < last; i++) {
+		double lat1, lon1, lat2, lon2, dt = 0;
+
+		if (track->fixed_point) {
+			lat1 = track->latitude_e7[i] * RADIANS_PER_E7;
+			lon1 = track->longitude_e7[i] * RADIANS_PER_E7;
+			lat2 = track->latitude_e7[i + 1] * RADIANS_PER_E7;
+			lon2 = track->longitude_e7[i + 1] * RADIANS_PER_E7;
+			if (segments->speed) {
+				dt = (double)track->epoch_s[i + 1] - (double)track->epoch_s[i];
+			}
+		} else {
+			lat1 = track->latitude[i] * RADIANS_PER_DEGREE;
+			lon1 = track->longitude[i] * RADIANS_PER_DEGREE;
+			lat2 = track->latitude[i + 1] * RADIANS_PER_DEGREE;
+			lon2 = track->longitude[i + 1] * RADIANS_PER_DEGREE;
+			if (segments->speed) {
+				dt = track->time_s[i + 1] - track->time_s[i];
+			}
+		}
+
+		double dlon = lon2 - lon1;
+		if (dlon > M_PI) dlon -= 2 * M_PI;
+		if (dlon < -M_PI) dlon += 2 * M_PI;
+		double sin_dlat = sin((lat2 - lat1) / 2), sin_dlon = sin(dlon / 2), cos_dlon = cos(dlon / 2);
+		double cos_lat1 = cos(lat1), cos_lat2 = cos(lat2);
+		double h = sin_dlat * sin_dlat + cos_lat1 * cos_lat2 * sin_dlon * sin_dlon;
+
+		h = h < 1 ? h : 1;
+		double distance = 2 * NMEA_GEO_EARTH_RADIUS * atan2(sqrt(h), sqrt(1 - h));
+		odometer += distance;
+
+		if (segments->distance) {
+			segments->distance[i] = distance;
+		}
+		if (segments->odometer) {
+			segments->odometer[i] = odometer;
+		}
+		if (segments->bearing) {
+			double y = 2 * sin_dlon * cos_dlon * cos_lat2;
+			double x = cos_lat1 * sin(lat2) - sin(lat1) * cos_lat2 * (1 - 2 * sin_dlon * sin_dlon);
+			double bearing = atan2(y, x) / RADIANS_PER_DEGREE;
+			segments->bearing[i] = bearing < 0 ? bearing + 360 : bearing;
+		}
+		if (segments->speed) {
+			segments->speed[i] = dt > 0 ? distance / dt / NMEA_GEO_METERS_PER_KNOT_S : NAN;
+		}
+	}
+	return odometer;
+}
+
+#ifdef NMEA_GEO_X86
+
+/**
+********************************************************************************
+* Sine and cosine of 4 angles of at most a half turn
+********************************************************************************/
+__attribute__((target("avx2,fma")))
+static inline void geo_sincos_avx2(__m256d x, __m256d *sin_x, __m256d *cos_x)
+{
+	// x = k pi/2 + r, |r| <= pi/4, quadrant q = k mod 4
+	__m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(2 / M_PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(PI_2_HI), x);
+	r = _mm256_fnmadd_pd(k, _mm256_set1_pd(PI_2_LO), r);
+	__m256d q = _mm256_sub_pd(k, _mm256_mul_pd(_mm256_floor_pd(_mm256_mul_pd(k, _mm256_set1_pd(0.25))), _mm256_set1_pd(4)));
+	__m256d z = _mm256_mul_pd(r, r);
+
+	// Taylor series to r^15 and r^16
+	__m256d s = _mm256_set1_pd(-1.0 / 1307674368000.0);
+	s = _mm256_fmadd_pd(s, z, _mm256_set1_pd(1.0 / 6227020800.0));
+	s = _mm256_fmadd_pd(s, z, _mm256_set1_pd(-1.0 / 39916800.0));
+	s = _mm256_fmadd_pd(s, z, _mm256_set1_pd(1.0 / 362880.0));
+	s = _mm256_fmadd_pd(s, z, _mm256_set1_pd(-1.0 / 5040.0));
+	s = _mm256_fmadd_pd(s, z, _mm256_set1_pd(1.0 / 120.0));
+	s = _mm256_fmadd_pd(s, z, _mm256_set1_pd(-1.0 / 6.0));
+	s = _mm256_fmadd_pd(_mm256_mul_pd(s, z), r, r);
+
+	__m256d c = _mm256_set1_pd(1.0 / 20922789888000.0);
+	c = _mm256_fmadd_pd(c, z, _mm256_set1_pd(-1.0 / 87178291200.0));
+	c = _mm256_fmadd_pd(c, z, _mm256_set1_pd(1.0 / 479001600.0));
+	c = _mm256_fmadd_pd(c, z, _mm256_set1_pd(-1.0 / 3628800.0));
+	c = _mm256_fmadd_pd(c, z, _mm256_set1_pd(1.0 / 40320.0));
+	c = _mm256_fmadd_pd(c, z, _mm256_set1_pd(-1.0 / 720.0));
+	c = _mm256_fmadd_pd(c, z, _mm256_set1_pd(1.0 / 24.0));
+	c = _mm256_fmadd_pd(c, z, _mm256_set1_pd(-1.0 / 2.0));
+	c = _mm256_fmadd_pd(c, z, _mm256_set1_pd(1.0));
+
+	// odd quadrants swap sine and cosine, the signs follow the quadrant
+	__m256d odd = _mm256_or_pd(_mm256_cmp_pd(q, _mm256_set1_pd(1), _CMP_EQ_OQ), _mm256_cmp_pd(q, _mm256_set1_pd(3), _CMP_EQ_OQ));
+	__m256d sin_neg = _mm256_cmp_pd(q, _mm256_set1_pd(2), _CMP_GE_OQ);
+	__m256d cos_neg = _mm256_and_pd(_mm256_cmp_pd(q, _mm256_set1_pd(1), _CMP_GE_OQ), _mm256_cmp_pd(q, _mm256_set1_pd(2), _CMP_LE_OQ));
+	__m256d sign = _mm256_set1_pd(-0.0);
+
+	*sin_x = _mm256_xor_pd(_mm256_blendv_pd(s, c, odd), _mm256_and_pd(sin_neg, sign));
+	*cos_x = _mm256_xor_pd(_mm256_blendv_pd(c, s, odd), _mm256_and_pd(cos_neg, sign));
+}
+
+/**
+********************************************************************************
+* Arctangent of 4 quotients y / x, in (-pi, pi]
+********************************************************************************/
+__attribute__((target("avx2,fma")))
+static inline __m256d geo_atan2_avx2(__m256d y, __m256d x)
+{
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	const __m256d one = _mm256_set1_pd(1);
+	__m256d ax = _mm256_andnot_pd(sign, x), ay = _mm256_andnot_pd(sign, y);
+	__m256d swap = _mm256_cmp_pd(ay, ax, _CMP_GT_OQ);
+	__m256d num = _mm256_min_pd(ax, ay), den = _mm256_max_pd(ax, ay);
+
+	// a = num / den in [0, 1], 0 when both are 0
+	__m256d a = _mm256_and_pd(_mm256_div_pd(num, den), _mm256_cmp_pd(den, _mm256_setzero_pd(), _CMP_GT_OQ));
+
+	// atan(a) = pi/4 + atan((a - 1) / (a + 1)) above tan(pi/8), then
+	// atan(t) = 2 atan(t / (1 + sqrt(1 + t^2))) leaves |u| <= tan(pi/16)
+	__m256d big = _mm256_cmp_pd(a, _mm256_set1_pd(TAN_PI_8), _CMP_GT_OQ);
+	__m256d t = _mm256_blendv_pd(a, _mm256_div_pd(_mm256_sub_pd(a, one), _mm256_add_pd(a, one)), big);
+	__m256d u = _mm256_div_pd(t, _mm256_add_pd(one, _mm256_sqrt_pd(_mm256_fmadd_pd(t, t, one))));
+	__m256d z = _mm256_mul_pd(u, u);
+
+	// Taylor series to u^23
+	__m256d p = _mm256_set1_pd(-1.0 / 23);
+	p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(1.0 / 21));
+	p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-1.0 / 19));
+	p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(1.0 / 17));
+	p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-1.0 / 15));
+	p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(1.0 / 13));
+	p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-1.0 / 11));
+	p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(1.0 / 9));
+	p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-1.0 / 7));
+	p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(1.0 / 5));
+	p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-1.0 / 3));
+	p = _mm256_fmadd_pd(_mm256_mul_pd(p, z), u, u);
+
+	__m256d r = _mm256_fmadd_pd(p, _mm256_set1_pd(2), _mm256_and_pd(big, _mm256_set1_pd(M_PI / 4)));
+	r = _mm256_blendv_pd(r, _mm256_sub_pd(_mm256_set1_pd(M_PI / 2), r), swap);
+	r = _mm256_blendv_pd(r, _mm256_sub_pd(_mm256_set1_pd(M_PI), r), x);
+	return _mm256_xor_pd(r, _mm256_and_pd(y, sign));
+}
+
+/**
+********************************************************************************
+* Load 4 fixes as radians and their times as seconds
+********************************************************************************/
+__attribute__((target("avx2,fma")))
+static inline void geo_load_avx2(const geo_track_t *track, size_t i, __m256d *lat, __m256d *lon, __m256d *t)
+{
+	if (track->fixed_point) {
+		const __m256d scale = _mm256_set1_pd(RADIANS_PER_E7);
+		*lat = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(track->latitude_e7 + i))), scale);
+		*lon = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(track->longitude_e7 + i))), scale);
+		if (track->epoch_s) {
+			// unsigned to double: flip the top bit to go thru the signed conversion
+			__m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(track->epoch_s + i)), _mm_set1_epi32(INT32_MIN));
+			*t = _mm256_add_pd(_mm256_cvtepi32_pd(s), _mm256_set1_pd(2147483648.0));
+		}
+	} else {
+		const __m256d scale = _mm256_set1_pd(RADIANS_PER_DEGREE);
+		*lat = _mm256_mul_pd(_mm256_loadu_pd(track->latitude + i), scale);
+		*lon = _mm256_mul_pd(_mm256_loadu_pd(track->longitude + i), scale);
+		if (track->time_s) {
+			*t = _mm256_loadu_pd(track->time_s + i);
+		}
+	}
+}
+
+/**
+********************************************************************************
+* Segments first to last - 1 of a track, 4 at a time, the same formulas as
+* geo_kernel_scalar()
+********************************************************************************/
+__attribute__((target("avx2,fma")))
+static double geo_kernel_avx2(const geo_track_t *track, size_t first, size_t last, double odometer,
+		const nmea_geo_segments_t *segments)
+{
+	const __m256d half = _mm256_set1_pd(0.5);
+	const __m256d one = _mm256_set1_pd(1);
+	const __m256d two_pi = _mm256_set1_pd(2 * M_PI);
+	const __m256d zero = _mm256_setzero_pd();
+	__m256d total = _mm256_set1_pd(odometer);
+	__m256d t1 = zero, t2 = zero;
+	size_t i;
+
+	for (i = first; i + 4 <= last; i += 4) {
+		__m256d lat1, lon1, lat2, lon2;
+		__m256d sin_lat1, cos_lat1, sin_lat2, cos_lat2, sin_dlat, cos_dlat, sin_dlon, cos_dlon;
+
+		geo_load_avx2(track, i, &lat1, &lon1, &t1);
+		geo_load_avx2(track, i + 1, &lat2, &lon2, &t2);
+
+		// longitude difference wrapped to [-pi, pi]
+		__m256d dlon = _mm256_sub_pd(lon2, lon1);
+		dlon = _mm256_sub_pd(dlon, _mm256_and_pd(_mm256_cmp_pd(dlon, _mm256_set1_pd(M_PI), _CMP_GT_OQ), two_pi));
+		dlon = _mm256_add_pd(dlon, _mm256_and_pd(_mm256_cmp_pd(dlon, _mm256_set1_pd(-M_PI), _CMP_LT_OQ), two_pi));
+
+		geo_sincos_avx2(lat1, &sin_lat1, &cos_lat1);
+		geo_sincos_avx2(lat2, &sin_lat2, &cos_lat2);
+		geo_sincos_avx2(_mm256_mul_pd(_mm256_sub_pd(lat2, lat1), half), &sin_dlat, &cos_dlat);
+		geo_sincos_avx2(_mm256_mul_pd(dlon, half), &sin_dlon, &cos_dlon);
+
+		__m256d sin2_dlon = _mm256_mul_pd(sin_dlon, sin_dlon);
+		__m256d h = _mm256_fmadd_pd(_mm256_mul_pd(cos_lat1, cos_lat2), sin2_dlon, _mm256_mul_pd(sin_dlat, sin_dlat));
+		h = _mm256_min_pd(h, one);
+		__m256d distance = _mm256_mul_pd(geo_atan2_avx2(_mm256_sqrt_pd(h), _mm256_sqrt_pd(_mm256_sub_pd(one, h))),
+				_mm256_set1_pd(2 * NMEA_GEO_EARTH_RADIUS));
+
+		// prefix sum across the lanes, plus the total so far
+		__m256d sum = _mm256_add_pd(distance, _mm256_blend_pd(_mm256_permute4x64_pd(distance, 0x90), zero, 0x1));
+		sum = _mm256_add_pd(sum, _mm256_blend_pd(_mm256_permute4x64_pd(sum, 0x40), zero, 0x3));
+		sum = _mm256_add_pd(sum, total);
+		total = _mm256_permute4x64_pd(sum, 0xff);
+
+		if (segments->distance) {
+			_mm256_storeu_pd(segments->distance + i, distance);
+		}
+		if (segments->odometer) {
+			_mm256_storeu_pd(segments->odometer + i, sum);
+		}
+		if (segments->bearing) {
+			__m256d y = _mm256_mul_pd(_mm256_mul_pd(_mm256_add_pd(sin_dlon, sin_dlon), cos_dlon), cos_lat2);
+			__m256d cos_dl = _mm256_fnmadd_pd(_mm256_add_pd(sin2_dlon, sin2_dlon), one, one);
+			__m256d x = _mm256_fmsub_pd(cos_lat1, sin_lat2, _mm256_mul_pd(_mm256_mul_pd(sin_lat1, cos_lat2), cos_dl));
+			__m256d bearing = _mm256_mul_pd(geo_atan2_avx2(y, x), _mm256_set1_pd(1 / RADIANS_PER_DEGREE));
+			bearing = _mm256_add_pd(bearing, _mm256_and_pd(_mm256_cmp_pd(bearing, zero, _CMP_LT_OQ), _mm256_set1_pd(360)));
+			_mm256_storeu_pd(segments->bearing + i, bearing);
+		}
+		if (segments->speed) {
+			__m256d dt = _mm256_sub_pd(t2, t1);
+			__m256d speed = _mm256_div_pd(distance, _mm256_mul_pd(dt, _mm256_set1_pd(NMEA_GEO_METERS_PER_KNOT_S)));
+			speed = _mm256_blendv_pd(_mm256_set1_pd(NAN), speed, _mm256_cmp_pd(dt, zero, _CMP_GT_OQ));
+			_mm256_storeu_pd(segments->speed + i, speed);
+		}
+	}
+
+	return geo_kernel_scalar(track, i, last, _mm256_cvtsd_f64(total), segments);
+}
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
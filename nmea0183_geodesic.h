@@ -0,0 +1,88 @@
+/** @file
+ *  Provides prototypes for the batch geodesic kernels: segment distance,
+ *  odometer, bearing and implied speed along a track of fixes.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_GEODESIC_H__
+#define __NMEA0183_GEODESIC_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_GEO_EARTH_RADIUS		6371008.8		/**< Mean earth radius in meters. */
+#define NMEA_GEO_METERS_PER_KNOT_S	(1852.0 / 3600.0)	/**< Meters per second in a knot. */
+
+/**
+ * Geodesic kernels, selected at runtime from the CPU features
+ */
+typedef enum {
+	NMEA_GEO_KERNEL_AUTO = 0,					/**< Best kernel supported by the CPU. */
+	NMEA_GEO_KERNEL_SCALAR = 1,					/**< Portable kernel on libm. */
+	NMEA_GEO_KERNEL_AVX2 = 2,					/**< 4 segments per step. */
+	NMEA_GEO_KERNEL_INVALID
+} nmea_geo_kernel;
+
+/**
+ * Outputs of a track, one entry per segment: segment i joins fix i to fix
+ * i + 1. Outputs not wanted are NULL.
+ *
+ * Accuracy: the earth is a sphere of NMEA_GEO_EARTH_RADIUS, which is within
+ * 0.5% of distances on the WGS-84 ellipsoid. For the same input the AVX2
+ * kernel stays within 1e-12 relative or 1e-9 meter of the scalar kernel on
+ * distance, odometer and speed, and within 1e-9 degree on bearing.
+ */
+typedef struct nmea_geo_segments_t
+{
+	double *distance;							/**< Great-circle distance in meters. */
+	double *odometer;							/**< Distance from the first fix to the end of the segment. */
+	double *bearing;							/**< Initial bearing in degrees clockwise from north, [0, 360). */
+	double *speed;								/**< Distance over time in knots, NAN when time does not advance. */
+} nmea_geo_segments_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+double nmea_geo_track(const double *latitude, const double *longitude, const double *time_s, size_t count,
+		const nmea_geo_segments_t *segments);
+double nmea_geo_track_e7(const int32_t *latitude_e7, const int32_t *longitude_e7, const uint32_t *epoch_s,
+		size_t count, const nmea_geo_segments_t *segments);
+int nmea_geo_select(nmea_geo_kernel kernel);
+nmea_geo_kernel nmea_geo_kernel_in_use(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
@@ -0,0 +1,705 @@
+/** @file
+ *  Provides implementation for the geofence engine.
+ *
+ *  Adding a polygon unwraps its longitudes from the first vertex, so that a
+ *  polygon across the antimeridian is one piece, and lists its edges per
+ *  grid row. Every cell of its bounding box is then classified: cells an
+ *  edge passes thru hold part of the boundary, the others are wholly inside
+ *  or outside, which the test of one point per run of such cells along a row
+ *  tells. Building sorts the cells met by any polygon into a hash table.
+ *
+ *  A fix then reads the one cell it falls in: polygons the cell is inside of
+ *  hold it without a test, polygons whose boundary crosses the cell take a
+ *  ray crossing test over the edges of the row only. The cost per fix is the
+ *  polygons met in its cell, not the polygons loaded.
+ *
+ *  The fences a vehicle was in after its last fix are kept sorted, so the
+ *  enter and exit events of a fix come from one merge with the fences that
+ *  hold it now, which come sorted out of the cell.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "nmea0183_geofence.h"
+#include "nmea0183_vehicle.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define LATITUDE_SPAN				1800000000LL
+#define LONGITUDE_SPAN				3600000000LL
+#define CELL_BOUNDARY				1
+#define CELL_INSIDE					2
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static int64_t floor_div(int64_t a, int64_t b);
+static int64_t cell_row(const nmea_geofence_t *geofence, int64_t y);
+static int64_t cell_column(const nmea_geofence_t *geofence, int64_t x);
+static uint64_t cell_key(const nmea_geofence_t *geofence, int64_t row, int64_t column);
+static int polygon_contains(const nmea_geofence_t *geofence, const nmea_geofence_polygon_t *polygon, double x, double y);
+static void polygon_free(nmea_geofence_polygon_t *polygon);
+static int polygon_edges(nmea_geofence_t *geofence, nmea_geofence_polygon_t *polygon, const int64_t *x,
+		const int64_t *y, size_t count);
+static int polygon_cells(nmea_geofence_t *geofence, uint32_t index, const int64_t *x, const int64_t *y, size_t count);
+static int add_entry(nmea_geofence_t *geofence, uint64_t cell, uint32_t polygon);
+static int compare_entries(const void *a, const void *b);
+static const nmea_geofence_cell_t *find_cell(const nmea_geofence_t *geofence, int32_t latitude_e7, int32_t longitude_e7);
+static size_t polygons_at(const nmea_geofence_t *geofence, int32_t latitude_e7, int32_t longitude_e7, uint32_t *polygons);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Initialize an empty geofence engine
+* @param  geofence: Engine to initialize
+* @param  cell_e7: Side of a grid cell in 1e-7 degree, a divisor of 180
+*                  degrees, 0 for NMEA_GEOFENCE_CELL_E7. Near the size of the
+*                  smaller fences is best.
+* @param  max_vehicles: Most vehicles tracked
+* @return 0 on success, -1 if cell_e7 is not a divisor of 180 degrees or
+*         memory could not be allocated
+********************************************************************************/
+int nmea_geofence_init(nmea_geofence_t *geofence, int32_t cell_e7, size_t max_vehicles)
+{
+	size_t slots = nmea_vehicle_slots(max_vehicles);
+
+	if (!cell_e7) {
+		cell_e7 = NMEA_GEOFENCE_CELL_E7;
+	}
+	memset(geofence, 0, sizeof(*geofence));
+	if (cell_e7 < 0 || LATITUDE_SPAN % cell_e7) {
+		return -1;
+	}
+	geofence->vehicles = calloc(slots, sizeof(nmea_geofence_vehicle_t));
+	if (!geofence->vehicles || slots > UINT32_MAX) {
+		free(geofence->vehicles);
+		geofence->vehicles = NULL;
+		return -1;
+	}
+	geofence->vehicle_mask = slots - 1;
+	geofence->cell_e7 = cell_e7;
+	geofence->columns = LONGITUDE_SPAN / cell_e7;
+
+	return 0;
+}
+
+/**
+********************************************************************************
+* Free a geofence engine
+* @param  geofence: Engine to destroy
+********************************************************************************/
+void nmea_geofence_destroy(nmea_geofence_t *geofence)
+{
+	size_t i;
+
+	for (i = 0; i < geofence->num_polygons; i++) {
+		polygon_free(&geofence->polygons[i]);
+	}
+	if (geofence->vehicles) {
+		for (i = 0; i <= geofence->vehicle_mask; i++) {
+			free(geofence->vehicles[i].polygons);
+		}
+	}
+	free(geofence->polygons);
+	free(geofence->cells);
+	free(geofence->entries);
+	free(geofence->vehicles);
+	free(geofence->inside);
+	memset(geofence, 0, sizeof(*geofence));
+}
+
+/**
+********************************************************************************
+* Add a fence, before nmea_geofence_build()
+* @param  geofence: Engine to add to
+* @param  fence: Id of the fence, given back in its events
+* @param  latitude_e7: Latitude of each vertex, 1e-7 degree
+* @param  longitude_e7: Longitude of each vertex, 1e-7 degree. Each edge is
+*                       the shorter way round, so a polygon may cross the
+*                       antimeridian but not go round a pole.
+* @param  count: Number of vertices, the last one joined to the first
+* @return 0 on success, -1 if the polygon is degenerate or too large, the
+*         engine is built, or memory could not be allocated
+********************************************************************************/
+int nmea_geofence_add(nmea_geofence_t *geofence, uint32_t fence, const int32_t *latitude_e7,
+		const int32_t *longitude_e7, size_t count)
+{
+	nmea_geofence_polygon_t *polygon;
+	size_t num_entries = geofence->num_entries, i;
+	int64_t *x, *y;
+	int ret;
+
+	// the first vertex repeated at the end closes nothing more
+	if (count > 1 && latitude_e7[0] == latitude_e7[count - 1] && longitude_e7[0] == longitude_e7[count - 1]) {
+		count--;
+	}
+	if (geofence->built || count < 3 || geofence->num_polygons >= UINT32_MAX >> 1) {
+		return -1;
+	}
+	if (geofence->num_polygons == geofence->polygon_capacity) {
+		size_t capacity = geofence->polygon_capacity ? 2 * geofence->polygon_capacity : 64;
+		nmea_geofence_polygon_t *polygons = realloc(geofence->polygons, capacity * sizeof(*polygons));
+
+		if (!polygons) {
+			return -1;
+		}
+		geofence->polygons = polygons;
+		geofence->polygon_capacity = capacity;
+	}
+
+	x = malloc(count * sizeof(int64_t));
+	y = malloc(count * sizeof(int64_t));
+	if (!x || !y) {
+		free(x);
+		free(y);
+		return -1;
+	}
+	polygon = &geofence->polygons[geofence->num_polygons];
+	memset(polygon, 0, sizeof(*polygon));
+	polygon->fence = fence;
+
+	// longitudes unwrapped from the first vertex, the shorter way round
+	for (i = 0; i < count; i++) {
+		y[i] = latitude_e7[i];
+		if (i == 0) {
+			x[i] = longitude_e7[i];
+		} else {
+			int64_t dx = (int64_t)longitude_e7[i] - longitude_e7[i - 1];
+
+			if (dx > LONGITUDE_SPAN / 2) dx -= LONGITUDE_SPAN;
+			if (dx < -LONGITUDE_SPAN / 2) dx += LONGITUDE_SPAN;
+			x[i] = x[i - 1] + dx;
+		}
+		if (i == 0 || x[i] < polygon->min_x) polygon->min_x = x[i];
+		if (i == 0 || x[i] > polygon->max_x) polygon->max_x = x[i];
+		if (i == 0 || y[i] < polygon->min_y) polygon->min_y = y[i];
+		if (i == 0 || y[i] > polygon->max_y) polygon->max_y = y[i];
+	}
+
+	ret = -1;
+	if (polygon->max_x - polygon->min_x < LONGITUDE_SPAN && polygon->max_y > polygon->min_y &&
+			!polygon_edges(geofence, polygon, x, y, count) &&
+			!polygon_cells(geofence, geofence->num_polygons, x, y, count)) {
+		geofence->num_polygons++;
+		ret = 0;
+	} else {
+		polygon_free(polygon);
+		geofence->num_entries = num_entries;
+	}
+	free(x);
+	free(y);
+
+	return ret;
+}
+
+/**
+********************************************************************************
+* Build the grid of the fences added, after which fixes can be evaluated
+* @param  geofence: Engine to build
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+int nmea_geofence_build(nmea_geofence_t *geofence)
+{
+	size_t cells = 0, slots = 1, i;
+
+	if (geofence->built) {
+		return 0;
+	}
+	qsort(geofence->entries, geofence->num_entries, sizeof(nmea_geofence_entry_t), compare_entries);
+	for (i = 0; i < geofence->num_entries; i++) {
+		cells += i == 0 || geofence->entries[i].cell != geofence->entries[i - 1].cell;
+	}
+	while (slots < 2 * cells) {
+		slots <<= 1;
+	}
+	geofence->cells = calloc(slots, sizeof(nmea_geofence_cell_t));
+	geofence->inside = malloc((geofence->num_polygons + 1) * sizeof(uint32_t));
+	if (!geofence->cells || !geofence->inside) {
+		free(geofence->cells);
+		free(geofence->inside);
+		geofence->cells = NULL;
+		geofence->inside = NULL;
+		return -1;
+	}
+	geofence->cell_mask = slots - 1;
+
+	for (i = 0; i < geofence->num_entries; ) {
+		uint64_t key = geofence->entries[i].cell + 1;
+		size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & geofence->cell_mask;
+		size_t first = i;
+
+		while (geofence->cells[slot].key) {
+			slot = (slot + 1) & geofence->cell_mask;
+		}
+		while (i < geofence->num_entries && geofence->entries[i].cell + 1 == key) {
+			i++;
+		}
+		geofence->cells[slot].key = key;
+		geofence->cells[slot].first = (uint32_t)first;
+		geofence->cells[slot].count = (uint32_t)(i - first);
+	}
+	geofence->built = 1;
+
+	return 0;
+}
+
+/**
+********************************************************************************
+* Fences holding a point
+* @param  geofence: Built engine
+* @param  latitude_e7: Latitude of the point, 1e-7 degree
+* @param  longitude_e7: Longitude of the point, 1e-7 degree
+* @param  fences: Ids of the fences holding the point, in the order added
+* @param  max_fences: Room in fences
+* @return Number of fences holding the point, which may exceed max_fences
+********************************************************************************/
+size_t nmea_geofence_contains(const nmea_geofence_t *geofence, int32_t latitude_e7, int32_t longitude_e7,
+		uint32_t *fences, size_t max_fences)
+{
+	size_t count, i;
+
+	if (!geofence->built) {
+		return 0;
+	}
+	count = polygons_at(geofence, latitude_e7, longitude_e7, geofence->inside);
+	for (i = 0; i < count && i < max_fences; i++) {
+		fences[i] = geofence->polygons[geofence->inside[i]].fence;
+	}
+	return count;
+}
+
+/**
+********************************************************************************
+* Evaluate a batch of fixes against the fences. A fix that takes its vehicle
+* into or out of a fence, compared with the previous fix of the vehicle, gives
+* an event; the first fix of a vehicle gives an enter event for every fence
+* holding it.
+* @param  geofence: Built engine
+* @param  vehicles: Vehicle of each fix
+* @param  latitude_e7: Latitude of each fix, 1e-7 degree
+* @param  longitude_e7: Longitude of each fix, 1e-7 degree
+* @param  count: Number of fixes, in time order per vehicle
+* @param  callback: Called with each event, in fix order
+* @param  user_data: Passed to the callback
+* @return Number of events
+********************************************************************************/
+size_t nmea_geofence_evaluate(nmea_geofence_t *geofence, const uint32_t *vehicles, const int32_t *latitude_e7,
+		const int32_t *longitude_e7, size_t count, nmea_geofence_callback_t callback, void *user_data)
+{
+	nmea_geofence_event_t event;
+	size_t events = 0, i;
+
+	if (!geofence->built) {
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		nmea_geofence_vehicle_t *state = nmea_vehicle_find(geofence->vehicles, sizeof(nmea_geofence_vehicle_t),
+				geofence->vehicle_mask, vehicles[i]);
+		uint32_t *inside = geofence->inside;
+		size_t now, was, a = 0, b = 0;
+
+		if (!state) {
+			geofence->dropped++;
+			continue;
+		}
+		now = polygons_at(geofence, latitude_e7[i], longitude_e7[i], inside);
+		was = state->count;
+
+		// both lists sorted by polygon index
+		event.vehicle = vehicles[i];
+		event.fix = i;
+		while (a < now || b < was) {
+			if (b == was || (a < now && inside[a] < state->polygons[b])) {
+				event.fence = geofence->polygons[inside[a++]].fence;
+				event.transition = NMEA_GEOFENCE_ENTER;
+			} else if (a == now || state->polygons[b] < inside[a]) {
+				event.fence = geofence->polygons[state->polygons[b++]].fence;
+				event.transition = NMEA_GEOFENCE_EXIT;
+			} else {
+				a++;
+				b++;
+				continue;
+			}
+			events++;
+			if (callback) {
+				callback(&event, user_data);
+			}
+		}
+
+		if (now > state->capacity) {
+			uint32_t *polygons = realloc(state->polygons, now * 2 * sizeof(uint32_t));
+
+			if (!polygons) {
+				// the fences are then entered again on the next fix
+				state->count = 0;
+				geofence->dropped++;
+				continue;
+			}
+			state->polygons = polygons;
+			state->capacity = (uint32_t)(now * 2);
+		}
+		memcpy(state->polygons, inside, now * sizeof(uint32_t));
+		state->count = (uint32_t)now;
+	}
+	return events;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+static int64_t floor_div(int64_t a, int64_t b)
+{
+	return a / b - (a % b < 0);
+}
+
+/**
+********************************************************************************
+* Grid row of a latitude
+* @param  geofence: Engine of the grid
+* @param  y: Latitude, 1e-7 degree
+* @return Row from the south pole, the pole itself in the last one
+********************************************************************************/
+static int64_t cell_row(const nmea_geofence_t *geofence, int64_t y)
+{
+	int64_t row = floor_div(y + LATITUDE_SPAN / 2, geofence->cell_e7);
+	int64_t rows = LATITUDE_SPAN / geofence->cell_e7;
+
+	return row < 0 ? 0 : row < rows ? row : rows - 1;
+}
+
+/**
+********************************************************************************
+* Grid column of an unwrapped longitude
+* @param  geofence: Engine of the grid
+* @param  x: Longitude, 1e-7 degree, may be off the range
+* @return Column from the antimeridian, off the range as much as x is
+********************************************************************************/
+static int64_t cell_column(const nmea_geofence_t *geofence, int64_t x)
+{
+	return floor_div(x + LONGITUDE_SPAN / 2, geofence->cell_e7);
+}
+
+static uint64_t cell_key(const nmea_geofence_t *geofence, int64_t row, int64_t column)
+{
+	column %= geofence->columns;
+	if (column < 0) {
+		column += geofence->columns;
+	}
+	return (uint64_t)(row * geofence->columns + column);
+}
+
+/**
+********************************************************************************
+* Point in polygon test, by the crossings of a ray to the east with the edges
+* of the row of the point
+* @param  geofence: Engine of the grid
+* @param  polygon: Polygon to test
+* @param  x: Longitude, 1e-7 degree, unwrapped into the box of the polygon
+* @param  y: Latitude, 1e-7 degree
+* @return 1 if the polygon holds the point, 0 otherwise
+********************************************************************************/
+static int polygon_contains(const nmea_geofence_t *geofence, const nmea_geofence_polygon_t *polygon, double x, double y)
+{
+	int64_t row = cell_row(geofence, (int64_t)y) - polygon->first_row;
+	uint32_t i;
+	int inside = 0;
+
+	if (row < 0 || row >= (int64_t)polygon->rows) {
+		return 0;
+	}
+	for (i = polygon->row_start[row]; i < polygon->row_start[row + 1]; i++) {
+		const nmea_geofence_edge_t *edge = &polygon->edges[polygon->row_edges[i]];
+
+		if (edge->y_low <= y && y < edge->y_high && x < edge->x_low + (y - edge->y_low) * edge->dx_dy) {
+			inside ^= 1;
+		}
+	}
+	return inside;
+}
+
+static void polygon_free(nmea_geofence_polygon_t *polygon)
+{
+	free(polygon->row_start);
+	free(polygon->row_edges);
+	free(polygon->edges);
+	polygon->row_start = NULL;
+	polygon->row_edges = NULL;
+	polygon->edges = NULL;
+}
+
+/**
+********************************************************************************
+* Edges of a polygon, listed per grid row they span
+* @param  geofence: Engine of the grid
+* @param  polygon: Polygon with its box set
+* @param  x: Longitude of each vertex, unwrapped
+* @param  y: Latitude of each vertex
+* @param  count: Number of vertices
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+static int polygon_edges(nmea_geofence_t *geofence, nmea_geofence_polygon_t *polygon, const int64_t *x,
+		const int64_t *y, size_t count)
+{
+	size_t num_edges = 0, i;
+	int64_t row;
+
+	polygon->first_row = cell_row(geofence, polygon->min_y);
+	polygon->rows = (size_t)(cell_row(geofence, polygon->max_y) - polygon->first_row + 1);
+	polygon->edges = malloc(count * sizeof(nmea_geofence_edge_t));
+	polygon->row_start = calloc(polygon->rows + 1, sizeof(uint32_t));
+	if (!polygon->edges || !polygon->row_start) {
+		return -1;
+	}
+
+	// horizontal edges never cross a ray to the east
+	for (i = 0; i < count; i++) {
+		size_t j = i + 1 < count ? i + 1 : 0;
+		size_t low = y[i] < y[j] ? i : j, high = low == i ? j : i;
+		nmea_geofence_edge_t *edge = &polygon->edges[num_edges];
+
+		if (y[i] == y[j]) {
+			continue;
+		}
+		edge->y_low = (double)y[low];
+		edge->y_high = (double)y[high];
+		edge->x_low = (double)x[low];
+		edge->dx_dy = (double)(x[high] - x[low]) / (double)(y[high] - y[low]);
+		for (row = cell_row(geofence, y[low]); row <= cell_row(geofence, y[high]); row++) {
+			polygon->row_start[row - polygon->first_row + 1]++;
+		}
+		num_edges++;
+	}
+	for (i = 0; i < polygon->rows; i++) {
+		polygon->row_start[i + 1] += polygon->row_start[i];
+	}
+
+	polygon->row_edges = malloc((polygon->row_start[polygon->rows] + 1) * sizeof(uint32_t));
+	if (!polygon->row_edges) {
+		return -1;
+	}
+	for (i = 0; i < num_edges; i++) {
+		const nmea_geofence_edge_t *edge = &polygon->edges[i];
+
+		// row_start[r] is moved to the end of row r - 1, then back
+		for (row = cell_row(geofence, (int64_t)edge->y_low); row <= cell_row(geofence, (int64_t)edge->y_high); row++) {
+			polygon->row_edges[polygon->row_start[row - polygon->first_row]++] = (uint32_t)i;
+		}
+	}
+	for (i = polygon->rows; i > 0; i--) {
+		polygon->row_start[i] = polygon->row_start[i - 1];
+	}
+	polygon->row_start[0] = 0;
+
+	return 0;
+}
+
+/**
+********************************************************************************
+* Classify the cells of the box of a polygon, and add an entry for each cell
+* that holds part of its boundary or lies inside it
+* @param  geofence: Engine of the grid
+* @param  index: Index of the polygon, with its edges listed
+* @param  x: Longitude of each vertex, unwrapped
+* @param  y: Latitude of each vertex
+* @param  count: Number of vertices
+* @return 0 on success, -1 if the box is too large or memory could not be
+*         allocated
+********************************************************************************/
+static int polygon_cells(nmea_geofence_t *geofence, uint32_t index, const int64_t *x, const int64_t *y, size_t count)
+{
+	const nmea_geofence_polygon_t *polygon = &geofence->polygons[index];
+	int64_t first_column = cell_column(geofence, polygon->min_x);
+	int64_t columns = cell_column(geofence, polygon->max_x) - first_column + 1;
+	int64_t rows = (int64_t)polygon->rows;
+	int64_t cell = geofence->cell_e7, row, column;
+	uint8_t *grid;
+	size_t i;
+	int ret = 0;
+
+	if (rows * columns > NMEA_GEOFENCE_MAX_CELLS || !(grid = calloc(rows * columns, 1))) {
+		return -1;
+	}
+
+	// the cells of every edge, a row at a time
+	for (i = 0; i < count; i++) {
+		size_t j = i + 1 < count ? i + 1 : 0;
+		int64_t y_low = y[i] < y[j] ? y[i] : y[j], y_high = y[i] < y[j] ? y[j] : y[i];
+
+		for (row = cell_row(geofence, y_low); row <= cell_row(geofence, y_high); row++) {
+			double band_low = (double)(row * cell - LATITUDE_SPAN / 2), band_high = band_low + cell;
+			double x_from = (double)x[i], x_to = (double)x[j];
+			int64_t from, to;
+
+			if (y[i] != y[j]) {
+				double dx_dy = (double)(x[j] - x[i]) / (double)(y[j] - y[i]);
+
+				band_low = band_low > y_low ? band_low : y_low;
+				band_high = band_high < y_high ? band_high : y_high;
+				x_from = x[i] + (band_low - y[i]) * dx_dy;
+				x_to = x[i] + (band_high - y[i]) * dx_dy;
+			}
+			// a unit of slack for the rounding of the ends
+			from = cell_column(geofence, (int64_t)floor((x_from < x_to ? x_from : x_to) - 1)) - first_column;
+			to = cell_column(geofence, (int64_t)floor((x_from < x_to ? x_to : x_from) + 1)) - first_column;
+			for (column = from < 0 ? 0 : from; column <= to && column < columns; column++) {
+				grid[(row - polygon->first_row) * columns + column] = CELL_BOUNDARY;
+			}
+		}
+	}
+
+	// one test per run of cells free of the boundary
+	for (row = 0; row < rows; row++) {
+		int state = 0;
+
+		for (column = 0; column < columns; column++) {
+			uint8_t *mark = &grid[row * columns + column];
+
+			if (*mark == CELL_BOUNDARY) {
+				state = 0;
+				continue;
+			}
+			if (!state) {
+				double center_x = (double)((first_column + column) * cell - LONGITUDE_SPAN / 2 + cell / 2);
+				double center_y = (double)((polygon->first_row + row) * cell - LATITUDE_SPAN / 2 + cell / 2);
+
+				state = polygon_contains(geofence, polygon, center_x, center_y) ? CELL_INSIDE : -1;
+			}
+			if (state == CELL_INSIDE) {
+				*mark = CELL_INSIDE;
+			}
+		}
+	}
+
+	for (row = 0; row < rows && !ret; row++) {
+		for (column = 0; column < columns && !ret; column++) {
+			uint8_t mark = grid[row * columns + column];
+
+			if (mark) {
+				ret = add_entry(geofence, cell_key(geofence, polygon->first_row + row, first_column + column),
+						index << 1 | (mark == CELL_BOUNDARY));
+			}
+		}
+	}
+	free(grid);
+
+	return ret;
+}
+
+static int add_entry(nmea_geofence_t *geofence, uint64_t cell, uint32_t polygon)
+{
+	if (geofence->num_entries == geofence->entry_capacity) {
+		size_t capacity = geofence->entry_capacity ? 2 * geofence->entry_capacity : 1024;
+		nmea_geofence_entry_t *entries;
+
+		if (capacity > UINT32_MAX || !(entries = realloc(geofence->entries, capacity * sizeof(*entries)))) {
+			return -1;
+		}
+		geofence->entries = entries;
+		geofence->entry_capacity = capacity;
+	}
+	geofence->entries[geofence->num_entries].cell = cell;
+	geofence->entries[geofence->num_entries].polygon = polygon;
+	geofence->num_entries++;
+
+	return 0;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+	const nmea_geofence_entry_t *ea = a, *eb = b;
+
+	if (ea->cell != eb->cell) {
+		return ea->cell < eb->cell ? -1 : 1;
+	}
+	return ea->polygon < eb->polygon ? -1 : ea->polygon > eb->polygon;
+}
+
+static const nmea_geofence_cell_t *find_cell(const nmea_geofence_t *geofence, int32_t latitude_e7, int32_t longitude_e7)
+{
+	uint64_t key = cell_key(geofence, cell_row(geofence, latitude_e7), cell_column(geofence, longitude_e7)) + 1;
+	size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & geofence->cell_mask;
+
+	while (geofence->cells[slot].key) {
+		if (geofence->cells[slot].key == key) {
+			return &geofence->cells[slot];
+		}
+		slot = (slot + 1) & geofence->cell_mask;
+	}
+	return NULL;
+}
+
+/**
+********************************************************************************
+* Polygons holding a point
+* @param  geofence: Built engine
+* @param  latitude_e7: Latitude of the point, 1e-7 degree
+* @param  longitude_e7: Longitude of the point, 1e-7 degree
+* @param  polygons: Indices of the polygons holding the point, ascending
+* @return Number of polygons holding the point
+********************************************************************************/
+static size_t polygons_at(const nmea_geofence_t *geofence, int32_t latitude_e7, int32_t longitude_e7, uint32_t *polygons)
+{
+	const nmea_geofence_cell_t *cell = find_cell(geofence, latitude_e7, longitude_e7);
+	size_t count = 0;
+	uint32_t i;
+
+	if (!cell) {
+		return 0;
+	}
+	for (i = cell->first; i < cell->first + cell->count; i++) {
+		uint32_t index = geofence->entries[i].polygon >> 1;
+		const nmea_geofence_polygon_t *polygon = &geofence->polygons[index];
+		int64_t x = longitude_e7;
+
+		if (geofence->entries[i].polygon & 1) {
+			// into the unwrapped box of the polygon
+			while (x < polygon->min_x) x += LONGITUDE_SPAN;
+			while (x >= polygon->min_x + LONGITUDE_SPAN) x -= LONGITUDE_SPAN;
+			if (!polygon_contains(geofence, polygon, (double)x, (double)latitude_e7)) {
+				continue;
+			}
+		}
+		polygons[count++] = index;
+	}
+	return count;
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
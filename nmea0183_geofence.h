@@ -0,0 +1,164 @@
+/** @file
+ *  Provides prototypes for the geofence engine: polygons loaded once into a
+ *  grid of cells, and enter and exit events of vehicles from batches of fixes.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_GEOFENCE_H__
+#define __NMEA0183_GEOFENCE_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_GEOFENCE_CELL_E7		100000			/**< Default side of a grid cell, 1e-7 degree (0.01 degree). */
+#define NMEA_GEOFENCE_MAX_CELLS		(64 * 1024 * 1024)	/**< Most grid cells covered by the box of a polygon. */
+
+/**
+ * Transition of a vehicle across the boundary of a fence
+ */
+typedef enum {
+	NMEA_GEOFENCE_ENTER = 1,
+	NMEA_GEOFENCE_EXIT = 2
+} nmea_geofence_transition;
+
+typedef struct nmea_geofence_event_t
+{
+	uint32_t vehicle;
+	uint32_t fence;								/**< Id given to nmea_geofence_add(). */
+	size_t fix;									/**< Index of the fix in the batch. */
+	nmea_geofence_transition transition;
+} nmea_geofence_event_t;
+
+typedef void (*nmea_geofence_callback_t)(const nmea_geofence_event_t *event, void *user_data);
+
+/**
+ * Non-horizontal edge of a polygon, for the crossings of a ray from a point
+ * to the east: the edge crosses it if y_low <= y < y_high and the point is
+ * west of x_low + (y - y_low) * dx_dy. Coordinates are 1e-7 degree, with
+ * longitudes unwrapped from the first vertex.
+ */
+typedef struct nmea_geofence_edge_t
+{
+	double y_low;
+	double y_high;
+	double x_low;
+	double dx_dy;
+} nmea_geofence_edge_t;
+
+/**
+ * Polygon, with its edges listed per grid row so that a point test only
+ * reads the edges of its row
+ */
+typedef struct nmea_geofence_polygon_t
+{
+	uint32_t fence;
+	int64_t min_x, max_x, min_y, max_y;			/**< Bounding box, unwrapped. */
+	int64_t first_row;							/**< Grid row of min_y. */
+	size_t rows;
+	uint32_t *row_start;						/**< rows + 1 offsets into row_edges. */
+	uint32_t *row_edges;						/**< Indices into edges. */
+	nmea_geofence_edge_t *edges;
+} nmea_geofence_polygon_t;
+
+/**
+ * Polygon met in a grid cell
+ */
+typedef struct nmea_geofence_entry_t
+{
+	uint64_t cell;
+	uint32_t polygon;							/**< Polygon index << 1 | 1 if the cell holds part of its boundary. */
+} nmea_geofence_entry_t;
+
+/**
+ * Polygons met in a grid cell, entries first to first + count - 1
+ */
+typedef struct nmea_geofence_cell_t
+{
+	uint64_t key;								/**< Cell + 1, 0 for a free slot. */
+	uint32_t first;
+	uint32_t count;
+} nmea_geofence_cell_t;
+
+/**
+ * Fences a vehicle was in after its last fix, sorted by polygon index
+ */
+typedef struct nmea_geofence_vehicle_t
+{
+	uint32_t key;								/**< Vehicle + 1, 0 for a free slot, see nmea_vehicle_find(). */
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t *polygons;
+} nmea_geofence_vehicle_t;
+
+/**
+ * Geofence engine. Polygons are added, then built once into the grid; fixes
+ * are evaluated from one thread at a time.
+ */
+typedef struct nmea_geofence_t
+{
+	int64_t cell_e7;
+	int64_t columns;							/**< Grid cells around a parallel. */
+	nmea_geofence_polygon_t *polygons;
+	size_t num_polygons;
+	size_t polygon_capacity;
+	nmea_geofence_cell_t *cells;				/**< Open-addressed by cell. */
+	size_t cell_mask;
+	nmea_geofence_entry_t *entries;				/**< Sorted by cell once built. */
+	size_t num_entries;
+	size_t entry_capacity;
+	nmea_geofence_vehicle_t *vehicles;			/**< Open-addressed by vehicle. */
+	size_t vehicle_mask;
+	uint32_t *inside;							/**< Polygons holding the fix under evaluation. */
+	size_t dropped;								/**< Fixes of vehicles beyond the capacity or NMEA_VEHICLE_MAX. */
+	int built;
+} nmea_geofence_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_geofence_init(nmea_geofence_t *geofence, int32_t cell_e7, size_t max_vehicles);
+void nmea_geofence_destroy(nmea_geofence_t *geofence);
+int nmea_geofence_add(nmea_geofence_t *geofence, uint32_t fence, const int32_t *latitude_e7,
+		const int32_t *longitude_e7, size_t count);
+int nmea_geofence_build(nmea_geofence_t *geofence);
+size_t nmea_geofence_contains(const nmea_geofence_t *geofence, int32_t latitude_e7, int32_t longitude_e7,
+		uint32_t *fences, size_t max_fences);
+size_t nmea_geofence_evaluate(nmea_geofence_t *geofence, const uint32_t *vehicles, const int32_t *latitude_e7,
+		const int32_t *longitude_e7, size_t count, nmea_geofence_callback_t callback, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
@@ -0,0 +1,330 @@
+/** @file
+ *  Provides implementation for the parser instrumentation.
+ *
+ *  Every thread that parses gets a block of counters on its first sentence,
+ *  found again thru a thread-local pointer. Only the owner writes a block,
+ *  with plain adds stored atomically, so the hot path takes no lock and no
+ *  locked instruction. Blocks are pushed once onto a lock-free list that a
+ *  scraper walks to add them up while the parsers run; a snapshot is not an
+ *  instant of all threads, but every counter in it is a value it really had.
+ *
+ *  Latencies are in ticks of the time stamp counter on x86-64, converted
+ *  to nanoseconds by the rate measured between the first block and the
+ *  snapshot, and in nanoseconds of CLOCK_MONOTONIC elsewhere.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#define NMEA_METRICS_TSC
+#endif
+
+#include "nmea0183_metrics.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+#ifdef NMEA_METRICS
+static void metrics_once(void);
+static void metrics_detach(void *block);
+static uint64_t clock_ns(void);
+#endif
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+static const char *const stage_names[NMEA_STAGE_CODE_INVALID] = {
+	"framing", "checksum", "decode", "output"
+};
+
+#ifdef NMEA_METRICS
+static nmea_metrics_thread_t *metrics_blocks;	// all blocks, newest first
+static pthread_once_t metrics_init = PTHREAD_ONCE_INIT;
+static pthread_key_t metrics_key;				// releases the block of an exiting thread
+static uint64_t origin_ticks;					// clock of the first block, for the tick rate
+static uint64_t origin_ns;
+#endif
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+#ifdef NMEA_METRICS
+__thread nmea_metrics_thread_t *nmea_metrics_tls;
+#endif
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Tell whether the instrumentation is compiled in
+* @return 1 if built with NMEA_METRICS, 0 otherwise
+********************************************************************************/
+int nmea_metrics_enabled(void)
+{
+#ifdef NMEA_METRICS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/**
+********************************************************************************
+* Add up the counters of every thread that parsed so far, without stopping
+* them. Counters only grow, so two snapshots give the rates in between.
+* @param  snapshot: Sums of the counters, all zero when not compiled in
+********************************************************************************/
+void nmea_metrics_snapshot(nmea_metrics_t *snapshot)
+{
+	memset(snapshot, 0, sizeof(*snapshot));
+	snapshot->ns_per_tick = 1;
+#ifdef NMEA_METRICS
+	nmea_metrics_thread_t *block = __atomic_load_n(&metrics_blocks, __ATOMIC_ACQUIRE);
+	const uint64_t *from;
+	uint64_t *to = (uint64_t *)snapshot;
+	size_t i, words = offsetof(nmea_metrics_t, ns_per_tick) / sizeof(uint64_t);
+
+	// the counters are the leading uint64_t members
+	for (; block; block = block->next) {
+		from = (const uint64_t *)&block->metrics;
+		for (i = 0; i < words; i++) {
+			to[i] += __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+		}
+		snapshot->threads++;
+	}
+#ifdef NMEA_METRICS_TSC
+	if (__atomic_load_n(&origin_ticks, __ATOMIC_ACQUIRE)) {
+		uint64_t ns = clock_ns() - origin_ns, ticks;
+
+		// a millisecond at least, for a rate within 0.1%
+		if (ns < 1000000) {
+			struct timespec wait = { 0, 1000000 - ns };
+
+			nanosleep(&wait, NULL);
+			ns = clock_ns() - origin_ns;
+		}
+		ticks = nmea_metrics_ticks() - origin_ticks;
+		snapshot->ns_per_tick = ticks ? (double)ns / ticks : snapshot->ns_per_tick;
+	}
+#endif
+#endif
+}
+
+/**
+********************************************************************************
+* Add counters of another snapshot, e.g. of another process
+* @param  metrics: Counters to update
+* @param  other: Counters to add, with the same tick rate
+********************************************************************************/
+void nmea_metrics_merge(nmea_metrics_t *metrics, const nmea_metrics_t *other)
+{
+	const uint64_t *from = (const uint64_t *)other;
+	uint64_t *to = (uint64_t *)metrics;
+	size_t i, words = offsetof(nmea_metrics_t, ns_per_tick) / sizeof(uint64_t);
+
+	for (i = 0; i < words; i++) {
+		to[i] += from[i];
+	}
+	metrics->threads += other->threads;
+}
+
+/**
+********************************************************************************
+* Number of sentences counted
+* @param  metrics: Counters
+* @return Sentences of every parse result
+********************************************************************************/
+uint64_t nmea_metrics_sentences(const nmea_metrics_t *metrics)
+{
+	return metrics->results[RMC_PARSE_SUCCESSFUL_WITH_FIX] + metrics->results[RMC_PARSE_SUCCESSFUL_WITH_NO_FIX] +
+			metrics->results[RMC_PARSE_FAILED];
+}
+
+/**
+********************************************************************************
+* Latency of a stage below which a fraction of the samples fall
+* @param  metrics: Counters
+* @param  stage: Ingest stage
+* @param  fraction: Fraction of the samples, e.g. 0.99
+* @return Upper bound of the bucket holding that sample in nanoseconds, 0
+*         without samples
+********************************************************************************/
+double nmea_metrics_percentile(const nmea_metrics_t *metrics, nmea_metrics_stage stage, double fraction)
+{
+	const uint64_t *buckets = metrics->latency[stage];
+	uint64_t samples = 0, seen = 0;
+	int k;
+
+	for (k = 0; k < NMEA_METRICS_BUCKETS; k++) {
+		samples += buckets[k];
+	}
+	for (k = 0; k < NMEA_METRICS_BUCKETS && samples; k++) {
+		seen += buckets[k];
+		if (seen >= fraction * samples) {
+			return (double)(1ULL << k) * metrics->ns_per_tick;
+		}
+	}
+	return 0;
+}
+
+/**
+********************************************************************************
+* Mean latency of a stage
+* @param  metrics: Counters
+* @param  stage: Ingest stage
+* @return Mean of the samples in nanoseconds, 0 without samples
+********************************************************************************/
+double nmea_metrics_mean(const nmea_metrics_t *metrics, nmea_metrics_stage stage)
+{
+	uint64_t samples = 0;
+	int k;
+
+	for (k = 0; k < NMEA_METRICS_BUCKETS; k++) {
+		samples += metrics->latency[stage][k];
+	}
+	return samples ? metrics->latency_ticks[stage] * metrics->ns_per_tick / samples : 0;
+}
+
+/**
+********************************************************************************
+* Name of a stage, for reports
+* @param  stage: Ingest stage
+* @return Lower case name, "invalid" when out of range
+********************************************************************************/
+const char *nmea_metrics_stage_name(nmea_metrics_stage stage)
+{
+	if ((unsigned int)stage >= NMEA_STAGE_CODE_INVALID) {
+		return "invalid";
+	}
+	return stage_names[stage];
+}
+
+#ifdef NMEA_METRICS
+
+/**
+********************************************************************************
+* Give the calling thread a block of counters, one released by a thread that
+* exited if any, on its first sentence
+* @return Block of the thread, NULL if out of memory; tried again on the
+*         next sentence
+********************************************************************************/
+nmea_metrics_thread_t *nmea_metrics_attach(void)
+{
+	nmea_metrics_thread_t *block;
+
+	pthread_once(&metrics_init, metrics_once);
+	for (block = __atomic_load_n(&metrics_blocks, __ATOMIC_ACQUIRE); block; block = block->next) {
+		int released = 0;
+
+		if (__atomic_compare_exchange_n(&block->owned, &released, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+	if (!block) {
+		block = calloc(1, sizeof(nmea_metrics_thread_t));
+		if (!block) {
+			return NULL;
+		}
+		block->owned = 1;
+		block->next = __atomic_load_n(&metrics_blocks, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&metrics_blocks, &block->next, block, 1, __ATOMIC_RELEASE,
+				__ATOMIC_RELAXED)) {
+		}
+	}
+	block->countdown = NMEA_METRICS_SAMPLE_PERIOD;
+	block->mark = 0;
+	block->output_mark = 0;
+	nmea_metrics_tls = block;
+	pthread_setspecific(metrics_key, block);
+
+	return block;
+}
+
+/**
+********************************************************************************
+* Current tick of the latency clock
+********************************************************************************/
+uint64_t nmea_metrics_ticks(void)
+{
+#ifdef NMEA_METRICS_TSC
+	return __rdtsc();
+#else
+	return clock_ns();
+#endif
+}
+
+#endif
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+#ifdef NMEA_METRICS
+
+/**
+********************************************************************************
+* Set up the release of blocks and the origin of the tick rate, once
+********************************************************************************/
+static void metrics_once(void)
+{
+	pthread_key_create(&metrics_key, metrics_detach);
+	origin_ns = clock_ns();
+	__atomic_store_n(&origin_ticks, nmea_metrics_ticks(), __ATOMIC_RELEASE);
+}
+
+/**
+********************************************************************************
+* Release the block of an exiting thread to the next new one
+* @param  block: Block of the thread
+********************************************************************************/
+static void metrics_detach(void *block)
+{
+	__atomic_store_n(&((nmea_metrics_thread_t *)block)->owned, 0, __ATOMIC_RELEASE);
+}
+
+/**
+********************************************************************************
+* Nanoseconds of the monotonic clock
+********************************************************************************/
+static uint64_t clock_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
@@ -0,0 +1,198 @@
+/** @file
+ *  Provides prototypes for the parser instrumentation: per-thread counters
+ *  of the sentences parsed and latency histograms of the ingest stages, read
+ *  by a scraper while the parsers run. Built with NMEA_METRICS defined
+ *  ('make METRICS=1'); otherwise the hooks compile to nothing and snapshots
+ *  stay zero.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_METRICS_H__
+#define __NMEA0183_METRICS_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nmea0183_parser.h"
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_METRICS_BUCKETS		40			/**< Latency buckets, bucket k holds [2^(k-1), 2^k) ticks. */
+#define NMEA_METRICS_SAMPLE_PERIOD	64			/**< One sentence in this many is timed. */
+
+/**
+ * Ingest stage of a sentence
+ */
+typedef enum {
+	NMEA_STAGE_FRAMING = 0,						/**< From the start of its line to its decoded address. */
+	NMEA_STAGE_CHECKSUM,						/**< Checksum verified and fields located. */
+	NMEA_STAGE_DECODE,							/**< Fields converted. */
+	NMEA_STAGE_OUTPUT,							/**< Result handed over: stored, or the callback run. */
+	NMEA_STAGE_CODE_INVALID
+} nmea_metrics_stage;
+
+/**
+ * Counters of one thread, or of several added up. The latency of a stage
+ * is measured on one sentence in NMEA_METRICS_SAMPLE_PERIOD.
+ */
+typedef struct nmea_metrics_t
+{
+	uint64_t bytes;								/**< Input handed to the parse functions. */
+	uint64_t results[RMC_PARSE_CODE_INVALID];	/**< Sentences by parse result. */
+	uint64_t errors[RMC_ERROR_CODE_INVALID];	/**< Failures by failed check. */
+	uint64_t types[NMEA_SENTENCE_CODE_INVALID];	/**< Sentences by type, as read from the address. */
+	uint64_t latency[NMEA_STAGE_CODE_INVALID][NMEA_METRICS_BUCKETS];
+	uint64_t latency_ticks[NMEA_STAGE_CODE_INVALID];	/**< Sum of the samples. */
+	double ns_per_tick;							/**< Of the latencies, set by nmea_metrics_snapshot(). */
+	size_t threads;								/**< Blocks added up: the most threads that parsed at once. */
+} nmea_metrics_t;
+
+/**
+ * Counters of a thread, only written by the thread that owns it. Blocks are
+ * never freed: the block of a thread that exits goes to the next new one,
+ * so the sums never go back. A thread that cannot get a block counts
+ * nothing until it can.
+ */
+typedef struct nmea_metrics_thread_t
+{
+	nmea_metrics_t metrics;
+	struct nmea_metrics_thread_t *next;			/**< List of all blocks, newest first. */
+	uint64_t mark;								/**< Tick the line of the next timed sentence started, or 0. */
+	uint64_t output_mark;						/**< Tick the last timed sentence was decoded, or 0. */
+	uint32_t countdown;							/**< Sentences until the next timed one. */
+	int owned;									/**< 1 while a thread owns the block. */
+} nmea_metrics_thread_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+#ifdef NMEA_METRICS
+extern __thread nmea_metrics_thread_t *nmea_metrics_tls;
+#endif
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_metrics_enabled(void);
+void nmea_metrics_snapshot(nmea_metrics_t *snapshot);
+void nmea_metrics_merge(nmea_metrics_t *metrics, const nmea_metrics_t *other);
+uint64_t nmea_metrics_sentences(const nmea_metrics_t *metrics);
+double nmea_metrics_percentile(const nmea_metrics_t *metrics, nmea_metrics_stage stage, double fraction);
+double nmea_metrics_mean(const nmea_metrics_t *metrics, nmea_metrics_stage stage);
+const char *nmea_metrics_stage_name(nmea_metrics_stage stage);
+
+#ifdef NMEA_METRICS
+
+nmea_metrics_thread_t *nmea_metrics_attach(void);
+uint64_t nmea_metrics_ticks(void);
+
+/**
+ * Hooks of the parse functions, all on the counters of the calling thread;
+ * they do nothing while the thread has no block
+ */
+static inline nmea_metrics_thread_t *nmea_metrics_self(void)
+{
+	nmea_metrics_thread_t *self = nmea_metrics_tls;
+
+	return __builtin_expect(self != NULL, 1) ? self : nmea_metrics_attach();
+}
+
+static inline void nmea_metrics_add(uint64_t *counter, uint64_t n)
+{
+	// one writer, so a plain add; the atomic store keeps readers from tearing it
+	__atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
+
+static inline void nmea_metrics_record(nmea_metrics_thread_t *self, nmea_metrics_stage stage, uint64_t ticks)
+{
+	int bucket = ticks ? 64 - __builtin_clzll(ticks) : 0;
+
+	if (bucket >= NMEA_METRICS_BUCKETS) {
+		bucket = NMEA_METRICS_BUCKETS - 1;
+	}
+	nmea_metrics_add(&self->metrics.latency[stage][bucket], 1);
+	nmea_metrics_add(&self->metrics.latency_ticks[stage], ticks);
+}
+
+// the block of the calling thread, for the hooks of a loop over lines
+#define NMEA_METRICS_THREAD(self) \
+	nmea_metrics_thread_t *self = nmea_metrics_self()
+
+#define NMEA_METRICS_BYTES(n) \
+	do { nmea_metrics_thread_t *self_ = nmea_metrics_self(); \
+		if (self_) nmea_metrics_add(&self_->metrics.bytes, (n)); } while (0)
+
+// a line starts: the framing of the next timed sentence is measured from here
+#define NMEA_METRICS_LINE(self) \
+	do { if ((self) && (self)->countdown <= 1) (self)->mark = nmea_metrics_ticks(); } while (0)
+
+// a sentence starts: tick is 0 unless the sentence is timed, which takes the mark of its line
+#define NMEA_METRICS_SENTENCE(self, tick) \
+	nmea_metrics_thread_t *self = nmea_metrics_self(); \
+	uint64_t tick = 0; \
+	if (self && --self->countdown == 0) { \
+		self->countdown = NMEA_METRICS_SAMPLE_PERIOD; \
+		tick = self->mark ? self->mark : nmea_metrics_ticks(); \
+		self->mark = 0; \
+	}
+
+// a stage of the timed sentence ends
+#define NMEA_METRICS_STAGE(self, tick, stage) \
+	do { if (tick) { uint64_t now_ = nmea_metrics_ticks(); \
+		nmea_metrics_record(self, stage, now_ - tick); tick = now_; } } while (0)
+
+// the sentence is parsed: count it, the output of a timed one starts
+#define NMEA_METRICS_RESULT(self, tick, type, result, error) \
+	do { if (self) { nmea_metrics_add(&self->metrics.types[type], 1); \
+		nmea_metrics_add(&self->metrics.results[result], 1); \
+		if ((result) == RMC_PARSE_FAILED) nmea_metrics_add(&self->metrics.errors[error], 1); \
+		self->output_mark = tick; } } while (0)
+
+// the result of the last sentence is handed over
+#define NMEA_METRICS_OUTPUT(self) \
+	do { if ((self) && (self)->output_mark) { \
+			nmea_metrics_record(self, NMEA_STAGE_OUTPUT, nmea_metrics_ticks() - (self)->output_mark); \
+			(self)->output_mark = 0; } } while (0)
+
+#else
+
+#define NMEA_METRICS_THREAD(self)							do { } while (0)
+#define NMEA_METRICS_BYTES(n)								do { } while (0)
+#define NMEA_METRICS_LINE(self)								do { } while (0)
+#define NMEA_METRICS_SENTENCE(self, tick)					do { } while (0)
+#define NMEA_METRICS_STAGE(self, tick, stage)				do { } while (0)
+#define NMEA_METRICS_RESULT(self, tick, type, result, error)	do { } while (0)
+#define NMEA_METRICS_OUTPUT(self)							do { } while (0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
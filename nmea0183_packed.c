@@ -0,0 +1,345 @@
+/** @file
+ *  Provides implementation for the compact fix representations.
+ *
+ *  A batch allocates its five columns as one block. The capacity is kept a
+ *  multiple of NMEA_FIX_BATCH_ALIGN / sizeof(uint16_t) elements, so each
+ *  column starts aligned when the block is. nmea_fix_batch_parse() decodes
+ *  every sentence into one nmea_rmc_data_t on the stack, which stays in L1,
+ *  and stores the fixes straight into the columns.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "nmea0183_packed.h"
+#include "nmea0183_metrics.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define BATCH_CAPACITY_STEP			(NMEA_FIX_BATCH_ALIGN / sizeof(uint16_t))
+#define BATCH_ELEMENT_SIZE			(3 * sizeof(int32_t) + 2 * sizeof(uint16_t))
+#define BATCH_INITIAL_CAPACITY		1024
+
+_Static_assert(sizeof(nmea_packed_fix_t) == 16, "nmea_packed_fix_t must stay 16 bytes");
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static uint16_t pack_speed(double speed);
+static uint16_t pack_heading(double heading);
+static int batch_grow(nmea_fix_batch_t *batch, size_t count);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Pack a fix parsed with at least RMC_FIELD_MASK_PACKED
+* @param  fix: Fix to pack
+* @param  packed: Packed fix
+********************************************************************************/
+void nmea_fix_pack(const nmea_rmc_data_t *fix, nmea_packed_fix_t *packed)
+{
+	packed->latitude_e7 = fix->latitude_e7;
+	packed->longitude_e7 = fix->longitude_e7;
+	packed->epoch_s = (uint32_t)(fix->epoch_ms / 1000);
+	packed->speed = pack_speed(fix->ground_speed);
+	packed->heading = pack_heading(fix->heading);
+}
+
+/**
+********************************************************************************
+* Convert a packed fix back to the parser's representation
+* @param  packed: Packed fix
+* @param  fix: Fix as parse_rmc() would fill it in, up to the packed precision
+********************************************************************************/
+void nmea_fix_unpack(const nmea_packed_fix_t *packed, nmea_rmc_data_t *fix)
+{
+	nmea_rmc_set_time(fix, (int64_t)packed->epoch_s * 1000);
+	fix->status = 'A';
+	fix->mode = 0;
+	fix->nav_status = 0;
+	fix->latitude_e7 = packed->latitude_e7;
+	fix->longitude_e7 = packed->longitude_e7;
+	fix->latitude = packed->latitude_e7 / 1e7;
+	fix->longitude = packed->longitude_e7 / 1e7;
+	fix->ground_speed = (double)packed->speed / NMEA_PACKED_SPEED_SCALE;
+	fix->heading = (double)packed->heading / NMEA_PACKED_HEADING_SCALE;
+	fix->magnetic_var = 0;
+}
+
+/**
+********************************************************************************
+* Initialize an empty batch
+* @param  batch: Batch to initialize
+* @param  capacity: Fixes held before the batch grows, 0 for none
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+int nmea_fix_batch_init(nmea_fix_batch_t *batch, size_t capacity)
+{
+	memset(batch, 0, sizeof(*batch));
+	return capacity ? nmea_fix_batch_reserve(batch, capacity) : 0;
+}
+
+/**
+********************************************************************************
+* Free the columns of a batch
+* @param  batch: Batch to free
+********************************************************************************/
+void nmea_fix_batch_free(nmea_fix_batch_t *batch)
+{
+	free(batch->latitude_e7);
+	memset(batch, 0, sizeof(*batch));
+}
+
+/**
+********************************************************************************
+* Make room for a number of fixes, keeping the ones held
+* @param  batch: Batch to grow
+* @param  capacity: Fixes to hold
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+int nmea_fix_batch_reserve(nmea_fix_batch_t *batch, size_t capacity)
+{
+	nmea_fix_batch_t grown;
+	void *block;
+
+	if (capacity <= batch->capacity) {
+		return 0;
+	}
+	capacity = (capacity + BATCH_CAPACITY_STEP - 1) / BATCH_CAPACITY_STEP * BATCH_CAPACITY_STEP;
+	if (posix_memalign(&block, NMEA_FIX_BATCH_ALIGN, capacity * BATCH_ELEMENT_SIZE)) {
+		return -1;
+	}
+	grown.count = batch->count;
+	grown.capacity = capacity;
+	grown.latitude_e7 = (int32_t *)block;
+	grown.longitude_e7 = grown.latitude_e7 + capacity;
+	grown.epoch_s = (uint32_t *)(grown.longitude_e7 + capacity);
+	grown.speed = (uint16_t *)(grown.epoch_s + capacity);
+	grown.heading = grown.speed + capacity;
+	if (batch->count) {
+		memcpy(grown.latitude_e7, batch->latitude_e7, batch->count * sizeof(int32_t));
+		memcpy(grown.longitude_e7, batch->longitude_e7, batch->count * sizeof(int32_t));
+		memcpy(grown.epoch_s, batch->epoch_s, batch->count * sizeof(uint32_t));
+		memcpy(grown.speed, batch->speed, batch->count * sizeof(uint16_t));
+		memcpy(grown.heading, batch->heading, batch->count * sizeof(uint16_t));
+	}
+	free(batch->latitude_e7);
+	*batch = grown;
+	return 0;
+}
+
+/**
+********************************************************************************
+* Append a fix parsed with at least RMC_FIELD_MASK_PACKED
+* @param  batch: Batch to append to
+* @param  fix: Fix to append
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+int nmea_fix_batch_append(nmea_fix_batch_t *batch, const nmea_rmc_data_t *fix)
+{
+	size_t i = batch->count;
+
+	if (i == batch->capacity && batch_grow(batch, 1)) {
+		return -1;
+	}
+	batch->latitude_e7[i] = fix->latitude_e7;
+	batch->longitude_e7[i] = fix->longitude_e7;
+	batch->epoch_s[i] = (uint32_t)(fix->epoch_ms / 1000);
+	batch->speed[i] = pack_speed(fix->ground_speed);
+	batch->heading[i] = pack_heading(fix->heading);
+	batch->count = i + 1;
+	return 0;
+}
+
+/**
+********************************************************************************
+* Convert a fix of a batch back to the parser's representation
+* @param  batch: Batch holding the fix
+* @param  i: Index of the fix
+* @param  fix: Fix as parse_rmc() would fill it in, up to the packed precision
+********************************************************************************/
+void nmea_fix_batch_get(const nmea_fix_batch_t *batch, size_t i, nmea_rmc_data_t *fix)
+{
+	nmea_packed_fix_t packed;
+
+	nmea_fix_batch_get_packed(batch, i, 1, &packed);
+	nmea_fix_unpack(&packed, fix);
+}
+
+/**
+********************************************************************************
+* Append packed fixes, scattering them over the columns
+* @param  batch: Batch to append to
+* @param  packed: Fixes to append
+* @param  count: Number of fixes
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+int nmea_fix_batch_append_packed(nmea_fix_batch_t *batch, const nmea_packed_fix_t *packed, size_t count)
+{
+	size_t base = batch->count, i;
+
+	if (base + count > batch->capacity && batch_grow(batch, count)) {
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		batch->latitude_e7[base + i] = packed[i].latitude_e7;
+		batch->longitude_e7[base + i] = packed[i].longitude_e7;
+		batch->epoch_s[base + i] = packed[i].epoch_s;
+		batch->speed[base + i] = packed[i].speed;
+		batch->heading[base + i] = packed[i].heading;
+	}
+	batch->count = base + count;
+	return 0;
+}
+
+/**
+********************************************************************************
+* Gather fixes of a batch as packed fixes
+* @param  batch: Batch holding the fixes
+* @param  first: Index of the first fix
+* @param  count: Number of fixes, first + count at most batch->count
+* @param  packed: Packed fixes
+********************************************************************************/
+void nmea_fix_batch_get_packed(const nmea_fix_batch_t *batch, size_t first, size_t count, nmea_packed_fix_t *packed)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		packed[i].latitude_e7 = batch->latitude_e7[first + i];
+		packed[i].longitude_e7 = batch->longitude_e7[first + i];
+		packed[i].epoch_s = batch->epoch_s[first + i];
+		packed[i].speed = batch->speed[first + i];
+		packed[i].heading = batch->heading[first + i];
+	}
+}
+
+/**
+********************************************************************************
+* Parse the sentences of a buffer, appending the fixes to a batch
+* @param  batch: Batch to append to, grown as needed
+* @param  buf: Pointer to the buffer, sentences are split as by parse_rmc_buffer()
+* @param  len: Number of bytes in the buffer
+* @param  stats: Counters to update, or NULL
+* @return Number of fixes appended; fewer than found if memory ran out
+********************************************************************************/
+size_t nmea_fix_batch_parse(nmea_fix_batch_t *batch, const char *buf, size_t len, nmea_parse_stats_t *stats)
+{
+	const char *p = buf;
+	const char *end = buf + len;
+	const char *nl, *line_end, *p1, *p2;
+	size_t base = batch->count;
+	rmc_error_detail_t error;
+	rmc_line_result_t line;
+	nmea_rmc_data_t fix;
+	NMEA_METRICS_THREAD(metrics);
+
+	while (p < end) {
+		NMEA_METRICS_LINE(metrics);
+		nl = memchr(p, '\n', end - p);
+		line_end = nl ? nl : end;
+
+		for (p1 = memchr(p, '$', line_end - p); p1; p1 = p2) {
+			p2 = memchr(p1 + 1, '$', line_end - p1 - 1);
+			line.result = parse_rmc_fields(&fix, p1, (p2 ? p2 : line_end) - p1, RMC_FIELD_MASK_PACKED, &error);
+			line.error = error.field;
+			if (stats) {
+				nmea_parse_stats_add(stats, &line, 1);
+			}
+			if (line.result == RMC_PARSE_SUCCESSFUL_WITH_FIX && nmea_fix_batch_append(batch, &fix)) {
+				return batch->count - base;
+			}
+			NMEA_METRICS_OUTPUT(metrics);
+		}
+		p = nl ? nl + 1 : end;
+	}
+	return batch->count - base;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Quantize a speed, saturating out of range values
+* @param  speed: Speed in knots
+* @return Speed in 1 / NMEA_PACKED_SPEED_SCALE knot
+********************************************************************************/
+static uint16_t pack_speed(double speed)
+{
+	double v = round(speed * NMEA_PACKED_SPEED_SCALE);
+
+	if (!(v > 0)) return 0;
+	if (v > UINT16_MAX) return UINT16_MAX;
+	return (uint16_t)v;
+}
+
+/**
+********************************************************************************
+* Quantize a heading, normalized to [0, 360)
+* @param  heading: Heading in degrees, any sign
+* @return Heading in 1 / NMEA_PACKED_HEADING_SCALE degree
+********************************************************************************/
+static uint16_t pack_heading(double heading)
+{
+	double v = round(fmod(heading, 360.0) * NMEA_PACKED_HEADING_SCALE);
+
+	if (v < 0) v += 360 * NMEA_PACKED_HEADING_SCALE;
+	if (!(v < 360 * NMEA_PACKED_HEADING_SCALE)) v = 0;		// rounded up to 360, or NaN
+	return (uint16_t)v;
+}
+
+/**
+********************************************************************************
+* Grow a full batch geometrically
+* @param  batch: Batch to grow
+* @param  count: Fixes about to be appended
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+static int batch_grow(nmea_fix_batch_t *batch, size_t count)
+{
+	size_t capacity = batch->capacity ? 2 * batch->capacity : BATCH_INITIAL_CAPACITY;
+
+	if (capacity < batch->count + count) {
+		capacity = batch->count + count;
+	}
+	return nmea_fix_batch_reserve(batch, capacity);
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
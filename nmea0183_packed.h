@@ -0,0 +1,104 @@
+/** @file
+ *  Provides prototypes for the compact fix representations: a 16-byte packed
+ *  fix, and a structure-of-arrays batch of the same fields.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_PACKED_H__
+#define __NMEA0183_PACKED_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nmea0183_parser.h"
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_PACKED_SPEED_SCALE		100		/**< Units of speed per knot. */
+#define NMEA_PACKED_HEADING_SCALE	100		/**< Units of heading per degree. */
+#define NMEA_FIX_BATCH_ALIGN		32		/**< Alignment of every column of a batch. */
+
+/**
+ * Fields of a fix kept by the packed forms, which the parser is asked for
+ * by nmea_fix_batch_parse()
+ */
+#define RMC_FIELD_MASK_PACKED		(RMC_FIELD_MASK_POSITION | RMC_FIELD_MASK_TIMESTAMP | \
+									 RMC_FIELD_MASK_SPEED | RMC_FIELD_MASK_HEADING)
+
+/**
+ * Fix in 16 bytes, a third of nmea_rmc_data_t. Only fixes with status 'A'
+ * are packed; the fraction of seconds and magnetic variation are dropped.
+ */
+typedef struct nmea_packed_fix_t
+{
+	int32_t latitude_e7;						/**< 1e-7 degree. */
+	int32_t longitude_e7;						/**< 1e-7 degree. */
+	uint32_t epoch_s;							/**< UTC seconds since 1970-01-01. */
+	uint16_t speed;								/**< 1e-2 knot, saturated at 655.35 knots. */
+	uint16_t heading;							/**< 1e-2 degree, 0 to 359.99. */
+} nmea_packed_fix_t;
+
+/**
+ * Fixes as one array per field of nmea_packed_fix_t. The columns are
+ * NMEA_FIX_BATCH_ALIGN aligned so that scans over them vectorize.
+ */
+typedef struct nmea_fix_batch_t
+{
+	size_t count;
+	size_t capacity;
+	int32_t *latitude_e7;
+	int32_t *longitude_e7;
+	uint32_t *epoch_s;
+	uint16_t *speed;
+	uint16_t *heading;
+} nmea_fix_batch_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+void nmea_fix_pack(const nmea_rmc_data_t *fix, nmea_packed_fix_t *packed);
+void nmea_fix_unpack(const nmea_packed_fix_t *packed, nmea_rmc_data_t *fix);
+
+int nmea_fix_batch_init(nmea_fix_batch_t *batch, size_t capacity);
+void nmea_fix_batch_free(nmea_fix_batch_t *batch);
+int nmea_fix_batch_reserve(nmea_fix_batch_t *batch, size_t capacity);
+int nmea_fix_batch_append(nmea_fix_batch_t *batch, const nmea_rmc_data_t *fix);
+void nmea_fix_batch_get(const nmea_fix_batch_t *batch, size_t i, nmea_rmc_data_t *fix);
+int nmea_fix_batch_append_packed(nmea_fix_batch_t *batch, const nmea_packed_fix_t *packed, size_t count);
+void nmea_fix_batch_get_packed(const nmea_fix_batch_t *batch, size_t first, size_t count, nmea_packed_fix_t *packed);
+size_t nmea_fix_batch_parse(nmea_fix_batch_t *batch, const char *buf, size_t len, nmea_parse_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
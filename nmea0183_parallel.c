@@ -0,0 +1,432 @@
+/** @file
+ *  Provides implementation for parsing a large NMEA log on several threads.
+ *
+ *  The input is cut into chunks of NMEA_PARALLEL_CHUNK_SIZE bytes, moved to
+ *  the next line boundary, so that every chunk parses exactly as it would
+ *  sequentially. Chunks are processed a window at a time: each worker owns a
+ *  range of the window's chunks, takes them from the front, and steals the
+ *  back half of the largest remaining range once its own is empty. While the
+ *  workers parse one window, the calling thread hands the previous one to
+ *  the callback in input order, so memory stays bounded by two windows.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "nmea0183_parallel.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define CHUNK_INITIAL_CAPACITY		(NMEA_PARALLEL_CHUNK_SIZE / 64)
+
+/**
+ * Sentences parsed from one chunk
+ */
+typedef struct chunk_slot_t
+{
+	nmea_rmc_data_t *data;
+	rmc_line_result_t *results;
+	size_t count;
+	size_t capacity;
+} chunk_slot_t;
+
+/**
+ * Chunks of the current window still owned by a worker
+ */
+typedef struct ws_range_t
+{
+	pthread_mutex_t lock;
+	size_t begin;
+	size_t end;
+} __attribute__((aligned(64))) ws_range_t;
+
+/**
+ * State shared by the calling thread and the workers
+ */
+typedef struct parallel_ctx_t
+{
+	const char *buf;
+	size_t len;
+	int num_threads;
+	ws_range_t *ranges;					// one per worker
+	nmea_parse_stats_t *thread_stats;	// one per worker
+	chunk_slot_t *slots;				// slots of the window being parsed
+	size_t first_chunk;					// chunk index of slots[0]
+
+	pthread_mutex_t lock;
+	pthread_cond_t start_cond;
+	pthread_cond_t done_cond;
+	unsigned int generation;			// bumped for each window
+	int busy;							// workers still on the window
+	int quit;
+	int failed;
+} parallel_ctx_t;
+
+/**
+ * Worker thread argument
+ */
+typedef struct worker_arg_t
+{
+	parallel_ctx_t *ctx;
+	int id;
+} worker_arg_t;
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static void *worker_main(void *arg);
+static int worker_next_chunk(parallel_ctx_t *ctx, int id, size_t *chunk);
+static void parse_chunk(parallel_ctx_t *ctx, int id, size_t chunk);
+static size_t chunk_boundary(const parallel_ctx_t *ctx, size_t chunk);
+static int slot_grow(chunk_slot_t *slot);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Parse every sentence of a buffer, e.g. a memory-mapped log file, on a pool
+* of threads. Sentences reach the callback in input order, on the calling
+* thread, with the same results as parse_rmc_buffer() would give.
+* @param  buf: Pointer to the buffer
+* @param  len: Number of bytes in the buffer
+* @param  num_threads: Number of worker threads, 0 for one per online CPU
+* @param  callback: Receives the sentences in order, may be NULL
+* @param  user_data: Handed back to the callback
+* @param  stats: Merged counters of all workers, may be NULL
+* @return 0 on success, -1 if threads or memory could not be allocated
+********************************************************************************/
+int parse_rmc_parallel(const char *buf, size_t len, int num_threads,
+		nmea_batch_callback_t callback, void *user_data, nmea_parse_stats_t *stats)
+{
+	parallel_ctx_t ctx;
+	pthread_t *threads;
+	worker_arg_t *args;
+	chunk_slot_t *windows[2];
+	size_t total_chunks, window_size, first, prev_count = 0, w = 0, i;
+	int t, started = 0, result = 0;
+
+	if (num_threads <= 0) {
+		num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		if (num_threads <= 0) {
+			num_threads = 1;
+		}
+	}
+	total_chunks = (len + NMEA_PARALLEL_CHUNK_SIZE - 1) / NMEA_PARALLEL_CHUNK_SIZE;
+	window_size = (size_t)num_threads * NMEA_PARALLEL_CHUNKS_PER_THREAD;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.buf = buf;
+	ctx.len = len;
+	ctx.num_threads = num_threads;
+	ctx.ranges = aligned_alloc(64, num_threads * sizeof(ws_range_t));
+	ctx.thread_stats = calloc(num_threads, sizeof(nmea_parse_stats_t));
+	windows[0] = calloc(window_size, sizeof(chunk_slot_t));
+	windows[1] = calloc(window_size, sizeof(chunk_slot_t));
+	threads = calloc(num_threads, sizeof(pthread_t));
+	args = calloc(num_threads, sizeof(worker_arg_t));
+	pthread_mutex_init(&ctx.lock, NULL);
+	pthread_cond_init(&ctx.start_cond, NULL);
+	pthread_cond_init(&ctx.done_cond, NULL);
+	if (!ctx.ranges || !ctx.thread_stats || !windows[0] || !windows[1] || !threads || !args) {
+		result = -1;
+		goto parallel_cleanup;
+	}
+
+	for (t = 0; t < num_threads; t++) {
+		pthread_mutex_init(&ctx.ranges[t].lock, NULL);
+		ctx.ranges[t].begin = ctx.ranges[t].end = 0;
+		args[t].ctx = &ctx;
+		args[t].id = t;
+		if (pthread_create(&threads[t], NULL, worker_main, &args[t])) {
+			result = -1;
+			break;
+		}
+		started++;
+	}
+
+	for (first = 0; result == 0 && first < total_chunks; first += window_size, w++) {
+		size_t count = total_chunks - first < window_size ? total_chunks - first : window_size;
+
+		// hand the window to the workers, each owning an even share of it
+		pthread_mutex_lock(&ctx.lock);
+		ctx.slots = windows[w & 1];
+		ctx.first_chunk = first;
+		for (t = 0; t < num_threads; t++) {
+			ctx.ranges[t].begin = count * t / num_threads;
+			ctx.ranges[t].end = count * (t + 1) / num_threads;
+		}
+		ctx.busy = num_threads;
+		ctx.generation++;
+		pthread_cond_broadcast(&ctx.start_cond);
+		pthread_mutex_unlock(&ctx.lock);
+
+		// meanwhile, deliver the previous window
+		if (callback) {
+			chunk_slot_t *prev = windows[(w + 1) & 1];
+			for (i = 0; i < prev_count; i++) {
+				callback(prev[i].data, prev[i].results, prev[i].count, user_data);
+			}
+		}
+
+		pthread_mutex_lock(&ctx.lock);
+		while (ctx.busy) {
+			pthread_cond_wait(&ctx.done_cond, &ctx.lock);
+		}
+		pthread_mutex_unlock(&ctx.lock);
+
+		prev_count = count;
+	}
+
+	if (callback && result == 0) {
+		chunk_slot_t *prev = windows[(w + 1) & 1];
+		for (i = 0; i < prev_count; i++) {
+			callback(prev[i].data, prev[i].results, prev[i].count, user_data);
+		}
+	}
+
+	pthread_mutex_lock(&ctx.lock);
+	ctx.quit = 1;
+	pthread_cond_broadcast(&ctx.start_cond);
+	pthread_mutex_unlock(&ctx.lock);
+	for (t = 0; t < started; t++) {
+		pthread_join(threads[t], NULL);
+	}
+
+	if (ctx.failed) {
+		result = -1;
+	}
+	if (stats) {
+		memset(stats, 0, sizeof(*stats));
+		for (t = 0; t < num_threads; t++) {
+			nmea_parse_stats_merge(stats, &ctx.thread_stats[t]);
+		}
+	}
+
+parallel_cleanup:
+	for (i = 0; i < window_size; i++) {
+		if (windows[0]) {
+			free(windows[0][i].data);
+			free(windows[0][i].results);
+		}
+		if (windows[1]) {
+			free(windows[1][i].data);
+			free(windows[1][i].results);
+		}
+	}
+	free(windows[0]);
+	free(windows[1]);
+	free(ctx.ranges);
+	free(ctx.thread_stats);
+	free(threads);
+	free(args);
+	pthread_mutex_destroy(&ctx.lock);
+	pthread_cond_destroy(&ctx.start_cond);
+	pthread_cond_destroy(&ctx.done_cond);
+
+	return result;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+static void *worker_main(void *arg)
+{
+	parallel_ctx_t *ctx = ((worker_arg_t *)arg)->ctx;
+	int id = ((worker_arg_t *)arg)->id;
+	unsigned int generation = 0;
+	size_t chunk;
+
+	for (;;) {
+		pthread_mutex_lock(&ctx->lock);
+		while (!ctx->quit && ctx->generation == generation) {
+			pthread_cond_wait(&ctx->start_cond, &ctx->lock);
+		}
+		if (ctx->quit) {
+			pthread_mutex_unlock(&ctx->lock);
+			break;
+		}
+		generation = ctx->generation;
+		pthread_mutex_unlock(&ctx->lock);
+
+		while (worker_next_chunk(ctx, id, &chunk)) {
+			parse_chunk(ctx, id, chunk);
+		}
+
+		pthread_mutex_lock(&ctx->lock);
+		if (--ctx->busy == 0) {
+			pthread_cond_signal(&ctx->done_cond);
+		}
+		pthread_mutex_unlock(&ctx->lock);
+	}
+
+	return NULL;
+}
+
+/**
+********************************************************************************
+* Take the next chunk of a worker's own range, or steal the back half of the
+* largest range left when its own is empty
+* @param  ctx: Shared state
+* @param  id: Worker index
+* @param  chunk: Index of the chunk in the window
+* @return 1 if a chunk was found, 0 once the window is done
+********************************************************************************/
+static int worker_next_chunk(parallel_ctx_t *ctx, int id, size_t *chunk)
+{
+	ws_range_t *own = &ctx->ranges[id];
+	int t, victim;
+	size_t left, most;
+
+	for (;;) {
+		pthread_mutex_lock(&own->lock);
+		if (own->begin < own->end) {
+			*chunk = own->begin;
+			__atomic_store_n(&own->begin, own->begin + 1, __ATOMIC_RELAXED);
+			pthread_mutex_unlock(&own->lock);
+			return 1;
+		}
+		pthread_mutex_unlock(&own->lock);
+
+		// pick the victim with the most chunks left, reading without locks
+		victim = -1;
+		most = 0;
+		for (t = 0; t < ctx->num_threads; t++) {
+			left = __atomic_load_n(&ctx->ranges[t].end, __ATOMIC_RELAXED) -
+					__atomic_load_n(&ctx->ranges[t].begin, __ATOMIC_RELAXED);
+			if (t != id && (ptrdiff_t)left > (ptrdiff_t)most) {
+				victim = t;
+				most = left;
+			}
+		}
+		if (victim < 0) {
+			return 0;
+		}
+
+		pthread_mutex_lock(&ctx->ranges[victim].lock);
+		left = ctx->ranges[victim].end - ctx->ranges[victim].begin;
+		if (ctx->ranges[victim].begin < ctx->ranges[victim].end) {
+			size_t mid = ctx->ranges[victim].end - (left + 1) / 2;
+			size_t end = ctx->ranges[victim].end;
+			__atomic_store_n(&ctx->ranges[victim].end, mid, __ATOMIC_RELAXED);
+			pthread_mutex_unlock(&ctx->ranges[victim].lock);
+
+			pthread_mutex_lock(&own->lock);
+			__atomic_store_n(&own->begin, mid, __ATOMIC_RELAXED);
+			__atomic_store_n(&own->end, end, __ATOMIC_RELAXED);
+			pthread_mutex_unlock(&own->lock);
+		} else {
+			pthread_mutex_unlock(&ctx->ranges[victim].lock);
+		}
+	}
+}
+
+/**
+********************************************************************************
+* Parse one chunk into its slot of the window
+* @param  ctx: Shared state
+* @param  id: Worker index
+* @param  chunk: Index of the chunk in the window
+********************************************************************************/
+static void parse_chunk(parallel_ctx_t *ctx, int id, size_t chunk)
+{
+	chunk_slot_t *slot = &ctx->slots[chunk];
+	size_t begin = chunk_boundary(ctx, ctx->first_chunk + chunk);
+	size_t end = chunk_boundary(ctx, ctx->first_chunk + chunk + 1);
+	size_t consumed, n, i;
+
+	slot->count = 0;
+	while (begin < end) {
+		if (slot->count == slot->capacity && !slot_grow(slot)) {
+			__atomic_store_n(&ctx->failed, 1, __ATOMIC_RELAXED);
+			return;
+		}
+		n = parse_rmc_buffer(ctx->buf + begin, end - begin, slot->data + slot->count,
+				slot->results + slot->count, slot->capacity - slot->count, &consumed);
+		for (i = slot->count; i < slot->count + n; i++) {
+			slot->results[i].offset += begin;
+		}
+		nmea_parse_stats_add(&ctx->thread_stats[id], slot->results + slot->count, n);
+		slot->count += n;
+		begin += consumed;
+	}
+}
+
+/**
+********************************************************************************
+* Start of a chunk: its nominal start moved past the line in progress there
+* @param  ctx: Shared state
+* @param  chunk: Index of the chunk in the whole input
+* @return Byte offset of the first line of the chunk
+********************************************************************************/
+static size_t chunk_boundary(const parallel_ctx_t *ctx, size_t chunk)
+{
+	size_t start = chunk * NMEA_PARALLEL_CHUNK_SIZE;
+	const char *nl;
+
+	if (start == 0) {
+		return 0;
+	}
+	if (start >= ctx->len) {
+		return ctx->len;
+	}
+	nl = memchr(ctx->buf + start - 1, '\n', ctx->len - start + 1);
+	return nl ? (size_t)(nl + 1 - ctx->buf) : ctx->len;
+}
+
+static int slot_grow(chunk_slot_t *slot)
+{
+	size_t capacity = slot->capacity ? slot->capacity * 2 : CHUNK_INITIAL_CAPACITY;
+	nmea_rmc_data_t *data = realloc(slot->data, capacity * sizeof(*data));
+	rmc_line_result_t *results;
+
+	if (!data) {
+		return 0;
+	}
+	slot->data = data;
+	results = realloc(slot->results, capacity * sizeof(*results));
+	if (!results) {
+		return 0;
+	}
+	slot->results = results;
+	slot->capacity = capacity;
+	return 1;
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
@@ -0,0 +1,64 @@
+/** @file
+ *  Provides prototypes for parsing a large NMEA log on several threads.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_PARALLEL_H__
+#define __NMEA0183_PARALLEL_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+
+#include "nmea0183_parser.h"
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_PARALLEL_CHUNK_SIZE		(1024 * 1024)	/**< Bytes of input per task. */
+#define NMEA_PARALLEL_CHUNKS_PER_THREAD	8				/**< Tasks per thread in flight. */
+
+/**
+ * Callback receiving the sentences of the input in order, one batch at a
+ * time. Offsets in results are relative to the start of the whole input.
+ */
+typedef void (*nmea_batch_callback_t)(const nmea_rmc_data_t *data, const rmc_line_result_t *results,
+		size_t count, void *user_data);
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int parse_rmc_parallel(const char *buf, size_t len, int num_threads,
+		nmea_batch_callback_t callback, void *user_data, nmea_parse_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
@@ -14,9 +14,11 @@
 *******************************************************************************/
 #include <string.h>
 #include <stdlib.h>
-#include <stdio.h>
+#include <stdint.h>
 
 #include "nmea0183_parser.h"
+#include "nmea0183_scan.h"
+#include "nmea0183_metrics.h"
 
 /*******************************************************************************
 *                          Extern Data Declarations
@@ -29,16 +31,188 @@
 /*******************************************************************************
 *                          Type & Macro Definitions
 *******************************************************************************/
-#define RMC_HEADER					"$GPRMC,"
-#define ASSERT_RMC(t, m, b)			do {if (!(t)) { printf(m); goto b; } } while(0);
+#define ADDRESS_SIZE				7				// "$GPRMC,"
+#define ASSERT_RMC(t, e, p, b)		do {if (!(t)) { error->field = (e); error->offset = (p) - buf; goto b; } } while(0);
+
+#define DECIMAL_MAX_DIGITS			18				// digits that fit in an int64_t mantissa
+
+// Packed talker ID and sentence type, for switch statements
+#define MS_PER_DAY					86400000LL
+#define CODE2(a, b)					(((a) << 8) | (b))
+#define CODE3(a, b, c)				(((a) << 16) | ((b) << 8) | (c))
+
+// Bounds of field k of a scanned body, field 0 is the address ("GPRMC")
+#define FIELD_BEGIN(k)				(body + ((k) ? commas[(k) - 1] + 1 : 0))
+#define FIELD_END(k)				(body + ((k) < n ? commas[k] : star - body))
+
+/**
+ * Index of RMC fields in a sentence body
+ */
+enum {
+	RMC_FIELD_TIME = 1,
+	RMC_FIELD_STATUS,
+	RMC_FIELD_LAT,
+	RMC_FIELD_LAT_DIR,
+	RMC_FIELD_LON,
+	RMC_FIELD_LON_DIR,
+	RMC_FIELD_SPEED,
+	RMC_FIELD_HEADING,
+	RMC_FIELD_DATE,
+	RMC_FIELD_MAG_VAR,
+	RMC_FIELD_MAG_DIR,
+	RMC_FIELD_MODE,
+	RMC_FIELD_NAV_STATUS
+};
+
+/**
+ * Index of GGA fields in a sentence body
+ */
+enum {
+	GGA_FIELD_TIME = 1,
+	GGA_FIELD_LAT,
+	GGA_FIELD_LAT_DIR,
+	GGA_FIELD_LON,
+	GGA_FIELD_LON_DIR,
+	GGA_FIELD_QUALITY,
+	GGA_FIELD_SATELLITES,
+	GGA_FIELD_HDOP,
+	GGA_FIELD_ALTITUDE,
+	GGA_FIELD_ALTITUDE_UNIT,
+	GGA_FIELD_GEOID,
+	GGA_FIELD_GEOID_UNIT,
+	GGA_FIELD_DGPS_AGE,
+	GGA_FIELD_DGPS_STATION
+};
+
+/**
+ * Index of VTG fields in a sentence body
+ */
+enum {
+	VTG_FIELD_TRACK_TRUE = 1,
+	VTG_FIELD_TRACK_TRUE_UNIT,
+	VTG_FIELD_TRACK_MAGNETIC,
+	VTG_FIELD_TRACK_MAGNETIC_UNIT,
+	VTG_FIELD_SPEED_KNOTS,
+	VTG_FIELD_SPEED_KNOTS_UNIT,
+	VTG_FIELD_SPEED_KMH,
+	VTG_FIELD_SPEED_KMH_UNIT,
+	VTG_FIELD_MODE							// NMEA 2.3 and later
+};
+
+/**
+ * Index of GLL fields in a sentence body
+ */
+enum {
+	GLL_FIELD_LAT = 1,
+	GLL_FIELD_LAT_DIR,
+	GLL_FIELD_LON,
+	GLL_FIELD_LON_DIR,
+	GLL_FIELD_TIME,
+	GLL_FIELD_STATUS,
+	GLL_FIELD_MODE							// NMEA 2.3 and later
+};
+
+/**
+ * Index of GSA fields in a sentence body
+ */
+enum {
+	GSA_FIELD_SELECTION = 1,
+	GSA_FIELD_FIX_TYPE,
+	GSA_FIELD_PRN,							// NMEA_GSA_MAX_SATELLITES of them
+	GSA_FIELD_PDOP = GSA_FIELD_PRN + NMEA_GSA_MAX_SATELLITES,
+	GSA_FIELD_HDOP,
+	GSA_FIELD_VDOP,
+	GSA_FIELD_SYSTEM_ID						// NMEA 4.10 and later
+};
+
+/**
+ * Index of GSV fields in a sentence body
+ */
+enum {
+	GSV_FIELD_NUM_MESSAGES = 1,
+	GSV_FIELD_MESSAGE_NUMBER,
+	GSV_FIELD_IN_VIEW,
+	GSV_FIELD_SATELLITES					// 4 per satellite, then the NMEA 4.10 signal ID
+};
+
+/**
+ * A sentence whose checksum is verified and whose fields are located
+ */
+typedef struct nmea_frame_t
+{
+	const char *buf;						// the '$' starting the sentence
+	const char *body;						// the byte after '$'
+	const char *star;						// the '*' before the checksum
+	int n;									// number of commas in the body
+	unsigned char commas[NMEA_MAX_FIELDS];	// offset of each comma from body
+} nmea_frame_t;
 
 /*******************************************************************************
 *                          Static Function Prototypes
 *******************************************************************************/
+static rmc_parse_result parse_rmc_span(nmea_rmc_data_t *data, const char *buf, const char *end, unsigned int fields,
+		rmc_error_detail_t *error);
+static int decode_address(const char *buf, const char *end, nmea_talker *talker, nmea_sentence_type *type);
+static int frame_sentence(nmea_frame_t *frame, const char *buf, const char *end, rmc_error_detail_t *error);
+static rmc_parse_result decode_rmc(nmea_rmc_data_t *data, const nmea_frame_t *frame, unsigned int fields,
+		rmc_error_detail_t *error);
+static rmc_parse_result decode_gga(nmea_gga_data_t *data, const nmea_frame_t *frame, rmc_error_detail_t *error);
+static rmc_parse_result decode_vtg(nmea_vtg_data_t *data, const nmea_frame_t *frame, rmc_error_detail_t *error);
+static rmc_parse_result decode_gll(nmea_gll_data_t *data, const nmea_frame_t *frame, rmc_error_detail_t *error);
+static rmc_parse_result decode_gsa(nmea_gsa_data_t *data, const nmea_frame_t *frame, rmc_error_detail_t *error);
+static rmc_parse_result decode_gsv(nmea_gsv_data_t *data, const nmea_frame_t *frame, rmc_error_detail_t *error);
+static int hex_value(char c);
+static int decode_two_digits(const char *p, char *value);
+static int decode_millisec(const char *begin, const char *end, uint16_t *value);
+static int decode_decimal(const char *begin, const char *end, int64_t *mantissa, int *frac_digits);
+static int decode_number(const char *begin, const char *end, double *value);
+static int64_t epoch_days(int year, int month, int day);
+static int days_in_month(int year, int month);
+static void civil_from_days(int64_t days, int *y, int *m, int *d);
+static int decode_degrees(const char *begin, const char *end, int max_degrees, double *value, int32_t *value_e7);
+static int decode_coordinate(const char *begin, const char *end, const char *dir, const char *dir_end,
+		int max_degrees, const char *hemispheres, double *value, int32_t *value_e7);
+static int decode_utc(const char *begin, const char *end, char *hour, char *min, char *sec, uint16_t *millisec);
+static int decode_signed_number(const char *begin, const char *end, double *value);
+static int decode_integer(const char *begin, const char *end, int max, int *value);
+static int decode_char(const char *begin, const char *end, const char *allowed, char *value);
+static void stream_carry(nmea_stream_t *ctx, const char *buf, size_t len);
+static void stream_emit(nmea_stream_t *ctx, const char *begin, const char *end);
+static void stream_fail(nmea_stream_t *ctx, const char *begin, const char *end, const rmc_error_detail_t *error);
+static int stream_scan_line(nmea_stream_t *ctx, const char *begin, const char *end);
 
 /*******************************************************************************
 *                          Static Data Definitions
 *******************************************************************************/
+static const double pow10_double[DECIMAL_MAX_DIGITS + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+	1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+static const int64_t pow10_int[DECIMAL_MAX_DIGITS + 1] = {
+	1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+	100000000LL, 1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL,
+	10000000000000LL, 100000000000000LL, 1000000000000000LL,
+	10000000000000000LL, 100000000000000000LL, 1000000000000000000LL
+};
+
+// days of a non-leap year before the first of each month
+static const int16_t days_before_month[12] = {
+	0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
+
+// days of each month of a non-leap year
+static const char month_days[12] = {
+	31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+// largest prn, elevation, azimuth and snr of a GSV satellite
+static const int gsv_field_max[4] = { 999, 90, 359, 99 };
+
+static const char *const error_names[RMC_ERROR_CODE_INVALID] = {
+	"none", "header", "length", "checksum", "time", "status",
+	"latitude", "longitude", "speed", "heading", "date", "magnetic var", "field"
+};
 
 /*******************************************************************************
 *                          Extern/Exported Data Definitions
@@ -53,7 +227,8 @@
 * GPS gives information about year, date, time along with longitude and latitude
 * @param  data: Pointer to nmea RMC data structure
 * @param  buf: Pointer to the buffer
-* @param  buf_size: Buffer Size 
+* @param  buf_size: Buffer Size; the sentence ends at the first NUL within it,
+*                   or at its end. 0 if the sentence is NUL-terminated
 * @return Result of parsing operatoin 
 ********************************************************************************/
 /* Format
@@ -84,145 +259,1363 @@
      
 rmc_parse_result parse_rmc(nmea_rmc_data_t *data, const char *buf, int buf_size)
 {
-    char aux_buf[15];
-    const char *p1, *p2;
-	char checksum;
-    
-	// unused parameter
-	(void)buf_size;
-	
-    // Verify $GPRMC
-    ASSERT_RMC(!strncmp(buf, RMC_HEADER, strlen(RMC_HEADER)), "Not a RMC sentence\n", parse_rmc_bailout);
+	rmc_error_detail_t error;
+	size_t len = buf_size > 0 ? strnlen(buf, buf_size) : strlen(buf);
+
+	NMEA_METRICS_BYTES(len);
+	return parse_rmc_span(data, buf, buf + len, RMC_FIELD_MASK_ALL, &error);
+}
+
+/**
+********************************************************************************
+* Parse a RMC sentence that need not be NUL-terminated and tell which check
+* failed. A trailing line ending is ignored.
+* @param  data: Pointer to nmea RMC data structure
+* @param  buf: Pointer to the '$' starting the sentence
+* @param  len: Number of bytes of the sentence
+* @param  error: Always written: the failed check and its position,
+*         RMC_ERROR_NONE unless failed
+* @return Result of parsing operation
+********************************************************************************/
+rmc_parse_result parse_rmc_detail(nmea_rmc_data_t *data, const char *buf, size_t len, rmc_error_detail_t *error)
+{
+	return parse_rmc_fields(data, buf, len, RMC_FIELD_MASK_ALL, error);
+}
+
+/**
+********************************************************************************
+* Same as parse_rmc_detail(), decoding only the requested fields. Position-only
+* consumers pass RMC_FIELD_MASK_POSITION to skip converting speed, heading,
+* date and magnetic variation.
+* @param  data: Pointer to nmea RMC data structure
+* @param  buf: Pointer to the '$' starting the sentence
+* @param  len: Number of bytes of the sentence
+* @param  fields: RMC_FIELD_MASK_* to decode
+* @param  error: Always written: the failed check and its position,
+*         RMC_ERROR_NONE unless failed
+* @return Result of parsing operation
+********************************************************************************/
+rmc_parse_result parse_rmc_fields(nmea_rmc_data_t *data, const char *buf, size_t len, unsigned int fields,
+		rmc_error_detail_t *error)
+{
+	NMEA_METRICS_BYTES(len);
+	while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r')) {
+		len--;
+	}
+	error->field = RMC_ERROR_NONE;
+	error->offset = 0;
+
+	return parse_rmc_span(data, buf, buf + len, fields, error);
+}
+
+/**
+********************************************************************************
+* Set the date and time fields of a fix from UTC epoch milliseconds, the
+* inverse of the epoch_ms computed by the parser
+* @param  data: Fix to update
+* @param  epoch_ms: UTC milliseconds since 1970-01-01
+********************************************************************************/
+void nmea_rmc_set_time(nmea_rmc_data_t *data, int64_t epoch_ms)
+{
+	int64_t days = epoch_ms >= 0 ? epoch_ms / MS_PER_DAY : -((-epoch_ms + MS_PER_DAY - 1) / MS_PER_DAY);
+	int64_t ms = epoch_ms - days * MS_PER_DAY;
+	int y, m, d;
 
-	// Verify checksum first
-    p1 = buf + 1;	// skip '$' sign
-    ASSERT_RMC(p2 = strchr(p1, '*'), "No checksum\n", parse_rmc_bailout);
-    ASSERT_RMC(*(p2 + 3) == 0, "Inproper ending\n", parse_rmc_bailout);
-	checksum = strtol(p2 + 1, NULL, 16);
-	while (p1 != p2) {
-		checksum ^= *p1++;
+	civil_from_days(days, &y, &m, &d);
+	data->year = y % 100;
+	data->month = m;
+	data->day = d;
+	data->hour = ms / 3600000;
+	data->min = ms / 60000 % 60;
+	data->sec = ms / 1000 % 60;
+	data->millisec = ms % 1000;
+	data->epoch_ms = epoch_ms;
+}
+
+/**
+********************************************************************************
+* Name of a failed check, for logging
+* @param  error: Failed check
+* @return Lower case name, "invalid" when out of range
+********************************************************************************/
+const char *rmc_parse_error_name(rmc_parse_error error)
+{
+	if ((unsigned int)error >= RMC_ERROR_CODE_INVALID) {
+		return "invalid";
+	}
+	return error_names[error];
+}
+
+/**
+********************************************************************************
+* Parse a sentence of any supported type and talker. The address is decoded
+* into talker and type, then the checksum and fields are located in a single
+* pass shared by every type before the decoder of the type runs.
+* RMC_PARSE_SUCCESSFUL_WITH_FIX tells that the sentence reports a valid fix:
+* status A for RMC and GLL, quality above 0 for GGA, a mode other than N for
+* RMC and VTG and a 2D or 3D fix for GSA. GSV carries no fix status and always gives
+* RMC_PARSE_SUCCESSFUL_WITH_NO_FIX.
+* @param  data: Talker, type and decoded fields of the sentence
+* @param  buf: Pointer to the '$' starting the sentence
+* @param  len: Number of bytes of the sentence, a trailing line ending is ignored
+* @param  error: Always written: the failed check and its position,
+*         RMC_ERROR_NONE unless failed
+* @return Result of parsing operation
+********************************************************************************/
+rmc_parse_result parse_nmea(nmea_0183_data_t *data, const char *buf, size_t len, rmc_error_detail_t *error)
+{
+	nmea_frame_t frame;
+	const char *end;
+	rmc_parse_result res = RMC_PARSE_FAILED;
+
+	NMEA_METRICS_BYTES(len);
+	NMEA_METRICS_SENTENCE(metrics, tick);
+	while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r')) {
+		len--;
+	}
+	end = buf + len;
+	error->field = RMC_ERROR_NONE;
+	error->offset = 0;
+
+	if (!decode_address(buf, end, &data->talker, &data->type)) {
+		error->field = RMC_ERROR_HEADER;
+		goto parse_nmea_done;
+	}
+	NMEA_METRICS_STAGE(metrics, tick, NMEA_STAGE_FRAMING);
+	if (!frame_sentence(&frame, buf, end, error)) {
+		goto parse_nmea_done;
+	}
+	NMEA_METRICS_STAGE(metrics, tick, NMEA_STAGE_CHECKSUM);
+
+	switch (data->type) {
+		case NMEA_SENTENCE_RMC:
+			res = decode_rmc(&data->rmcData, &frame, RMC_FIELD_MASK_ALL, error);
+			break;
+		case NMEA_SENTENCE_GGA:
+			res = decode_gga(&data->ggaData, &frame, error);
+			break;
+		case NMEA_SENTENCE_VTG:
+			res = decode_vtg(&data->vtgData, &frame, error);
+			break;
+		case NMEA_SENTENCE_GLL:
+			res = decode_gll(&data->gllData, &frame, error);
+			break;
+		case NMEA_SENTENCE_GSA:
+			res = decode_gsa(&data->gsaData, &frame, error);
+			break;
+		case NMEA_SENTENCE_GSV:
+			res = decode_gsv(&data->gsvData, &frame, error);
+			break;
+		default:
+			error->field = RMC_ERROR_HEADER;
+			break;
+	}
+	NMEA_METRICS_STAGE(metrics, tick, NMEA_STAGE_DECODE);
+
+parse_nmea_done:
+	NMEA_METRICS_RESULT(metrics, tick, data->type, res, error->field);
+	return res;
+}
+
+/**
+********************************************************************************
+* Initialize a stream parser context
+* @param  ctx: Pointer to the stream context
+* @param  callback: Function called for every sentence found in the stream
+* @param  user_data: Opaque pointer handed back to the callback
+********************************************************************************/
+void nmea_stream_init(nmea_stream_t *ctx, nmea_rmc_callback_t callback, void *user_data)
+{
+	ctx->callback = callback;
+	ctx->user_data = user_data;
+	ctx->counters = NULL;
+	ctx->diag = NULL;
+	ctx->diag_user_data = NULL;
+	ctx->fields = RMC_FIELD_MASK_ALL;
+	nmea_stream_reset(ctx);
+}
+
+/**
+********************************************************************************
+* Opt in to failure monitoring of a stream. Both are off after init; either
+* may be NULL.
+* @param  ctx: Pointer to the stream context
+* @param  counters: Failure counters to update, may be shared between contexts
+* @param  diag: Function called with the sentence and detail of every failure
+* @param  user_data: Opaque pointer handed back to diag
+********************************************************************************/
+void nmea_stream_set_diagnostics(nmea_stream_t *ctx, nmea_error_counters_t *counters,
+		nmea_diag_callback_t diag, void *user_data)
+{
+	ctx->counters = counters;
+	ctx->diag = diag;
+	ctx->diag_user_data = user_data;
+}
+
+/**
+********************************************************************************
+* Select the fields a stream decodes, RMC_FIELD_MASK_ALL after init
+* @param  ctx: Pointer to the stream context
+* @param  fields: RMC_FIELD_MASK_* to decode
+********************************************************************************/
+void nmea_stream_set_fields(nmea_stream_t *ctx, unsigned int fields)
+{
+	ctx->fields = fields;
+}
+
+/**
+********************************************************************************
+* Drop any partially received sentence, e.g. after the link was reconnected
+* @param  ctx: Pointer to the stream context
+********************************************************************************/
+void nmea_stream_reset(nmea_stream_t *ctx)
+{
+	ctx->carry_len = 0;
+	ctx->in_sentence = 0;
+	ctx->overflow = 0;
+}
+
+/**
+********************************************************************************
+* Feed a chunk of raw receiver output to the stream parser. The chunk may start
+* or end anywhere inside a sentence. Complete sentences are parsed in place;
+* only the fragment of a sentence that straddles two chunks is kept in the
+* context until its line ending arrives.
+* @param  ctx: Pointer to the stream context
+* @param  buf: Pointer to the chunk
+* @param  len: Number of bytes in the chunk
+* @return Number of sentences reported to the callback
+********************************************************************************/
+int nmea_stream_feed(nmea_stream_t *ctx, const char *buf, int len)
+{
+	const char *p = buf;
+	const char *end = buf + len;
+	const char *nl;
+	int count = 0;
+	NMEA_METRICS_THREAD(metrics);
+
+	NMEA_METRICS_BYTES(len);
+
+	// finish the sentence left over from the previous chunk
+	if (ctx->in_sentence) {
+		NMEA_METRICS_LINE(metrics);
+		nl = memchr(p, '\n', end - p);
+		stream_carry(ctx, p, (nl ? nl : end) - p);
+		if (!nl) {
+			return 0;
+		}
+		if (ctx->overflow) {
+			stream_emit(ctx, NULL, NULL);
+			count++;
+		} else {
+			count += stream_scan_line(ctx, ctx->carry, ctx->carry + ctx->carry_len);
+		}
+		nmea_stream_reset(ctx);
+		p = nl + 1;
 	}
-    ASSERT_RMC(checksum == 0, "Wrong checksum\n", parse_rmc_bailout);
+
+	while (p < end) {
+		NMEA_METRICS_LINE(metrics);
+		nl = memchr(p, '\n', end - p);
+		if (!nl) {
+			// keep the trailing fragment, starting from its first '$'
+			const char *s = memchr(p, '$', end - p);
+			if (s) {
+				ctx->in_sentence = 1;
+				stream_carry(ctx, s, end - s);
+			}
+			break;
+		}
+		count += stream_scan_line(ctx, p, nl);
+		p = nl + 1;
+	}
+
+	return count;
+}
+
+/**
+********************************************************************************
+* Parse every sentence of a buffer in place, e.g. a memory-mapped log file.
+* Lines end with '\n' (an optional '\r' before it is ignored); the last line
+* may lack it. Results are reported in input order, one entry per sentence.
+* @param  buf: Pointer to the buffer
+* @param  len: Number of bytes in the buffer
+* @param  fixes: Decoded sentences, fixes[i] belongs to results[i]
+* @param  results: Result code and byte offset of each sentence
+* @param  max_results: Number of entries in fixes and results
+* @param  consumed: Bytes processed; less than len when the arrays are full
+* @return Number of sentences written to fixes and results
+********************************************************************************/
+size_t parse_rmc_buffer(const char *buf, size_t len, nmea_rmc_data_t *fixes,
+		rmc_line_result_t *results, size_t max_results, size_t *consumed)
+{
+	return parse_rmc_buffer_fields(buf, len, RMC_FIELD_MASK_ALL, fixes, results, max_results, consumed);
+}
+
+/**
+********************************************************************************
+* Same as parse_rmc_buffer(), decoding only the requested fields
+* @param  buf: Pointer to the buffer
+* @param  len: Number of bytes in the buffer
+* @param  fields: RMC_FIELD_MASK_* to decode
+* @param  fixes: Decoded sentences, fixes[i] belongs to results[i]
+* @param  results: Result code and byte offset of each sentence
+* @param  max_results: Number of entries in fixes and results
+* @param  consumed: Bytes processed; less than len when the arrays are full
+* @return Number of sentences written to fixes and results
+********************************************************************************/
+size_t parse_rmc_buffer_fields(const char *buf, size_t len, unsigned int fields, nmea_rmc_data_t *fixes,
+		rmc_line_result_t *results, size_t max_results, size_t *consumed)
+{
+	const char *p = buf;
+	const char *end = buf + len;
+	const char *nl, *line_end, *p1, *p2;
+	rmc_error_detail_t error;
+	size_t n = 0;
+	NMEA_METRICS_THREAD(metrics);
+
+	while (p < end && n < max_results) {
+		NMEA_METRICS_LINE(metrics);
+		nl = memchr(p, '\n', end - p);
+		line_end = nl ? nl : end;
+		if (line_end > p && *(line_end - 1) == '\r') {
+			line_end--;
+		}
+
+		p1 = memchr(p, '$', line_end - p);
+		while (p1 && n < max_results) {
+			p2 = memchr(p1 + 1, '$', line_end - p1 - 1);
+			results[n].offset = p1 - buf;
+			error.field = RMC_ERROR_NONE;
+			results[n].result = parse_rmc_span(&fixes[n], p1, p2 ? p2 : line_end, fields, &error);
+			results[n].error = error.field;
+			NMEA_METRICS_OUTPUT(metrics);
+			n++;
+			p1 = p2;
+		}
+		if (p1) {
+			// out of room in the middle of a line, resume at its next sentence
+			p = p1;
+			break;
+		}
+		p = nl ? nl + 1 : end;
+	}
+
+	NMEA_METRICS_BYTES(p - buf);
+	if (consumed) {
+		*consumed = p - buf;
+	}
+	return n;
+}
+
+/**
+********************************************************************************
+* Count parse results by category
+* @param  stats: Counters to update
+* @param  results: Results of parse_rmc_buffer()
+* @param  count: Number of results
+********************************************************************************/
+void nmea_parse_stats_add(nmea_parse_stats_t *stats, const rmc_line_result_t *results, size_t count)
+{
+	size_t i;
+
+	stats->sentences += count;
+	for (i = 0; i < count; i++) {
+		switch (results[i].result) {
+			case RMC_PARSE_SUCCESSFUL_WITH_FIX:
+				stats->fixes++;
+				break;
+			case RMC_PARSE_SUCCESSFUL_WITH_NO_FIX:
+				stats->no_fixes++;
+				break;
+			default:
+				stats->failures++;
+				stats->errors[results[i].error]++;
+		}
+	}
+}
+
+/**
+********************************************************************************
+* Add counters collected separately, e.g. by another thread
+* @param  stats: Counters to update
+* @param  other: Counters to add
+********************************************************************************/
+void nmea_parse_stats_merge(nmea_parse_stats_t *stats, const nmea_parse_stats_t *other)
+{
+	size_t i;
+
+	stats->sentences += other->sentences;
+	stats->fixes += other->fixes;
+	stats->no_fixes += other->no_fixes;
+	stats->failures += other->failures;
+	for (i = 0; i < RMC_ERROR_CODE_INVALID; i++) {
+		stats->errors[i] += other->errors[i];
+	}
+}
+
+/**
+********************************************************************************
+* Read one failure counter of a set shared with parsing threads
+* @param  counters: Failure counters
+* @param  error: Failed check
+* @return Number of failures so far
+********************************************************************************/
+size_t nmea_error_count(const nmea_error_counters_t *counters, rmc_parse_error error)
+{
+	return __atomic_load_n(&counters->count[error], __ATOMIC_RELAXED);
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Append bytes to the carry buffer of a stream context
+* @param  ctx: Pointer to the stream context
+* @param  buf: Bytes to append
+* @param  len: Number of bytes
+********************************************************************************/
+static void stream_carry(nmea_stream_t *ctx, const char *buf, size_t len)
+{
+	if (ctx->overflow || ctx->carry_len + len > sizeof(ctx->carry)) {
+		// too long for a NMEA sentence, report it as failed once the line ends
+		ctx->overflow = 1;
+		return;
+	}
+	memcpy(ctx->carry + ctx->carry_len, buf, len);
+	ctx->carry_len += len;
+}
+
+/**
+********************************************************************************
+* Parse one sentence and hand the result to the stream callback
+* @param  ctx: Pointer to the stream context
+* @param  begin: First byte of the sentence ('$'), NULL for a dropped sentence
+* @param  end: One past the last checksum digit
+********************************************************************************/
+static void stream_emit(nmea_stream_t *ctx, const char *begin, const char *end)
+{
+	nmea_rmc_data_t data;
+	rmc_error_detail_t error = { RMC_ERROR_LENGTH, 0 };
+	rmc_parse_result res = RMC_PARSE_FAILED;
+	NMEA_METRICS_THREAD(metrics);
+
+	if (begin) {
+		res = parse_rmc_span(&data, begin, end, ctx->fields, &error);
+	} else {
+		NMEA_METRICS_SENTENCE(dropped, tick);
+		NMEA_METRICS_RESULT(dropped, tick, NMEA_SENTENCE_UNKNOWN, res, error.field);
+		memset(&data, 0, sizeof(data));
+	}
+	if (res == RMC_PARSE_FAILED) {
+		stream_fail(ctx, begin, end, &error);
+	}
+	if (ctx->callback) {
+		ctx->callback(&data, res, ctx->user_data);
+	}
+	NMEA_METRICS_OUTPUT(metrics);
+}
+
+/**
+********************************************************************************
+* Count a failed sentence and report it to the diagnostics callback, if the
+* stream opted in to either
+* @param  ctx: Pointer to the stream context
+* @param  begin: First byte of the sentence ('$'), NULL for a dropped sentence
+* @param  end: One past the last checksum digit
+* @param  error: Failed check
+********************************************************************************/
+static void stream_fail(nmea_stream_t *ctx, const char *begin, const char *end, const rmc_error_detail_t *error)
+{
+	if (ctx->counters) {
+		__atomic_fetch_add(&ctx->counters->count[error->field], 1, __ATOMIC_RELAXED);
+	}
+	if (ctx->diag) {
+		ctx->diag(begin, begin ? (size_t)(end - begin) : 0, error, ctx->diag_user_data);
+	}
+}
+
+/**
+********************************************************************************
+* Split one line into sentences and parse them. Every '$' starts a new sentence,
+* so a truncated sentence followed by a complete one on the same line only
+* loses the truncated part.
+* @param  ctx: Pointer to the stream context
+* @param  begin: First byte of the line
+* @param  end: The line feed ending the line
+* @return Number of sentences reported to the callback
+********************************************************************************/
+static int stream_scan_line(nmea_stream_t *ctx, const char *begin, const char *end)
+{
+	const char *p1, *p2;
+	int count = 0;
+
+	if (end > begin && *(end - 1) == '\r') {
+		end--;
+	}
+
+	p1 = memchr(begin, '$', end - begin);
+	while (p1) {
+		p2 = memchr(p1 + 1, '$', end - p1 - 1);
+		stream_emit(ctx, p1, p2 ? p2 : end);
+		count++;
+		p1 = p2;
+	}
+
+	return count;
+}
+
+/**
+********************************************************************************
+* Parse a RMC sentence of any talker that is not NUL-terminated
+* @param  data: Pointer to nmea RMC data structure
+* @param  buf: Pointer to the '$' starting the sentence
+* @param  end: One past the last checksum digit
+* @param  fields: RMC_FIELD_MASK_* to decode
+* @param  error: Failed check and its position, written on failure; the entry
+*         points reset it to RMC_ERROR_NONE first
+* @return Result of parsing operation
+********************************************************************************/
+static rmc_parse_result parse_rmc_span(nmea_rmc_data_t *data, const char *buf, const char *end, unsigned int fields,
+		rmc_error_detail_t *error)
+{
+	nmea_frame_t frame;
+	nmea_talker talker;
+	nmea_sentence_type type;
+	rmc_parse_result res = RMC_PARSE_FAILED;
+
+	NMEA_METRICS_SENTENCE(metrics, tick);
+
+	// the type is known before the checksum pass, so other sentences are cheap to skip
+	if (!decode_address(buf, end, &talker, &type) || type != NMEA_SENTENCE_RMC) {
+		error->field = RMC_ERROR_HEADER;
+		error->offset = 0;
+		goto parse_rmc_done;
+	}
+	NMEA_METRICS_STAGE(metrics, tick, NMEA_STAGE_FRAMING);
+	if (!frame_sentence(&frame, buf, end, error)) {
+		goto parse_rmc_done;
+	}
+	NMEA_METRICS_STAGE(metrics, tick, NMEA_STAGE_CHECKSUM);
+	res = decode_rmc(data, &frame, fields, error);
+	NMEA_METRICS_STAGE(metrics, tick, NMEA_STAGE_DECODE);
+
+parse_rmc_done:
+	NMEA_METRICS_RESULT(metrics, tick, type, res, error->field);
+	return res;
+}
+
+/**
+********************************************************************************
+* Decode the talker ID and sentence type of "$TTSSS," into small integers
+* @param  buf: Pointer to the '$' starting the sentence
+* @param  end: One past the last checksum digit
+* @param  talker: Decoded talker ID
+* @param  type: Decoded sentence type
+* @return 1 for a known talker and type, 0 otherwise
+********************************************************************************/
+static int decode_address(const char *buf, const char *end, nmea_talker *talker, nmea_sentence_type *type)
+{
+	const unsigned char *p = (const unsigned char *)buf;
+
+	*talker = NMEA_TALKER_UNKNOWN;
+	*type = NMEA_SENTENCE_UNKNOWN;
+	if (end - buf <= ADDRESS_SIZE || p[0] != '$' || p[ADDRESS_SIZE - 1] != ',') {
+		return 0;
+	}
+
+	switch (CODE2(p[1], p[2])) {
+		case CODE2('G', 'P'): *talker = NMEA_TALKER_GP; break;
+		case CODE2('G', 'L'): *talker = NMEA_TALKER_GL; break;
+		case CODE2('G', 'A'): *talker = NMEA_TALKER_GA; break;
+		case CODE2('G', 'B'): *talker = NMEA_TALKER_GB; break;
+		case CODE2('B', 'D'): *talker = NMEA_TALKER_BD; break;
+		case CODE2('G', 'Q'): *talker = NMEA_TALKER_GQ; break;
+		case CODE2('G', 'I'): *talker = NMEA_TALKER_GI; break;
+		case CODE2('G', 'N'): *talker = NMEA_TALKER_GN; break;
+		default: return 0;
+	}
+	switch (CODE3(p[3], p[4], p[5])) {
+		case CODE3('R', 'M', 'C'): *type = NMEA_SENTENCE_RMC; break;
+		case CODE3('G', 'G', 'A'): *type = NMEA_SENTENCE_GGA; break;
+		case CODE3('V', 'T', 'G'): *type = NMEA_SENTENCE_VTG; break;
+		case CODE3('G', 'L', 'L'): *type = NMEA_SENTENCE_GLL; break;
+		case CODE3('G', 'S', 'A'): *type = NMEA_SENTENCE_GSA; break;
+		case CODE3('G', 'S', 'V'): *type = NMEA_SENTENCE_GSV; break;
+		default: return 0;
+	}
+	return 1;
+}
+
+/**
+********************************************************************************
+* Verify the checksum of a sentence and locate its fields, in one pass
+* @param  frame: Filled in with the located fields
+* @param  buf: Pointer to the '$' starting the sentence
+* @param  end: One past the last checksum digit
+* @param  error: Failed check and its position, written on failure; the entry
+*         points reset it to RMC_ERROR_NONE first
+* @return 1 on success, 0 on failure
+********************************************************************************/
+static int frame_sentence(nmea_frame_t *frame, const char *buf, const char *end, rmc_error_detail_t *error)
+{
+	nmea_scan_t scan;
+	const char *star;
+	int hi, lo;
+
+    frame->buf = buf;
+    frame->body = buf + 1;	// skip '$' sign
+    frame->star = star = end - 3;
+    ASSERT_RMC(*star == '*', RMC_ERROR_CHECKSUM, star, frame_bailout);
+    ASSERT_RMC(nmea_scan(frame->body, star - frame->body, &scan), RMC_ERROR_LENGTH, buf, frame_bailout);
+    ASSERT_RMC(!scan.has_star, RMC_ERROR_CHECKSUM, star, frame_bailout);
+	hi = hex_value(star[1]);
+	lo = hex_value(star[2]);
+    ASSERT_RMC(hi >= 0 && lo >= 0, RMC_ERROR_CHECKSUM, star + 1, frame_bailout);
+    ASSERT_RMC(scan.checksum == ((hi << 4) | lo), RMC_ERROR_CHECKSUM, star + 1, frame_bailout);
+	frame->n = nmea_scan_fields(&scan, frame->commas, NMEA_MAX_FIELDS);
+	return 1;
+
+frame_bailout:
+	return 0;
+}
+
+/**
+********************************************************************************
+* Decode the fields of a RMC sentence, with or without the mode of NMEA 2.3
+* and the navigational status of NMEA 4.10; mode N reports no fix like
+* status V
+* @param  data: Pointer to nmea RMC data structure
+* @param  frame: The sentence, checksum verified
+* @param  fields: RMC_FIELD_MASK_* to decode
+* @param  error: Failed check and its position, written on failure; the entry
+*         points reset it to RMC_ERROR_NONE first
+* @return Result of parsing operation
+********************************************************************************/
+static rmc_parse_result decode_rmc(nmea_rmc_data_t *data, const nmea_frame_t *frame, unsigned int fields,
+		rmc_error_detail_t *error)
+{
+	const char *buf = frame->buf, *body = frame->body, *star = frame->star;
+	const unsigned char *commas = frame->commas;
+	const char *p1, *p2;
+	int n = frame->n;
 
     // Time
-    p1 = buf + strlen(RMC_HEADER);
-    ASSERT_RMC(p2 = strchr(p1, ','), "Invalid time\n", parse_rmc_bailout);
-    memcpy(aux_buf, p1, 2);
-    aux_buf[2] = '\0';
-    data->hour = atoi(aux_buf);
-    p1 += 2;
-    memcpy(aux_buf, p1, 2);
-    aux_buf[2] = '\0';
-    data->min = atoi(aux_buf);
-    p1 += 2;
-    memcpy(aux_buf, p1, 2);
-    aux_buf[2] = '\0';
-    data->sec = atoi(aux_buf);
-	p1 += 2;
-    ASSERT_RMC(*p1 == '.', "Invalid time\n", parse_rmc_bailout);
-	// ignore milliseconds
-    p1 = p2 + 1;
+	if (fields & RMC_FIELD_MASK_TIME) {
+		ASSERT_RMC(n > RMC_FIELD_TIME, RMC_ERROR_TIME, star, parse_rmc_bailout);
+		p1 = FIELD_BEGIN(RMC_FIELD_TIME);
+		p2 = FIELD_END(RMC_FIELD_TIME);
+		ASSERT_RMC(p2 - p1 >= 7, RMC_ERROR_TIME, p1, parse_rmc_bailout);
+		ASSERT_RMC(decode_two_digits(p1, &data->hour), RMC_ERROR_TIME, p1, parse_rmc_bailout);
+		ASSERT_RMC(decode_two_digits(p1 + 2, &data->min), RMC_ERROR_TIME, p1, parse_rmc_bailout);
+		ASSERT_RMC(decode_two_digits(p1 + 4, &data->sec), RMC_ERROR_TIME, p1, parse_rmc_bailout);
+		// a second of 60 is a leap second
+		ASSERT_RMC(data->hour < 24 && data->min < 60 && data->sec <= 60, RMC_ERROR_TIME, p1, parse_rmc_bailout);
+		ASSERT_RMC(p1[6] == '.', RMC_ERROR_TIME, p1, parse_rmc_bailout);
+		ASSERT_RMC(decode_millisec(p1 + 7, p2, &data->millisec), RMC_ERROR_TIME, p1, parse_rmc_bailout);
+	}
 
     // Status 
-    ASSERT_RMC(p2 = strchr(p1, ','), "Invalid status\n", parse_rmc_bailout);
-    data->status = *p1;
+    ASSERT_RMC(n > RMC_FIELD_STATUS, RMC_ERROR_STATUS, star, parse_rmc_bailout);
+    data->status = *FIELD_BEGIN(RMC_FIELD_STATUS);
     if (data->status == 'V') {
 		// no valid fix, stop here
         return RMC_PARSE_SUCCESSFUL_WITH_NO_FIX;
 	}
-    ASSERT_RMC(data->status == 'A', "Invalid status\n", parse_rmc_bailout);
-    p1 = p2 + 1;
+    ASSERT_RMC(data->status == 'A', RMC_ERROR_STATUS, FIELD_BEGIN(RMC_FIELD_STATUS), parse_rmc_bailout);
 
     // Latitude
-    ASSERT_RMC(p2 = strchr(p1, ','), "Invalid latitude\n", parse_rmc_bailout);
-    memcpy(aux_buf, p1, p2 - p1);
-    aux_buf[p2 - p1] = '\0';
-    p1 = p2 + 1;
-    ASSERT_RMC(p2 = strchr(aux_buf, '.'), "Invalid latitude\n", parse_rmc_bailout);
-    ASSERT_RMC(p2 - aux_buf >= 2, "Invalid latitude\n", parse_rmc_bailout);
-    data->latitude = atof(p2 - 2) / 60.0;
-    aux_buf[p2 - 2 - aux_buf] = '\0';
-    data->latitude += atof(aux_buf);
-	// Direction
-    ASSERT_RMC(*(p1 + 1) == ',', "Invalid latitude\n", parse_rmc_bailout);
-    if (*p1 == 'S') {
-         data->latitude = -data->latitude;
-	} else {
-		ASSERT_RMC(*p1 == 'N', "Invalid latitude\n", parse_rmc_bailout);
+	if (fields & RMC_FIELD_MASK_LATITUDE) {
+		ASSERT_RMC(n > RMC_FIELD_LAT_DIR, RMC_ERROR_LATITUDE, star, parse_rmc_bailout);
+		ASSERT_RMC(decode_degrees(FIELD_BEGIN(RMC_FIELD_LAT), FIELD_END(RMC_FIELD_LAT), 90, &data->latitude, &data->latitude_e7), RMC_ERROR_LATITUDE, FIELD_BEGIN(RMC_FIELD_LAT), parse_rmc_bailout);
+		// Direction
+		p1 = FIELD_BEGIN(RMC_FIELD_LAT_DIR);
+		ASSERT_RMC(FIELD_END(RMC_FIELD_LAT_DIR) == p1 + 1, RMC_ERROR_LATITUDE, p1, parse_rmc_bailout);
+		if (*p1 == 'S') {
+			data->latitude = -data->latitude;
+			data->latitude_e7 = -data->latitude_e7;
+		} else {
+			ASSERT_RMC(*p1 == 'N', RMC_ERROR_LATITUDE, p1, parse_rmc_bailout);
+		}
 	}
-    p1 += 2;
 
     // Longitude
-    ASSERT_RMC(p2 = strchr(p1, ','), "Invalid longitude\n", parse_rmc_bailout);
-    memcpy(aux_buf, p1, p2 - p1);
-    aux_buf[p2 - p1] = '\0';
-    p1 = p2 + 1;
-    ASSERT_RMC(p2 = strchr(aux_buf, '.'), "Invalid longitude", parse_rmc_bailout);
-    ASSERT_RMC(p2 - aux_buf >= 2, "Invalid longitude\n", parse_rmc_bailout);
-    data->longitude = atof(p2 - 2) / 60.0;
-    aux_buf[p2 - 2 - aux_buf] = '\0';
-    data->longitude += atof((char *)aux_buf);
-	// Direction
-    ASSERT_RMC(*(p1 + 1) == ',', "Invalid longitude\n", parse_rmc_bailout);
-    if (*p1 == 'W') {
-         data->longitude = -data->longitude;
-    } else {
-		ASSERT_RMC(*p1 == 'E', "Invalid longitude\n", parse_rmc_bailout);
-	}
-    p1 += 2;
+	if (fields & RMC_FIELD_MASK_LONGITUDE) {
+		ASSERT_RMC(n > RMC_FIELD_LON_DIR, RMC_ERROR_LONGITUDE, star, parse_rmc_bailout);
+		ASSERT_RMC(decode_degrees(FIELD_BEGIN(RMC_FIELD_LON), FIELD_END(RMC_FIELD_LON), 180, &data->longitude, &data->longitude_e7), RMC_ERROR_LONGITUDE, FIELD_BEGIN(RMC_FIELD_LON), parse_rmc_bailout);
+		// Direction
+		p1 = FIELD_BEGIN(RMC_FIELD_LON_DIR);
+		ASSERT_RMC(FIELD_END(RMC_FIELD_LON_DIR) == p1 + 1, RMC_ERROR_LONGITUDE, p1, parse_rmc_bailout);
+		if (*p1 == 'W') {
+			data->longitude = -data->longitude;
+			data->longitude_e7 = -data->longitude_e7;
+		} else {
+			ASSERT_RMC(*p1 == 'E', RMC_ERROR_LONGITUDE, p1, parse_rmc_bailout);
+		}
+	}
 
     // Ground speed
-    ASSERT_RMC(p2 = strchr(p1, ','), "Invalid speed\n", parse_rmc_bailout);
-    memcpy(aux_buf, p1, p2 - p1);
-    aux_buf[p2 - p1] = '\0';
-    p1 = p2 + 1;
-    data->ground_speed = atof(aux_buf);
+	if (fields & RMC_FIELD_MASK_SPEED) {
+		ASSERT_RMC(n > RMC_FIELD_SPEED, RMC_ERROR_SPEED, star, parse_rmc_bailout);
+		ASSERT_RMC(decode_number(FIELD_BEGIN(RMC_FIELD_SPEED), FIELD_END(RMC_FIELD_SPEED), &data->ground_speed), RMC_ERROR_SPEED, FIELD_BEGIN(RMC_FIELD_SPEED), parse_rmc_bailout);
+	}
 
     // heading (degrees) 
-    ASSERT_RMC(p2 = strchr(p1, ','), "Invalid heading\n", parse_rmc_bailout);
-    memcpy(aux_buf, p1, p2 - p1);
-    aux_buf[p2 - p1] = '\0';
-    p1 = p2 + 1;
-    data->heading = atof(aux_buf);
+	if (fields & RMC_FIELD_MASK_HEADING) {
+		ASSERT_RMC(n > RMC_FIELD_HEADING, RMC_ERROR_HEADING, star, parse_rmc_bailout);
+		ASSERT_RMC(decode_number(FIELD_BEGIN(RMC_FIELD_HEADING), FIELD_END(RMC_FIELD_HEADING), &data->heading), RMC_ERROR_HEADING, FIELD_BEGIN(RMC_FIELD_HEADING), parse_rmc_bailout);
+	}
 
     // Date
-    ASSERT_RMC(p2 = strchr(p1, ','), "Invalid date\n", parse_rmc_bailout);
-    memcpy(aux_buf, p1, 2);
-    aux_buf[2] = '\0';
-    data->day = atoi(aux_buf);
-    p1 += 2;
-    memcpy(aux_buf, p1, 2);
-    aux_buf[2] = '\0';
-    data->month = atoi(aux_buf);
-    p1 += 2;
-    memcpy(aux_buf, p1, 2);
-    aux_buf[2] = '\0';
-    data->year = atoi(aux_buf);
-    p1 = p2 + 1;
-
-    // Magnetic variation
-    ASSERT_RMC(p2 = strchr(p1, ','), "Invalid magnetic var\n", parse_rmc_bailout);
-    memcpy(aux_buf, p1, p2 - p1);
-    aux_buf[p2 - p1] = '\0';
-    p1 = p2 + 1;
-    data->magnetic_var = atof(aux_buf);
-    ASSERT_RMC(*(p1 + 1) == '*', "Invalid magnetic var\n", parse_rmc_bailout);
-    if (*p1 == 'W') {
-        data->magnetic_var = -data->magnetic_var;
-	} else {
-		ASSERT_RMC(*p1 == 'E', "Invalid magnetic var\n", parse_rmc_bailout);
+	if (fields & RMC_FIELD_MASK_DATE) {
+		ASSERT_RMC(n > RMC_FIELD_DATE, RMC_ERROR_DATE, star, parse_rmc_bailout);
+		p1 = FIELD_BEGIN(RMC_FIELD_DATE);
+		ASSERT_RMC(FIELD_END(RMC_FIELD_DATE) - p1 >= 6, RMC_ERROR_DATE, p1, parse_rmc_bailout);
+		ASSERT_RMC(decode_two_digits(p1, &data->day), RMC_ERROR_DATE, p1, parse_rmc_bailout);
+		ASSERT_RMC(decode_two_digits(p1 + 2, &data->month), RMC_ERROR_DATE, p1, parse_rmc_bailout);
+		ASSERT_RMC(decode_two_digits(p1 + 4, &data->year), RMC_ERROR_DATE, p1, parse_rmc_bailout);
+		ASSERT_RMC(data->month >= 1 && data->month <= 12 && data->day >= 1 &&
+				data->day <= days_in_month(data->year, data->month), RMC_ERROR_DATE, p1, parse_rmc_bailout);
 	}
-    p1 = p2 + 1;
 
-	return RMC_PARSE_SUCCESSFUL_WITH_FIX;
+    // Magnetic variation, may be empty; the direction is the last field, or the mode of NMEA 2.3,
+    // or the navigational status of NMEA 4.10
+    ASSERT_RMC(n >= RMC_FIELD_MAG_DIR && n <= RMC_FIELD_NAV_STATUS, RMC_ERROR_MAGNETIC_VAR, star, parse_rmc_bailout);
+	if (fields & RMC_FIELD_MASK_MAGNETIC_VAR) {
+		ASSERT_RMC(decode_number(FIELD_BEGIN(RMC_FIELD_MAG_VAR), FIELD_END(RMC_FIELD_MAG_VAR), &data->magnetic_var), RMC_ERROR_MAGNETIC_VAR, FIELD_BEGIN(RMC_FIELD_MAG_VAR), parse_rmc_bailout);
+		p1 = FIELD_BEGIN(RMC_FIELD_MAG_DIR);
+		p2 = FIELD_END(RMC_FIELD_MAG_DIR);
+		if (p2 == p1 + 1 && *p1 == 'W') {
+			data->magnetic_var = -data->magnetic_var;
+		} else {
+			ASSERT_RMC(p2 == p1 || (p2 == p1 + 1 && *p1 == 'E'), RMC_ERROR_MAGNETIC_VAR, p1, parse_rmc_bailout);
+		}
+	}
+
+	// Mode
+	data->mode = 0;
+	if (n >= RMC_FIELD_MODE) {
+		ASSERT_RMC(decode_char(FIELD_BEGIN(RMC_FIELD_MODE), FIELD_END(RMC_FIELD_MODE), "ADEFMNPRS", &data->mode),
+				RMC_ERROR_STATUS, FIELD_BEGIN(RMC_FIELD_MODE), parse_rmc_bailout);
+	}
+
+	// Navigational status
+	data->nav_status = 0;
+	if (n == RMC_FIELD_NAV_STATUS) {
+		ASSERT_RMC(decode_char(FIELD_BEGIN(RMC_FIELD_NAV_STATUS), FIELD_END(RMC_FIELD_NAV_STATUS), "SCUV",
+				&data->nav_status), RMC_ERROR_STATUS, FIELD_BEGIN(RMC_FIELD_NAV_STATUS), parse_rmc_bailout);
+	}
+
+	if ((fields & RMC_FIELD_MASK_TIMESTAMP) == RMC_FIELD_MASK_TIMESTAMP) {
+		data->epoch_ms = ((epoch_days(data->year, data->month, data->day) * 24 + data->hour) * 60 + data->min) * 60000 +
+				data->sec * 1000 + data->millisec;
+	}
+
+	return data->mode == 'N' ? RMC_PARSE_SUCCESSFUL_WITH_NO_FIX : RMC_PARSE_SUCCESSFUL_WITH_FIX;
 	
 parse_rmc_bailout:
     return RMC_PARSE_FAILED;
 }
 
-/*******************************************************************************
-*                          Static Function Definitions
-*******************************************************************************/
+/**
+********************************************************************************
+* Decode the fields of a GGA sentence. Position and the fields after it are
+* only decoded when the quality indicator reports a fix.
+* @param  data: Pointer to GGA data structure
+* @param  frame: The sentence, checksum verified
+* @param  error: Failed check and its position, written on failure; the entry
+*         points reset it to RMC_ERROR_NONE first
+* @return Result of parsing operation
+********************************************************************************/
+static rmc_parse_result decode_gga(nmea_gga_data_t *data, const nmea_frame_t *frame, rmc_error_detail_t *error)
+{
+	const char *buf = frame->buf, *body = frame->body, *star = frame->star;
+	const unsigned char *commas = frame->commas;
+	int n = frame->n, value;
+	char unit;
+
+	ASSERT_RMC(n == GGA_FIELD_DGPS_STATION, RMC_ERROR_FIELD, star, gga_bailout);
+	ASSERT_RMC(decode_utc(FIELD_BEGIN(GGA_FIELD_TIME), FIELD_END(GGA_FIELD_TIME),
+			&data->hour, &data->min, &data->sec, &data->millisec), RMC_ERROR_TIME, FIELD_BEGIN(GGA_FIELD_TIME), gga_bailout);
+	ASSERT_RMC(decode_integer(FIELD_BEGIN(GGA_FIELD_QUALITY), FIELD_END(GGA_FIELD_QUALITY), 9, &value) && value >= 0,
+			RMC_ERROR_STATUS, FIELD_BEGIN(GGA_FIELD_QUALITY), gga_bailout);
+	data->quality = value;
+	if (data->quality == 0) {
+		// no valid fix, stop here
+		return RMC_PARSE_SUCCESSFUL_WITH_NO_FIX;
+	}
+
+	ASSERT_RMC(decode_coordinate(FIELD_BEGIN(GGA_FIELD_LAT), FIELD_END(GGA_FIELD_LAT),
+			FIELD_BEGIN(GGA_FIELD_LAT_DIR), FIELD_END(GGA_FIELD_LAT_DIR), 90, "NS", &data->latitude, &data->latitude_e7),
+			RMC_ERROR_LATITUDE, FIELD_BEGIN(GGA_FIELD_LAT), gga_bailout);
+	ASSERT_RMC(decode_coordinate(FIELD_BEGIN(GGA_FIELD_LON), FIELD_END(GGA_FIELD_LON),
+			FIELD_BEGIN(GGA_FIELD_LON_DIR), FIELD_END(GGA_FIELD_LON_DIR), 180, "EW", &data->longitude, &data->longitude_e7),
+			RMC_ERROR_LONGITUDE, FIELD_BEGIN(GGA_FIELD_LON), gga_bailout);
+	ASSERT_RMC(decode_integer(FIELD_BEGIN(GGA_FIELD_SATELLITES), FIELD_END(GGA_FIELD_SATELLITES), 99, &value),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GGA_FIELD_SATELLITES), gga_bailout);
+	data->satellites = value;
+	ASSERT_RMC(decode_number(FIELD_BEGIN(GGA_FIELD_HDOP), FIELD_END(GGA_FIELD_HDOP), &data->hdop),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GGA_FIELD_HDOP), gga_bailout);
+	ASSERT_RMC(decode_signed_number(FIELD_BEGIN(GGA_FIELD_ALTITUDE), FIELD_END(GGA_FIELD_ALTITUDE), &data->altitude),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GGA_FIELD_ALTITUDE), gga_bailout);
+	ASSERT_RMC(decode_char(FIELD_BEGIN(GGA_FIELD_ALTITUDE_UNIT), FIELD_END(GGA_FIELD_ALTITUDE_UNIT), "M", &unit),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GGA_FIELD_ALTITUDE_UNIT), gga_bailout);
+	ASSERT_RMC(decode_signed_number(FIELD_BEGIN(GGA_FIELD_GEOID), FIELD_END(GGA_FIELD_GEOID), &data->geoid_separation),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GGA_FIELD_GEOID), gga_bailout);
+	ASSERT_RMC(decode_char(FIELD_BEGIN(GGA_FIELD_GEOID_UNIT), FIELD_END(GGA_FIELD_GEOID_UNIT), "M", &unit),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GGA_FIELD_GEOID_UNIT), gga_bailout);
+
+	return RMC_PARSE_SUCCESSFUL_WITH_FIX;
+
+gga_bailout:
+	return RMC_PARSE_FAILED;
+}
+
+/**
+********************************************************************************
+* Decode the fields of a VTG sentence, with or without the mode of NMEA 2.3
+* @param  data: Pointer to VTG data structure
+* @param  frame: The sentence, checksum verified
+* @param  error: Failed check and its position, written on failure; the entry
+*         points reset it to RMC_ERROR_NONE first
+* @return Result of parsing operation
+********************************************************************************/
+static rmc_parse_result decode_vtg(nmea_vtg_data_t *data, const nmea_frame_t *frame, rmc_error_detail_t *error)
+{
+	const char *buf = frame->buf, *body = frame->body, *star = frame->star;
+	const unsigned char *commas = frame->commas;
+	int n = frame->n;
+	char unit;
+
+	ASSERT_RMC(n == VTG_FIELD_SPEED_KMH_UNIT || n == VTG_FIELD_MODE, RMC_ERROR_FIELD, star, vtg_bailout);
+	ASSERT_RMC(decode_number(FIELD_BEGIN(VTG_FIELD_TRACK_TRUE), FIELD_END(VTG_FIELD_TRACK_TRUE), &data->track_true) &&
+			decode_char(FIELD_BEGIN(VTG_FIELD_TRACK_TRUE_UNIT), FIELD_END(VTG_FIELD_TRACK_TRUE_UNIT), "T", &unit),
+			RMC_ERROR_HEADING, FIELD_BEGIN(VTG_FIELD_TRACK_TRUE), vtg_bailout);
+	ASSERT_RMC(decode_number(FIELD_BEGIN(VTG_FIELD_TRACK_MAGNETIC), FIELD_END(VTG_FIELD_TRACK_MAGNETIC), &data->track_magnetic) &&
+			decode_char(FIELD_BEGIN(VTG_FIELD_TRACK_MAGNETIC_UNIT), FIELD_END(VTG_FIELD_TRACK_MAGNETIC_UNIT), "M", &unit),
+			RMC_ERROR_HEADING, FIELD_BEGIN(VTG_FIELD_TRACK_MAGNETIC), vtg_bailout);
+	ASSERT_RMC(decode_number(FIELD_BEGIN(VTG_FIELD_SPEED_KNOTS), FIELD_END(VTG_FIELD_SPEED_KNOTS), &data->speed_knots) &&
+			decode_char(FIELD_BEGIN(VTG_FIELD_SPEED_KNOTS_UNIT), FIELD_END(VTG_FIELD_SPEED_KNOTS_UNIT), "N", &unit),
+			RMC_ERROR_SPEED, FIELD_BEGIN(VTG_FIELD_SPEED_KNOTS), vtg_bailout);
+	ASSERT_RMC(decode_number(FIELD_BEGIN(VTG_FIELD_SPEED_KMH), FIELD_END(VTG_FIELD_SPEED_KMH), &data->speed_kmh) &&
+			decode_char(FIELD_BEGIN(VTG_FIELD_SPEED_KMH_UNIT), FIELD_END(VTG_FIELD_SPEED_KMH_UNIT), "K", &unit),
+			RMC_ERROR_SPEED, FIELD_BEGIN(VTG_FIELD_SPEED_KMH), vtg_bailout);
+	data->mode = 0;
+	if (n == VTG_FIELD_MODE) {
+		ASSERT_RMC(decode_char(FIELD_BEGIN(VTG_FIELD_MODE), FIELD_END(VTG_FIELD_MODE), "ADEFMNPRS", &data->mode),
+				RMC_ERROR_STATUS, FIELD_BEGIN(VTG_FIELD_MODE), vtg_bailout);
+	}
+
+	return data->mode == 'N' ? RMC_PARSE_SUCCESSFUL_WITH_NO_FIX : RMC_PARSE_SUCCESSFUL_WITH_FIX;
+
+vtg_bailout:
+	return RMC_PARSE_FAILED;
+}
+
+/**
+********************************************************************************
+* Decode the fields of a GLL sentence, with or without the mode of NMEA 2.3.
+* The position is only decoded when the status is A.
+* @param  data: Pointer to GLL data structure
+* @param  frame: The sentence, checksum verified
+* @param  error: Failed check and its position, written on failure; the entry
+*         points reset it to RMC_ERROR_NONE first
+* @return Result of parsing operation
+********************************************************************************/
+static rmc_parse_result decode_gll(nmea_gll_data_t *data, const nmea_frame_t *frame, rmc_error_detail_t *error)
+{
+	const char *buf = frame->buf, *body = frame->body, *star = frame->star;
+	const unsigned char *commas = frame->commas;
+	int n = frame->n;
+
+	ASSERT_RMC(n == GLL_FIELD_STATUS || n == GLL_FIELD_MODE, RMC_ERROR_FIELD, star, gll_bailout);
+	ASSERT_RMC(decode_utc(FIELD_BEGIN(GLL_FIELD_TIME), FIELD_END(GLL_FIELD_TIME),
+			&data->hour, &data->min, &data->sec, &data->millisec), RMC_ERROR_TIME, FIELD_BEGIN(GLL_FIELD_TIME), gll_bailout);
+	ASSERT_RMC(decode_char(FIELD_BEGIN(GLL_FIELD_STATUS), FIELD_END(GLL_FIELD_STATUS), "AV", &data->status) && data->status,
+			RMC_ERROR_STATUS, FIELD_BEGIN(GLL_FIELD_STATUS), gll_bailout);
+	data->mode = 0;
+	if (n == GLL_FIELD_MODE) {
+		ASSERT_RMC(decode_char(FIELD_BEGIN(GLL_FIELD_MODE), FIELD_END(GLL_FIELD_MODE), "ADEFMNPRS", &data->mode),
+				RMC_ERROR_STATUS, FIELD_BEGIN(GLL_FIELD_MODE), gll_bailout);
+	}
+	if (data->status == 'V') {
+		// no valid fix, stop here
+		return RMC_PARSE_SUCCESSFUL_WITH_NO_FIX;
+	}
+
+	ASSERT_RMC(decode_coordinate(FIELD_BEGIN(GLL_FIELD_LAT), FIELD_END(GLL_FIELD_LAT),
+			FIELD_BEGIN(GLL_FIELD_LAT_DIR), FIELD_END(GLL_FIELD_LAT_DIR), 90, "NS", &data->latitude, &data->latitude_e7),
+			RMC_ERROR_LATITUDE, FIELD_BEGIN(GLL_FIELD_LAT), gll_bailout);
+	ASSERT_RMC(decode_coordinate(FIELD_BEGIN(GLL_FIELD_LON), FIELD_END(GLL_FIELD_LON),
+			FIELD_BEGIN(GLL_FIELD_LON_DIR), FIELD_END(GLL_FIELD_LON_DIR), 180, "EW", &data->longitude, &data->longitude_e7),
+			RMC_ERROR_LONGITUDE, FIELD_BEGIN(GLL_FIELD_LON), gll_bailout);
+
+	return RMC_PARSE_SUCCESSFUL_WITH_FIX;
+
+gll_bailout:
+	return RMC_PARSE_FAILED;
+}
+
+/**
+********************************************************************************
+* Decode the fields of a GSA sentence, with or without the system ID of
+* NMEA 4.10. Empty satellite slots are skipped.
+* @param  data: Pointer to GSA data structure
+* @param  frame: The sentence, checksum verified
+* @param  error: Failed check and its position, written on failure; the entry
+*         points reset it to RMC_ERROR_NONE first
+* @return Result of parsing operation
+********************************************************************************/
+static rmc_parse_result decode_gsa(nmea_gsa_data_t *data, const nmea_frame_t *frame, rmc_error_detail_t *error)
+{
+	const char *buf = frame->buf, *body = frame->body, *star = frame->star;
+	const unsigned char *commas = frame->commas;
+	int n = frame->n, value, k;
+
+	ASSERT_RMC(n == GSA_FIELD_VDOP || n == GSA_FIELD_SYSTEM_ID, RMC_ERROR_FIELD, star, gsa_bailout);
+	ASSERT_RMC(decode_char(FIELD_BEGIN(GSA_FIELD_SELECTION), FIELD_END(GSA_FIELD_SELECTION), "MA", &data->selection),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GSA_FIELD_SELECTION), gsa_bailout);
+	ASSERT_RMC(decode_integer(FIELD_BEGIN(GSA_FIELD_FIX_TYPE), FIELD_END(GSA_FIELD_FIX_TYPE), 3, &value) && value >= 1,
+			RMC_ERROR_STATUS, FIELD_BEGIN(GSA_FIELD_FIX_TYPE), gsa_bailout);
+	data->fix_type = value;
+
+	data->num_satellites = 0;
+	for (k = GSA_FIELD_PRN; k < GSA_FIELD_PRN + NMEA_GSA_MAX_SATELLITES; k++) {
+		ASSERT_RMC(decode_integer(FIELD_BEGIN(k), FIELD_END(k), INT16_MAX, &value), RMC_ERROR_FIELD, FIELD_BEGIN(k), gsa_bailout);
+		if (value >= 0) {
+			data->prn[(int)data->num_satellites++] = value;
+		}
+	}
+
+	ASSERT_RMC(decode_number(FIELD_BEGIN(GSA_FIELD_PDOP), FIELD_END(GSA_FIELD_PDOP), &data->pdop),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GSA_FIELD_PDOP), gsa_bailout);
+	ASSERT_RMC(decode_number(FIELD_BEGIN(GSA_FIELD_HDOP), FIELD_END(GSA_FIELD_HDOP), &data->hdop),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GSA_FIELD_HDOP), gsa_bailout);
+	ASSERT_RMC(decode_number(FIELD_BEGIN(GSA_FIELD_VDOP), FIELD_END(GSA_FIELD_VDOP), &data->vdop),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GSA_FIELD_VDOP), gsa_bailout);
+	data->system_id = 0;
+	if (n == GSA_FIELD_SYSTEM_ID) {
+		ASSERT_RMC(decode_integer(FIELD_BEGIN(GSA_FIELD_SYSTEM_ID), FIELD_END(GSA_FIELD_SYSTEM_ID), 15, &value),
+				RMC_ERROR_FIELD, FIELD_BEGIN(GSA_FIELD_SYSTEM_ID), gsa_bailout);
+		data->system_id = value < 0 ? 0 : value;
+	}
+
+	return data->fix_type == 1 ? RMC_PARSE_SUCCESSFUL_WITH_NO_FIX : RMC_PARSE_SUCCESSFUL_WITH_FIX;
+
+gsa_bailout:
+	return RMC_PARSE_FAILED;
+}
+
+/**
+********************************************************************************
+* Decode the fields of one GSV message, up to four satellites, with or without
+* the signal ID of NMEA 4.10
+* @param  data: Pointer to GSV data structure
+* @param  frame: The sentence, checksum verified
+* @param  error: Failed check and its position, written on failure; the entry
+*         points reset it to RMC_ERROR_NONE first
+* @return RMC_PARSE_SUCCESSFUL_WITH_NO_FIX, or RMC_PARSE_FAILED
+********************************************************************************/
+static rmc_parse_result decode_gsv(nmea_gsv_data_t *data, const nmea_frame_t *frame, rmc_error_detail_t *error)
+{
+	const char *buf = frame->buf, *body = frame->body, *star = frame->star;
+	const unsigned char *commas = frame->commas;
+	int n = frame->n, value, i, k, extra;
+
+	extra = n - GSV_FIELD_IN_VIEW;
+	ASSERT_RMC(extra >= 0 && extra / 4 <= NMEA_GSV_MAX_SATELLITES && extra % 4 <= 1, RMC_ERROR_FIELD, star, gsv_bailout);
+	ASSERT_RMC(decode_integer(FIELD_BEGIN(GSV_FIELD_NUM_MESSAGES), FIELD_END(GSV_FIELD_NUM_MESSAGES), 99, &value) && value >= 1,
+			RMC_ERROR_FIELD, FIELD_BEGIN(GSV_FIELD_NUM_MESSAGES), gsv_bailout);
+	data->num_messages = value;
+	ASSERT_RMC(decode_integer(FIELD_BEGIN(GSV_FIELD_MESSAGE_NUMBER), FIELD_END(GSV_FIELD_MESSAGE_NUMBER), data->num_messages, &value) && value >= 1,
+			RMC_ERROR_FIELD, FIELD_BEGIN(GSV_FIELD_MESSAGE_NUMBER), gsv_bailout);
+	data->message_number = value;
+	ASSERT_RMC(decode_integer(FIELD_BEGIN(GSV_FIELD_IN_VIEW), FIELD_END(GSV_FIELD_IN_VIEW), INT16_MAX, &value),
+			RMC_ERROR_FIELD, FIELD_BEGIN(GSV_FIELD_IN_VIEW), gsv_bailout);
+	data->satellites_in_view = value < 0 ? 0 : value;
+
+	data->num_satellites = extra / 4;
+	for (i = 0; i < data->num_satellites; i++) {
+		int values[4];
+
+		// prn, elevation, azimuth and snr
+		for (k = 0; k < 4; k++) {
+			int field = GSV_FIELD_SATELLITES + 4 * i + k;
+			ASSERT_RMC(decode_integer(FIELD_BEGIN(field), FIELD_END(field), gsv_field_max[k], &values[k]),
+					RMC_ERROR_FIELD, FIELD_BEGIN(field), gsv_bailout);
+		}
+		data->satellites[i].prn = values[0];
+		data->satellites[i].elevation = values[1];
+		data->satellites[i].azimuth = values[2];
+		data->satellites[i].snr = values[3];
+	}
+
+	data->signal_id = 0;
+	if (extra % 4) {
+		const char *p1 = FIELD_BEGIN(n);
+		ASSERT_RMC(FIELD_END(n) == p1 + 1 && hex_value(*p1) >= 0, RMC_ERROR_FIELD, p1, gsv_bailout);
+		data->signal_id = hex_value(*p1);
+	}
+
+	return RMC_PARSE_SUCCESSFUL_WITH_NO_FIX;
+
+gsv_bailout:
+	return RMC_PARSE_FAILED;
+}
+
+/**
+********************************************************************************
+* Decode a two digit decimal number, e.g. hours or day of month
+* @param  p: Pointer to the first digit
+* @param  value: Decoded number
+* @return 1 on success, 0 if either character is not a digit
+********************************************************************************/
+static int decode_two_digits(const char *p, char *value)
+{
+	if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') {
+		return 0;
+	}
+	*value = (p[0] - '0') * 10 + (p[1] - '0');
+	return 1;
+}
+
+/**
+********************************************************************************
+* Decode the fraction of seconds of a time field as milliseconds, further
+* digits are truncated
+* @param  begin: First digit after the '.'
+* @param  end: The ',' ending the field
+* @param  value: Decoded milliseconds
+* @return 1 on success, 0 if a character is not a digit
+********************************************************************************/
+static int decode_millisec(const char *begin, const char *end, uint16_t *value)
+{
+	const char *p;
+	int ms = 0, i = 0;
+
+	for (p = begin; p < end; p++, i++) {
+		if (*p < '0' || *p > '9') {
+			return 0;
+		}
+		if (i < 3) {
+			ms = ms * 10 + (*p - '0');
+		}
+	}
+	for (; i < 3; i++) {
+		ms *= 10;
+	}
+	*value = ms;
+	return 1;
+}
+
+/**
+********************************************************************************
+* Decode an unsigned decimal field into an integer mantissa and the number of
+* digits after the '.', i.e. value = mantissa / 10^frac_digits. An empty field
+* decodes as 0.
+* @param  begin: First character of the field
+* @param  end: The ',' ending the field
+* @param  mantissa: Decoded digits
+* @param  frac_digits: Number of digits after the '.'
+* @return 1 on success, 0 on malformed field or too many digits
+********************************************************************************/
+static int decode_decimal(const char *begin, const char *end, int64_t *mantissa, int *frac_digits)
+{
+	const char *p;
+	int64_t m = 0;
+	int digits = 0, frac = -1;
+
+	for (p = begin; p < end; p++) {
+		if (*p >= '0' && *p <= '9') {
+			if (++digits > DECIMAL_MAX_DIGITS) {
+				return 0;
+			}
+			m = m * 10 + (*p - '0');
+			if (frac >= 0) {
+				frac++;
+			}
+		} else if (*p == '.' && frac < 0) {
+			frac = 0;
+		} else {
+			return 0;
+		}
+	}
+
+	*mantissa = m;
+	*frac_digits = frac < 0 ? 0 : frac;
+	return 1;
+}
+
+/**
+********************************************************************************
+* Decode a decimal field such as speed or heading. Up to 15 significant digits
+* the result is correctly rounded, i.e. the same as strtod() in the C locale.
+* @param  begin: First character of the field
+* @param  end: The ',' ending the field
+* @param  value: Decoded number
+* @return 1 on success, 0 on malformed field
+********************************************************************************/
+static int decode_number(const char *begin, const char *end, double *value)
+{
+	int64_t mantissa;
+	int frac;
+
+	if (!decode_decimal(begin, end, &mantissa, &frac)) {
+		return 0;
+	}
+	// both operands are exact, so the division rounds once
+	*value = (double)mantissa / pow10_double[frac];
+	return 1;
+}
+
+/**
+********************************************************************************
+* Days since 1970-01-01 of a RMC date. Between 1901 and 2099 every fourth year
+* is a leap year, so no century rule is needed for the RMC_YEAR_PIVOT window.
+* @param  year: Two-digit year
+* @param  month: Month, 1 to 12
+* @param  day: Day of month
+* @return Number of days
+********************************************************************************/
+static int64_t epoch_days(int year, int month, int day)
+{
+	int y = year + (year < RMC_YEAR_PIVOT ? 2000 : 1900);
+	int leap = (y & 3) == 0;
+
+	return 365 * (y - 1970) + (y - 1969) / 4 + days_before_month[month - 1] + (leap & (month > 2)) + day - 1;
+}
+
+/**
+********************************************************************************
+* Number of days of a month of a RMC date, leap years as in epoch_days()
+* @param  year: Two-digit year
+* @param  month: Month, 1 to 12
+* @return Number of days
+********************************************************************************/
+static int days_in_month(int year, int month)
+{
+	return month_days[month - 1] + (month == 2 && (year & 3) == 0);
+}
+
+/**
+********************************************************************************
+* Proleptic Gregorian date of a number of days since 1970-01-01
+********************************************************************************/
+static void civil_from_days(int64_t days, int *y, int *m, int *d)
+{
+	int64_t z = days + 719468;
+	int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+	int64_t doe = z - era * 146097;
+	int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	int64_t mp = (5 * doy + 2) / 153;
+
+	*d = doy - (153 * mp + 2) / 5 + 1;
+	*m = mp < 10 ? mp + 3 : mp - 9;
+	*y = yoe + era * 400 + (*m <= 2);
+}
+
+/**
+********************************************************************************
+* Decode a dddmm.mmmm latitude or longitude field in place
+* @param  begin: First character of the field
+* @param  end: The ',' ending the field
+* @param  max_degrees: Largest valid number of degrees, minutes then must be 0
+* @param  value: Decoded degrees
+* @param  value_e7: Decoded degrees in units of 1e-7, rounded half up
+* @return 1 on success, 0 on malformed field
+********************************************************************************/
+static int decode_degrees(const char *begin, const char *end, int max_degrees, double *value, int32_t *value_e7)
+{
+	const char *dot = memchr(begin, '.', end - begin);
+	const char *p;
+	int64_t minutes, e7, den, num;
+	int degrees = 0, frac;
+
+	if (!dot || dot - begin < 2 || dot - begin > 5) {
+		return 0;
+	}
+	for (p = begin; p < dot - 2; p++) {
+		if (*p < '0' || *p > '9') {
+			return 0;
+		}
+		degrees = degrees * 10 + (*p - '0');
+	}
+	if (degrees > max_degrees || !decode_decimal(dot - 2, end, &minutes, &frac)) {
+		return 0;
+	}
+	// two digits before the dot leave frac <= 16, so 60 * 10^frac fits
+	den = 60 * pow10_int[frac];
+	if (minutes >= den || (degrees == max_degrees && minutes)) {
+		return 0;
+	}
+
+	// one rounding when both operands are exact doubles, i.e. up to 2^53
+	num = frac <= 12 ? degrees * den + minutes : -1;
+	if (num >= 0 && num <= ((int64_t)1 << 53)) {
+		*value = (double)num / (double)den;
+	} else {
+		*value = (double)minutes / pow10_double[frac] / 60.0 + degrees;
+	}
+
+	// minutes / 10^frac / 60 in units of 1e-7 degree, without overflow
+	if (frac <= 7) {
+		e7 = (minutes * pow10_int[7 - frac] + 30) / 60;
+	} else {
+		int64_t d = 6 * pow10_int[frac - 6];
+		e7 = (minutes + d / 2) / d;
+	}
+	*value_e7 = degrees * 10000000 + (int32_t)e7;
+	return 1;
+}
+
+/**
+********************************************************************************
+* Decode a latitude or longitude field and its hemisphere field
+* @param  begin: First character of the dddmm.mmmm field
+* @param  end: The ',' ending the field
+* @param  dir: First character of the hemisphere field
+* @param  dir_end: The ',' ending the hemisphere field
+* @param  max_degrees: 90 for latitude, 180 for longitude
+* @param  hemispheres: Positive then negative hemisphere letter, "NS" or "EW"
+* @param  value: Decoded degrees
+* @param  value_e7: Decoded units of 1e-7 degree
+* @return 1 on success, 0 on malformed field
+********************************************************************************/
+static int decode_coordinate(const char *begin, const char *end, const char *dir, const char *dir_end,
+		int max_degrees, const char *hemispheres, double *value, int32_t *value_e7)
+{
+	if (dir_end != dir + 1 || (*dir != hemispheres[0] && *dir != hemispheres[1]) ||
+			!decode_degrees(begin, end, max_degrees, value, value_e7)) {
+		return 0;
+	}
+	if (*dir == hemispheres[1]) {
+		*value = -*value;
+		*value_e7 = -*value_e7;
+	}
+	return 1;
+}
+
+/**
+********************************************************************************
+* Decode a hhmmss[.sss] time field. An empty field decodes as midnight, a
+* second of 60 is a leap second.
+* @param  begin: First character of the field
+* @param  end: The ',' ending the field
+* @param  hour: Decoded hours
+* @param  min: Decoded minutes
+* @param  sec: Decoded seconds
+* @param  millisec: Decoded fraction of the second
+* @return 1 on success, 0 on malformed field
+********************************************************************************/
+static int decode_utc(const char *begin, const char *end, char *hour, char *min, char *sec, uint16_t *millisec)
+{
+	if (begin == end) {
+		*hour = *min = *sec = 0;
+		*millisec = 0;
+		return 1;
+	}
+	if (end - begin < 6 || !decode_two_digits(begin, hour) ||
+			!decode_two_digits(begin + 2, min) || !decode_two_digits(begin + 4, sec) ||
+			*hour >= 24 || *min >= 60 || *sec > 60) {
+		return 0;
+	}
+	if (end - begin == 6) {
+		*millisec = 0;
+		return 1;
+	}
+	return begin[6] == '.' && decode_millisec(begin + 7, end, millisec);
+}
+
+/**
+********************************************************************************
+* Decode a decimal field that may start with '-', e.g. altitude
+* @param  begin: First character of the field
+* @param  end: The ',' ending the field
+* @param  value: Decoded number
+* @return 1 on success, 0 on malformed field
+********************************************************************************/
+static int decode_signed_number(const char *begin, const char *end, double *value)
+{
+	if (begin < end && *begin == '-') {
+		if (!decode_number(begin + 1, end, value)) {
+			return 0;
+		}
+		*value = -*value;
+		return 1;
+	}
+	return decode_number(begin, end, value);
+}
+
+/**
+********************************************************************************
+* Decode an unsigned integer field. An empty field decodes as -1.
+* @param  begin: First character of the field
+* @param  end: The ',' ending the field
+* @param  max: Largest value accepted
+* @param  value: Decoded number
+* @return 1 on success, 0 on malformed field or a value above max
+********************************************************************************/
+static int decode_integer(const char *begin, const char *end, int max, int *value)
+{
+	const char *p;
+	int v = 0;
+
+	if (begin == end) {
+		*value = -1;
+		return 1;
+	}
+	for (p = begin; p < end; p++) {
+		if (*p < '0' || *p > '9' || v > max) {
+			return 0;
+		}
+		v = v * 10 + (*p - '0');
+	}
+	if (v > max) {
+		return 0;
+	}
+	*value = v;
+	return 1;
+}
+
+/**
+********************************************************************************
+* Decode a single character field such as a unit or mode. An empty field
+* decodes as 0.
+* @param  begin: First character of the field
+* @param  end: The ',' ending the field
+* @param  allowed: Characters accepted
+* @param  value: Decoded character
+* @return 1 on success, 0 on a longer field or a character not allowed
+********************************************************************************/
+static int decode_char(const char *begin, const char *end, const char *allowed, char *value)
+{
+	if (begin == end) {
+		*value = 0;
+		return 1;
+	}
+	if (end != begin + 1 || !*begin || !strchr(allowed, *begin)) {
+		return 0;
+	}
+	*value = *begin;
+	return 1;
+}
+
+/**
+********************************************************************************
+* Convert a hexadecimal digit
+* @param  c: Character to convert
+* @return Value of the digit, -1 if c is not a hexadecimal digit
+********************************************************************************/
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
 
 /**
  *	@}		// end of nmea_parser
@@ -17,6 +17,8 @@
 /*******************************************************************************
 *                          Include Files
 *******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 
 /*******************************************************************************
@@ -41,7 +43,12 @@ typedef struct nmea_rmc_data_t
     char day;
     char month;
     char year;
-	char mode;
+	char mode;				/**< Mode of NMEA 2.3 as in VTG, 0 if absent; not decoded with status V. */
+	char nav_status;		/**< Navigational status of NMEA 4.10: S safe, C caution, U unsafe, V not valid; 0 if absent, as the mode. */
+	uint16_t millisec;		/**< Fraction of the second of the fix time. */
+	int32_t latitude_e7;	/**< Latitude in units of 1e-7 degree. */
+	int32_t longitude_e7;	/**< Longitude in units of 1e-7 degree. */
+	int64_t epoch_ms;		/**< Fix time as UTC milliseconds since 1970-01-01. */
     double latitude;
     double longitude;
     double ground_speed;
@@ -60,11 +67,254 @@ typedef enum {
 } rmc_parse_result;
 
 /**
- * Structure to store GPS info of various sentences
+ * Two-digit years below the pivot are 20yy, the others 19yy. GPS started in
+ * 1980, so RMC dates cover 1980 to 2079.
+ */
+#define RMC_YEAR_PIVOT				80
+
+/**
+ * Fields to decode, for the parse functions taking a field mask. The status
+ * is always decoded and the checksum always verified; the delimiters of fields
+ * left out are still checked but their content is neither validated nor
+ * converted, and their members of nmea_rmc_data_t are left unchanged.
+ */
+#define RMC_FIELD_MASK_TIME				(1u << 0)	/**< hour, min, sec, millisec. */
+#define RMC_FIELD_MASK_LATITUDE			(1u << 1)	/**< latitude, latitude_e7. */
+#define RMC_FIELD_MASK_LONGITUDE		(1u << 2)	/**< longitude, longitude_e7. */
+#define RMC_FIELD_MASK_SPEED			(1u << 3)	/**< ground_speed. */
+#define RMC_FIELD_MASK_HEADING			(1u << 4)	/**< heading. */
+#define RMC_FIELD_MASK_DATE				(1u << 5)	/**< day, month, year. */
+#define RMC_FIELD_MASK_MAGNETIC_VAR		(1u << 6)	/**< magnetic_var. */
+#define RMC_FIELD_MASK_POSITION			(RMC_FIELD_MASK_TIME | RMC_FIELD_MASK_LATITUDE | RMC_FIELD_MASK_LONGITUDE)
+#define RMC_FIELD_MASK_TIMESTAMP		(RMC_FIELD_MASK_TIME | RMC_FIELD_MASK_DATE)	/**< Also fills in epoch_ms. */
+#define RMC_FIELD_MASK_ALL				0x7fu
+
+/**
+ * Check that failed when the result is RMC_PARSE_FAILED
+ */
+typedef enum {
+	RMC_ERROR_NONE = 0,							/**< Parse did not fail. */
+	RMC_ERROR_HEADER,							/**< Not a sentence of the expected or of a known type. */
+	RMC_ERROR_LENGTH,							/**< Sentence longer than a NMEA sentence can be. */
+	RMC_ERROR_CHECKSUM,							/**< Checksum missing, malformed or wrong. */
+	RMC_ERROR_TIME,
+	RMC_ERROR_STATUS,
+	RMC_ERROR_LATITUDE,
+	RMC_ERROR_LONGITUDE,
+	RMC_ERROR_SPEED,
+	RMC_ERROR_HEADING,
+	RMC_ERROR_DATE,
+	RMC_ERROR_MAGNETIC_VAR,
+	RMC_ERROR_FIELD,							/**< Another field of a non-RMC sentence. */
+	RMC_ERROR_CODE_INVALID
+} rmc_parse_error;
+
+/**
+ * Where parsing a sentence failed
+ */
+typedef struct rmc_error_detail_t
+{
+	rmc_parse_error field;						/**< Failed check, RMC_ERROR_NONE on success. */
+	unsigned int offset;						/**< Byte offset from the '$' of the offending field, or of the '*' when the field is missing. */
+} rmc_error_detail_t;
+
+/**
+ * Outcome of one sentence found by the buffer parser
+ */
+typedef struct rmc_line_result_t
+{
+	size_t offset;								/**< Byte offset of the sentence's '$' in the buffer. */
+	rmc_parse_result result;					/**< Result of parsing the sentence. */
+	rmc_parse_error error;						/**< Failed check when result is RMC_PARSE_FAILED. */
+} rmc_line_result_t;
+
+/**
+ * Number of sentences per parse result
+ */
+typedef struct nmea_parse_stats_t
+{
+	size_t sentences;							/**< Sentences found. */
+	size_t fixes;								/**< RMC_PARSE_SUCCESSFUL_WITH_FIX. */
+	size_t no_fixes;							/**< RMC_PARSE_SUCCESSFUL_WITH_NO_FIX. */
+	size_t failures;							/**< RMC_PARSE_FAILED. */
+	size_t errors[RMC_ERROR_CODE_INVALID];		/**< Failures by failed check. */
+} nmea_parse_stats_t;
+
+/**
+ * Failure counters by failed check, updated atomically so that one set can be
+ * shared by stream contexts running on several threads
+ */
+typedef struct nmea_error_counters_t
+{
+	size_t count[RMC_ERROR_CODE_INVALID];
+} nmea_error_counters_t;
+
+/**
+ * Opt-in diagnostics callback, called for every failed sentence. sentence is
+ * NULL for a sentence dropped for being too long to keep across chunks.
+ */
+typedef void (*nmea_diag_callback_t)(const char *sentence, size_t len, const rmc_error_detail_t *error, void *user_data);
+
+/**
+ * Maximum size of a sentence kept across two chunks by the stream parser
+ */
+#define NMEA_STREAM_CARRY_SIZE		128
+
+/**
+ * Callback receiving every sentence found by the stream parser. data is only
+ * fully filled in when result is RMC_PARSE_SUCCESSFUL_WITH_FIX.
+ */
+typedef void (*nmea_rmc_callback_t)(const nmea_rmc_data_t *data, rmc_parse_result result, void *user_data);
+
+/**
+ * Resumable parser context for a byte stream delivered in arbitrary chunks
+ */
+typedef struct nmea_stream_t
+{
+	nmea_rmc_callback_t callback;				/**< Called for every sentence found. */
+	void *user_data;							/**< Handed back to the callback. */
+	nmea_error_counters_t *counters;			/**< Failures are counted here when not NULL. */
+	nmea_diag_callback_t diag;					/**< Called for every failure when not NULL. */
+	void *diag_user_data;						/**< Handed back to diag. */
+	unsigned int fields;						/**< RMC_FIELD_MASK_* to decode. */
+	unsigned int carry_len;						/**< Bytes of the pending sentence in carry. */
+	char in_sentence;							/**< A sentence started in a previous chunk. */
+	char overflow;								/**< The pending sentence did not fit in carry. */
+	char carry[NMEA_STREAM_CARRY_SIZE];			/**< Start of a sentence straddling two chunks. */
+} nmea_stream_t;
+
+/**
+ * Talker ID, the constellation a sentence comes from
+ */
+typedef enum {
+	NMEA_TALKER_UNKNOWN = 0,
+	NMEA_TALKER_GP,								/**< GPS. */
+	NMEA_TALKER_GL,								/**< GLONASS. */
+	NMEA_TALKER_GA,								/**< Galileo. */
+	NMEA_TALKER_GB,								/**< BeiDou. */
+	NMEA_TALKER_BD,								/**< BeiDou, older receivers. */
+	NMEA_TALKER_GQ,								/**< QZSS. */
+	NMEA_TALKER_GI,								/**< NavIC. */
+	NMEA_TALKER_GN,								/**< Combined solution of several constellations. */
+	NMEA_TALKER_CODE_INVALID
+} nmea_talker;
+
+/**
+ * Sentence type, the three letters after the talker ID
+ */
+typedef enum {
+	NMEA_SENTENCE_UNKNOWN = 0,
+	NMEA_SENTENCE_RMC,							/**< Recommended minimum data. */
+	NMEA_SENTENCE_GGA,							/**< Fix data. */
+	NMEA_SENTENCE_VTG,							/**< Track and ground speed. */
+	NMEA_SENTENCE_GLL,							/**< Geographic position. */
+	NMEA_SENTENCE_GSA,							/**< DOP and active satellites. */
+	NMEA_SENTENCE_GSV,							/**< Satellites in view. */
+	NMEA_SENTENCE_CODE_INVALID
+} nmea_sentence_type;
+
+/**
+ * Structure to store GGA data
+ */
+typedef struct nmea_gga_data_t
+{
+	char hour;
+	char min;
+	char sec;
+	char quality;								/**< 0 no fix, 1 GPS, 2 DGPS, 4 RTK fixed, 5 RTK float, ... */
+	uint16_t millisec;
+	int16_t satellites;							/**< Satellites in use, -1 when not reported. */
+	int32_t latitude_e7;
+	int32_t longitude_e7;
+	double latitude;
+	double longitude;
+	double hdop;
+	double altitude;							/**< Above mean sea level, meters. */
+	double geoid_separation;					/**< Geoid above the WGS84 ellipsoid, meters. */
+} nmea_gga_data_t;
+
+/**
+ * Structure to store VTG data
+ */
+typedef struct nmea_vtg_data_t
+{
+	char mode;									/**< A autonomous, D differential, E estimated, N not valid, 0 if absent. */
+	double track_true;							/**< Degrees. */
+	double track_magnetic;						/**< Degrees. */
+	double speed_knots;
+	double speed_kmh;
+} nmea_vtg_data_t;
+
+/**
+ * Structure to store GLL data
+ */
+typedef struct nmea_gll_data_t
+{
+	char hour;
+	char min;
+	char sec;
+	char status;								/**< A valid, V not valid. */
+	char mode;									/**< As in VTG, 0 if absent. */
+	uint16_t millisec;
+	int32_t latitude_e7;
+	int32_t longitude_e7;
+	double latitude;
+	double longitude;
+} nmea_gll_data_t;
+
+#define NMEA_GSA_MAX_SATELLITES		12
+
+/**
+ * Structure to store GSA data
+ */
+typedef struct nmea_gsa_data_t
+{
+	char selection;								/**< M manual, A automatic 2D/3D. */
+	char fix_type;								/**< 1 no fix, 2 2D, 3 3D. */
+	char num_satellites;						/**< Entries used in prn. */
+	char system_id;								/**< NMEA 4.10 GNSS system ID, 0 if absent. */
+	int16_t prn[NMEA_GSA_MAX_SATELLITES];		/**< Satellites used in the solution. */
+	double pdop;
+	double hdop;
+	double vdop;
+} nmea_gsa_data_t;
+
+#define NMEA_GSV_MAX_SATELLITES		4
+
+/**
+ * Structure to store GSV data, one message of a GSV group
+ */
+typedef struct nmea_gsv_data_t
+{
+	char num_messages;							/**< Messages in the group. */
+	char message_number;						/**< 1 to num_messages. */
+	char num_satellites;						/**< Entries used in satellites. */
+	char signal_id;								/**< NMEA 4.10 signal ID, 0 if absent. */
+	int16_t satellites_in_view;
+	struct {
+		int16_t prn;
+		int16_t elevation;						/**< Degrees, -1 when not reported. */
+		int16_t azimuth;						/**< Degrees, -1 when not reported. */
+		int16_t snr;							/**< dB-Hz, -1 when not tracked. */
+	} satellites[NMEA_GSV_MAX_SATELLITES];
+} nmea_gsv_data_t;
+
+/**
+ * Structure to store GPS info of various sentences. talker and type tell
+ * which member of the union parse_nmea() filled in.
  */
 typedef struct nmea_0183_data_t
 {
-   	nmea_rmc_data_t rmcData;
+	nmea_talker talker;
+	nmea_sentence_type type;
+	union {
+		nmea_rmc_data_t rmcData;
+		nmea_gga_data_t ggaData;
+		nmea_vtg_data_t vtgData;
+		nmea_gll_data_t gllData;
+		nmea_gsa_data_t gsaData;
+		nmea_gsv_data_t gsvData;
+	};
 } nmea_0183_data_t;
 
 /*******************************************************************************
@@ -76,6 +326,27 @@ typedef struct nmea_0183_data_t
 *******************************************************************************/
 
 rmc_parse_result parse_rmc(nmea_rmc_data_t *data, const char *buf, const int bufSize);
+rmc_parse_result parse_rmc_detail(nmea_rmc_data_t *data, const char *buf, size_t len, rmc_error_detail_t *error);
+rmc_parse_result parse_rmc_fields(nmea_rmc_data_t *data, const char *buf, size_t len, unsigned int fields,
+		rmc_error_detail_t *error);
+const char *rmc_parse_error_name(rmc_parse_error error);
+void nmea_rmc_set_time(nmea_rmc_data_t *data, int64_t epoch_ms);
+rmc_parse_result parse_nmea(nmea_0183_data_t *data, const char *buf, size_t len, rmc_error_detail_t *error);
+
+void nmea_stream_init(nmea_stream_t *ctx, nmea_rmc_callback_t callback, void *user_data);
+void nmea_stream_set_diagnostics(nmea_stream_t *ctx, nmea_error_counters_t *counters,
+		nmea_diag_callback_t diag, void *user_data);
+void nmea_stream_set_fields(nmea_stream_t *ctx, unsigned int fields);
+void nmea_stream_reset(nmea_stream_t *ctx);
+int nmea_stream_feed(nmea_stream_t *ctx, const char *buf, int len);
+
+size_t parse_rmc_buffer(const char *buf, size_t len, nmea_rmc_data_t *fixes,
+		rmc_line_result_t *results, size_t max_results, size_t *consumed);
+size_t parse_rmc_buffer_fields(const char *buf, size_t len, unsigned int fields, nmea_rmc_data_t *fixes,
+		rmc_line_result_t *results, size_t max_results, size_t *consumed);
+void nmea_parse_stats_add(nmea_parse_stats_t *stats, const rmc_line_result_t *results, size_t count);
+void nmea_parse_stats_merge(nmea_parse_stats_t *stats, const nmea_parse_stats_t *other);
+size_t nmea_error_count(const nmea_error_counters_t *counters, rmc_parse_error error);
 
 #ifdef __cplusplus
 }
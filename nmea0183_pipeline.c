@@ -0,0 +1,549 @@
+/** @file
+ *  Provides implementation for the pipelined ingest of a NMEA byte stream.
+ *
+ *  A reader thread fills chunks of NMEA_PIPELINE_CHUNK_SIZE bytes from a source
+ *  (nmea0183_source.h), decompressing it if need be, cut at the last line
+ *  ending, and deals them round-robin to the parser threads. Each parser owns a
+ *  lane of three rings: full chunks from the reader, parsed chunks to the
+ *  writer, and drained chunks back to the reader. The writer, the calling
+ *  thread, takes parsed chunks from the lanes in the same round-robin order, so
+ *  the callback sees the input order. Every ring has a single producer and a
+ *  single consumer, and a lane only owns NMEA_PIPELINE_CHUNKS_PER_LANE chunks,
+ *  so a slow stage holds back the others instead of letting memory grow.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#define _GNU_SOURCE				// memrchr()
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nmea0183_pipeline.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define CHUNK_INITIAL_CAPACITY		(NMEA_PIPELINE_CHUNK_SIZE / 64)
+#define WAIT_SPINS					64			// polls before yielding the CPU
+#define WAIT_YIELDS					1024		// yields before sleeping
+#define WAIT_SLEEP_NS				100000
+
+/**
+ * Bytes read from the stream and the sentences parsed from them
+ */
+typedef struct pipeline_chunk_t
+{
+	char *buf;
+	size_t len;
+	size_t offset;						// stream offset of buf[0]
+	int eos;							// no more chunks follow on this lane
+	nmea_rmc_data_t *data;
+	rmc_line_result_t *results;
+	size_t count;
+	size_t capacity;
+} pipeline_chunk_t;
+
+struct pipeline_ctx_t;
+
+/**
+ * One parser thread and the rings connecting it to the reader and writer
+ */
+typedef struct pipeline_lane_t
+{
+	nmea_ring_t input;					// reader -> parser
+	nmea_ring_t output;					// parser -> writer
+	nmea_ring_t drained;				// writer -> reader
+	nmea_parse_stats_t stats;
+	struct pipeline_ctx_t *ctx;
+	pthread_t thread;
+	pipeline_chunk_t chunks[NMEA_PIPELINE_CHUNKS_PER_LANE];
+} pipeline_lane_t;
+
+/**
+ * State shared by the stages
+ */
+typedef struct pipeline_ctx_t
+{
+	nmea_source_t *source;
+	int num_lanes;
+	unsigned int fields;
+	pipeline_lane_t *lanes;
+	int failed;
+} pipeline_ctx_t;
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static void *reader_main(void *arg);
+static void *parser_main(void *arg);
+static size_t read_full(pipeline_ctx_t *ctx, char *buf, size_t len, int *eof);
+static void parse_chunk(pipeline_lane_t *lane, pipeline_chunk_t *chunk);
+static int chunk_grow(pipeline_chunk_t *chunk);
+static void ring_wait_push(nmea_ring_t *ring, void *item);
+static void *ring_wait_pop(nmea_ring_t *ring);
+static void wait_backoff(unsigned int *waits);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Initialize an empty ring
+* @param  ring: Ring to initialize
+* @param  capacity: Most items held, rounded up to a power of two
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+int nmea_ring_init(nmea_ring_t *ring, size_t capacity)
+{
+	size_t size = 1;
+
+	while (size < capacity) {
+		size <<= 1;
+	}
+	ring->slots = calloc(size, sizeof(void *));
+	ring->mask = size - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	return ring->slots ? 0 : -1;
+}
+
+/**
+********************************************************************************
+* Free the slots of a ring; the items are the caller's
+* @param  ring: Ring to destroy
+********************************************************************************/
+void nmea_ring_destroy(nmea_ring_t *ring)
+{
+	free(ring->slots);
+	ring->slots = NULL;
+}
+
+/**
+********************************************************************************
+* Append an item, from the producer thread only
+* @param  ring: Ring to append to
+* @param  item: Item to append
+* @return 1 on success, 0 if the ring is full
+********************************************************************************/
+int nmea_ring_push(nmea_ring_t *ring, void *item)
+{
+	size_t head = ring->head;
+
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > ring->mask) {
+		return 0;
+	}
+	ring->slots[head & ring->mask] = item;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/**
+********************************************************************************
+* Remove the oldest item, from the consumer thread only
+* @param  ring: Ring to remove from
+* @return The item, NULL if the ring is empty
+********************************************************************************/
+void *nmea_ring_pop(nmea_ring_t *ring)
+{
+	size_t tail = ring->tail;
+	void *item;
+
+	if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+		return NULL;
+	}
+	item = ring->slots[tail & ring->mask];
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	return item;
+}
+
+/**
+********************************************************************************
+* Parse a byte stream, e.g. a file or a pipe, with reading, parsing and
+* handing out the sentences overlapped on separate threads. Sentences reach
+* the callback in stream order, on the calling thread, with offsets relative
+* to the start of the stream. gzip and zstd input is decompressed by the
+* reader thread when built in.
+* @param  fd: File descriptor to read until end of file
+* @param  num_parsers: Number of parser threads, 0 for one per online CPU not
+*         taken by the reader and the caller
+* @param  fields: RMC_FIELD_MASK_* to decode
+* @param  callback: Receives the sentences in order, may be NULL
+* @param  user_data: Handed back to the callback
+* @param  stats: Merged counters of all parsers, may be NULL
+* @return 0 on success, -1 on a read error, on input that cannot be
+*         decompressed, or if threads or memory could not be allocated
+********************************************************************************/
+int nmea_pipeline_run(int fd, int num_parsers, unsigned int fields,
+		nmea_batch_callback_t callback, void *user_data, nmea_parse_stats_t *stats)
+{
+	nmea_source_t source;
+	int result;
+
+	if (nmea_source_open(&source, fd, 1)) {
+		return -1;
+	}
+	result = nmea_pipeline_run_source(&source, num_parsers, fields, callback, user_data, stats);
+	nmea_source_close(&source);
+
+	return result;
+}
+
+/**
+********************************************************************************
+* Same as nmea_pipeline_run(), on a source opened by the caller, e.g. with
+* threads decoding zstd frames in parallel
+* @param  source: Source to read until its end
+* @param  num_parsers: Number of parser threads, 0 for one per online CPU not
+*         taken by the reader and the caller
+* @param  fields: RMC_FIELD_MASK_* to decode
+* @param  callback: Receives the sentences in order, may be NULL
+* @param  user_data: Handed back to the callback
+* @param  stats: Merged counters of all parsers, may be NULL
+* @return 0 on success, -1 on a read or decompression error, or if threads or
+*         memory could not be allocated
+********************************************************************************/
+int nmea_pipeline_run_source(nmea_source_t *source, int num_parsers, unsigned int fields,
+		nmea_batch_callback_t callback, void *user_data, nmea_parse_stats_t *stats)
+{
+	pipeline_ctx_t ctx;
+	pipeline_lane_t *lane;
+	pipeline_chunk_t *chunk;
+	pthread_t reader;
+	int t, c, started = 0, reader_started = 0, result = 0;
+
+	if (num_parsers <= 0) {
+		num_parsers = (int)sysconf(_SC_NPROCESSORS_ONLN) - 2;
+		if (num_parsers <= 0) {
+			num_parsers = 1;
+		}
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.source = source;
+	ctx.num_lanes = num_parsers;
+	ctx.fields = fields;
+	ctx.lanes = aligned_alloc(64, num_parsers * sizeof(pipeline_lane_t));
+	if (!ctx.lanes) {
+		return -1;
+	}
+	memset(ctx.lanes, 0, num_parsers * sizeof(pipeline_lane_t));
+
+	for (t = 0; t < num_parsers; t++) {
+		lane = &ctx.lanes[t];
+		lane->ctx = &ctx;
+		if (nmea_ring_init(&lane->input, NMEA_PIPELINE_CHUNKS_PER_LANE) ||
+				nmea_ring_init(&lane->output, NMEA_PIPELINE_CHUNKS_PER_LANE) ||
+				nmea_ring_init(&lane->drained, NMEA_PIPELINE_CHUNKS_PER_LANE)) {
+			result = -1;
+			goto pipeline_cleanup;
+		}
+		for (c = 0; c < NMEA_PIPELINE_CHUNKS_PER_LANE; c++) {
+			lane->chunks[c].buf = malloc(NMEA_PIPELINE_CHUNK_SIZE);
+			if (!lane->chunks[c].buf) {
+				result = -1;
+				goto pipeline_cleanup;
+			}
+			nmea_ring_push(&lane->drained, &lane->chunks[c]);
+		}
+	}
+
+	for (t = 0; t < num_parsers; t++) {
+		if (pthread_create(&ctx.lanes[t].thread, NULL, parser_main, &ctx.lanes[t])) {
+			result = -1;
+			break;
+		}
+		started++;
+	}
+	if (result == 0 && pthread_create(&reader, NULL, reader_main, &ctx) == 0) {
+		reader_started = 1;
+	} else {
+		// let the parsers already started run into the end of the stream
+		result = -1;
+		for (t = 0; t < started; t++) {
+			chunk = ring_wait_pop(&ctx.lanes[t].drained);
+			chunk->len = 0;
+			chunk->eos = 1;
+			ring_wait_push(&ctx.lanes[t].input, chunk);
+		}
+	}
+
+	// writer stage: drain the lanes in the order the reader filled them
+	for (t = 0; reader_started; t = (t + 1) % num_parsers) {
+		lane = &ctx.lanes[t];
+		chunk = ring_wait_pop(&lane->output);
+		if (chunk->eos) {
+			break;
+		}
+		if (callback && chunk->count) {
+			callback(chunk->data, chunk->results, chunk->count, user_data);
+		}
+		ring_wait_push(&lane->drained, chunk);
+	}
+
+	if (reader_started) {
+		pthread_join(reader, NULL);
+	}
+	for (t = 0; t < started; t++) {
+		pthread_join(ctx.lanes[t].thread, NULL);
+	}
+
+	if (ctx.failed) {
+		result = -1;
+	}
+	if (stats) {
+		memset(stats, 0, sizeof(*stats));
+		for (t = 0; t < num_parsers; t++) {
+			nmea_parse_stats_merge(stats, &ctx.lanes[t].stats);
+		}
+	}
+
+pipeline_cleanup:
+	for (t = 0; t < num_parsers; t++) {
+		lane = &ctx.lanes[t];
+		for (c = 0; c < NMEA_PIPELINE_CHUNKS_PER_LANE; c++) {
+			free(lane->chunks[c].buf);
+			free(lane->chunks[c].data);
+			free(lane->chunks[c].results);
+		}
+		nmea_ring_destroy(&lane->input);
+		nmea_ring_destroy(&lane->output);
+		nmea_ring_destroy(&lane->drained);
+	}
+	free(ctx.lanes);
+
+	return result;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Reader stage: fill chunks from the file descriptor and deal them to the
+* lanes, then send every lane the end of the stream
+* @param  arg: Shared state
+* @return NULL
+********************************************************************************/
+static void *reader_main(void *arg)
+{
+	pipeline_ctx_t *ctx = arg;
+	pipeline_chunk_t *chunk;
+	char *carry = malloc(NMEA_PIPELINE_CHUNK_SIZE);
+	size_t carry_len = 0, offset = 0, len;
+	int lane = 0, eof = 0, t;
+	const char *nl;
+
+	if (!carry) {
+		__atomic_store_n(&ctx->failed, 1, __ATOMIC_RELAXED);
+		eof = 1;
+	}
+
+	while (!eof) {
+		chunk = ring_wait_pop(&ctx->lanes[lane].drained);
+		memcpy(chunk->buf, carry, carry_len);
+		len = carry_len + read_full(ctx, chunk->buf + carry_len, NMEA_PIPELINE_CHUNK_SIZE - carry_len, &eof);
+
+		// keep the line in progress for the next chunk
+		carry_len = 0;
+		if (!eof) {
+			nl = memrchr(chunk->buf, '\n', len);
+			if (nl) {
+				carry_len = chunk->buf + len - (nl + 1);
+				memcpy(carry, nl + 1, carry_len);
+				len -= carry_len;
+			}
+		}
+
+		chunk->len = len;
+		chunk->offset = offset;
+		chunk->eos = 0;
+		offset += len;
+		ring_wait_push(&ctx->lanes[lane].input, chunk);
+		lane = (lane + 1) % ctx->num_lanes;
+	}
+
+	// the writer stops at the first end of stream, so send it in dealing order
+	for (t = 0; t < ctx->num_lanes; t++) {
+		chunk = ring_wait_pop(&ctx->lanes[lane].drained);
+		chunk->len = 0;
+		chunk->eos = 1;
+		ring_wait_push(&ctx->lanes[lane].input, chunk);
+		lane = (lane + 1) % ctx->num_lanes;
+	}
+
+	free(carry);
+	return NULL;
+}
+
+/**
+********************************************************************************
+* Parser stage of one lane
+* @param  arg: The lane
+* @return NULL
+********************************************************************************/
+static void *parser_main(void *arg)
+{
+	pipeline_lane_t *lane = arg;
+	pipeline_chunk_t *chunk;
+
+	do {
+		chunk = ring_wait_pop(&lane->input);
+		if (!chunk->eos) {
+			parse_chunk(lane, chunk);
+		}
+		ring_wait_push(&lane->output, chunk);
+	} while (!chunk->eos);
+
+	return NULL;
+}
+
+/**
+********************************************************************************
+* Read until a buffer is full or the end of the source
+* @param  ctx: Shared state
+* @param  buf: Buffer to fill
+* @param  len: Bytes to read
+* @param  eof: Set on end of the source or read error
+* @return Number of bytes read
+********************************************************************************/
+static size_t read_full(pipeline_ctx_t *ctx, char *buf, size_t len, int *eof)
+{
+	size_t total = 0;
+	ssize_t n;
+
+	while (total < len) {
+		n = nmea_source_read(ctx->source, buf + total, len - total);
+		if (n <= 0) {
+			if (n < 0) {
+				__atomic_store_n(&ctx->failed, 1, __ATOMIC_RELAXED);
+			}
+			*eof = 1;
+			break;
+		}
+		total += n;
+	}
+	return total;
+}
+
+/**
+********************************************************************************
+* Parse every sentence of a chunk
+* @param  lane: Lane of the parser
+* @param  chunk: Chunk to parse
+********************************************************************************/
+static void parse_chunk(pipeline_lane_t *lane, pipeline_chunk_t *chunk)
+{
+	size_t begin = 0, consumed, n, i;
+
+	chunk->count = 0;
+	while (begin < chunk->len) {
+		if (chunk->count == chunk->capacity && !chunk_grow(chunk)) {
+			__atomic_store_n(&lane->ctx->failed, 1, __ATOMIC_RELAXED);
+			return;
+		}
+		n = parse_rmc_buffer_fields(chunk->buf + begin, chunk->len - begin, lane->ctx->fields,
+				chunk->data + chunk->count, chunk->results + chunk->count, chunk->capacity - chunk->count, &consumed);
+		for (i = chunk->count; i < chunk->count + n; i++) {
+			chunk->results[i].offset += chunk->offset + begin;
+		}
+		nmea_parse_stats_add(&lane->stats, chunk->results + chunk->count, n);
+		chunk->count += n;
+		begin += consumed;
+	}
+}
+
+static int chunk_grow(pipeline_chunk_t *chunk)
+{
+	size_t capacity = chunk->capacity ? chunk->capacity * 2 : CHUNK_INITIAL_CAPACITY;
+	nmea_rmc_data_t *data = realloc(chunk->data, capacity * sizeof(*data));
+	rmc_line_result_t *results;
+
+	if (!data) {
+		return 0;
+	}
+	chunk->data = data;
+	results = realloc(chunk->results, capacity * sizeof(*results));
+	if (!results) {
+		return 0;
+	}
+	chunk->results = results;
+	chunk->capacity = capacity;
+	return 1;
+}
+
+static void ring_wait_push(nmea_ring_t *ring, void *item)
+{
+	unsigned int waits = 0;
+
+	while (!nmea_ring_push(ring, item)) {
+		wait_backoff(&waits);
+	}
+}
+
+static void *ring_wait_pop(nmea_ring_t *ring)
+{
+	unsigned int waits = 0;
+	void *item;
+
+	while (!(item = nmea_ring_pop(ring))) {
+		wait_backoff(&waits);
+	}
+	return item;
+}
+
+/**
+********************************************************************************
+* Wait a little longer each time a ring is found full or empty: poll first,
+* then give up the CPU, then sleep so an idle stage costs next to nothing
+* @param  waits: Number of waits so far
+********************************************************************************/
+static void wait_backoff(unsigned int *waits)
+{
+	struct timespec ts = { 0, WAIT_SLEEP_NS };
+
+	if (*waits < WAIT_SPINS) {
+		(*waits)++;
+	} else if (*waits < WAIT_SPINS + WAIT_YIELDS) {
+		(*waits)++;
+		sched_yield();
+	} else {
+		nanosleep(&ts, NULL);
+	}
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
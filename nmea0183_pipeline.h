@@ -0,0 +1,81 @@
+/** @file
+ *  Provides prototypes for the pipelined ingest of a NMEA byte stream: a
+ *  reader, parser and writer stage connected by single-producer/single-consumer
+ *  rings.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_PIPELINE_H__
+#define __NMEA0183_PIPELINE_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+
+#include "nmea0183_parser.h"
+#include "nmea0183_parallel.h"
+#include "nmea0183_source.h"
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_PIPELINE_CHUNK_SIZE		(1024 * 1024)	/**< Bytes read per chunk. */
+#define NMEA_PIPELINE_CHUNKS_PER_LANE	4				/**< Chunks in flight per parser thread. */
+
+/**
+ * Bounded lock-free ring carrying pointers from one producer thread to one
+ * consumer thread. head and tail sit on their own cache lines so the two
+ * sides do not share one.
+ */
+typedef struct nmea_ring_t
+{
+	void **slots;
+	size_t mask;								/**< Capacity - 1, the capacity is a power of two. */
+	size_t head __attribute__((aligned(64)));	/**< Next slot to fill, written by the producer. */
+	size_t tail __attribute__((aligned(64)));	/**< Next slot to drain, written by the consumer. */
+} nmea_ring_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_ring_init(nmea_ring_t *ring, size_t capacity);
+void nmea_ring_destroy(nmea_ring_t *ring);
+int nmea_ring_push(nmea_ring_t *ring, void *item);
+void *nmea_ring_pop(nmea_ring_t *ring);
+
+int nmea_pipeline_run(int fd, int num_parsers, unsigned int fields,
+		nmea_batch_callback_t callback, void *user_data, nmea_parse_stats_t *stats);
+int nmea_pipeline_run_source(nmea_source_t *source, int num_parsers, unsigned int fields,
+		nmea_batch_callback_t callback, void *user_data, nmea_parse_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
@@ -0,0 +1,311 @@
+/** @file
+ *  Provides implementation for the sentence scanning front end of the GPS NMEA
+ *  parser. A single pass over the sentence body computes the XOR checksum and
+ *  a bitmask of ',' positions; the kernel is picked at runtime from the CPU.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define NMEA_SCAN_X86
+#endif
+
+#include "nmea0183_scan.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+typedef void (*scan_kernel_t)(const char *buf, size_t len, nmea_scan_t *scan);
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static void scan_kernel_scalar(const char *buf, size_t len, nmea_scan_t *scan);
+#ifdef NMEA_SCAN_X86
+static void scan_kernel_sse2(const char *buf, size_t len, nmea_scan_t *scan);
+static void scan_kernel_avx2(const char *buf, size_t len, nmea_scan_t *scan);
+#endif
+static nmea_scan_kernel scan_best_kernel(void);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+static scan_kernel_t scan_kernel;
+static nmea_scan_kernel scan_kernel_id;
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Scan a sentence body, i.e. the bytes between '$' and '*'
+* @param  buf: Pointer to the first byte after '$'
+* @param  len: Number of bytes to scan
+* @param  scan: Checksum, ',' bitmask and '*' presence of the bytes scanned
+* @return 1 on success, 0 if len exceeds NMEA_SCAN_MAX_SIZE
+********************************************************************************/
+int nmea_scan(const char *buf, size_t len, nmea_scan_t *scan)
+{
+	if (len > NMEA_SCAN_MAX_SIZE) {
+		return 0;
+	}
+	scan_kernel_t kernel = __atomic_load_n(&scan_kernel, __ATOMIC_ACQUIRE);
+
+	if (!kernel) {
+		nmea_scan_select(NMEA_SCAN_KERNEL_AUTO);
+		kernel = __atomic_load_n(&scan_kernel, __ATOMIC_ACQUIRE);
+	}
+
+	kernel(buf, len, scan);
+	return 1;
+}
+
+/**
+********************************************************************************
+* Turn the ',' bitmask of a scan into ',' offsets, in increasing order
+* @param  scan: Result of nmea_scan()
+* @param  commas: Offsets of the first max_commas ','
+* @param  max_commas: Number of entries in commas
+* @return Number of ',' in the body, which may exceed max_commas
+********************************************************************************/
+int nmea_scan_fields(const nmea_scan_t *scan, unsigned char *commas, int max_commas)
+{
+	int i, n = 0;
+
+	for (i = 0; i < NMEA_SCAN_WORDS; i++) {
+		uint64_t mask = scan->commas[i];
+		while (mask) {
+			if (n < max_commas) {
+				commas[n] = i * 64 + __builtin_ctzll(mask);
+			}
+			n++;
+			mask &= mask - 1;
+		}
+	}
+
+	return n;
+}
+
+/**
+********************************************************************************
+* Select the scan kernel, e.g. to compare kernels in a benchmark
+* @param  kernel: Kernel to use, NMEA_SCAN_KERNEL_AUTO for the best available
+* @return 1 on success, 0 if the CPU does not support the kernel
+********************************************************************************/
+int nmea_scan_select(nmea_scan_kernel kernel)
+{
+	scan_kernel_t fn;
+
+	if (kernel == NMEA_SCAN_KERNEL_AUTO) {
+		kernel = scan_best_kernel();
+	}
+
+	switch (kernel) {
+		case NMEA_SCAN_KERNEL_SCALAR:
+			fn = scan_kernel_scalar;
+			break;
+#ifdef NMEA_SCAN_X86
+		case NMEA_SCAN_KERNEL_SSE2:
+			if (!__builtin_cpu_supports("sse2")) return 0;
+			fn = scan_kernel_sse2;
+			break;
+		case NMEA_SCAN_KERNEL_AVX2:
+			if (!__builtin_cpu_supports("avx2")) return 0;
+			fn = scan_kernel_avx2;
+			break;
+#endif
+		default:
+			return 0;
+	}
+	// threads racing on the first scan all store the same kernel
+	__atomic_store_n(&scan_kernel_id, kernel, __ATOMIC_RELAXED);
+	__atomic_store_n(&scan_kernel, fn, __ATOMIC_RELEASE);
+
+	return 1;
+}
+
+/**
+********************************************************************************
+* Get the scan kernel in use
+* @return Kernel selected by nmea_scan_select() or picked on first use
+********************************************************************************/
+nmea_scan_kernel nmea_scan_kernel_in_use(void)
+{
+	if (!__atomic_load_n(&scan_kernel, __ATOMIC_ACQUIRE)) {
+		nmea_scan_select(NMEA_SCAN_KERNEL_AUTO);
+	}
+	return __atomic_load_n(&scan_kernel_id, __ATOMIC_RELAXED);
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+static nmea_scan_kernel scan_best_kernel(void)
+{
+#ifdef NMEA_SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return NMEA_SCAN_KERNEL_AVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return NMEA_SCAN_KERNEL_SSE2;
+	}
+#endif
+	return NMEA_SCAN_KERNEL_SCALAR;
+}
+
+static void scan_kernel_scalar(const char *buf, size_t len, nmea_scan_t *scan)
+{
+	uint64_t commas = 0;
+	unsigned char x = 0, star = 0;
+	size_t i;
+
+	memset(scan->commas, 0, sizeof(scan->commas));
+	for (i = 0; i < len; i++) {
+		x ^= buf[i];
+		star |= buf[i] == '*';
+		commas |= (uint64_t)(buf[i] == ',') << (i & 63);
+		if ((i & 63) == 63) {
+			scan->commas[i >> 6] = commas;
+			commas = 0;
+		}
+	}
+	if (len & 63) {
+		scan->commas[len >> 6] = commas;
+	}
+	scan->checksum = x;
+	scan->has_star = star;
+}
+
+#ifdef NMEA_SCAN_X86
+
+/**
+********************************************************************************
+* Fold the XOR of the 16 bytes of a vector into one byte
+********************************************************************************/
+__attribute__((target("sse2")))
+static unsigned char scan_fold_xor(__m128i acc)
+{
+	uint64_t x = (uint64_t)_mm_cvtsi128_si64(acc) ^ (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc));
+
+	x ^= x >> 32;
+	x ^= x >> 16;
+	x ^= x >> 8;
+	return (unsigned char)x;
+}
+
+/**
+********************************************************************************
+* The tail of the body takes one more vector step instead of a byte loop: the
+* last vector of the body is loaded again with the lanes already scanned
+* cleared. Zeros change neither the checksum nor the ',' and '*' masks. Bodies
+* shorter than one vector are copied to a zero-padded block, so that no load
+* reads past the end of the body.
+********************************************************************************/
+__attribute__((target("sse2")))
+static void scan_kernel_sse2(const char *buf, size_t len, nmea_scan_t *scan)
+{
+	const __m128i comma = _mm_set1_epi8(',');
+	const __m128i star = _mm_set1_epi8('*');
+	const __m128i lanes = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i acc = _mm_setzero_si128();
+	__m128i stars = _mm_setzero_si128();
+	uint64_t commas[NMEA_SCAN_WORDS] = { 0 };
+	char tail[16] __attribute__((aligned(16)));
+	size_t i;
+
+	for (i = 0; i < len; i += 16) {
+		__m128i v;
+		int shift = 0;
+		if (i + 16 <= len) {
+			v = _mm_loadu_si128((const __m128i *)(buf + i));
+		} else if (len >= 16) {
+			// last 16 bytes of the body, with the lanes already scanned cleared
+			shift = 16 - (len - i);
+			v = _mm_loadu_si128((const __m128i *)(buf + len - 16));
+			v = _mm_and_si128(v, _mm_cmpgt_epi8(lanes, _mm_set1_epi8(shift - 1)));
+		} else {
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, buf, len);
+			v = _mm_load_si128((const __m128i *)tail);
+		}
+		acc = _mm_xor_si128(acc, v);
+		stars = _mm_or_si128(stars, _mm_cmpeq_epi8(v, star));
+		commas[i >> 6] |= (uint64_t)((uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)) >> shift) << (i & 63);
+	}
+
+	memcpy(scan->commas, commas, sizeof(commas));
+	scan->checksum = scan_fold_xor(acc);
+	scan->has_star = _mm_movemask_epi8(stars) != 0;
+}
+
+__attribute__((target("avx2")))
+static void scan_kernel_avx2(const char *buf, size_t len, nmea_scan_t *scan)
+{
+	const __m256i comma = _mm256_set1_epi8(',');
+	const __m256i star = _mm256_set1_epi8('*');
+	const __m256i lanes = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+			16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+	__m256i acc = _mm256_setzero_si256();
+	__m256i stars = _mm256_setzero_si256();
+	uint64_t commas[NMEA_SCAN_WORDS] = { 0 };
+	char tail[32] __attribute__((aligned(32)));
+	size_t i;
+
+	for (i = 0; i < len; i += 32) {
+		__m256i v;
+		int shift = 0;
+		if (i + 32 <= len) {
+			v = _mm256_loadu_si256((const __m256i *)(buf + i));
+		} else if (len >= 32) {
+			shift = 32 - (len - i);
+			v = _mm256_loadu_si256((const __m256i *)(buf + len - 32));
+			v = _mm256_and_si256(v, _mm256_cmpgt_epi8(lanes, _mm256_set1_epi8(shift - 1)));
+		} else {
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, buf, len);
+			v = _mm256_load_si256((const __m256i *)tail);
+		}
+		acc = _mm256_xor_si256(acc, v);
+		stars = _mm256_or_si256(stars, _mm256_cmpeq_epi8(v, star));
+		commas[i >> 6] |= (uint64_t)((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, comma)) >> shift) << (i & 63);
+	}
+
+	memcpy(scan->commas, commas, sizeof(commas));
+	scan->checksum = scan_fold_xor(_mm_xor_si128(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+	scan->has_star = _mm256_movemask_epi8(stars) != 0;
+}
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
@@ -0,0 +1,81 @@
+/** @file
+ *  Provides prototypes for the sentence scanning front end of the GPS NMEA
+ *  parser: checksum and field delimiter detection in one pass.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_SCAN_H__
+#define __NMEA0183_SCAN_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_SCAN_MAX_SIZE			256				/**< Longest sentence body that can be scanned. */
+#define NMEA_SCAN_WORDS				(NMEA_SCAN_MAX_SIZE / 64)
+#define NMEA_MAX_FIELDS				32				/**< Most fields located by nmea_scan_fields(). */
+
+/**
+ * Result of scanning a sentence body, i.e. the bytes between '$' and '*'
+ */
+typedef struct nmea_scan_t
+{
+	uint64_t commas[NMEA_SCAN_WORDS];			/**< Bit i is set if byte i is a ','. */
+	unsigned char checksum;						/**< XOR of all bytes scanned. */
+	unsigned char has_star;						/**< A '*' was found among the bytes scanned. */
+} nmea_scan_t;
+
+/**
+ * Scan kernels, selected at runtime from the CPU features
+ */
+typedef enum {
+	NMEA_SCAN_KERNEL_AUTO = 0,					/**< Best kernel supported by the CPU. */
+	NMEA_SCAN_KERNEL_SCALAR = 1,				/**< Portable byte at a time kernel. */
+	NMEA_SCAN_KERNEL_SSE2 = 2,					/**< 16 bytes per step. */
+	NMEA_SCAN_KERNEL_AVX2 = 3,					/**< 32 bytes per step. */
+	NMEA_SCAN_KERNEL_INVALID
+} nmea_scan_kernel;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_scan(const char *buf, size_t len, nmea_scan_t *scan);
+int nmea_scan_fields(const nmea_scan_t *scan, unsigned char *commas, int max_commas);
+int nmea_scan_select(nmea_scan_kernel kernel);
+nmea_scan_kernel nmea_scan_kernel_in_use(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
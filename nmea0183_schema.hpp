@@ -0,0 +1,914 @@
+/** @file
+ *  Provides the schema-generated sentence decoders for C++17 users of the
+ *  parser, next to the C API of nmea0183_parser.h.
+ *
+ *  The fields of a sentence type are described by a list of field types
+ *  whose template arguments are the schema: field index, destination
+ *  members, scale, whether the field may be empty or missing, and the
+ *  hemisphere letters. sentence<> folds the list into one decoder per type
+ *  and field mask at compile time, so every index, member and letter is a
+ *  constant and the fields left out by the mask are not compiled in.
+ *  Results, data and error details are those of parse_rmc_fields() and
+ *  parse_nmea(); data is written in the same order, so also a failed
+ *  sentence leaves the same members set.
+ *
+ *  The checks of a schema are its own fields: present<> and count<> guard
+ *  the fields after them against a sentence with too few of them, status<>
+ *  and no_fix_if<> end the decode of a sentence without a fix.
+ *
+ *  e.g., nmea_rmc_data_t fix;
+ *        rmc_error_detail_t error;
+ *        nmea::decode<nmea::rmc_schema, RMC_FIELD_MASK_POSITION>(fix, buf, len, error);
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_SCHEMA_HPP__
+#define __NMEA0183_SCHEMA_HPP__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "nmea0183_parser.h"
+#include "nmea0183_scan.h"
+
+namespace nmea {
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+
+/**
+ * Outcome of a field, whether the decode goes on to the next one
+ */
+enum class step {
+	next,										/**< Decoded, go on. */
+	no_fix,										/**< The sentence reports no fix, stop here. */
+	failed										/**< Malformed, error is set. */
+};
+
+/**
+ * Whether a field may be left empty or out of the sentence
+ */
+enum class presence {
+	required,									/**< Full form, e.g. a time with its fraction, or a character other than empty. */
+	optional,									/**< May be empty, decoded as 0 (a time as midnight). */
+	trailing									/**< May be missing, e.g. the mode of NMEA 2.3; decoded as 0 then. */
+};
+
+/**
+ * A sentence whose checksum is verified and whose fields are located
+ */
+struct frame
+{
+	const char *buf;							/**< The '$' starting the sentence. */
+	const char *body;							/**< The byte after '$'. */
+	const char *star;							/**< The '*' before the checksum. */
+	int n;										/**< Number of commas in the body. */
+	unsigned char commas[NMEA_MAX_FIELDS];		/**< Offset of each comma from body. */
+
+	/** First character of field K, field 0 is the address ("GPRMC"). */
+	template <int K>
+	const char *begin() const
+	{
+		if constexpr (K == 0) {
+			return body;
+		} else {
+			return body + commas[K - 1] + 1;
+		}
+	}
+
+	/** The ',' or '*' ending field K. */
+	template <int K>
+	const char *end() const
+	{
+		return body + (K < n ? commas[K] : star - body);
+	}
+
+	/** Fail with a check and the position of the offending field. */
+	step fail(rmc_error_detail_t &error, rmc_parse_error field, const char *p) const
+	{
+		error.field = field;
+		error.offset = p - buf;
+		return step::failed;
+	}
+};
+
+namespace detail {
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+constexpr int decimal_max_digits = 18;			// digits that fit in an int64_t mantissa
+
+constexpr double pow10_double[decimal_max_digits + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+	1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+constexpr int64_t pow10_int[decimal_max_digits + 1] = {
+	1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+	100000000LL, 1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL,
+	10000000000000LL, 100000000000000LL, 1000000000000000LL,
+	10000000000000000LL, 100000000000000000LL, 1000000000000000000LL
+};
+
+// days of a non-leap year before the first of each month
+constexpr int16_t days_before_month[12] = {
+	0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
+
+// days of each month of a non-leap year
+constexpr char month_days[12] = {
+	31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+/*******************************************************************************
+*                          Inline Function Definitions
+*******************************************************************************/
+
+/** Member of a data structure, or a scratch value when Member is nullptr. */
+template <auto Member, class Data, class Value>
+inline auto &member_or(Data &data, Value &scratch)
+{
+	if constexpr (std::is_same_v<decltype(Member), std::nullptr_t>) {
+		return scratch;
+	} else {
+		return data.*Member;
+	}
+}
+
+/** Two digit decimal number, false if either character is not a digit. */
+inline bool two_digits(const char *p, char &value)
+{
+	if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') {
+		return false;
+	}
+	value = (p[0] - '0') * 10 + (p[1] - '0');
+	return true;
+}
+
+/** Fraction of seconds as milliseconds, further digits are truncated. */
+inline bool millisec(const char *begin, const char *end, uint16_t &value)
+{
+	int ms = 0, i = 0;
+
+	for (const char *p = begin; p < end; p++, i++) {
+		if (*p < '0' || *p > '9') {
+			return false;
+		}
+		if (i < 3) {
+			ms = ms * 10 + (*p - '0');
+		}
+	}
+	for (; i < 3; i++) {
+		ms *= 10;
+	}
+	value = ms;
+	return true;
+}
+
+/** Unsigned decimal as mantissa / 10^frac_digits, an empty field is 0. */
+inline bool decimal(const char *begin, const char *end, int64_t &mantissa, int &frac_digits)
+{
+	int64_t m = 0;
+	int digits = 0, frac = -1;
+
+	for (const char *p = begin; p < end; p++) {
+		if (*p >= '0' && *p <= '9') {
+			if (++digits > decimal_max_digits) {
+				return false;
+			}
+			m = m * 10 + (*p - '0');
+			if (frac >= 0) {
+				frac++;
+			}
+		} else if (*p == '.' && frac < 0) {
+			frac = 0;
+		} else {
+			return false;
+		}
+	}
+	mantissa = m;
+	frac_digits = frac < 0 ? 0 : frac;
+	return true;
+}
+
+/** Decimal field, correctly rounded up to 15 significant digits. */
+inline bool number(const char *begin, const char *end, double &value)
+{
+	int64_t mantissa;
+	int frac;
+
+	if (!decimal(begin, end, mantissa, frac)) {
+		return false;
+	}
+	// both operands are exact, so the division rounds once
+	value = (double)mantissa / pow10_double[frac];
+	return true;
+}
+
+/** Decimal field that may start with '-'. */
+inline bool signed_number(const char *begin, const char *end, double &value)
+{
+	if (begin < end && *begin == '-') {
+		if (!number(begin + 1, end, value)) {
+			return false;
+		}
+		value = -value;
+		return true;
+	}
+	return number(begin, end, value);
+}
+
+/** dddmm.mmmm field up to max_degrees, as degrees and units of 10^-Scale degree, rounded half up. */
+template <int Scale>
+inline bool degrees(const char *begin, const char *end, int max_degrees, double &value, int32_t &value_scaled)
+{
+	static_assert(Scale >= 1 && Scale <= 7, "180 degrees must fit in an int32_t");
+	const char *dot = (const char *)memchr(begin, '.', end - begin);
+	int64_t minutes, scaled, den, num;
+	int whole = 0, frac;
+
+	if (!dot || dot - begin < 2 || dot - begin > 5) {
+		return false;
+	}
+	for (const char *p = begin; p < dot - 2; p++) {
+		if (*p < '0' || *p > '9') {
+			return false;
+		}
+		whole = whole * 10 + (*p - '0');
+	}
+	if (whole > max_degrees || !decimal(dot - 2, end, minutes, frac)) {
+		return false;
+	}
+	// two digits before the dot leave frac <= 16, so 60 * 10^frac fits
+	den = 60 * pow10_int[frac];
+	if (minutes >= den || (whole == max_degrees && minutes)) {
+		return false;
+	}
+
+	// one rounding when both operands are exact doubles, i.e. up to 2^53
+	num = frac <= 12 ? whole * den + minutes : -1;
+	if (num >= 0 && num <= ((int64_t)1 << 53)) {
+		value = (double)num / (double)den;
+	} else {
+		value = (double)minutes / pow10_double[frac] / 60.0 + whole;
+	}
+
+	// minutes / 10^frac / 60 in units of 10^-Scale degree, without overflow
+	if (frac <= Scale) {
+		scaled = (minutes * pow10_int[Scale - frac] + 30) / 60;
+	} else {
+		int64_t d = 6 * pow10_int[frac - Scale + 1];
+		scaled = (minutes + d / 2) / d;
+	}
+	value_scaled = whole * (int32_t)pow10_int[Scale] + (int32_t)scaled;
+	return true;
+}
+
+/** Unsigned integer up to max, an empty field is -1. */
+inline bool integer(const char *begin, const char *end, int max, int &value)
+{
+	int v = 0;
+
+	if (begin == end) {
+		value = -1;
+		return true;
+	}
+	for (const char *p = begin; p < end; p++) {
+		if (*p < '0' || *p > '9' || v > max) {
+			return false;
+		}
+		v = v * 10 + (*p - '0');
+	}
+	if (v > max) {
+		return false;
+	}
+	value = v;
+	return true;
+}
+
+/** Single character among Allowed, an empty field is 0. */
+template <char... Allowed>
+inline bool character(const char *begin, const char *end, char &value)
+{
+	if (begin == end) {
+		value = 0;
+		return true;
+	}
+	if (end != begin + 1 || !*begin || !((*begin == Allowed) || ...)) {
+		return false;
+	}
+	value = *begin;
+	return true;
+}
+
+/** Days since 1970-01-01 of a two-digit year RMC date. */
+inline int64_t epoch_days(int year, int month, int day)
+{
+	int y = year + (year < RMC_YEAR_PIVOT ? 2000 : 1900);
+	int leap = (y & 3) == 0;
+
+	return 365 * (y - 1970) + (y - 1969) / 4 + days_before_month[month - 1] + (leap & (month > 2)) + day - 1;
+}
+
+/** Days of a month of a two-digit year, leap years as in epoch_days(). */
+inline int days_in_month(int year, int month)
+{
+	return month_days[month - 1] + (month == 2 && (year & 3) == 0);
+}
+
+/** Value of a hexadecimal digit, -1 if not one. */
+inline int hex_value(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+/** Known talker ID and the sentence type Code after '$', as parse_nmea() takes them. */
+inline bool address_is(const char *buf, const char *end, const char *code)
+{
+	constexpr int address_size = 7;			// "$GPRMC,"
+	const unsigned char *p = (const unsigned char *)buf;
+
+	if (end - buf <= address_size || p[0] != '$' || p[address_size - 1] != ',' ||
+			p[3] != code[0] || p[4] != code[1] || p[5] != code[2]) {
+		return false;
+	}
+	switch ((p[1] << 8) | p[2]) {
+		case ('G' << 8) | 'P': case ('G' << 8) | 'L': case ('G' << 8) | 'A': case ('G' << 8) | 'B':
+		case ('B' << 8) | 'D': case ('G' << 8) | 'Q': case ('G' << 8) | 'I': case ('G' << 8) | 'N':
+			return true;
+		default:
+			return false;
+	}
+}
+
+/** Verify the checksum and locate the fields, in one pass. */
+inline bool frame_sentence(frame &f, const char *buf, const char *end, rmc_error_detail_t &error)
+{
+	nmea_scan_t scan;
+	int hi, lo;
+
+	f.buf = buf;
+	f.body = buf + 1;							// skip '$' sign
+	f.star = end - 3;
+	if (*f.star != '*') {
+		f.fail(error, RMC_ERROR_CHECKSUM, f.star);
+		return false;
+	}
+	if (!nmea_scan(f.body, f.star - f.body, &scan)) {
+		f.fail(error, RMC_ERROR_LENGTH, buf);
+		return false;
+	}
+	if (scan.has_star) {
+		f.fail(error, RMC_ERROR_CHECKSUM, f.star);
+		return false;
+	}
+	hi = hex_value(f.star[1]);
+	lo = hex_value(f.star[2]);
+	if (hi < 0 || lo < 0 || scan.checksum != ((hi << 4) | lo)) {
+		f.fail(error, RMC_ERROR_CHECKSUM, f.star + 1);
+		return false;
+	}
+	f.n = nmea_scan_fields(&scan, f.commas, NMEA_MAX_FIELDS);
+	return true;
+}
+
+} // namespace detail
+
+/*******************************************************************************
+*                          Field Types
+*******************************************************************************/
+
+/**
+ * The body holds between Min and Max commas, i.e. Min + 1 to Max + 1 fields
+ */
+template <int Min, int Max, rmc_parse_error Error>
+struct count
+{
+	static constexpr unsigned int mask = 0;
+
+	template <class Data>
+	static step decode(Data &, const frame &f, rmc_error_detail_t &error)
+	{
+		return f.n >= Min && f.n <= Max ? step::next : f.fail(error, Error, f.star);
+	}
+};
+
+/**
+ * Field K and the comma before it are there
+ */
+template <int K, rmc_parse_error Error, unsigned int Mask = 0>
+struct present
+{
+	static constexpr unsigned int mask = Mask;
+
+	template <class Data>
+	static step decode(Data &, const frame &f, rmc_error_detail_t &error)
+	{
+		return f.n > K ? step::next : f.fail(error, Error, f.star);
+	}
+};
+
+/**
+ * hhmmss.sss UTC time, a second of 60 is a leap second; required takes the
+ * fraction, optional also an empty field (midnight) or hhmmss
+ */
+template <int K, auto Hour, auto Min, auto Sec, auto Millisec, rmc_parse_error Error,
+		presence Presence, unsigned int Mask = 0>
+struct utc
+{
+	static constexpr unsigned int mask = Mask;
+
+	template <class Data>
+	static step decode(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		const char *p = f.template begin<K>(), *end = f.template end<K>();
+
+		if constexpr (Presence != presence::required) {
+			if (p == end) {
+				data.*Hour = data.*Min = data.*Sec = 0;
+				data.*Millisec = 0;
+				return step::next;
+			}
+			if (end - p < 6 || !detail::two_digits(p, data.*Hour) || !detail::two_digits(p + 2, data.*Min) ||
+					!detail::two_digits(p + 4, data.*Sec) || data.*Hour >= 24 || data.*Min >= 60 || data.*Sec > 60) {
+				return f.fail(error, Error, p);
+			}
+			if (end - p == 6) {
+				data.*Millisec = 0;
+				return step::next;
+			}
+		} else {
+			if (end - p < 7 || !detail::two_digits(p, data.*Hour) || !detail::two_digits(p + 2, data.*Min) ||
+					!detail::two_digits(p + 4, data.*Sec) || data.*Hour >= 24 || data.*Min >= 60 || data.*Sec > 60) {
+				return f.fail(error, Error, p);
+			}
+		}
+		return p[6] == '.' && detail::millisec(p + 7, end, data.*Millisec) ? step::next : f.fail(error, Error, p);
+	}
+};
+
+/**
+ * ddmmyy date with a valid month and a day of that month
+ */
+template <int K, auto Day, auto Month, auto Year, rmc_parse_error Error, unsigned int Mask = 0>
+struct date
+{
+	static constexpr unsigned int mask = Mask;
+
+	template <class Data>
+	static step decode(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		const char *p = f.template begin<K>();
+
+		if (f.template end<K>() - p < 6 || !detail::two_digits(p, data.*Day) || !detail::two_digits(p + 2, data.*Month) ||
+				!detail::two_digits(p + 4, data.*Year) || data.*Month < 1 || data.*Month > 12 || data.*Day < 1 ||
+				data.*Day > detail::days_in_month(data.*Year, data.*Month)) {
+			return f.fail(error, Error, p);
+		}
+		return step::next;
+	}
+};
+
+/**
+ * Status letter read as it is: Void ends with no fix, anything but Valid fails
+ */
+template <int K, auto Member, char Valid, char Void, rmc_parse_error Error>
+struct status
+{
+	static constexpr unsigned int mask = 0;
+
+	template <class Data>
+	static step decode(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		data.*Member = *f.template begin<K>();
+		if (data.*Member == Void) {
+			return step::no_fix;
+		}
+		return data.*Member == Valid ? step::next : f.fail(error, Error, f.template begin<K>());
+	}
+};
+
+/**
+ * Ends with no fix when a member decoded before holds Value
+ */
+template <auto Member, auto Value>
+struct no_fix_if
+{
+	static constexpr unsigned int mask = 0;
+
+	template <class Data>
+	static step decode(Data &data, const frame &, rmc_error_detail_t &)
+	{
+		return data.*Member == Value ? step::no_fix : step::next;
+	}
+};
+
+/**
+ * dddmm.mmmm position field up to MaxDegrees, to degrees and to units of
+ * 10^-Scale degree; the hemisphere follows as a field of its own
+ */
+template <int K, int MaxDegrees, auto Value, auto Scaled, rmc_parse_error Error, int Scale = 7, unsigned int Mask = 0>
+struct degrees
+{
+	static constexpr unsigned int mask = Mask;
+
+	template <class Data>
+	static step decode(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		return detail::degrees<Scale>(f.template begin<K>(), f.template end<K>(), MaxDegrees, data.*Value, data.*Scaled) ?
+				step::next : f.fail(error, Error, f.template begin<K>());
+	}
+};
+
+/**
+ * Hemisphere letter of a value decoded before, Negative turns it around;
+ * Scaled may be nullptr, optional leaves the value as it is when empty
+ */
+template <int K, char Positive, char Negative, auto Value, auto Scaled, rmc_parse_error Error, unsigned int Mask = 0,
+		presence Presence = presence::required>
+struct hemisphere
+{
+	static constexpr unsigned int mask = Mask;
+
+	template <class Data>
+	static step decode(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		const char *p = f.template begin<K>();
+
+		if constexpr (Presence != presence::required) {
+			if (f.template end<K>() == p) {
+				return step::next;
+			}
+		}
+		if (f.template end<K>() != p + 1) {
+			return f.fail(error, Error, p);
+		}
+		if (*p == Negative) {
+			data.*Value = -(data.*Value);
+			if constexpr (!std::is_same_v<decltype(Scaled), std::nullptr_t>) {
+				data.*Scaled = -(data.*Scaled);
+			}
+			return step::next;
+		}
+		return *p == Positive ? step::next : f.fail(error, Error, p);
+	}
+};
+
+/**
+ * Position field K and its hemisphere field K + 1, checked before the
+ * position is decoded; both fail at field K
+ */
+template <int K, int MaxDegrees, char Positive, char Negative, auto Value, auto Scaled, rmc_parse_error Error,
+		int Scale = 7>
+struct coordinate
+{
+	static constexpr unsigned int mask = 0;
+
+	template <class Data>
+	static step decode(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		const char *dir = f.template begin<K + 1>();
+
+		if (f.template end<K + 1>() != dir + 1 || (*dir != Positive && *dir != Negative) ||
+				!detail::degrees<Scale>(f.template begin<K>(), f.template end<K>(), MaxDegrees, data.*Value,
+						data.*Scaled)) {
+			return f.fail(error, Error, f.template begin<K>());
+		}
+		if (*dir == Negative) {
+			data.*Value = -(data.*Value);
+			data.*Scaled = -(data.*Scaled);
+		}
+		return step::next;
+	}
+};
+
+/**
+ * Decimal number, unsigned unless Signed; an empty field is 0
+ */
+template <int K, auto Member, rmc_parse_error Error, bool Signed = false, unsigned int Mask = 0>
+struct number
+{
+	static constexpr unsigned int mask = Mask;
+
+	template <class Data>
+	static step decode(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		const char *p = f.template begin<K>(), *end = f.template end<K>();
+		bool ok;
+
+		if constexpr (Signed) {
+			ok = detail::signed_number(p, end, data.*Member);
+		} else {
+			ok = detail::number(p, end, data.*Member);
+		}
+		return ok ? step::next : f.fail(error, Error, p);
+	}
+};
+
+/**
+ * Unsigned number followed by a field holding its unit letter, or empty;
+ * both fail at field K
+ */
+template <int K, auto Member, char Unit, rmc_parse_error Error>
+struct measure
+{
+	static constexpr unsigned int mask = 0;
+
+	template <class Data>
+	static step decode(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		char unit;
+
+		return detail::number(f.template begin<K>(), f.template end<K>(), data.*Member) &&
+				detail::character<Unit>(f.template begin<K + 1>(), f.template end<K + 1>(), unit) ?
+				step::next : f.fail(error, Error, f.template begin<K>());
+	}
+};
+
+/**
+ * Integer from Min to Max, an empty field is -1
+ */
+template <int K, auto Member, int Min, int Max, rmc_parse_error Error>
+struct integer
+{
+	static constexpr unsigned int mask = 0;
+
+	template <class Data>
+	static step decode(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		int value;
+
+		if (!detail::integer(f.template begin<K>(), f.template end<K>(), Max, value) || value < Min) {
+			return f.fail(error, Error, f.template begin<K>());
+		}
+		data.*Member = value;
+		return step::next;
+	}
+};
+
+/**
+ * Single letter among Allowed, e.g. a unit or mode; Member may be nullptr to
+ * only check it
+ */
+template <int K, auto Member, presence Presence, rmc_parse_error Error, char... Allowed>
+struct character
+{
+	static constexpr unsigned int mask = 0;
+
+	template <class Data>
+	static step decode(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		char scratch;
+		char &value = detail::member_or<Member>(data, scratch);
+
+		if constexpr (Presence == presence::trailing) {
+			value = 0;
+			if (f.n < K) {
+				return step::next;
+			}
+		}
+		if (!detail::character<Allowed...>(f.template begin<K>(), f.template end<K>(), value) ||
+				(Presence == presence::required && !value)) {
+			return f.fail(error, Error, f.template begin<K>());
+		}
+		return step::next;
+	}
+};
+
+/**
+ * UTC epoch milliseconds of a date and time decoded before
+ */
+template <auto EpochMs, auto Year, auto Month, auto Day, auto Hour, auto Min, auto Sec, auto Millisec,
+		unsigned int Mask = 0>
+struct epoch
+{
+	static constexpr unsigned int mask = Mask;
+
+	template <class Data>
+	static step decode(Data &data, const frame &, rmc_error_detail_t &)
+	{
+		data.*EpochMs = ((detail::epoch_days(data.*Year, data.*Month, data.*Day) * 24 + data.*Hour) * 60 +
+				data.*Min) * 60000 + data.*Sec * 1000 + data.*Millisec;
+		return step::next;
+	}
+};
+
+/*******************************************************************************
+*                          Sentence Schemas
+*******************************************************************************/
+
+/**
+ * Decoder of a sentence type: its fields, decoded in the order listed. A
+ * field runs when the field mask holds all bits of its mask, so a mask of 0
+ * always runs.
+ */
+template <char A, char B, char C, class Data, class... Fields>
+struct sentence
+{
+	using data_type = Data;
+	static constexpr char code[4] = { A, B, C, 0 };	/**< Sentence type after the talker ID. */
+
+	template <unsigned int FieldMask>
+	static rmc_parse_result decode_fields(Data &data, const frame &f, rmc_error_detail_t &error)
+	{
+		step result = step::next;
+
+		// unrolled at compile time, stops at the first field that does not go on
+		(void)(run<Fields, FieldMask>(data, f, error, result) && ...);
+		switch (result) {
+			case step::next: return RMC_PARSE_SUCCESSFUL_WITH_FIX;
+			case step::no_fix: return RMC_PARSE_SUCCESSFUL_WITH_NO_FIX;
+			default: return RMC_PARSE_FAILED;
+		}
+	}
+
+private:
+	template <class Field, unsigned int FieldMask>
+	static bool run(Data &data, const frame &f, rmc_error_detail_t &error, step &result)
+	{
+		if constexpr ((FieldMask & Field::mask) == Field::mask) {
+			result = Field::decode(data, f, error);
+			return result == step::next;
+		} else {
+			return true;
+		}
+	}
+};
+
+namespace rmc_field {
+enum : int { time = 1, status, lat, lat_dir, lon, lon_dir, speed, heading, date, mag_var, mag_dir, mode, nav_status };
+}
+
+namespace gga_field {
+enum : int { time = 1, lat, lat_dir, lon, lon_dir, quality, satellites, hdop, altitude, altitude_unit, geoid,
+		geoid_unit, dgps_age, dgps_station };
+}
+
+namespace vtg_field {
+enum : int { track_true = 1, track_true_unit, track_magnetic, track_magnetic_unit, speed_knots, speed_knots_unit,
+		speed_kmh, speed_kmh_unit, mode };
+}
+
+namespace gll_field {
+enum : int { lat = 1, lat_dir, lon, lon_dir, time, status, mode };
+}
+
+/**
+ * RMC, with or without the mode of NMEA 2.3 and the navigational status of
+ * NMEA 4.10: the field mask selects the fields, the status, mode and
+ * navigational status are always decoded and the field count always
+ * checked; an empty magnetic variation is 0, mode N is no fix
+ */
+using rmc_schema = sentence<'R', 'M', 'C', nmea_rmc_data_t,
+	present<rmc_field::time, RMC_ERROR_TIME, RMC_FIELD_MASK_TIME>,
+	utc<rmc_field::time, &nmea_rmc_data_t::hour, &nmea_rmc_data_t::min, &nmea_rmc_data_t::sec,
+			&nmea_rmc_data_t::millisec, RMC_ERROR_TIME, presence::required, RMC_FIELD_MASK_TIME>,
+	present<rmc_field::status, RMC_ERROR_STATUS>,
+	status<rmc_field::status, &nmea_rmc_data_t::status, 'A', 'V', RMC_ERROR_STATUS>,
+	present<rmc_field::lat_dir, RMC_ERROR_LATITUDE, RMC_FIELD_MASK_LATITUDE>,
+	degrees<rmc_field::lat, 90, &nmea_rmc_data_t::latitude, &nmea_rmc_data_t::latitude_e7, RMC_ERROR_LATITUDE, 7,
+			RMC_FIELD_MASK_LATITUDE>,
+	hemisphere<rmc_field::lat_dir, 'N', 'S', &nmea_rmc_data_t::latitude, &nmea_rmc_data_t::latitude_e7,
+			RMC_ERROR_LATITUDE, RMC_FIELD_MASK_LATITUDE>,
+	present<rmc_field::lon_dir, RMC_ERROR_LONGITUDE, RMC_FIELD_MASK_LONGITUDE>,
+	degrees<rmc_field::lon, 180, &nmea_rmc_data_t::longitude, &nmea_rmc_data_t::longitude_e7, RMC_ERROR_LONGITUDE, 7,
+			RMC_FIELD_MASK_LONGITUDE>,
+	hemisphere<rmc_field::lon_dir, 'E', 'W', &nmea_rmc_data_t::longitude, &nmea_rmc_data_t::longitude_e7,
+			RMC_ERROR_LONGITUDE, RMC_FIELD_MASK_LONGITUDE>,
+	present<rmc_field::speed, RMC_ERROR_SPEED, RMC_FIELD_MASK_SPEED>,
+	number<rmc_field::speed, &nmea_rmc_data_t::ground_speed, RMC_ERROR_SPEED, false, RMC_FIELD_MASK_SPEED>,
+	present<rmc_field::heading, RMC_ERROR_HEADING, RMC_FIELD_MASK_HEADING>,
+	number<rmc_field::heading, &nmea_rmc_data_t::heading, RMC_ERROR_HEADING, false, RMC_FIELD_MASK_HEADING>,
+	present<rmc_field::date, RMC_ERROR_DATE, RMC_FIELD_MASK_DATE>,
+	date<rmc_field::date, &nmea_rmc_data_t::day, &nmea_rmc_data_t::month, &nmea_rmc_data_t::year, RMC_ERROR_DATE,
+			RMC_FIELD_MASK_DATE>,
+	count<rmc_field::mag_dir, rmc_field::nav_status, RMC_ERROR_MAGNETIC_VAR>,
+	number<rmc_field::mag_var, &nmea_rmc_data_t::magnetic_var, RMC_ERROR_MAGNETIC_VAR, false,
+			RMC_FIELD_MASK_MAGNETIC_VAR>,
+	hemisphere<rmc_field::mag_dir, 'E', 'W', &nmea_rmc_data_t::magnetic_var, nullptr, RMC_ERROR_MAGNETIC_VAR,
+			RMC_FIELD_MASK_MAGNETIC_VAR, presence::optional>,
+	character<rmc_field::mode, &nmea_rmc_data_t::mode, presence::trailing, RMC_ERROR_STATUS,
+			'A', 'D', 'E', 'F', 'M', 'N', 'P', 'R', 'S'>,
+	character<rmc_field::nav_status, &nmea_rmc_data_t::nav_status, presence::trailing, RMC_ERROR_STATUS,
+			'S', 'C', 'U', 'V'>,
+	epoch<&nmea_rmc_data_t::epoch_ms, &nmea_rmc_data_t::year, &nmea_rmc_data_t::month, &nmea_rmc_data_t::day,
+			&nmea_rmc_data_t::hour, &nmea_rmc_data_t::min, &nmea_rmc_data_t::sec, &nmea_rmc_data_t::millisec,
+			RMC_FIELD_MASK_TIMESTAMP>,
+	no_fix_if<&nmea_rmc_data_t::mode, 'N'>
+>;
+
+/**
+ * GGA: the position and the fields after it only with a fix
+ */
+using gga_schema = sentence<'G', 'G', 'A', nmea_gga_data_t,
+	count<gga_field::dgps_station, gga_field::dgps_station, RMC_ERROR_FIELD>,
+	utc<gga_field::time, &nmea_gga_data_t::hour, &nmea_gga_data_t::min, &nmea_gga_data_t::sec,
+			&nmea_gga_data_t::millisec, RMC_ERROR_TIME, presence::optional>,
+	integer<gga_field::quality, &nmea_gga_data_t::quality, 0, 9, RMC_ERROR_STATUS>,
+	no_fix_if<&nmea_gga_data_t::quality, 0>,
+	coordinate<gga_field::lat, 90, 'N', 'S', &nmea_gga_data_t::latitude, &nmea_gga_data_t::latitude_e7,
+			RMC_ERROR_LATITUDE>,
+	coordinate<gga_field::lon, 180, 'E', 'W', &nmea_gga_data_t::longitude, &nmea_gga_data_t::longitude_e7,
+			RMC_ERROR_LONGITUDE>,
+	integer<gga_field::satellites, &nmea_gga_data_t::satellites, -1, 99, RMC_ERROR_FIELD>,
+	number<gga_field::hdop, &nmea_gga_data_t::hdop, RMC_ERROR_FIELD>,
+	number<gga_field::altitude, &nmea_gga_data_t::altitude, RMC_ERROR_FIELD, true>,
+	character<gga_field::altitude_unit, nullptr, presence::optional, RMC_ERROR_FIELD, 'M'>,
+	number<gga_field::geoid, &nmea_gga_data_t::geoid_separation, RMC_ERROR_FIELD, true>,
+	character<gga_field::geoid_unit, nullptr, presence::optional, RMC_ERROR_FIELD, 'M'>
+>;
+
+/**
+ * VTG, with or without the mode of NMEA 2.3; mode N is no fix
+ */
+using vtg_schema = sentence<'V', 'T', 'G', nmea_vtg_data_t,
+	count<vtg_field::speed_kmh_unit, vtg_field::mode, RMC_ERROR_FIELD>,
+	measure<vtg_field::track_true, &nmea_vtg_data_t::track_true, 'T', RMC_ERROR_HEADING>,
+	measure<vtg_field::track_magnetic, &nmea_vtg_data_t::track_magnetic, 'M', RMC_ERROR_HEADING>,
+	measure<vtg_field::speed_knots, &nmea_vtg_data_t::speed_knots, 'N', RMC_ERROR_SPEED>,
+	measure<vtg_field::speed_kmh, &nmea_vtg_data_t::speed_kmh, 'K', RMC_ERROR_SPEED>,
+	character<vtg_field::mode, &nmea_vtg_data_t::mode, presence::trailing, RMC_ERROR_STATUS,
+			'A', 'D', 'E', 'F', 'M', 'N', 'P', 'R', 'S'>,
+	no_fix_if<&nmea_vtg_data_t::mode, 'N'>
+>;
+
+/**
+ * GLL, with or without the mode of NMEA 2.3; the position only with status A
+ */
+using gll_schema = sentence<'G', 'L', 'L', nmea_gll_data_t,
+	count<gll_field::status, gll_field::mode, RMC_ERROR_FIELD>,
+	utc<gll_field::time, &nmea_gll_data_t::hour, &nmea_gll_data_t::min, &nmea_gll_data_t::sec,
+			&nmea_gll_data_t::millisec, RMC_ERROR_TIME, presence::optional>,
+	character<gll_field::status, &nmea_gll_data_t::status, presence::required, RMC_ERROR_STATUS, 'A', 'V'>,
+	character<gll_field::mode, &nmea_gll_data_t::mode, presence::trailing, RMC_ERROR_STATUS,
+			'A', 'D', 'E', 'F', 'M', 'N', 'P', 'R', 'S'>,
+	no_fix_if<&nmea_gll_data_t::status, 'V'>,
+	coordinate<gll_field::lat, 90, 'N', 'S', &nmea_gll_data_t::latitude, &nmea_gll_data_t::latitude_e7,
+			RMC_ERROR_LATITUDE>,
+	coordinate<gll_field::lon, 180, 'E', 'W', &nmea_gll_data_t::longitude, &nmea_gll_data_t::longitude_e7,
+			RMC_ERROR_LONGITUDE>
+>;
+
+/*******************************************************************************
+*                          Decode Functions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Parse a sentence of the type of a schema and of any known talker, as
+* parse_rmc_fields() does for RMC and parse_nmea() for the others
+* @param  data: Decoded fields
+* @param  buf: Pointer to the '$' starting the sentence, need not be
+*         NUL-terminated
+* @param  len: Number of bytes of the sentence, a trailing line ending is ignored
+* @param  error: Always written: the failed check and its position,
+*         RMC_ERROR_NONE unless failed
+* @return Result of parsing operation; RMC_ERROR_HEADER for another type
+********************************************************************************/
+template <class Schema, unsigned int FieldMask = RMC_FIELD_MASK_ALL>
+inline rmc_parse_result decode(typename Schema::data_type &data, const char *buf, size_t len, rmc_error_detail_t &error)
+{
+	frame f;
+
+	while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r')) {
+		len--;
+	}
+	error.field = RMC_ERROR_NONE;
+	error.offset = 0;
+
+	if (!detail::address_is(buf, buf + len, Schema::code)) {
+		error.field = RMC_ERROR_HEADER;
+		return RMC_PARSE_FAILED;
+	}
+	if (!detail::frame_sentence(f, buf, buf + len, error)) {
+		return RMC_PARSE_FAILED;
+	}
+	return Schema::template decode_fields<FieldMask>(data, f, error);
+}
+
+} // namespace nmea
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
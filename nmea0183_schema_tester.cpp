@@ -0,0 +1,267 @@
+/** @file
+ *  Provides the equivalence test of the schema-generated decoders of
+ *  nmea0183_schema.hpp, run by the tester: every sentence, every variant of
+ *  it with one byte changed or taken out, and generated fleet traffic must
+ *  decode to the result, error detail and data of the C parser.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <cstdio>
+#include <cstring>
+
+#include "nmea0183_parser.h"
+#include "nmea0183_generator.h"
+#include "nmea0183_schema.hpp"
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+extern "C" int test_schema_decoders(const char *const *sentences, size_t count);
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define SCHEMA_FILL					0x5a		// data before a decode, so that members left alone compare equal
+#define SCHEMA_MAX_SENTENCE			128
+#define SCHEMA_CORPUS_SENTENCES		20000
+
+/**
+ * Sentences compared by sentence type, to tell that the test reached them
+ */
+struct schema_counts_t
+{
+	size_t compared[NMEA_SENTENCE_CODE_INVALID];
+	size_t failed;								// of them, failed by both
+};
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+template <unsigned int Fields>
+static bool same_rmc(const char *buf, size_t len);
+template <class Schema, nmea_sentence_type Type>
+static bool same_sentence(const char *buf, size_t len, schema_counts_t &counts);
+static bool same_decode(const char *buf, size_t len, schema_counts_t &counts);
+static bool same_variants(const char *sentence, schema_counts_t &counts);
+static bool same_corpus(unsigned int pct_corrupt, uint64_t seed, schema_counts_t &counts);
+static void set_checksum(char *buf, size_t len);
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Decode sentences with the schema decoders and the C parser, then with one
+* byte of each changed or taken out and the checksum fixed up, so that every
+* field check fails somewhere, then generated traffic of every supported type
+* @param  sentences: Sentences to start from, NUL-terminated
+* @param  count: Number of sentences
+* @return 1 if every decode matched, 0 otherwise
+********************************************************************************/
+int test_schema_decoders(const char *const *sentences, size_t count)
+{
+	schema_counts_t counts = {};
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (!same_variants(sentences[i], counts)) {
+			return 0;
+		}
+	}
+	if (!same_corpus(5, 23, counts) || !same_corpus(60, 24, counts)) {
+		return 0;
+	}
+	if (!counts.compared[NMEA_SENTENCE_RMC] || !counts.compared[NMEA_SENTENCE_GGA] ||
+			!counts.compared[NMEA_SENTENCE_VTG] || !counts.compared[NMEA_SENTENCE_GLL] || !counts.failed) {
+		printf("sentence types not reached ");
+		return 0;
+	}
+	return 1;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Compare the RMC schema decoder of a field mask with parse_rmc_fields()
+********************************************************************************/
+template <unsigned int Fields>
+static bool same_rmc(const char *buf, size_t len)
+{
+	nmea_rmc_data_t expected, decoded;
+	rmc_error_detail_t expected_error, decoded_error;
+	rmc_parse_result expected_result, decoded_result;
+
+	memset(&expected, SCHEMA_FILL, sizeof(expected));
+	memset(&decoded, SCHEMA_FILL, sizeof(decoded));
+	expected_result = parse_rmc_fields(&expected, buf, len, Fields, &expected_error);
+	decoded_result = nmea::decode<nmea::rmc_schema, Fields>(decoded, buf, len, decoded_error);
+
+	return expected_result == decoded_result && expected_error.field == decoded_error.field &&
+			expected_error.offset == decoded_error.offset && !memcmp(&expected, &decoded, sizeof(expected));
+}
+
+/**
+********************************************************************************
+* Compare a schema decoder with parse_nmea(); sentences of another type must
+* fail as a header the schema does not take
+********************************************************************************/
+template <class Schema, nmea_sentence_type Type>
+static bool same_sentence(const char *buf, size_t len, schema_counts_t &counts)
+{
+	nmea_0183_data_t expected;
+	typename Schema::data_type decoded;
+	const void *expected_data;
+	rmc_error_detail_t expected_error, decoded_error;
+	rmc_parse_result expected_result, decoded_result;
+
+	memset(&expected, SCHEMA_FILL, sizeof(expected));
+	memset(&decoded, SCHEMA_FILL, sizeof(decoded));
+	expected_result = parse_nmea(&expected, buf, len, &expected_error);
+	decoded_result = nmea::decode<Schema>(decoded, buf, len, decoded_error);
+
+	if (expected.type != Type) {
+		return decoded_result == RMC_PARSE_FAILED && decoded_error.field == RMC_ERROR_HEADER && !decoded_error.offset;
+	}
+	if constexpr (Type == NMEA_SENTENCE_RMC) {
+		expected_data = &expected.rmcData;
+	} else if constexpr (Type == NMEA_SENTENCE_GGA) {
+		expected_data = &expected.ggaData;
+	} else if constexpr (Type == NMEA_SENTENCE_VTG) {
+		expected_data = &expected.vtgData;
+	} else {
+		expected_data = &expected.gllData;
+	}
+	counts.compared[Type]++;
+	counts.failed += expected_result == RMC_PARSE_FAILED;
+
+	return expected_result == decoded_result && expected_error.field == decoded_error.field &&
+			expected_error.offset == decoded_error.offset && !memcmp(expected_data, &decoded, sizeof(decoded));
+}
+
+/**
+********************************************************************************
+* Compare every schema decoder on a sentence, RMC also with field masks
+********************************************************************************/
+static bool same_decode(const char *buf, size_t len, schema_counts_t &counts)
+{
+	if (same_rmc<RMC_FIELD_MASK_ALL>(buf, len) && same_rmc<RMC_FIELD_MASK_POSITION>(buf, len) &&
+			same_rmc<RMC_FIELD_MASK_TIMESTAMP>(buf, len) &&
+			same_rmc<RMC_FIELD_MASK_SPEED | RMC_FIELD_MASK_MAGNETIC_VAR>(buf, len) &&
+			same_sentence<nmea::rmc_schema, NMEA_SENTENCE_RMC>(buf, len, counts) &&
+			same_sentence<nmea::gga_schema, NMEA_SENTENCE_GGA>(buf, len, counts) &&
+			same_sentence<nmea::vtg_schema, NMEA_SENTENCE_VTG>(buf, len, counts) &&
+			same_sentence<nmea::gll_schema, NMEA_SENTENCE_GLL>(buf, len, counts)) {
+		return true;
+	}
+	printf("schema decode differs on %.*s ", (int)len, buf);
+	return false;
+}
+
+/**
+********************************************************************************
+* Compare a sentence, its prefixes, and its variants with one byte of the
+* body changed to a field delimiter, digit or letter, or taken out
+********************************************************************************/
+static bool same_variants(const char *sentence, schema_counts_t &counts)
+{
+	static const char replacements[] = ",.-09AVNSEWMTK*x";
+	char buf[SCHEMA_MAX_SENTENCE];
+	size_t len = strlen(sentence), i, k;
+	const char *star = strrchr(sentence, '*');
+
+	if (len >= sizeof(buf)) {
+		return false;
+	}
+	for (i = 0; i <= len; i++) {
+		if (!same_decode(sentence, i, counts)) {
+			return false;
+		}
+	}
+	if (!star || sentence[0] != '$') {
+		return true;
+	}
+	for (i = 1; sentence + i < star; i++) {
+		for (k = 0; k < sizeof(replacements) - 1; k++) {
+			memcpy(buf, sentence, len);
+			buf[i] = replacements[k];
+			set_checksum(buf, len);
+			if (!same_decode(buf, len, counts)) {
+				return false;
+			}
+		}
+		memcpy(buf, sentence, i);
+		memcpy(buf + i, sentence + i + 1, len - i - 1);
+		set_checksum(buf, len - 1);
+		if (!same_decode(buf, len - 1, counts)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+********************************************************************************
+* Compare generated fleet traffic, RMC and GGA/VTG/GLL, with and without fix
+********************************************************************************/
+static bool same_corpus(unsigned int pct_corrupt, uint64_t seed, schema_counts_t &counts)
+{
+	static char buf[SCHEMA_CORPUS_SENTENCES * NMEA_GENERATOR_MAX_SENTENCE];
+	nmea_generator_t gen;
+	size_t len, begin, i;
+	bool ok = true;
+
+	if (nmea_generator_init(&gen, 20, 1372809500000LL, seed)) {
+		printf("generator not allocated ");
+		return false;
+	}
+	nmea_generator_set_rates(&gen, 10, pct_corrupt, 50);
+	len = nmea_generator_fill(&gen, buf, sizeof(buf), SCHEMA_CORPUS_SENTENCES);
+	nmea_generator_destroy(&gen);
+
+	for (i = begin = 0; i < len && ok; i++) {
+		if (buf[i] == '\n') {
+			ok = same_decode(buf + begin, i + 1 - begin, counts);
+			begin = i + 1;
+		}
+	}
+	return ok;
+}
+
+/**
+********************************************************************************
+* Write the checksum of the body of a sentence after its '*'
+* @param  buf: Sentence, '$' first and the two checksum digits last
+* @param  len: Number of bytes of the sentence
+********************************************************************************/
+static void set_checksum(char *buf, size_t len)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	unsigned char checksum = 0;
+	size_t i;
+
+	for (i = 1; i + 3 < len; i++) {
+		checksum ^= (unsigned char)buf[i];
+	}
+	buf[len - 2] = hex[checksum >> 4];
+	buf[len - 1] = hex[checksum & 15];
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
@@ -0,0 +1,458 @@
+/** @file
+ *  Provides implementation for the ingest server.
+ *
+ *  A single thread waits on an epoll set holding the listening socket and
+ *  every receiver connection. Each ready connection gets one read of up to
+ *  NMEA_SERVER_READ_SIZE bytes into a buffer shared by the whole server, and
+ *  the bytes go straight thru the connection's resumable stream parser. Fixes
+ *  gather in a batch, also shared, handed to the callback when full and after
+ *  every read, so a batch never mixes two vehicles. Between two reads a
+ *  connection only keeps its nmea_connection_t, which makes idle connections
+ *  cheap: the kernel socket buffers are the bulk of their cost.
+ *
+ *  Reads are level-triggered and limited to one per connection per poll, so a
+ *  chatty receiver cannot starve the others. When the process runs out of
+ *  descriptors, the listening socket leaves the epoll set until a connection
+ *  closes; pending connections wait in the backlog meanwhile.
+ *
+ *  Connections get vehicles in the order they are accepted, so a receiver that
+ *  reconnects comes back as a new vehicle. A caller that knows the vehicle of a
+ *  stream adds it with nmea_server_add() and sets its vehicle.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#define _GNU_SOURCE				// accept4()
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "nmea0183_server.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define LISTEN_BACKLOG				4096
+
+/**
+ * Socket address of a UNIX-domain path or a loopback TCP port
+ */
+typedef union server_address_t
+{
+	struct sockaddr sa;
+	struct sockaddr_un un;
+	struct sockaddr_in in;
+} server_address_t;
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static socklen_t resolve_address(const char *address, server_address_t *addr);
+static void accept_connections(nmea_server_t *server);
+static int read_connection(nmea_server_t *server, nmea_connection_t *conn);
+static void close_connection(nmea_server_t *server, nmea_connection_t *conn);
+static void on_connection_sentence(const nmea_rmc_data_t *data, rmc_parse_result result, void *user_data);
+static void flush_batch(nmea_server_t *server);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Initialize a server with no connection
+* @param  server: Server to initialize
+* @param  fields: RMC_FIELD_MASK_* to decode from every connection
+* @param  callback: Called with the fixes of each connection
+* @param  user_data: Handed back to callback
+* @return 0 on success, -1 on failure with errno set
+********************************************************************************/
+int nmea_server_init(nmea_server_t *server, unsigned int fields, nmea_fix_batch_callback_t callback, void *user_data)
+{
+	memset(server, 0, sizeof(*server));
+	server->listen_fd = -1;
+	server->fields = fields;
+	server->callback = callback;
+	server->user_data = user_data;
+	server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	server->batch = malloc(NMEA_SERVER_BATCH_SIZE * sizeof(nmea_rmc_data_t));
+	server->read_buf = malloc(NMEA_SERVER_READ_SIZE);
+	if (server->epoll_fd < 0 || !server->batch || !server->read_buf) {
+		int saved = server->epoll_fd < 0 ? errno : ENOMEM;
+		nmea_server_destroy(server);
+		errno = saved;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+********************************************************************************
+* Accept receiver connections on an address
+* @param  server: Server to accept connections
+* @param  address: Path of a UNIX-domain socket if it has a '/', else a TCP
+*                  port on the loopback interface. A stale socket at the path
+*                  is replaced.
+* @return 0 on success, -1 on failure with errno set
+********************************************************************************/
+int nmea_server_listen(nmea_server_t *server, const char *address)
+{
+	server_address_t addr;
+	socklen_t addr_len = resolve_address(address, &addr);
+	struct epoll_event event;
+	struct stat st;
+	int one = 1;
+
+	if (!addr_len) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (addr.sa.sa_family == AF_UNIX && !stat(address, &st) && S_ISSOCK(st.st_mode)) {
+		unlink(address);
+	}
+
+	int fd = socket(addr.sa.sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	if (addr.sa.sa_family == AF_INET) {
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	}
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;				// the only event without a connection
+	if (bind(fd, &addr.sa, addr_len) || listen(fd, LISTEN_BACKLOG) ||
+			epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+		int saved = errno;
+		close(fd);
+		errno = saved;
+		return -1;
+	}
+	server->listen_fd = fd;
+	return 0;
+}
+
+/**
+********************************************************************************
+* Parse a connected stream, e.g. one end of a socketpair(), with the others.
+* The connection gets the next vehicle; the caller may set conn->vehicle
+* before the next poll instead.
+* @param  server: Server to parse the stream
+* @param  fd: Connected stream, the server closes it at end of stream
+* @return The connection, NULL on failure with errno set
+********************************************************************************/
+nmea_connection_t *nmea_server_add(nmea_server_t *server, int fd)
+{
+	struct epoll_event event;
+	nmea_connection_t *conn = malloc(sizeof(nmea_connection_t));
+
+	if (!conn) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	conn->server = server;
+	conn->fd = fd;
+	conn->vehicle = server->next_vehicle;
+	nmea_stream_init(&conn->stream, on_connection_sentence, conn);
+	nmea_stream_set_fields(&conn->stream, server->fields);
+	nmea_stream_set_diagnostics(&conn->stream, &server->errors, NULL, NULL);
+
+	event.events = EPOLLIN | EPOLLRDHUP;
+	event.data.ptr = conn;
+	if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+		free(conn);
+		return NULL;
+	}
+	conn->prev = NULL;
+	conn->next = server->connections;
+	if (conn->next) {
+		conn->next->prev = conn;
+	}
+	server->connections = conn;
+	server->next_vehicle++;
+	server->stats.accepted++;
+	server->stats.active++;
+	return conn;
+}
+
+/**
+********************************************************************************
+* Wait for ready connections and parse what arrived on them
+* @param  server: Server to poll
+* @param  timeout_ms: Longest wait, -1 to wait for an event
+* @return Number of events handled, 0 on timeout, -1 on failure with errno set
+********************************************************************************/
+int nmea_server_poll(nmea_server_t *server, int timeout_ms)
+{
+	struct epoll_event events[NMEA_SERVER_MAX_EVENTS];
+	int i, n = epoll_wait(server->epoll_fd, events, NMEA_SERVER_MAX_EVENTS, timeout_ms);
+
+	if (n < 0) {
+		return errno == EINTR ? 0 : -1;
+	}
+	for (i = 0; i < n; i++) {
+		nmea_connection_t *conn = events[i].data.ptr;
+
+		if (!conn) {
+			accept_connections(server);
+		} else if (read_connection(server, conn) <= 0) {
+			close_connection(server, conn);
+		}
+	}
+	return n;
+}
+
+/**
+********************************************************************************
+* Parse what is left of every connection, close them and free the server
+* @param  server: Server to destroy
+********************************************************************************/
+void nmea_server_destroy(nmea_server_t *server)
+{
+	while (server->connections) {
+		close_connection(server, server->connections);
+	}
+	if (server->epoll_fd >= 0) {
+		close(server->epoll_fd);
+		server->epoll_fd = -1;
+	}
+	if (server->listen_fd >= 0) {
+		close(server->listen_fd);
+		server->listen_fd = -1;
+	}
+	free(server->batch);
+	free(server->read_buf);
+	server->batch = NULL;
+	server->read_buf = NULL;
+}
+
+/**
+********************************************************************************
+* Connect to a server, for a receiver or a load generator
+* @param  address: Address given to nmea_server_listen()
+* @return The connected blocking socket, -1 on failure with errno set
+********************************************************************************/
+int nmea_server_connect(const char *address)
+{
+	server_address_t addr;
+	socklen_t addr_len = resolve_address(address, &addr);
+	int one = 1;
+
+	if (!addr_len) {
+		errno = EINVAL;
+		return -1;
+	}
+	int fd = socket(addr.sa.sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	if (addr.sa.sa_family == AF_INET) {
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+	if (connect(fd, &addr.sa, addr_len)) {
+		int saved = errno;
+		close(fd);
+		errno = saved;
+		return -1;
+	}
+	return fd;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Fill the socket address of a UNIX-domain path or loopback TCP port
+* @param  address: Path with a '/', else a port number
+* @param  addr: Address to fill
+* @return Length of addr, 0 if address is invalid
+********************************************************************************/
+static socklen_t resolve_address(const char *address, server_address_t *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+	if (strchr(address, '/')) {
+		if (strlen(address) >= sizeof(addr->un.sun_path)) {
+			return 0;
+		}
+		addr->un.sun_family = AF_UNIX;
+		strcpy(addr->un.sun_path, address);
+		return sizeof(addr->un);
+	}
+
+	char *end;
+	long port = strtol(address, &end, 10);
+	if (*address == '\0' || *end != '\0' || port <= 0 || port > 65535) {
+		return 0;
+	}
+	addr->in.sin_family = AF_INET;
+	addr->in.sin_port = htons((uint16_t)port);
+	addr->in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return sizeof(addr->in);
+}
+
+/**
+********************************************************************************
+* Take every pending connection off the listening socket
+* @param  server: Server listening
+********************************************************************************/
+static void accept_connections(nmea_server_t *server)
+{
+	for (;;) {
+		int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+		if (fd < 0) {
+			if (errno != EAGAIN && errno != EINTR) {
+				// EMFILE and the like: the socket stays readable, so stop
+				// polling it until a connection closes
+				struct epoll_event event;
+
+				event.events = 0;
+				event.data.ptr = NULL;
+				if (!epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, server->listen_fd, &event)) {
+					server->accept_paused = 1;
+				}
+			}
+			return;
+		}
+		if (!nmea_server_add(server, fd)) {
+			close(fd);
+		}
+	}
+}
+
+/**
+********************************************************************************
+* Parse the bytes waiting on a connection
+* @param  server: Server of the connection
+* @param  conn: Ready connection
+* @return Bytes read, 0 at end of stream, -1 on failure; 1 for no data yet
+********************************************************************************/
+static int read_connection(nmea_server_t *server, nmea_connection_t *conn)
+{
+	ssize_t len = read(conn->fd, server->read_buf, NMEA_SERVER_READ_SIZE);
+
+	if (len < 0) {
+		return errno == EAGAIN || errno == EINTR ? 1 : -1;
+	}
+	if (len > 0) {
+		server->stats.bytes += len;
+		server->current = conn;
+		nmea_stream_feed(&conn->stream, server->read_buf, (int)len);
+		flush_batch(server);
+	}
+	return (int)len;
+}
+
+/**
+********************************************************************************
+* Parse what is left of a connection and free it
+* @param  server: Server of the connection
+* @param  conn: Connection to close
+********************************************************************************/
+static void close_connection(nmea_server_t *server, nmea_connection_t *conn)
+{
+	// a last sentence may lack its line feed
+	server->current = conn;
+	nmea_stream_feed(&conn->stream, "\n", 1);
+	flush_batch(server);
+
+	if (conn->prev) {
+		conn->prev->next = conn->next;
+	} else {
+		server->connections = conn->next;
+	}
+	if (conn->next) {
+		conn->next->prev = conn->prev;
+	}
+	epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+	close(conn->fd);
+	free(conn);
+	server->stats.closed++;
+	server->stats.active--;
+
+	if (server->accept_paused) {
+		struct epoll_event event;
+
+		event.events = EPOLLIN;
+		event.data.ptr = NULL;
+		if (!epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, server->listen_fd, &event)) {
+			server->accept_paused = 0;
+		}
+	}
+}
+
+/**
+********************************************************************************
+* Stream parser callback adding a fix to the batch of the current connection
+* @param  data: Parsed sentence
+* @param  result: Parse result
+* @param  user_data: Connection of the stream
+********************************************************************************/
+static void on_connection_sentence(const nmea_rmc_data_t *data, rmc_parse_result result, void *user_data)
+{
+	nmea_connection_t *conn = (nmea_connection_t *)user_data;
+	nmea_server_t *server = conn->server;
+
+	server->stats.sentences++;
+	if (result != RMC_PARSE_SUCCESSFUL_WITH_FIX) {
+		return;
+	}
+	server->stats.fixes++;
+	server->batch[server->batch_count++] = *data;
+	if (server->batch_count == NMEA_SERVER_BATCH_SIZE) {
+		flush_batch(server);
+	}
+}
+
+/**
+********************************************************************************
+* Hand the batch of the current connection to the callback
+* @param  server: Server of the batch
+********************************************************************************/
+static void flush_batch(nmea_server_t *server)
+{
+	if (server->batch_count && server->callback) {
+		server->callback(server->current->vehicle, server->batch, server->batch_count, server->user_data);
+	}
+	server->batch_count = 0;
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
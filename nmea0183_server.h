@@ -0,0 +1,120 @@
+/** @file
+ *  Provides prototypes for the ingest server: one epoll loop parsing the NMEA
+ *  streams of many receiver connections into per-vehicle fix batches.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_SERVER_H__
+#define __NMEA0183_SERVER_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nmea0183_parser.h"
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_SERVER_READ_SIZE		(16 * 1024)		/**< Most bytes read from a connection per event. */
+#define NMEA_SERVER_BATCH_SIZE		256				/**< Most fixes handed to the callback at once. */
+#define NMEA_SERVER_MAX_EVENTS		256				/**< Ready connections taken per poll. */
+
+/**
+ * Callback receiving the fixes parsed from one connection, in arrival order
+ */
+typedef void (*nmea_fix_batch_callback_t)(uint32_t vehicle, const nmea_rmc_data_t *fixes, size_t count,
+		void *user_data);
+
+struct nmea_server_t;
+
+/**
+ * State kept for every connection between two reads; the read buffer and the
+ * fix batch are shared by all connections of a server
+ */
+typedef struct nmea_connection_t
+{
+	struct nmea_server_t *server;
+	struct nmea_connection_t *prev;				/**< Open connections of the server. */
+	struct nmea_connection_t *next;
+	int fd;
+	uint32_t vehicle;							/**< Handed to the callback, by default in order of connection. */
+	nmea_stream_t stream;						/**< Sentence straddling two reads. */
+} nmea_connection_t;
+
+/**
+ * Running totals of a server
+ */
+typedef struct nmea_server_stats_t
+{
+	size_t accepted;							/**< Connections opened. */
+	size_t closed;								/**< Connections closed. */
+	size_t active;								/**< Connections open now. */
+	uint64_t bytes;								/**< Bytes read. */
+	uint64_t sentences;							/**< Sentences found. */
+	uint64_t fixes;								/**< RMC_PARSE_SUCCESSFUL_WITH_FIX. */
+} nmea_server_stats_t;
+
+/**
+ * Ingest server
+ */
+typedef struct nmea_server_t
+{
+	int epoll_fd;
+	int listen_fd;								/**< -1 until nmea_server_listen(). */
+	unsigned int fields;						/**< RMC_FIELD_MASK_* to decode. */
+	nmea_fix_batch_callback_t callback;
+	void *user_data;
+	uint32_t next_vehicle;						/**< Vehicle of the next connection; a reconnection gets a new one. */
+	int accept_paused;							/**< 1 while out of descriptors, the listening socket is not polled. */
+	nmea_connection_t *connections;				/**< Open connections, newest first. */
+	nmea_connection_t *current;					/**< Connection being parsed. */
+	size_t batch_count;
+	nmea_rmc_data_t *batch;						/**< Fixes of current not yet handed over. */
+	char *read_buf;
+	nmea_server_stats_t stats;
+	nmea_error_counters_t errors;				/**< Failures of all connections. */
+} nmea_server_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_server_init(nmea_server_t *server, unsigned int fields, nmea_fix_batch_callback_t callback, void *user_data);
+int nmea_server_listen(nmea_server_t *server, const char *address);
+nmea_connection_t *nmea_server_add(nmea_server_t *server, int fd);
+int nmea_server_poll(nmea_server_t *server, int timeout_ms);
+void nmea_server_destroy(nmea_server_t *server);
+int nmea_server_connect(const char *address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
@@ -0,0 +1,307 @@
+/** @file
+ *  Provides implementation for the streaming trajectory simplification.
+ *
+ *  The fixes of a vehicle are reduced by the opening window method with a
+ *  cone of directions: from the last fix kept, the anchor, each fix further
+ *  than the tolerance allows the directions within asin(tolerance / distance)
+ *  of its own. While the direction of a new fix is allowed by every fix
+ *  dropped since the anchor, the segment to it passes within the tolerance
+ *  of all of them, so it replaces the candidate end of the segment. Once it
+ *  is not, the candidate is kept and becomes the anchor. A fix within the
+ *  tolerance of the anchor is near any segment from it, so a parked vehicle
+ *  keeps nothing; a fix nearer than the farthest one dropped could leave
+ *  that one beyond the end of the segment, so it ends the segment too. Since
+ *  the candidate is farther than the tolerance, this also ends it when the
+ *  vehicle turns back within the tolerance of the anchor, so that no fix is
+ *  dropped between the candidate and the next anchor.
+ *
+ *  Each vehicle holds the anchor, one arc and the candidate, so the memory
+ *  is fixed per vehicle and every fix costs a constant time. Distances come
+ *  from an equirectangular projection at the anchor, which is exact enough
+ *  over the few kilometers of a segment.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "nmea0183_simplify.h"
+#include "nmea0183_geodesic.h"
+#include "nmea0183_vehicle.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define METERS_PER_E7				(NMEA_GEO_EARTH_RADIUS * M_PI / 180.0 / 1e7)
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static size_t keep(nmea_simplify_t *simplify, nmea_simplify_vehicle_t *state, const nmea_rmc_data_t *fix,
+		nmea_rmc_data_t *kept);
+static double offset_from_anchor(const nmea_simplify_vehicle_t *state, const nmea_rmc_data_t *fix, double *direction);
+static double turn(double angle);
+static void intersect_arc(nmea_simplify_vehicle_t *state, double direction, double width);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Initialize the simplification of the tracks of many vehicles
+* @param  simplify: State to initialize
+* @param  tolerance_m: Most distance in meters from a dropped fix to the track
+*                      thru the fixes kept
+* @param  max_interval_ms: Most time between fixes kept, so that a parked
+*                          vehicle still reports, 0 for no limit
+* @param  max_vehicles: Most vehicles tracked
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+int nmea_simplify_init(nmea_simplify_t *simplify, double tolerance_m, int64_t max_interval_ms, size_t max_vehicles)
+{
+	size_t slots = nmea_vehicle_slots(max_vehicles);
+
+	memset(simplify, 0, sizeof(*simplify));
+	simplify->vehicles = calloc(slots, sizeof(nmea_simplify_vehicle_t));
+	if (!simplify->vehicles) {
+		return -1;
+	}
+	simplify->vehicle_mask = slots - 1;
+	simplify->tolerance_m = tolerance_m;
+	simplify->max_interval_ms = max_interval_ms;
+
+	return 0;
+}
+
+/**
+********************************************************************************
+* Free the simplification state
+* @param  simplify: State to destroy
+********************************************************************************/
+void nmea_simplify_destroy(nmea_simplify_t *simplify)
+{
+	free(simplify->vehicles);
+	simplify->vehicles = NULL;
+}
+
+/**
+********************************************************************************
+* Simplify the next fixes of a vehicle. Only fixes with status 'A' can be
+* kept. A fix is kept once a later one shows it is needed, so the last fix of
+* a vehicle comes out of nmea_simplify_flush().
+* @param  simplify: Simplification state
+* @param  vehicle: Vehicle of the fixes
+* @param  fixes: Fixes of the vehicle, in time order
+* @param  count: Number of fixes
+* @param  kept: Fixes kept, room for count + 1
+* @return Number of fixes kept
+********************************************************************************/
+size_t nmea_simplify(nmea_simplify_t *simplify, uint32_t vehicle, const nmea_rmc_data_t *fixes, size_t count,
+		nmea_rmc_data_t *kept)
+{
+	nmea_simplify_vehicle_t *state = nmea_vehicle_find(simplify->vehicles, sizeof(nmea_simplify_vehicle_t),
+			simplify->vehicle_mask, vehicle);
+	double tolerance = simplify->tolerance_m;
+	size_t n = 0, i;
+
+	simplify->stats.fixes_in += count;
+	if (!state) {
+		simplify->stats.dropped += count;
+		return 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		const nmea_rmc_data_t *fix = &fixes[i];
+		double direction, distance;
+		int candidate = 0;
+
+		if (fix->status != 'A') {
+			continue;
+		}
+		if (!state->anchored) {
+			n += keep(simplify, state, fix, &kept[n]);
+			continue;
+		}
+
+		distance = offset_from_anchor(state, fix, &direction);
+		if (state->pending && (distance < state->reach ||
+				(state->width >= 0 && turn(direction - state->direction) > state->width))) {
+			// off the segment of the fixes dropped, or back toward the anchor: the candidate ends it
+			n += keep(simplify, state, &state->candidate, &kept[n]);
+			distance = offset_from_anchor(state, fix, &direction);
+		}
+		if (distance > tolerance) {
+			double width = asin(tolerance / distance);
+
+			intersect_arc(state, direction - width, 2 * width);
+			state->reach = distance > state->reach ? distance : state->reach;
+			state->candidate = *fix;
+			state->pending = 1;
+			candidate = 1;
+		}
+
+		// a fix now and then, even when the track is a straight line
+		if (simplify->max_interval_ms > 0 && fix->epoch_ms - state->anchor_epoch_ms >= simplify->max_interval_ms) {
+			if (state->pending && !candidate) {
+				n += keep(simplify, state, &state->candidate, &kept[n]);
+			}
+			n += keep(simplify, state, fix, &kept[n]);
+		}
+	}
+	return n;
+}
+
+/**
+********************************************************************************
+* Keep the last fix of a vehicle, when its stream ends
+* @param  simplify: Simplification state
+* @param  vehicle: Vehicle of the fixes
+* @param  kept: Fix kept, room for one
+* @return Number of fixes kept, 0 or 1
+********************************************************************************/
+size_t nmea_simplify_flush(nmea_simplify_t *simplify, uint32_t vehicle, nmea_rmc_data_t *kept)
+{
+	nmea_simplify_vehicle_t *state = nmea_vehicle_find(simplify->vehicles, sizeof(nmea_simplify_vehicle_t),
+			simplify->vehicle_mask, vehicle);
+
+	if (!state || !state->pending) {
+		return 0;
+	}
+	return keep(simplify, state, &state->candidate, kept);
+}
+
+/**
+********************************************************************************
+* Compression ratio of the fixes
+* @param  simplify: Simplification state
+* @return Fixes taken per fix kept, 0 before any is kept
+********************************************************************************/
+double nmea_simplify_ratio(const nmea_simplify_t *simplify)
+{
+	return simplify->stats.fixes_out ? (double)simplify->stats.fixes_in / simplify->stats.fixes_out : 0;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Keep a fix, which becomes the anchor of the next segment
+* @param  simplify: Simplification state
+* @param  state: State of the vehicle
+* @param  fix: Fix to keep, may be the candidate
+* @param  kept: Where the fix goes
+* @return 1
+********************************************************************************/
+static size_t keep(nmea_simplify_t *simplify, nmea_simplify_vehicle_t *state, const nmea_rmc_data_t *fix,
+		nmea_rmc_data_t *kept)
+{
+	*kept = *fix;
+	state->anchored = 1;
+	state->pending = 0;
+	state->anchor_latitude_e7 = fix->latitude_e7;
+	state->anchor_longitude_e7 = fix->longitude_e7;
+	state->anchor_epoch_ms = fix->epoch_ms;
+	state->meters_per_e7_x = METERS_PER_E7 * cos(fix->latitude_e7 * (M_PI / 180.0 / 1e7));
+	state->width = -1;
+	state->reach = 0;
+	simplify->stats.fixes_out++;
+
+	return 1;
+}
+
+/**
+********************************************************************************
+* Distance and direction of a fix from the anchor
+* @param  state: State of the vehicle
+* @param  fix: Fix to place
+* @param  direction: Direction from the anchor, radians counterclockwise from east
+* @return Distance from the anchor in meters
+********************************************************************************/
+static double offset_from_anchor(const nmea_simplify_vehicle_t *state, const nmea_rmc_data_t *fix, double *direction)
+{
+	int64_t dx_e7 = (int64_t)fix->longitude_e7 - state->anchor_longitude_e7;
+	double dx, dy;
+
+	if (dx_e7 > 1800000000) dx_e7 -= 3600000000LL;
+	if (dx_e7 < -1800000000) dx_e7 += 3600000000LL;
+	dx = dx_e7 * state->meters_per_e7_x;
+	dy = ((int64_t)fix->latitude_e7 - state->anchor_latitude_e7) * METERS_PER_E7;
+	*direction = atan2(dy, dx);
+
+	return sqrt(dx * dx + dy * dy);
+}
+
+/**
+********************************************************************************
+* Angle turned counterclockwise, in [0, 2 pi)
+********************************************************************************/
+static double turn(double angle)
+{
+	angle = fmod(angle, 2 * M_PI);
+	return angle < 0 ? angle + 2 * M_PI : angle;
+}
+
+/**
+********************************************************************************
+* Narrow the arc of directions allowed by the fixes dropped. Both arcs are at
+* most a half turn wide, so the part they share is one arc, never empty here
+* since the direction of the new fix is in both.
+* @param  state: State of the vehicle
+* @param  direction: Start of the arc allowed by a new fix, radians
+* @param  width: Width of that arc, radians
+********************************************************************************/
+static void intersect_arc(nmea_simplify_vehicle_t *state, double direction, double width)
+{
+	double ahead;
+
+	if (state->width < 0) {
+		state->direction = turn(direction);
+		state->width = width;
+		return;
+	}
+	ahead = turn(direction - state->direction);
+	if (ahead <= state->width) {
+		// the new arc starts inside the old one
+		state->direction = turn(direction);
+		state->width = fmin(state->width - ahead, width);
+	} else {
+		// the old arc starts inside the new one
+		state->width = fmin(width - turn(state->direction - direction), state->width);
+	}
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
@@ -0,0 +1,104 @@
+/** @file
+ *  Provides prototypes for the streaming trajectory simplification: the
+ *  fixes of each vehicle reduced to those needed to redraw its track within
+ *  a distance tolerance.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_SIMPLIFY_H__
+#define __NMEA0183_SIMPLIFY_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nmea0183_parser.h"
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+
+/**
+ * Track state of a vehicle: the last fix kept (the anchor), the directions
+ * from it that pass within the tolerance of every fix dropped since, and the
+ * newest fix, kept once the next one leaves those directions.
+ */
+typedef struct nmea_simplify_vehicle_t
+{
+	uint32_t key;								/**< Vehicle + 1, 0 for a free slot, see nmea_vehicle_find(). */
+	uint16_t anchored;							/**< 1 once a fix is kept. */
+	uint16_t pending;							/**< 1 if candidate is not kept yet. */
+	int32_t anchor_latitude_e7;
+	int32_t anchor_longitude_e7;
+	int64_t anchor_epoch_ms;
+	double meters_per_e7_x;						/**< At the latitude of the anchor. */
+	double direction;							/**< Start of the arc of directions, radians. */
+	double width;								/**< Width of the arc, radians, negative for any direction. */
+	double reach;								/**< Farthest fix from the anchor since, meters. */
+	nmea_rmc_data_t candidate;
+} nmea_simplify_vehicle_t;
+
+/**
+ * Fixes taken and kept since initialization
+ */
+typedef struct nmea_simplify_stats_t
+{
+	uint64_t fixes_in;
+	uint64_t fixes_out;
+	uint64_t dropped;							/**< Fixes of vehicles beyond the capacity or NMEA_VEHICLE_MAX. */
+} nmea_simplify_stats_t;
+
+/**
+ * Simplification of the tracks of many vehicles, from one thread at a time
+ */
+typedef struct nmea_simplify_t
+{
+	double tolerance_m;
+	int64_t max_interval_ms;
+	nmea_simplify_vehicle_t *vehicles;			/**< Open-addressed by vehicle. */
+	size_t vehicle_mask;
+	nmea_simplify_stats_t stats;
+} nmea_simplify_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_simplify_init(nmea_simplify_t *simplify, double tolerance_m, int64_t max_interval_ms, size_t max_vehicles);
+void nmea_simplify_destroy(nmea_simplify_t *simplify);
+size_t nmea_simplify(nmea_simplify_t *simplify, uint32_t vehicle, const nmea_rmc_data_t *fixes, size_t count,
+		nmea_rmc_data_t *kept);
+size_t nmea_simplify_flush(nmea_simplify_t *simplify, uint32_t vehicle, nmea_rmc_data_t *kept);
+double nmea_simplify_ratio(const nmea_simplify_t *simplify);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
@@ -0,0 +1,751 @@
+/** @file
+ *  Provides implementation for the input sources of the parsers.
+ *
+ *  The first bytes read tell the format: gzip by its two byte magic, zstd by
+ *  the magic of a frame or of a skippable frame, anything else is taken as
+ *  plain text. Compressed bytes are read NMEA_SOURCE_READ_SIZE at a time and
+ *  inflated straight into the buffer of the caller; gzip members and zstd
+ *  frames that follow one another are read as one stream.
+ *
+ *  zstd frames are independent of each other, so with decoder threads every
+ *  frame read in full becomes a job decoded by the next idle thread, while
+ *  the reading thread hands out the output of the jobs in file order. A frame
+ *  larger than NMEA_SOURCE_MAX_FRAME, e.g. of a file compressed as a single
+ *  frame, sends the rest of the input to the reading thread instead.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef NMEA_ZLIB
+#include <zlib.h>
+#endif
+#ifdef NMEA_ZSTD
+#include <zstd.h>
+#endif
+
+#include "nmea0183_source.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#define MAGIC_SIZE					4
+#define GZIP_MAGIC					0x8b1f			// first two bytes, little-endian
+#define ZSTD_FRAME_MAGIC			0xFD2FB528
+#define ZSTD_SKIPPABLE_MAGIC		0x184D2A50
+#define ZSTD_SKIPPABLE_MASK			0xFFFFFFF0
+
+#ifdef NMEA_ZSTD
+
+/**
+ * State of a decode job
+ */
+typedef enum {
+	JOB_FREE = 0,
+	JOB_QUEUED,									// frame copied in, waiting for or on a decoder
+	JOB_DONE,									// output ready
+	JOB_FAILED
+} source_job_state;
+
+/**
+ * One zstd frame and its output
+ */
+typedef struct source_job_t
+{
+	unsigned char *in;
+	size_t in_len;
+	size_t in_cap;
+	char *out;
+	size_t out_pos;								// next byte to hand out
+	size_t out_len;
+	size_t out_cap;
+	source_job_state state;
+} source_job_t;
+
+/**
+ * Decoder threads and the ring of jobs they take in order. filled and read
+ * are only written by the reading thread, taken by the decoders, all three
+ * under lock.
+ */
+struct source_pool_t
+{
+	pthread_mutex_t lock;
+	pthread_cond_t queued;						// a job was queued, or the pool stops
+	pthread_cond_t decoded;						// a job was decoded
+	source_job_t *jobs;
+	size_t num_jobs;
+	size_t filled;								// jobs queued so far
+	size_t taken;								// jobs taken by a decoder so far
+	size_t read;								// jobs read out so far
+	int stop;
+	int sequential;								// a frame too large: the rest goes to the reading thread
+	pthread_t *threads;
+	int num_threads;
+};
+
+#endif
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static int fill_input(nmea_source_t *source);
+static ssize_t read_plain(nmea_source_t *source, char *buf, size_t len);
+#ifdef NMEA_ZLIB
+static ssize_t read_gzip(nmea_source_t *source, char *buf, size_t len);
+#endif
+#ifdef NMEA_ZSTD
+static ssize_t read_zstd(nmea_source_t *source, char *buf, size_t len);
+static ssize_t read_frames(nmea_source_t *source, char *buf, size_t len);
+static int queue_frames(nmea_source_t *source);
+static int pool_start(nmea_source_t *source, int num_threads);
+static void pool_stop(struct source_pool_t *pool);
+static void *decoder_main(void *arg);
+static int decode_frame(ZSTD_DCtx *dctx, source_job_t *job);
+static int reserve(void *buf, size_t *cap, size_t size);
+#endif
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+static const char *const format_names[NMEA_SOURCE_CODE_INVALID] = {
+	"plain", "gzip", "zstd"
+};
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Open a source on a file descriptor, telling its format by its first bytes
+* @param  source: Source to initialize
+* @param  fd: File descriptor to read until end of file, left open by the source
+* @param  num_threads: Threads decoding the frames of zstd input, 0 or 1 to
+*         decode them on the reading thread
+* @return 0 on success, -1 on a read error, out of memory, or a format not
+*         built in, as told by source->format
+********************************************************************************/
+int nmea_source_open(nmea_source_t *source, int fd, int num_threads)
+{
+	const unsigned char *magic;
+	uint32_t word = 0;
+
+	memset(source, 0, sizeof(*source));
+	source->fd = fd;
+	source->in_cap = NMEA_SOURCE_READ_SIZE;
+	source->in = malloc(source->in_cap);
+	if (!source->in) {
+		return -1;
+	}
+	while (source->in_len < MAGIC_SIZE && !source->eof) {
+		if (fill_input(source)) {
+			goto open_failed;
+		}
+	}
+
+	magic = source->in;
+	if (source->in_len >= MAGIC_SIZE) {
+		word = magic[0] | magic[1] << 8 | magic[2] << 16 | (uint32_t)magic[3] << 24;
+	}
+	if (source->in_len >= 2 && (word & 0xffff) == GZIP_MAGIC) {
+		source->format = NMEA_SOURCE_GZIP;
+	} else if (word == ZSTD_FRAME_MAGIC || (word & ZSTD_SKIPPABLE_MASK) == ZSTD_SKIPPABLE_MAGIC) {
+		source->format = NMEA_SOURCE_ZSTD;
+	}
+
+	switch (source->format) {
+	case NMEA_SOURCE_GZIP:
+#ifdef NMEA_ZLIB
+		{
+			z_stream *strm = calloc(1, sizeof(z_stream));
+
+			// gzip wrapper only, members are reset one after the other
+			if (!strm || inflateInit2(strm, 15 + 16) != Z_OK) {
+				free(strm);
+				goto open_failed;
+			}
+			source->stream = strm;
+		}
+		break;
+#else
+		goto open_failed;
+#endif
+	case NMEA_SOURCE_ZSTD:
+#ifdef NMEA_ZSTD
+		source->stream = ZSTD_createDCtx();
+		if (!source->stream || (num_threads > 1 && pool_start(source, num_threads))) {
+			goto open_failed;
+		}
+		break;
+#else
+		(void)num_threads;
+		goto open_failed;
+#endif
+	default:
+		break;
+	}
+
+	return 0;
+
+open_failed:
+	nmea_source_close(source);
+	return -1;
+}
+
+/**
+********************************************************************************
+* Read the next bytes of the source, decompressed
+* @param  source: Source to read
+* @param  buf: Buffer to fill
+* @param  len: Size of the buffer
+* @return Number of bytes read, 0 at the end of the source, -1 on a read error
+*         or on corrupted or truncated compressed data
+********************************************************************************/
+ssize_t nmea_source_read(nmea_source_t *source, char *buf, size_t len)
+{
+	ssize_t n = -1;
+
+	if (source->finished || len == 0) {
+		return 0;
+	}
+	switch (source->format) {
+	case NMEA_SOURCE_PLAIN:
+		n = read_plain(source, buf, len);
+		break;
+#ifdef NMEA_ZLIB
+	case NMEA_SOURCE_GZIP:
+		n = read_gzip(source, buf, len);
+		break;
+#endif
+#ifdef NMEA_ZSTD
+	case NMEA_SOURCE_ZSTD:
+		n = source->pool ? read_frames(source, buf, len) : read_zstd(source, buf, len);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	if (n > 0) {
+		source->bytes_out += n;
+	} else if (n == 0) {
+		source->finished = 1;
+	}
+	return n;
+}
+
+/**
+********************************************************************************
+* Stop the decoder threads and free the buffers of a source
+* @param  source: Source to close; its file descriptor is the caller's
+********************************************************************************/
+void nmea_source_close(nmea_source_t *source)
+{
+#ifdef NMEA_ZSTD
+	if (source->pool) {
+		pool_stop(source->pool);
+	}
+	if (source->format == NMEA_SOURCE_ZSTD && source->stream) {
+		ZSTD_freeDCtx(source->stream);
+	}
+#endif
+#ifdef NMEA_ZLIB
+	if (source->format == NMEA_SOURCE_GZIP && source->stream) {
+		inflateEnd(source->stream);
+		free(source->stream);
+	}
+#endif
+	free(source->in);
+	source->in = NULL;
+	source->stream = NULL;
+	source->pool = NULL;
+}
+
+/**
+********************************************************************************
+* Tell whether a format can be read by this build
+* @param  format: Format of a source
+* @return 1 if built in, 0 otherwise
+********************************************************************************/
+int nmea_source_supported(nmea_source_format format)
+{
+	switch (format) {
+	case NMEA_SOURCE_PLAIN:
+		return 1;
+#ifdef NMEA_ZLIB
+	case NMEA_SOURCE_GZIP:
+		return 1;
+#endif
+#ifdef NMEA_ZSTD
+	case NMEA_SOURCE_ZSTD:
+		return 1;
+#endif
+	default:
+		return 0;
+	}
+}
+
+/**
+********************************************************************************
+* Name of a format, for reports
+* @param  format: Format of a source
+* @return Lower case name, "invalid" when out of range
+********************************************************************************/
+const char *nmea_source_format_name(nmea_source_format format)
+{
+	if ((unsigned int)format >= NMEA_SOURCE_CODE_INVALID) {
+		return "invalid";
+	}
+	return format_names[format];
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Move the bytes not consumed yet to the start of the input buffer and read
+* more after them, with a single read
+* @param  source: Source to read
+* @return 0 on success, also at end of file, -1 on a read error
+********************************************************************************/
+static int fill_input(nmea_source_t *source)
+{
+	ssize_t n;
+
+	if (source->in_pos) {
+		memmove(source->in, source->in + source->in_pos, source->in_len - source->in_pos);
+		source->in_len -= source->in_pos;
+		source->in_pos = 0;
+	}
+	while (!source->eof && source->in_len < source->in_cap) {
+		n = read(source->fd, source->in + source->in_len, source->in_cap - source->in_len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			return -1;
+		}
+		source->eof = n == 0;
+		source->in_len += n;
+		source->bytes_in += n;
+		break;
+	}
+	return 0;
+}
+
+/**
+********************************************************************************
+* Hand out what was read ahead to tell the format, then read straight into
+* the buffer of the caller
+********************************************************************************/
+static ssize_t read_plain(nmea_source_t *source, char *buf, size_t len)
+{
+	ssize_t n;
+
+	if (source->in_pos < source->in_len) {
+		n = len < source->in_len - source->in_pos ? len : source->in_len - source->in_pos;
+		memcpy(buf, source->in + source->in_pos, n);
+		source->in_pos += n;
+		return n;
+	}
+	do {
+		n = read(source->fd, buf, len);
+	} while (n < 0 && errno == EINTR);
+	if (n > 0) {
+		source->bytes_in += n;
+	}
+	return n;
+}
+
+#ifdef NMEA_ZLIB
+
+/**
+********************************************************************************
+* Inflate gzip members into the buffer of the caller until it is full
+********************************************************************************/
+static ssize_t read_gzip(nmea_source_t *source, char *buf, size_t len)
+{
+	z_stream *strm = source->stream;
+	uInt size = len > UINT_MAX ? UINT_MAX : len;
+	int ret;
+
+	strm->next_out = (Bytef *)buf;
+	strm->avail_out = size;
+	while (strm->avail_out) {
+		if (source->in_pos == source->in_len) {
+			// out of input within a member
+			if (source->eof || fill_input(source)) {
+				return -1;
+			}
+			continue;
+		}
+		strm->next_in = source->in + source->in_pos;
+		strm->avail_in = source->in_len - source->in_pos;
+		ret = inflate(strm, Z_NO_FLUSH);
+		source->in_pos = source->in_len - strm->avail_in;
+		if (ret == Z_STREAM_END) {
+			// another member may follow
+			while (source->in_pos == source->in_len && !source->eof) {
+				if (fill_input(source)) {
+					return -1;
+				}
+			}
+			if (source->in_pos == source->in_len) {
+				source->finished = 1;
+				break;
+			}
+			inflateReset(strm);
+		} else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+			return -1;
+		}
+	}
+	return size - strm->avail_out;
+}
+
+#endif
+
+#ifdef NMEA_ZSTD
+
+/**
+********************************************************************************
+* Decode zstd frames on the reading thread into the buffer of the caller
+* until it is full
+********************************************************************************/
+static ssize_t read_zstd(nmea_source_t *source, char *buf, size_t len)
+{
+	ZSTD_outBuffer out = { buf, len, 0 };
+	ZSTD_inBuffer in;
+	size_t ret = 0, out_pos;
+
+	while (out.pos < out.size) {
+		if (source->in_pos == source->in_len && !source->eof) {
+			if (fill_input(source)) {
+				return -1;
+			}
+			continue;
+		}
+		in.src = source->in;
+		in.size = source->in_len;
+		in.pos = source->in_pos;
+		out_pos = out.pos;
+		ret = ZSTD_decompressStream(source->stream, &out, &in);
+		if (ZSTD_isError(ret)) {
+			return -1;
+		}
+		if (in.pos == source->in_len) {
+			if (ret == 0) {
+				// a frame ended with the input, the source may end with it
+				source->in_pos = in.pos;
+				if (!source->eof && fill_input(source)) {
+					return -1;
+				}
+				if (source->in_pos == source->in_len && source->eof) {
+					source->finished = 1;
+					break;
+				}
+				continue;
+			}
+			// a frame still in progress that neither took input nor gave output is cut
+			if (source->eof && in.pos == source->in_pos && out.pos == out_pos) {
+				return -1;
+			}
+		}
+		source->in_pos = in.pos;
+	}
+	return out.pos;
+}
+
+/**
+********************************************************************************
+* Hand out the output of the decoder threads in file order, queuing the
+* frames read meanwhile
+********************************************************************************/
+static ssize_t read_frames(nmea_source_t *source, char *buf, size_t len)
+{
+	struct source_pool_t *pool = source->pool;
+	source_job_t *job;
+	size_t n;
+
+	for (;;) {
+		if (queue_frames(source)) {
+			return -1;
+		}
+		if (pool->read == pool->filled) {
+			// nothing in flight: the end, or the rest is left to this thread
+			return pool->sequential ? read_zstd(source, buf, len) : 0;
+		}
+
+		job = &pool->jobs[pool->read % pool->num_jobs];
+		pthread_mutex_lock(&pool->lock);
+		while (job->state == JOB_QUEUED) {
+			pthread_cond_wait(&pool->decoded, &pool->lock);
+		}
+		pthread_mutex_unlock(&pool->lock);
+		if (job->state == JOB_FAILED) {
+			return -1;
+		}
+		if (job->out_pos < job->out_len) {
+			n = len < job->out_len - job->out_pos ? len : job->out_len - job->out_pos;
+			memcpy(buf, job->out + job->out_pos, n);
+			job->out_pos += n;
+			return n;
+		}
+		job->state = JOB_FREE;
+		pool->read++;
+	}
+}
+
+/**
+********************************************************************************
+* Queue the frames read in full while jobs are free
+* @param  source: Source with decoder threads
+* @return 0 on success, -1 on a read error, out of memory or a truncated frame
+********************************************************************************/
+static int queue_frames(nmea_source_t *source)
+{
+	struct source_pool_t *pool = source->pool;
+	source_job_t *job;
+	unsigned char *in;
+	size_t size;
+
+	while (!pool->sequential && pool->filled - pool->read < pool->num_jobs &&
+			!(source->in_pos == source->in_len && source->eof)) {
+		size = ZSTD_findFrameCompressedSize(source->in + source->in_pos, source->in_len - source->in_pos);
+		if (ZSTD_isError(size)) {
+			// not all of the frame is read yet
+			if (source->eof) {
+				return -1;
+			}
+			if (source->in_pos == 0 && source->in_len == source->in_cap) {
+				if (source->in_cap >= NMEA_SOURCE_MAX_FRAME) {
+					pool->sequential = 1;
+					break;
+				}
+				in = realloc(source->in, source->in_cap * 2);
+				if (!in) {
+					return -1;
+				}
+				source->in = in;
+				source->in_cap *= 2;
+			}
+			if (fill_input(source)) {
+				return -1;
+			}
+			continue;
+		}
+
+		job = &pool->jobs[pool->filled % pool->num_jobs];
+		if (reserve(&job->in, &job->in_cap, size)) {
+			return -1;
+		}
+		memcpy(job->in, source->in + source->in_pos, size);
+		job->in_len = size;
+		job->out_pos = 0;
+		job->out_len = 0;
+		source->in_pos += size;
+
+		pthread_mutex_lock(&pool->lock);
+		job->state = JOB_QUEUED;
+		pool->filled++;
+		pthread_cond_signal(&pool->queued);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return 0;
+}
+
+/**
+********************************************************************************
+* Start the decoder threads of a zstd source
+* @param  source: Source to decode
+* @param  num_threads: Number of decoder threads
+* @return 0 on success, -1 if threads or memory could not be allocated
+********************************************************************************/
+static int pool_start(nmea_source_t *source, int num_threads)
+{
+	struct source_pool_t *pool = calloc(1, sizeof(struct source_pool_t));
+
+	if (!pool) {
+		return -1;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->queued, NULL);
+	pthread_cond_init(&pool->decoded, NULL);
+	pool->num_jobs = (size_t)num_threads * NMEA_SOURCE_JOBS_PER_THREAD;
+	pool->jobs = calloc(pool->num_jobs, sizeof(source_job_t));
+	pool->threads = calloc(num_threads, sizeof(pthread_t));
+	source->pool = pool;
+	if (!pool->jobs || !pool->threads) {
+		return -1;
+	}
+	for (; pool->num_threads < num_threads; pool->num_threads++) {
+		if (pthread_create(&pool->threads[pool->num_threads], NULL, decoder_main, pool)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+********************************************************************************
+* Stop the decoder threads, whatever is still queued, and free the jobs
+* @param  pool: Decoder threads of a source
+********************************************************************************/
+static void pool_stop(struct source_pool_t *pool)
+{
+	size_t j;
+	int t;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->queued);
+	pthread_mutex_unlock(&pool->lock);
+	for (t = 0; t < pool->num_threads; t++) {
+		pthread_join(pool->threads[t], NULL);
+	}
+
+	for (j = 0; pool->jobs && j < pool->num_jobs; j++) {
+		free(pool->jobs[j].in);
+		free(pool->jobs[j].out);
+	}
+	pthread_cond_destroy(&pool->decoded);
+	pthread_cond_destroy(&pool->queued);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->jobs);
+	free(pool->threads);
+	free(pool);
+}
+
+/**
+********************************************************************************
+* Decoder thread: decode the queued jobs in the order they were queued
+* @param  arg: The pool
+* @return NULL
+********************************************************************************/
+static void *decoder_main(void *arg)
+{
+	struct source_pool_t *pool = arg;
+	ZSTD_DCtx *dctx = ZSTD_createDCtx();
+	source_job_t *job;
+	int ok;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->stop && pool->taken == pool->filled) {
+			pthread_cond_wait(&pool->queued, &pool->lock);
+		}
+		if (pool->stop) {
+			break;
+		}
+		job = &pool->jobs[pool->taken++ % pool->num_jobs];
+		pthread_mutex_unlock(&pool->lock);
+
+		ok = dctx && decode_frame(dctx, job) == 0;
+
+		pthread_mutex_lock(&pool->lock);
+		job->state = ok ? JOB_DONE : JOB_FAILED;
+		pthread_cond_broadcast(&pool->decoded);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	ZSTD_freeDCtx(dctx);
+	return NULL;
+}
+
+/**
+********************************************************************************
+* Decode a whole frame, into room for its content size when the frame tells
+* @param  dctx: Decoder of the thread
+* @param  job: Job holding the frame
+* @return 0 on success, -1 on a corrupted frame or out of memory
+********************************************************************************/
+static int decode_frame(ZSTD_DCtx *dctx, source_job_t *job)
+{
+	unsigned long long size = ZSTD_getFrameContentSize(job->in, job->in_len);
+	ZSTD_inBuffer in = { job->in, job->in_len, 0 };
+	ZSTD_outBuffer out;
+	size_t ret = 1;
+
+	// unknown and error are the largest values
+	if (size > (unsigned long long)NMEA_SOURCE_MAX_FRAME * 64) {
+		size = NMEA_SOURCE_READ_SIZE;
+	}
+	ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+	if (reserve(&job->out, &job->out_cap, size ? size : 1)) {
+		return -1;
+	}
+
+	while (ret != 0) {
+		if (job->out_len == job->out_cap && reserve(&job->out, &job->out_cap, job->out_cap * 2)) {
+			return -1;
+		}
+		out.dst = job->out;
+		out.size = job->out_cap;
+		out.pos = job->out_len;
+		ret = ZSTD_decompressStream(dctx, &out, &in);
+		job->out_len = out.pos;
+		if (ZSTD_isError(ret) || (ret != 0 && in.pos == in.size && out.pos < out.size)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+********************************************************************************
+* Grow a buffer to hold at least size bytes
+* @param  buf: Pointer to the buffer pointer
+* @param  cap: Capacity of the buffer
+* @param  size: Bytes needed
+* @return 0 on success, -1 if memory could not be allocated
+********************************************************************************/
+static int reserve(void *buf, size_t *cap, size_t size)
+{
+	void *grown;
+
+	if (*cap >= size) {
+		return 0;
+	}
+	grown = realloc(*(void **)buf, size);
+	if (!grown) {
+		return -1;
+	}
+	*(void **)buf = grown;
+	*cap = size;
+	return 0;
+}
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
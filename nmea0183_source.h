@@ -0,0 +1,94 @@
+/** @file
+ *  Provides prototypes for the input sources of the parsers: a file
+ *  descriptor read as it is, or decompressed on the fly when it holds gzip
+ *  (built with NMEA_ZLIB) or zstd (built with NMEA_ZSTD) data.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_SOURCE_H__
+#define __NMEA0183_SOURCE_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_SOURCE_READ_SIZE		(1024 * 1024)		/**< Compressed bytes read at a time. */
+#define NMEA_SOURCE_MAX_FRAME		(16 * 1024 * 1024)	/**< Largest zstd frame decoded by the decoder threads. */
+#define NMEA_SOURCE_JOBS_PER_THREAD	2					/**< zstd frames in flight per decoder thread. */
+
+/**
+ * Format of the bytes read from the file descriptor, told by their first bytes
+ */
+typedef enum {
+	NMEA_SOURCE_PLAIN = 0,						/**< NMEA text as it is. */
+	NMEA_SOURCE_GZIP,							/**< One or more gzip members. */
+	NMEA_SOURCE_ZSTD,							/**< One or more zstd frames. */
+	NMEA_SOURCE_CODE_INVALID
+} nmea_source_format;
+
+struct source_pool_t;
+
+/**
+ * Source reading a file descriptor until its end, from one thread
+ */
+typedef struct nmea_source_t
+{
+	int fd;
+	nmea_source_format format;
+	unsigned char *in;							/**< Bytes read ahead from fd, compressed unless plain. */
+	size_t in_pos;								/**< Next byte of in to consume. */
+	size_t in_len;
+	size_t in_cap;
+	int eof;									/**< fd is at its end. */
+	int finished;								/**< The last byte was read out. */
+	void *stream;								/**< z_stream or ZSTD_DCtx of the reading thread. */
+	struct source_pool_t *pool;					/**< zstd decoder threads, NULL if none. */
+	uint64_t bytes_in;							/**< Bytes consumed from fd. */
+	uint64_t bytes_out;							/**< Bytes handed out. */
+} nmea_source_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_source_open(nmea_source_t *source, int fd, int num_threads);
+ssize_t nmea_source_read(nmea_source_t *source, char *buf, size_t len);
+void nmea_source_close(nmea_source_t *source);
+int nmea_source_supported(nmea_source_format format);
+const char *nmea_source_format_name(nmea_source_format format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
@@ -0,0 +1,429 @@
+/** @file
+ *  Provides implementation for the binary fix store.
+ *
+ *  A store file is a nmea_store_file_header_t followed by blocks of up to
+ *  NMEA_STORE_BLOCK_SIZE fixes. Each block is a nmea_store_block_header_t
+ *  followed by its columns, padded to 8 bytes. Within a column each value is
+ *  the difference to the previous one, zigzag mapped and written as a LEB128
+ *  varint, so slowly changing tracks take one or two bytes per value.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "nmea0183_store.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "nmea0183_store writes headers in host order, which must be little-endian"
+#endif
+
+#define VARINT_MAX_SIZE				10
+#define BLOCK_MAX_PAYLOAD			(NMEA_STORE_BLOCK_SIZE * VARINT_MAX_SIZE * NMEA_STORE_COLUMNS + 8)
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+static size_t encode_column64(unsigned char *out, const int64_t *values, size_t count);
+static size_t encode_column32(unsigned char *out, const int32_t *values, size_t count);
+static int decode_column64(const unsigned char *in, size_t size, int64_t *values, size_t count);
+static int decode_column32(const unsigned char *in, size_t size, int32_t *values, size_t count);
+static int32_t quantize(double value, double scale);
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Create a store file, truncating any existing file
+* @param  writer: Writer to initialize
+* @param  path: Path of the store file
+* @return 0 on success, -1 on error
+********************************************************************************/
+int nmea_store_create(nmea_store_writer_t *writer, const char *path)
+{
+	nmea_store_file_header_t header = { NMEA_STORE_MAGIC, NMEA_STORE_VERSION, NMEA_STORE_BLOCK_SIZE, 0 };
+
+	writer->pending.count = 0;
+	writer->encoded = malloc(BLOCK_MAX_PAYLOAD);
+	writer->file = fopen(path, "wb");
+	if (!writer->encoded || !writer->file || fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+		if (writer->file) {
+			fclose(writer->file);
+		}
+		free(writer->encoded);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+********************************************************************************
+* Append a fix; a block is written each time NMEA_STORE_BLOCK_SIZE are pending
+* @param  writer: Writer of the store file
+* @param  fix: Fix to append, as filled in by parse_rmc()
+* @return 0 on success, -1 on write error; the fix is not appended if the
+*         block before it still could not be written
+********************************************************************************/
+int nmea_store_append(nmea_store_writer_t *writer, const nmea_rmc_data_t *fix)
+{
+	nmea_fix_columns_t *p = &writer->pending;
+	size_t i = p->count;
+
+	if (i == NMEA_STORE_BLOCK_SIZE) {
+		// the write of the full block failed before, try it again
+		if (nmea_store_flush(writer)) {
+			return -1;
+		}
+		i = 0;
+	}
+
+	p->time[i] = fix->epoch_ms;
+	p->latitude_e7[i] = fix->latitude_e7;
+	p->longitude_e7[i] = fix->longitude_e7;
+	p->speed[i] = quantize(fix->ground_speed, 1e3);
+	p->heading[i] = quantize(fix->heading, 1e4);
+	p->magnetic_var[i] = quantize(fix->magnetic_var, 1e2);
+
+	if (++p->count == NMEA_STORE_BLOCK_SIZE) {
+		return nmea_store_flush(writer);
+	}
+	return 0;
+}
+
+/**
+********************************************************************************
+* Write the pending fixes as a block, even if it is not full
+* @param  writer: Writer of the store file
+* @return 0 on success, -1 on write error; the fixes stay pending then and
+*         the next flush writes the block over what was written of it
+********************************************************************************/
+int nmea_store_flush(nmea_store_writer_t *writer)
+{
+	nmea_fix_columns_t *p = &writer->pending;
+	nmea_store_block_header_t header;
+	unsigned char *out = writer->encoded;
+	size_t size = 0, i;
+	long start;
+
+	if (p->count == 0) {
+		return 0;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = NMEA_STORE_BLOCK_MAGIC;
+	header.count = p->count;
+	header.min_time = header.max_time = p->time[0];
+	for (i = 1; i < p->count; i++) {
+		if (p->time[i] < header.min_time) header.min_time = p->time[i];
+		if (p->time[i] > header.max_time) header.max_time = p->time[i];
+	}
+
+	header.column_size[NMEA_STORE_COL_TIME] = encode_column64(out, p->time, p->count);
+	size += header.column_size[NMEA_STORE_COL_TIME];
+	header.column_size[NMEA_STORE_COL_LATITUDE] = encode_column32(out + size, p->latitude_e7, p->count);
+	size += header.column_size[NMEA_STORE_COL_LATITUDE];
+	header.column_size[NMEA_STORE_COL_LONGITUDE] = encode_column32(out + size, p->longitude_e7, p->count);
+	size += header.column_size[NMEA_STORE_COL_LONGITUDE];
+	header.column_size[NMEA_STORE_COL_SPEED] = encode_column32(out + size, p->speed, p->count);
+	size += header.column_size[NMEA_STORE_COL_SPEED];
+	header.column_size[NMEA_STORE_COL_HEADING] = encode_column32(out + size, p->heading, p->count);
+	size += header.column_size[NMEA_STORE_COL_HEADING];
+	header.column_size[NMEA_STORE_COL_MAGNETIC_VAR] = encode_column32(out + size, p->magnetic_var, p->count);
+	size += header.column_size[NMEA_STORE_COL_MAGNETIC_VAR];
+
+	// keep the next block header 8 byte aligned in the mapped file
+	while (size & 7) {
+		out[size++] = 0;
+	}
+
+	start = ftell(writer->file);
+	if (fwrite(&header, sizeof(header), 1, writer->file) != 1 ||
+			fwrite(out, 1, size, writer->file) != size) {
+		if (start >= 0) {
+			fseek(writer->file, start, SEEK_SET);
+		}
+		return -1;
+	}
+	p->count = 0;
+	return 0;
+}
+
+/**
+********************************************************************************
+* Flush the pending fixes and close the store file
+* @param  writer: Writer of the store file
+* @return 0 on success, -1 on write error
+********************************************************************************/
+int nmea_store_close(nmea_store_writer_t *writer)
+{
+	int result = nmea_store_flush(writer);
+
+	if (fclose(writer->file)) {
+		result = -1;
+	}
+	free(writer->encoded);
+	writer->file = NULL;
+	writer->encoded = NULL;
+
+	return result;
+}
+
+/**
+********************************************************************************
+* Map a store file for reading
+* @param  reader: Reader to initialize
+* @param  path: Path of the store file
+* @return 0 on success, -1 if the file cannot be mapped or is not a store file
+********************************************************************************/
+int nmea_store_map(nmea_store_reader_t *reader, const char *path)
+{
+	const nmea_store_file_header_t *header;
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		return -1;
+	}
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(nmea_store_file_header_t)) {
+		close(fd);
+		return -1;
+	}
+	reader->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (reader->map == MAP_FAILED) {
+		return -1;
+	}
+	reader->len = st.st_size;
+	reader->offset = sizeof(nmea_store_file_header_t);
+
+	header = (const nmea_store_file_header_t *)reader->map;
+	if (header->magic != NMEA_STORE_MAGIC || header->version != NMEA_STORE_VERSION ||
+			header->block_size > NMEA_STORE_BLOCK_SIZE) {
+		nmea_store_unmap(reader);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+********************************************************************************
+* Unmap a store file
+* @param  reader: Reader of the store file
+********************************************************************************/
+void nmea_store_unmap(nmea_store_reader_t *reader)
+{
+	munmap((void *)reader->map, reader->len);
+	reader->map = NULL;
+	reader->len = 0;
+}
+
+/**
+********************************************************************************
+* Move to the next block. Its header tells the time range and size of the
+* block, so blocks can be skipped without being decoded.
+* @param  reader: Reader of the store file
+* @return Header of the block, NULL at the end of the file or on a bad block
+********************************************************************************/
+const nmea_store_block_header_t *nmea_store_next_block(nmea_store_reader_t *reader)
+{
+	const nmea_store_block_header_t *header;
+	size_t size = 0;
+	int i;
+
+	if (reader->offset + sizeof(*header) > reader->len) {
+		return NULL;
+	}
+	header = (const nmea_store_block_header_t *)(reader->map + reader->offset);
+	if (header->magic != NMEA_STORE_BLOCK_MAGIC || header->count > NMEA_STORE_BLOCK_SIZE) {
+		return NULL;
+	}
+	for (i = 0; i < NMEA_STORE_COLUMNS; i++) {
+		size += header->column_size[i];
+	}
+	size = (size + 7) & ~(size_t)7;
+	if (size > reader->len - reader->offset - sizeof(*header)) {
+		return NULL;
+	}
+
+	reader->offset += sizeof(*header) + size;
+	return header;
+}
+
+/**
+********************************************************************************
+* Decode the columns of a block into arrays
+* @param  header: Block header returned by nmea_store_next_block()
+* @param  columns: Decoded fixes
+* @return Number of fixes decoded, -1 on a corrupted block
+********************************************************************************/
+int nmea_store_decode_block(const nmea_store_block_header_t *header, nmea_fix_columns_t *columns)
+{
+	const unsigned char *in = (const unsigned char *)(header + 1);
+	const uint32_t *size = header->column_size;
+	size_t count = header->count;
+
+	if (decode_column64(in, size[NMEA_STORE_COL_TIME], columns->time, count) ||
+			decode_column32(in += size[NMEA_STORE_COL_TIME], size[NMEA_STORE_COL_LATITUDE], columns->latitude_e7, count) ||
+			decode_column32(in += size[NMEA_STORE_COL_LATITUDE], size[NMEA_STORE_COL_LONGITUDE], columns->longitude_e7, count) ||
+			decode_column32(in += size[NMEA_STORE_COL_LONGITUDE], size[NMEA_STORE_COL_SPEED], columns->speed, count) ||
+			decode_column32(in += size[NMEA_STORE_COL_SPEED], size[NMEA_STORE_COL_HEADING], columns->heading, count) ||
+			decode_column32(in += size[NMEA_STORE_COL_HEADING], size[NMEA_STORE_COL_MAGNETIC_VAR], columns->magnetic_var, count)) {
+		return -1;
+	}
+
+	columns->count = count;
+	return count;
+}
+
+/**
+********************************************************************************
+* Convert a decoded fix back to the parser's representation
+* @param  columns: Decoded fixes
+* @param  i: Index of the fix
+* @param  fix: Fix as parse_rmc() would fill it in, up to the stored precision
+********************************************************************************/
+void nmea_fix_columns_get(const nmea_fix_columns_t *columns, size_t i, nmea_rmc_data_t *fix)
+{
+	nmea_rmc_set_time(fix, columns->time[i]);
+	fix->status = 'A';
+	fix->mode = 0;
+	fix->nav_status = 0;
+	fix->latitude_e7 = columns->latitude_e7[i];
+	fix->longitude_e7 = columns->longitude_e7[i];
+	fix->latitude = columns->latitude_e7[i] / 1e7;
+	fix->longitude = columns->longitude_e7[i] / 1e7;
+	fix->ground_speed = columns->speed[i] / 1e3;
+	fix->heading = columns->heading[i] / 1e4;
+	fix->magnetic_var = columns->magnetic_var[i] / 1e2;
+}
+
+/*******************************************************************************
+*                          Static Function Definitions
+*******************************************************************************/
+
+static size_t encode_column64(unsigned char *out, const int64_t *values, size_t count)
+{
+	unsigned char *p = out;
+	int64_t prev = 0;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		// zigzag, so that small negative deltas stay small
+		uint64_t v = (uint64_t)(values[i] - prev);
+		v = (v << 1) ^ (uint64_t)((int64_t)v >> 63);
+		prev = values[i];
+		while (v >= 0x80) {
+			*p++ = (unsigned char)v | 0x80;
+			v >>= 7;
+		}
+		*p++ = (unsigned char)v;
+	}
+
+	return p - out;
+}
+
+static size_t encode_column32(unsigned char *out, const int32_t *values, size_t count)
+{
+	int64_t wide[NMEA_STORE_BLOCK_SIZE];
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		wide[i] = values[i];
+	}
+	return encode_column64(out, wide, count);
+}
+
+/**
+********************************************************************************
+* Decode a column, never reading past its size
+* @return 0 on success, -1 if the column is truncated or has extra bytes
+********************************************************************************/
+static int decode_column64(const unsigned char *in, size_t size, int64_t *values, size_t count)
+{
+	const unsigned char *end = in + size;
+	int64_t prev = 0;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		uint64_t v = 0;
+		int shift = 0;
+		do {
+			if (in == end || shift > 63) {
+				return -1;
+			}
+			v |= (uint64_t)(*in & 0x7f) << shift;
+			shift += 7;
+		} while (*in++ & 0x80);
+		prev += (int64_t)((v >> 1) ^ -(v & 1));
+		values[i] = prev;
+	}
+
+	return in == end ? 0 : -1;
+}
+
+static int decode_column32(const unsigned char *in, size_t size, int32_t *values, size_t count)
+{
+	int64_t wide[NMEA_STORE_BLOCK_SIZE];
+	size_t i;
+
+	if (decode_column64(in, size, wide, count)) {
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		values[i] = (int32_t)wide[i];
+	}
+	return 0;
+}
+
+static int32_t quantize(double value, double scale)
+{
+	double v = round(value * scale);
+
+	if (v > INT32_MAX) return INT32_MAX;
+	if (v < INT32_MIN) return INT32_MIN;
+	return (int32_t)v;
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
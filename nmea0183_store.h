@@ -0,0 +1,140 @@
+/** @file
+ *  Provides prototypes for the binary fix store: a columnar file of parsed
+ *  RMC fixes with delta/zigzag varint encoded columns.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_STORE_H__
+#define __NMEA0183_STORE_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "nmea0183_parser.h"
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_STORE_MAGIC			0x46434d52		/**< "RMCF", start of the file. */
+#define NMEA_STORE_BLOCK_MAGIC		0x42434d52		/**< "RMCB", start of each block. */
+#define NMEA_STORE_VERSION			1
+#define NMEA_STORE_BLOCK_SIZE		4096			/**< Most fixes in a block. */
+
+/**
+ * Columns of a block, in file order
+ */
+typedef enum {
+	NMEA_STORE_COL_TIME = 0,					/**< UTC epoch milliseconds. */
+	NMEA_STORE_COL_LATITUDE,					/**< 1e-7 degree. */
+	NMEA_STORE_COL_LONGITUDE,					/**< 1e-7 degree. */
+	NMEA_STORE_COL_SPEED,						/**< 1e-3 knot. */
+	NMEA_STORE_COL_HEADING,						/**< 1e-4 degree. */
+	NMEA_STORE_COL_MAGNETIC_VAR,				/**< 1e-2 degree. */
+	NMEA_STORE_COLUMNS
+} nmea_store_column;
+
+/**
+ * File header. All integers of the file are stored little-endian.
+ */
+typedef struct nmea_store_file_header_t
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t block_size;						/**< NMEA_STORE_BLOCK_SIZE of the writer. */
+	uint32_t reserved;
+} nmea_store_file_header_t;
+
+/**
+ * Block header, followed by the encoded columns
+ */
+typedef struct nmea_store_block_header_t
+{
+	uint32_t magic;
+	uint32_t count;								/**< Number of fixes. */
+	int64_t min_time;							/**< Earliest fix, UTC epoch milliseconds. */
+	int64_t max_time;							/**< Latest fix, UTC epoch milliseconds. */
+	uint32_t column_size[NMEA_STORE_COLUMNS];	/**< Bytes of each encoded column. */
+} nmea_store_block_header_t;
+
+/**
+ * Fixes of one block, one array per column
+ */
+typedef struct nmea_fix_columns_t
+{
+	size_t count;
+	int64_t time[NMEA_STORE_BLOCK_SIZE];
+	int32_t latitude_e7[NMEA_STORE_BLOCK_SIZE];
+	int32_t longitude_e7[NMEA_STORE_BLOCK_SIZE];
+	int32_t speed[NMEA_STORE_BLOCK_SIZE];
+	int32_t heading[NMEA_STORE_BLOCK_SIZE];
+	int32_t magnetic_var[NMEA_STORE_BLOCK_SIZE];
+} nmea_fix_columns_t;
+
+/**
+ * Writer appending fixes to a store file a block at a time
+ */
+typedef struct nmea_store_writer_t
+{
+	FILE *file;
+	unsigned char *encoded;						/**< Scratch space for one encoded block. */
+	nmea_fix_columns_t pending;					/**< Fixes of the block being filled. */
+} nmea_store_writer_t;
+
+/**
+ * Reader walking the blocks of a memory-mapped store file
+ */
+typedef struct nmea_store_reader_t
+{
+	const unsigned char *map;
+	size_t len;
+	size_t offset;								/**< Offset of the next block header. */
+} nmea_store_reader_t;
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+int nmea_store_create(nmea_store_writer_t *writer, const char *path);
+int nmea_store_append(nmea_store_writer_t *writer, const nmea_rmc_data_t *fix);
+int nmea_store_flush(nmea_store_writer_t *writer);
+int nmea_store_close(nmea_store_writer_t *writer);
+
+int nmea_store_map(nmea_store_reader_t *reader, const char *path);
+void nmea_store_unmap(nmea_store_reader_t *reader);
+const nmea_store_block_header_t *nmea_store_next_block(nmea_store_reader_t *reader);
+int nmea_store_decode_block(const nmea_store_block_header_t *header, nmea_fix_columns_t *columns);
+void nmea_fix_columns_get(const nmea_fix_columns_t *columns, size_t i, nmea_rmc_data_t *fix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/
@@ -15,8 +15,36 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 
 #include "nmea0183_parser.h"
+#include "nmea0183_scan.h"
+#include "nmea0183_parallel.h"
+#include "nmea0183_store.h"
+#include "nmea0183_pipeline.h"
+#include "nmea0183_server.h"
+#include "nmea0183_fleet.h"
+#include "nmea0183_packed.h"
+#include "nmea0183_geodesic.h"
+#include "nmea0183_geofence.h"
+#include "nmea0183_simplify.h"
+#include "nmea0183_generator.h"
+#include "nmea0183_metrics.h"
+#include "nmea0183_archive.h"
+#include "nmea0183_source.h"
+#ifdef NMEA_ZLIB
+#include <zlib.h>
+#endif
+#ifdef NMEA_ZSTD
+#include <zstd.h>
+#endif
 
 /*******************************************************************************
 *                          Extern Data Declarations
@@ -25,24 +53,155 @@
 /*******************************************************************************
 *                          Extern Function Declarations
 *******************************************************************************/
+extern int test_schema_decoders(const char *const *sentences, size_t count);	// nmea0183_schema_tester.cpp
 
 /*******************************************************************************
 *                          Type & Macro Definitions
 *******************************************************************************/
 #define RMC_HEADER					"$GPRMC,"
 #define ASSERT_RMC(t, m, b)			do {if (!(t)) { printf(m); goto b; } } while(0);
+#define MAX_FIXES_TO_OUTPUT			100
+#define INPUT_CHUNK_SIZE			(64 * 1024)
+#define MAPPED_BATCH_SIZE			4096
+#define SERVER_MAX_VEHICLES			(1024 * 1024)
+#define SERVER_SIMPLIFIED_VEHICLES	(64 * 1024)
+#define SERVER_TOLERANCE_M			25
+#define GENERATOR_CHUNK_SIZE		(1024 * 1024)
+#define GENERATOR_PCT_VOID			10
+#define GENERATOR_PCT_CORRUPT		2
+#define GENERATOR_PCT_OTHER			30
+
+/**
+ * Bookkeeping of the file mode while the input is streamed thru the parser
+ */
+typedef struct file_parse_state_t
+{
+	FILE *output_stream;
+	int num_of_sentences;
+	int num_of_fixes;
+} file_parse_state_t;
+
+/**
+ * Thread of the fleet generator modes, with its own generator and vehicles
+ */
+typedef struct generator_thread_t
+{
+	pthread_t thread;
+	nmea_generator_t gen;
+	size_t first_vehicle;						// of the fleet, for the connection of a vehicle
+	size_t sentences;							// to generate
+	int fd;										// file mode: output shared by all threads
+	pthread_mutex_t *lock;						// file mode: held to write a chunk
+	const int *fds;								// socket mode: one connection per vehicle of the fleet
+	int failed;
+} generator_thread_t;
+
+/**
+ * Fixes received by the server mode and test
+ */
+typedef struct server_state_t
+{
+	size_t batches;
+	size_t fixes;
+	uint32_t last_vehicle;
+	nmea_fleet_t *fleet;						// latest fix of every vehicle, if not NULL
+	nmea_simplify_t *simplify;					// tracks to keep, if not NULL
+	nmea_archive_writer_t *archive;				// every fix, if not NULL
+} server_state_t;
+
+/**
+ * Fixes found by the archive query mode and test
+ */
+typedef struct archive_query_t
+{
+	FILE *output_stream;						// query mode: fixes written here, if not NULL
+	const nmea_rmc_data_t *expected;			// test: the fixes to find, in order
+	size_t found;
+	int mismatch;
+} archive_query_t;
+
+/**
+ * Results counted by the stream parser test
+ */
+typedef struct stream_test_state_t
+{
+	int results[RMC_PARSE_CODE_INVALID];
+} stream_test_state_t;
 
 /*******************************************************************************
 *                          Static Function Prototypes
 *******************************************************************************/
 static void usage(char *arg);
 static void print_rmc_data(nmea_rmc_data_t *data);
-static rmc_parse_result test_rmc_input(const char *buf, int buf_size);
-static int readline(FILE *f, char *buf, int len);
+static rmc_parse_result test_rmc_input(const char *buf, int buf_size, rmc_error_detail_t *error);
+static int test_nmea_sentences(void);
+static int test_stream_input(const char *buf, int buf_size, int chunk_size);
+static void on_stream_test_sentence(const nmea_rmc_data_t *data, rmc_parse_result result, void *user_data);
+static int test_stream_failures(const char *buf, int buf_size);
+static void on_stream_failure(const char *sentence, size_t len, const rmc_error_detail_t *error, void *user_data);
+static void on_file_sentence(const nmea_rmc_data_t *data, rmc_parse_result result, void *user_data);
+static const char *map_input_file(const char *input_file, size_t *len);
+static void write_fixes(FILE *output_stream, const nmea_rmc_data_t *fixes, const rmc_line_result_t *results, size_t count);
+static void on_parallel_batch(const nmea_rmc_data_t *data, const rmc_line_result_t *results, size_t count, void *user_data);
+static int parse_mapped_file(const char *input_file, const char *output_file);
+static int parse_file_in_parallel(int num_threads, const char *input_file, const char *output_file);
+static int parse_file_in_pipeline(int num_parsers, int num_decoders, const char *input_file, const char *output_file);
+static int parse_file_to_store(const char *input_file, const char *store_file);
+static int test_store_round_trip(const nmea_rmc_data_t *fix);
+static int decode_store_file(const char *store_file, const char *output_file);
+static void on_archive_fixes(uint32_t vehicle, const nmea_rmc_data_t *fixes, size_t count, void *user_data);
+static int test_archive_queries(void);
+static int query_archive(const char *store_file, uint32_t vehicle, int64_t from_s, int64_t to_s, const char *output_file);
+static int start_generators(generator_thread_t *threads, int num_threads, size_t vehicles, size_t sentences,
+		const unsigned int *rates, void *(*run)(void *));
+static void *generate_to_file(void *arg);
+static int generate_fleet_file(size_t vehicles, size_t sentences, int num_threads, const char *output_file,
+		const unsigned int *rates);
+static int test_fleet_generator(void);
+static void *scrape_metrics(void *arg);
+static int test_parse_metrics(void);
+static void print_metrics(void);
+static int rewrite_file(int fd, const void *data, size_t len);
+static int check_source(int fd, int num_threads, const char *expected, size_t len);
+static int test_compressed_input(void);
+static void raise_fd_limit(void);
+static double elapsed_seconds(const struct timespec *start);
+static void on_server_batch(uint32_t vehicle, const nmea_rmc_data_t *fixes, size_t count, void *user_data);
+static int test_server_streams(const char *buf, int buf_size);
+static int test_fleet_index(const nmea_rmc_data_t *fix);
+static int test_packed_fixes(const nmea_rmc_data_t *fix, const char *buf, int buf_size);
+static int test_geodesic_kernels(void);
+static int geofence_brute_force(const int32_t *latitude_e7, const int32_t *longitude_e7, size_t count, int32_t y, int32_t x);
+static void on_geofence_event(const nmea_geofence_event_t *event, void *user_data);
+static int test_geofence_engine(void);
+static double track_error(const nmea_rmc_data_t *fix, const nmea_rmc_data_t *from, const nmea_rmc_data_t *to);
+static double max_track_error(const nmea_rmc_data_t *track, size_t count, const nmea_rmc_data_t *kept, size_t n);
+static int test_track_simplification(const nmea_rmc_data_t *fix);
+static int serve_streams(const char *address, const char *store_file);
+static void *generate_to_streams(void *arg);
+static int load_streams(const char *address, int num_streams, int sentences, int num_threads);
 
 /*******************************************************************************
 *                          Static Data Definitions
 *******************************************************************************/
+// one sentence of every supported type and talker, one that is not supported, then RMC of NMEA 2.3
+static const char *const nmea_sentences[] = {
+	"$GNRMC,102642.03,A,4813.7943164,S,01621.5693035,W,7.158,156.6705,020713,020.32,E*4F",
+	"$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47",
+	"$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48",
+	"$GPGLL,4916.45,N,12311.12,W,225444,A,*1D",
+	"$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39",
+	"$GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45*75",
+	"$GPZDA,201530.00,04,07,2002,00,00*60",
+	"$GNRMC,001031.00,A,4404.13993,N,12118.86023,W,0.146,,100117,,,A*7B",
+	"$GNRMC,001031.00,A,4404.13993,N,12118.86023,W,0.146,,100117,,*16",
+	"$GNRMC,001031.00,A,4404.13993,N,12118.86023,W,0.146,,100117,014.2,E,D*12",
+	"$GNRMC,001031.00,A,4404.13993,N,12118.86023,W,0.146,,100117,,,N*74",
+	"$GNRMC,001031.00,V,,,,,,,100117,,,N*66",
+	"$GNRMC,001031.00,A,4404.13993,N,12118.86023,W,0.146,,100117,,,A,V*01",
+	"$GNRMC,001031.00,A,4404.13993,N,12118.86023,W,0.146,,100117,014.2,E,D,S*6D",
+	"$GNRMC,001031.00,A,4404.13993,N,12118.86023,W,0.146,,100117,,,A,X*0F",
+};
 
 /*******************************************************************************
 *                          Extern/Exported Data Definitions
@@ -54,6 +213,41 @@ static int readline(FILE *f, char *buf, int len);
 
 int main(int argc, char **argv)
 {
+	if (argc == 4 && !strcmp(argv[1], "-m")) {
+		return parse_mapped_file(argv[2], argv[3]);
+	}
+	if (argc == 5 && !strcmp(argv[1], "-p")) {
+		return parse_file_in_parallel(atoi(argv[2]), argv[3], argv[4]);
+	}
+	if ((argc == 5 || argc == 6) && !strcmp(argv[1], "-P")) {
+		return parse_file_in_pipeline(atoi(argv[2]), argc == 6 ? atoi(argv[5]) : 1, argv[3], argv[4]);
+	}
+	if (argc == 4 && !strcmp(argv[1], "-b")) {
+		return parse_file_to_store(argv[2], argv[3]);
+	}
+	if (argc == 4 && !strcmp(argv[1], "-r")) {
+		return decode_store_file(argv[2], argv[3]);
+	}
+	if ((argc == 3 || argc == 4) && !strcmp(argv[1], "-S")) {
+		return serve_streams(argv[2], argc == 4 ? argv[3] : NULL);
+	}
+	if (argc == 7 && !strcmp(argv[1], "-q")) {
+		return query_archive(argv[2], strtoul(argv[3], NULL, 10), atoll(argv[4]), atoll(argv[5]), argv[6]);
+	}
+	if ((argc == 5 || argc == 6) && !strcmp(argv[1], "-L")) {
+		return load_streams(argv[2], atoi(argv[3]), atoi(argv[4]), argc == 6 ? atoi(argv[5]) : 1);
+	}
+	if ((argc == 6 || argc == 9) && !strcmp(argv[1], "-G")) {
+		unsigned int rates[3] = { GENERATOR_PCT_VOID, GENERATOR_PCT_CORRUPT, GENERATOR_PCT_OTHER };
+		int i;
+
+		for (i = 0; argc == 9 && i < 3; i++) {
+			rates[i] = atoi(argv[6 + i]);
+		}
+		return generate_fleet_file(strtoull(argv[2], NULL, 10), strtoull(argv[3], NULL, 10), atoi(argv[4]),
+				argv[5], rates);
+	}
+
 	if ((argc > 3) || (argc == 2 && !strcmp(argv[1], "-h"))) {
 		usage(argv[0]);
 		exit(0);
@@ -63,29 +257,222 @@ int main(int argc, char **argv)
 		// valid input with GPS fix
 		printf("*** Expect output of valid parse with fix.......");
 		char gprmc_str1[] = "$GPRMC,102642.03,A,4813.7943164,S,01621.5693035,W,7.158,156.6705,020713,020.32,E*51";
-		if (test_rmc_input(gprmc_str1, strlen(gprmc_str1)) == RMC_PARSE_SUCCESSFUL_WITH_FIX) printf("PASSED\n"); else printf("FAILED\n");
+		rmc_error_detail_t error;
+		if (test_rmc_input(gprmc_str1, strlen(gprmc_str1), &error) == RMC_PARSE_SUCCESSFUL_WITH_FIX) printf("PASSED\n"); else printf("FAILED\n");
 		
 		// valid input with no GPS fix
 		printf("*** Expect output of valid parse with no fix.......");
 		char gprmc_str2[] = "$GPRMC,102642.03,V,4813.7943164,N,01621.5693035,E,7.158,156.6705,020713,020.32,E*49";
-		if (test_rmc_input(gprmc_str2, strlen(gprmc_str2)) == RMC_PARSE_SUCCESSFUL_WITH_NO_FIX) printf("PASSED\n"); else printf("FAILED\n");
+		if (test_rmc_input(gprmc_str2, strlen(gprmc_str2), &error) == RMC_PARSE_SUCCESSFUL_WITH_NO_FIX) printf("PASSED\n"); else printf("FAILED\n");
 
 		// negative case 1: invalid checksum
 		printf("*** Expect output of failed checksum.......");
 		char gprmc_str_f1[] = "$GPRMC,102642.03,V,4813.7943164,N,01621.5693035,E,7.158,156.6705,020713,020.32,E*5E";
-		if (test_rmc_input(gprmc_str_f1, strlen(gprmc_str_f1)) == RMC_PARSE_FAILED) printf("PASSED\n"); else printf("FAILED\n");
+		if (test_rmc_input(gprmc_str_f1, strlen(gprmc_str_f1), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_CHECKSUM && error.offset == 81) printf("PASSED\n"); else printf("FAILED\n");
 
 		// negative case 2: invalid latitude
 		printf("*** Expect output of invalid latitude.......");
 		char gprmc_str_f2[] = "$GPRMC,102642.03,A,4813.7943164,I,01621.5693035,E,7.158,156.6705,020713,020.32,E*59";
-		if (test_rmc_input(gprmc_str_f2, strlen(gprmc_str_f2)) == RMC_PARSE_FAILED) printf("PASSED\n"); else printf("FAILED\n");
+		if (test_rmc_input(gprmc_str_f2, strlen(gprmc_str_f2), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_LATITUDE && error.offset == 32) printf("PASSED\n"); else printf("FAILED\n");
 
 		// negative case 3: invalid longitude
 		printf("*** Expect output of invalid longitude.......");
 		char gprmc_str_f3[] = "$GPRMC,102642.03,A,4813.7943164,N,1.5693035,E,7.158,156.6705,020713,020.32,E*5B";
-		if (test_rmc_input(gprmc_str_f3, strlen(gprmc_str_f3)) == RMC_PARSE_FAILED) printf("PASSED\n"); else printf("FAILED\n");
+		if (test_rmc_input(gprmc_str_f3, strlen(gprmc_str_f3), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_LONGITUDE && error.offset == 34) printf("PASSED\n"); else printf("FAILED\n");
+
+		// negative case 4: minutes of 60 or more, or past 90/180 degrees
+		printf("*** Expect output of out-of-range coordinates.......");
+		char gprmc_str_f4[] = "$GPRMC,102642.03,A,4460.50000,N,01621.5693035,E,7.158,156.6705,020713,020.32,E*59";
+		char gprmc_str_f5[] = "$GPRMC,102642.03,A,9059.0,N,01621.5693035,E,7.158,156.6705,020713,020.32,E*5F";
+		char gprmc_str_f6[] = "$GPRMC,102642.03,A,4813.7943164,N,18059.9,E,7.158,156.6705,020713,020.32,E*59";
+		char gprmc_str_pole[] = "$GPRMC,102642.03,A,9000.0,S,18000.000,W,7.158,156.6705,020713,020.32,E*5E";
+		nmea_rmc_data_t range_data;
+		if (parse_rmc_detail(&range_data, gprmc_str_f4, strlen(gprmc_str_f4), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_LATITUDE && error.offset == 19 &&
+				parse_rmc_detail(&range_data, gprmc_str_f5, strlen(gprmc_str_f5), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_LATITUDE && error.offset == 19 &&
+				parse_rmc_detail(&range_data, gprmc_str_f6, strlen(gprmc_str_f6), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_LONGITUDE && error.offset == 34 &&
+				parse_rmc_detail(&range_data, gprmc_str_pole, strlen(gprmc_str_pole), &error) == RMC_PARSE_SUCCESSFUL_WITH_FIX &&
+				range_data.latitude_e7 == -900000000 && range_data.longitude_e7 == -1800000000) printf("PASSED\n"); else printf("FAILED\n");
+
+		// coordinates rounded once, not thru minutes / 10^frac / 60 + degrees
+		printf("*** Expect output of correctly rounded coordinates.......");
+		char gprmc_str_rounded[] = "$GPRMC,102642.03,A,5240.967755,N,00035.1065,E,7.158,156.6705,020713,020.32,E*59";
+		if (parse_rmc_detail(&range_data, gprmc_str_rounded, strlen(gprmc_str_rounded), &error) == RMC_PARSE_SUCCESSFUL_WITH_FIX &&
+				range_data.latitude == 52.68279591666667 && range_data.longitude == 0.5851083333333333) printf("PASSED\n"); else printf("FAILED\n");
+
+		// stream input: sentences split across chunks of any size
+		printf("*** Expect stream parse of sentences split across chunks.......");
+		char stream_str[] = "noise\r\n$GPRMC,102642.03,A,4813.7943164,S,01621.5693035,W,7.158,156.6705,020713,020.32,E*51\r\n"
+							"$GPRMC,102642.03,V,4813.7943164,N,01621.5693035,E,7.158,156.6705,020713,020.32,E*49\n";
+		int chunk_size, stream_ok = 1;
+		for (chunk_size = 1; chunk_size <= (int)strlen(stream_str); chunk_size++) {
+			stream_ok &= test_stream_input(stream_str, strlen(stream_str), chunk_size);
+		}
+		if (stream_ok) printf("PASSED\n"); else printf("FAILED\n");
+
+		// failures are counted and reported only when the stream opts in
+		printf("*** Expect failure counters and diagnostics of a stream.......");
+		char failure_str[] = "$GPRMC,102642.03,A,4813.7943164,N,1.5693035,E,7.158,156.6705,020713,020.32,E*5B\n"
+							 "$GPRMC,102642.03,V,4813.7943164,N,01621.5693035,E,7.158,156.6705,020713,020.32,E*5E\n"
+							 "$GPRMC,102642.03,V,4813.7943164,N,01621.5693035,E,7.158,156.6705,020713,020.32,E*49\n";
+		if (test_stream_failures(failure_str, strlen(failure_str))) printf("PASSED\n"); else printf("FAILED\n");
+
+		// buffer input: one sentence per call, offsets relative to the buffer
+		printf("*** Expect buffer parse of every sentence in order.......");
+		nmea_rmc_data_t buffer_fix;
+		rmc_line_result_t buffer_res;
+		size_t buffer_off = 0, consumed;
+		int buffer_ok = 1, buffer_n = 0;
+		while (parse_rmc_buffer(stream_str + buffer_off, strlen(stream_str) - buffer_off, &buffer_fix, &buffer_res, 1, &consumed)) {
+			buffer_ok &= buffer_res.result == (buffer_n == 0 ? RMC_PARSE_SUCCESSFUL_WITH_FIX : RMC_PARSE_SUCCESSFUL_WITH_NO_FIX);
+			buffer_ok &= stream_str[buffer_off + buffer_res.offset] == '$';
+			buffer_off += consumed;
+			buffer_n++;
+		}
+		if (buffer_ok && buffer_n == 2) printf("PASSED\n"); else printf("FAILED\n");
+
+		// every scan kernel supported by the CPU gives the same result
+		printf("*** Expect identical scan from every kernel.......");
+		nmea_scan_t scan_ref, scan_res;
+		int kernel, scan_ok = 1;
+		nmea_scan_select(NMEA_SCAN_KERNEL_SCALAR);
+		nmea_scan(stream_str, strlen(stream_str), &scan_ref);
+		for (kernel = NMEA_SCAN_KERNEL_SSE2; kernel < NMEA_SCAN_KERNEL_INVALID; kernel++) {
+			if (nmea_scan_select(kernel)) {
+				nmea_scan(stream_str, strlen(stream_str), &scan_res);
+				scan_ok &= !memcmp(scan_ref.commas, scan_res.commas, sizeof(scan_ref.commas)) &&
+						scan_ref.checksum == scan_res.checksum && scan_ref.has_star == scan_res.has_star;
+			}
+		}
+		nmea_scan_select(NMEA_SCAN_KERNEL_AUTO);
+		if (scan_ok) printf("PASSED\n"); else printf("FAILED\n");
+
+		// fixed-point coordinates and fraction of seconds
+		printf("*** Expect fixed-point coordinates and milliseconds.......");
+		nmea_rmc_data_t fixed_data;
+		if (parse_rmc(&fixed_data, gprmc_str1, strlen(gprmc_str1)) == RMC_PARSE_SUCCESSFUL_WITH_FIX &&
+				fixed_data.millisec == 30 &&
+				fixed_data.latitude_e7 == -482299053 && fixed_data.longitude_e7 == -163594884) printf("PASSED\n"); else printf("FAILED\n");
+
+		// a sentence not NUL-terminated ends at the buffer size
+		printf("*** Expect parse of a sentence without NUL terminator.......");
+		char unterminated_str[sizeof(gprmc_str1) + 4];
+		memcpy(unterminated_str, gprmc_str1, strlen(gprmc_str1));
+		memcpy(unterminated_str + strlen(gprmc_str1), "0000\r\n", sizeof(unterminated_str) - strlen(gprmc_str1));
+		if (parse_rmc(&fixed_data, unterminated_str, strlen(gprmc_str1)) == RMC_PARSE_SUCCESSFUL_WITH_FIX &&
+				fixed_data.latitude_e7 == -482299053) printf("PASSED\n"); else printf("FAILED\n");
+
+		// epoch milliseconds, across a leap day and the two-digit year pivot
+		printf("*** Expect epoch milliseconds of the fix time.......");
+		char epoch_str1[] = "$GPRMC,235959.999,A,4813.7943164,N,01621.5693035,E,7.158,156.6705,290200,020.32,E*68";
+		char epoch_str2[] = "$GPRMC,000000.5,A,4813.7943164,N,01621.5693035,E,7.158,156.6705,311299,020.32,E*6D";
+		nmea_rmc_data_t epoch_data1, epoch_data2;
+		if (fixed_data.epoch_ms == 1372760802030LL &&
+				parse_rmc(&epoch_data1, epoch_str1, strlen(epoch_str1)) == RMC_PARSE_SUCCESSFUL_WITH_FIX &&
+				epoch_data1.epoch_ms == 951868799999LL &&
+				parse_rmc(&epoch_data2, epoch_str2, strlen(epoch_str2)) == RMC_PARSE_SUCCESSFUL_WITH_FIX &&
+				epoch_data2.epoch_ms == 946598400500LL) printf("PASSED\n"); else printf("FAILED\n");
+
+		// hour 25, 31 February and 29 February of a common year fail; a leap second does not
+		printf("*** Expect output of out-of-range time and date.......");
+		char time_str_f1[] = "$GPRMC,251031.00,A,4813.7943164,N,01621.5693035,E,7.158,156.6705,310217,020.32,E*5B";
+		char date_str_f1[] = "$GPRMC,001031.00,A,4813.7943164,N,01621.5693035,E,7.158,156.6705,310217,020.32,E*5C";
+		char date_str_f2[] = "$GPRMC,001031.00,A,4813.7943164,N,01621.5693035,E,7.158,156.6705,290217,020.32,E*55";
+		char leap_second_str[] = "$GPRMC,235960.00,A,4813.7943164,N,01621.5693035,E,7.158,156.6705,311216,020.32,E*54";
+		char gga_time_str_f1[] = "$GPGGA,126019,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47";
+		nmea_0183_data_t range_nmea;
+		if (parse_rmc_detail(&range_data, time_str_f1, strlen(time_str_f1), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_TIME && error.offset == 7 &&
+				parse_rmc_detail(&range_data, date_str_f1, strlen(date_str_f1), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_DATE && error.offset == 65 &&
+				parse_rmc_detail(&range_data, date_str_f2, strlen(date_str_f2), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_DATE && error.offset == 65 &&
+				parse_nmea(&range_nmea, gga_time_str_f1, strlen(gga_time_str_f1), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_TIME && error.offset == 7 &&
+				parse_rmc_detail(&range_data, leap_second_str, strlen(leap_second_str), &error) == RMC_PARSE_SUCCESSFUL_WITH_FIX &&
+				range_data.epoch_ms == 1483228800000LL) printf("PASSED\n"); else printf("FAILED\n");
+
+		// sentences of other types and talkers thru the dispatcher
+		printf("*** Expect every supported sentence type and talker.......");
+		if (test_nmea_sentences()) printf("PASSED\n"); else printf("FAILED\n");
+
+		// position-only parse skips the other fields but not the checksum
+		printf("*** Expect position-only parse to skip the other fields.......");
+		char projection_str[] = "$GPRMC,102642.03,A,4813.7943164,S,01621.5693035,W,7.1x8,156.6705,020713,020.32,E*1C";
+		nmea_rmc_data_t projection_data;
+		projection_data.ground_speed = -1;
+		if (parse_rmc_detail(&projection_data, projection_str, strlen(projection_str), &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_SPEED &&
+				parse_rmc_fields(&projection_data, projection_str, strlen(projection_str), RMC_FIELD_MASK_POSITION, &error) == RMC_PARSE_SUCCESSFUL_WITH_FIX &&
+				projection_data.latitude_e7 == fixed_data.latitude_e7 && projection_data.longitude_e7 == fixed_data.longitude_e7 &&
+				projection_data.ground_speed == -1 &&
+				parse_rmc_fields(&projection_data, gprmc_str_f1, strlen(gprmc_str_f1), RMC_FIELD_MASK_POSITION, &error) == RMC_PARSE_FAILED &&
+				error.field == RMC_ERROR_CHECKSUM) printf("PASSED\n"); else printf("FAILED\n");
+
+		// binary store round trip
+		printf("*** Expect binary store to give back the fix.......");
+		if (test_store_round_trip(&fixed_data)) printf("PASSED\n"); else printf("FAILED\n");
+
+		// an indexed query finds what a scan of every fix would, decoding a few blocks
+		printf("*** Expect archive queries to find the fixes of a vehicle and time range.......");
+		if (test_archive_queries()) printf("PASSED\n"); else printf("FAILED\n");
+
+		// ingest server: each connection keeps its own partial sentence
+		printf("*** Expect ingest server to batch the fixes of each connection.......");
+		if (test_server_streams(stream_str, strlen(stream_str))) printf("PASSED\n"); else printf("FAILED\n");
+
+		// fleet index: latest fix per vehicle, radius and box queries
+		printf("*** Expect fleet index to find the vehicles nearby.......");
+		if (test_fleet_index(&fixed_data)) printf("PASSED\n"); else printf("FAILED\n");
+
+		// packed fixes and batches of columns convert both ways
+		printf("*** Expect packed fixes and fix batches to give back the fix.......");
+		if (test_packed_fixes(&fixed_data, stream_str, strlen(stream_str))) printf("PASSED\n"); else printf("FAILED\n");
+
+		// geodesic kernels agree with each other and with a known distance
+		printf("*** Expect identical track measures from every geodesic kernel.......");
+		if (test_geodesic_kernels()) printf("PASSED\n"); else printf("FAILED\n");
+
+		// geofences: point tests thru the grid, enter and exit events
+		printf("*** Expect geofence engine to match a brute-force test and report transitions.......");
+		if (test_geofence_engine()) printf("PASSED\n"); else printf("FAILED\n");
+
+		// simplified tracks stay within the tolerance of every fix
+		printf("*** Expect simplified tracks within the tolerance of every fix.......");
+		if (test_track_simplification(&fixed_data)) printf("PASSED\n"); else printf("FAILED\n");
+
+		// generated traffic parses back to the fixes, no fixes and failures it was made of
+		printf("*** Expect generated fleet traffic to parse as generated.......");
+		if (test_fleet_generator()) printf("PASSED\n"); else printf("FAILED\n");
+
+		// the instrumentation counts what the parsers report, or stays zero when compiled out
+		printf("*** Expect parse metrics to count every sentence.......");
+		if (test_parse_metrics()) printf("PASSED\n"); else printf("FAILED\n");
+
+		// gzip and zstd input reads back as the text it was made of, or is told apart when not built in
+		printf("*** Expect compressed input to read as the plain text.......");
+		if (test_compressed_input()) printf("PASSED\n"); else printf("FAILED\n");
+
+		// the C++ schema decoders give what the C parser gives, sentence for sentence
+		printf("*** Expect schema decoders to decode as the parser.......");
+		const char *schema_sentences[] = {
+			gprmc_str1, gprmc_str2, gprmc_str_f1, gprmc_str_f2, gprmc_str_f3,
+			gprmc_str_f4, gprmc_str_f5, gprmc_str_f6, gprmc_str_pole, gprmc_str_rounded, epoch_str1, epoch_str2, projection_str,
+			time_str_f1, date_str_f1, date_str_f2, leap_second_str, gga_time_str_f1,
+			"$GPGGA,123519,4807.038,N,01131.000,E,0,08,0.9,545.4,M,46.9,M,,*46",
+			"$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,N*2A",
+			"$GPGLL,4916.45,N,12311.12,W,225444.5,V,A*50",
+		};
+		if (test_schema_decoders(schema_sentences, sizeof(schema_sentences) / sizeof(schema_sentences[0])) &&
+				test_schema_decoders(nmea_sentences, sizeof(nmea_sentences) / sizeof(nmea_sentences[0])))
+			printf("PASSED\n"); else printf("FAILED\n");
 	} else if (argc == 2) {
-		// generate random RMC sentences to a file
+		// generate random RMC sentences of a vehicle to a file
 		FILE *output_stream = fopen(argv[1], "w");
 		if (!output_stream) {
 			printf("Failed to open output file %s!\n", argv[1]);
@@ -93,55 +480,33 @@ int main(int argc, char **argv)
 		}
 
 		int i = 300;
-		struct tm tm;
-		time_t t_start = time(NULL);
-		double latitude = 3623.3452323;
-		double longitude = -12478.242425;
-		double speed = 3.728;
-		double heading = 54.0897;
-		double magnetic_var = 12.4368;
+		nmea_generator_t gen;
+		if (nmea_generator_init(&gen, 1, (int64_t)time(NULL) * 1000, time(NULL))) {
+			printf("Failed to allocate the generator!\n");
+			exit(-1);
+		}
+		nmea_generator_set_rates(&gen, 20, 0, 0);
 
 		while (i--) {
-			char buffer[256];
-
-			gmtime_r(&t_start, &tm);
-			int len = sprintf(buffer, "$GPRMC,%02d%02d%02d.%02d,%c,%.6f,%c,%.6f,%c,%.3f,%.4f,%02d%02d%02d,%.2f,%c*",
-					tm.tm_hour, tm.tm_min, tm.tm_sec, 0,
-					(float)rand()/(float)RAND_MAX > 0.8 ? 'V' : 'A',
-					fabs(latitude), latitude > 0 ? 'N' : 'S',
-					fabs(longitude), longitude > 0 ? 'E' : 'W',
-					fabs(speed), fabs(heading), 
-					tm.tm_mon + 1, tm.tm_mday, tm.tm_year - 100,
-					fabs(magnetic_var), magnetic_var > 0 ? 'E' : 'W');
-
-			// calculate checksum
-			char checksum = 0;
-			char *p = buffer + 1;
-			while (*p != '*') {
-				checksum ^= *p++;
-			}
-			sprintf(buffer + len, "%02X", checksum);
+			char buffer[NMEA_GENERATOR_MAX_SENTENCE];
 
-			// advance time
-			t_start += 5;
-
-			// add random variation to parameters
-			latitude += 0.02 * ((float)rand()/(float)RAND_MAX) * ((float)rand()/(float)RAND_MAX > 0.5 ? 1 : -1);
-			longitude += 0.02 * ((float)rand()/(float)RAND_MAX) * ((float)rand()/(float)RAND_MAX > 0.5 ? 1 : -1);
-			speed += 2 * ((float)rand()/(float)RAND_MAX) * ((float)rand()/(float)RAND_MAX > 0.5 ? 1 : -1);
-			heading += 0.02 * ((float)rand()/(float)RAND_MAX) * ((float)rand()/(float)RAND_MAX > 0.5 ? 1 : -1);
-
-			fprintf(output_stream, "%s\n", buffer);
+			fwrite(buffer, 1, nmea_generator_sentence(&gen, 0, buffer), output_stream);
 		}
 
+		nmea_generator_destroy(&gen);
 		fclose(output_stream);
 	} else {
-		// open input RMC stream file
-		FILE *input_stream = fopen(argv[1], "r");
-		if (!input_stream) {
+		// open input RMC stream file, compressed or not
+		nmea_source_t source;
+		int fd = open(argv[1], O_RDONLY);
+		if (fd < 0) {
 			printf("Failed to open input file %s!\n", argv[1]);
 			exit(-1);
 		}
+		if (nmea_source_open(&source, fd, 1)) {
+			printf("Failed to read %s input file %s!\n", nmea_source_format_name(source.format), argv[1]);
+			exit(-1);
+		}
 		// open output log file
 		FILE *output_stream = fopen(argv[2], "w");
 		if (!output_stream) {
@@ -150,29 +515,26 @@ int main(int argc, char **argv)
 		}
 		
 		// go thru the input stream to output valid GPS fix
-		char line[256];
-		int num_of_sentences = 0, num_of_fixes = 0;
-		do {
-			int len = readline(input_stream, line, sizeof(line));
-			if (len == 0) {
+		static char chunk[INPUT_CHUNK_SIZE];
+		file_parse_state_t state = { output_stream, 0, 0 };
+		nmea_stream_t stream;
+		nmea_stream_init(&stream, on_file_sentence, &state);
+		nmea_stream_set_fields(&stream, RMC_FIELD_MASK_POSITION);
+		while (state.num_of_fixes < MAX_FIXES_TO_OUTPUT) {
+			ssize_t len = nmea_source_read(&source, chunk, sizeof(chunk));
+			if (len <= 0) {
 				break;
 			}
-			
-			num_of_sentences++;
-			
-			nmea_rmc_data_t rmc_data;
-			rmc_parse_result parse_res = parse_rmc(&rmc_data, line, len);
-			if (parse_res == RMC_PARSE_SUCCESSFUL_WITH_FIX) {
-				num_of_fixes++;
-				fprintf(output_stream, "%02d:%02d:%02d, %.6f, %.6f\n", 
-						rmc_data.hour, rmc_data.min, rmc_data.sec,
-						rmc_data.latitude, rmc_data.longitude);
-			}
-		} while (num_of_fixes < 100);
+			nmea_stream_feed(&stream, chunk, len);
+		}
+		// a last sentence may lack its line feed
+		nmea_stream_feed(&stream, "\n", 1);
 		
+		int num_of_sentences = state.num_of_sentences, num_of_fixes = state.num_of_fixes;
 		printf("Done!");
 		printf("\tParsed %d sentences to obtain %d fixes\n", num_of_sentences, num_of_fixes);
-		fclose(input_stream);
+		nmea_source_close(&source);
+		close(fd);
 		fclose(output_stream);
 	}
 	
@@ -187,8 +549,35 @@ static void usage(char *arg)
 {
 	printf("%s [output_file]\n", arg);
 	printf("    Generate random RMC data to output_file\n");
+	printf("%s -G vehicles sentences threads output_file [void corrupt other]\n", arg);
+	printf("    Generate sentences of a fleet of vehicles on threads (0 for one per CPU) to output_file\n");
+	printf("    (- for stdout), with the given percentages of sentences without a fix, corrupted,\n");
+	printf("    and of GGA/VTG/GLL rather than RMC (%d, %d, %d)\n", GENERATOR_PCT_VOID, GENERATOR_PCT_CORRUPT,
+			GENERATOR_PCT_OTHER);
 	printf("%s [input_file output_file]\n", arg);
-	printf("    Parse RMC sentences from input_file and give valid time/lat/long to output_file\n");
+	printf("    Parse RMC sentences from input_file, gzip or zstd compressed or not, and give valid\n");
+	printf("    time/lat/long to output_file\n");
+	printf("%s -m input_file output_file\n", arg);
+	printf("    Same as above for all sentences, input_file is memory-mapped\n");
+	printf("%s -p threads input_file output_file\n", arg);
+	printf("    Same as -m, parsed on threads (0 for one per CPU)\n");
+	printf("%s -P parsers input_file output_file [decoders]\n", arg);
+	printf("    Same as -m, read, parsed and written by pipelined threads; input_file may be - for stdin,\n");
+	printf("    and gzip or zstd compressed, the frames of zstd decoded on decoders threads (1)\n");
+	printf("%s -b input_file store_file\n", arg);
+	printf("    Same as -m, all valid fixes go to the binary store_file\n");
+	printf("%s -r store_file output_file\n", arg);
+	printf("    Decode binary store_file and give valid time/lat/long to output_file\n");
+	printf("%s -S address [store_file]\n", arg);
+	printf("    Serve receiver streams on address (a UNIX socket path, or a loopback TCP port)\n");
+	printf("    until all connections are closed, then report the ingest rate; the fixes of every\n");
+	printf("    connection go to store_file and its index, if given\n");
+	printf("%s -q store_file vehicle from to output_file\n", arg);
+	printf("    Give the fixes of vehicle between the UTC epoch seconds from and to in a -S store_file\n");
+	printf("    to output_file\n");
+	printf("%s -L address streams sentences [threads]\n", arg);
+	printf("    Open streams connections to a -S server and send sentences RMC sentences of a vehicle on each,\n");
+	printf("    from threads (1)\n");
 }
 
 static void print_rmc_data(nmea_rmc_data_t *data) 
@@ -201,11 +590,11 @@ static void print_rmc_data(nmea_rmc_data_t *data)
 			data->magnetic_var);
 }
 
-static rmc_parse_result test_rmc_input(const char *buf, int buf_size)
+static rmc_parse_result test_rmc_input(const char *buf, int buf_size, rmc_error_detail_t *error)
 {
 	nmea_rmc_data_t rmc_data;
 	
-	rmc_parse_result parse_res = parse_rmc(&rmc_data, buf, buf_size);
+	rmc_parse_result parse_res = parse_rmc_detail(&rmc_data, buf, buf_size, error);
 	switch (parse_res) {
 		case RMC_PARSE_SUCCESSFUL_WITH_FIX:
 			printf("Valid RMC with fix\n");
@@ -215,6 +604,7 @@ static rmc_parse_result test_rmc_input(const char *buf, int buf_size)
 			printf("Valid RMC with no fix\n");
 			break;
 		case RMC_PARSE_FAILED:
+			printf("Invalid %s at byte %u\n", rmc_parse_error_name(error->field), error->offset);
 			break;
 		default:
 			printf("Unknow input\n");
@@ -223,26 +613,1598 @@ static rmc_parse_result test_rmc_input(const char *buf, int buf_size)
 	return parse_res;
 }
 
-static int readline(FILE *f, char *buf, int len)
+static int test_nmea_sentences(void)
+{
+	enum { SENTENCES = sizeof(nmea_sentences) / sizeof(nmea_sentences[0]) };
+	const char *const *sentences = nmea_sentences;
+	nmea_0183_data_t data[SENTENCES];
+	rmc_parse_result results[SENTENCES];
+	rmc_error_detail_t error[SENTENCES];
+	nmea_rmc_data_t rmc_data;
+	int i;
+
+	for (i = 0; i < SENTENCES; i++) {
+		results[i] = parse_nmea(&data[i], sentences[i], strlen(sentences[i]), &error[i]);
+	}
+
+	return results[0] == RMC_PARSE_SUCCESSFUL_WITH_FIX && data[0].talker == NMEA_TALKER_GN &&
+			data[0].type == NMEA_SENTENCE_RMC && data[0].rmcData.latitude_e7 == -482299053 &&
+			// parse_rmc() takes RMC of any talker
+			parse_rmc(&rmc_data, sentences[0], strlen(sentences[0])) == RMC_PARSE_SUCCESSFUL_WITH_FIX &&
+			results[1] == RMC_PARSE_SUCCESSFUL_WITH_FIX && data[1].type == NMEA_SENTENCE_GGA &&
+			data[1].ggaData.quality == 1 && data[1].ggaData.satellites == 8 &&
+			data[1].ggaData.latitude_e7 == 481173000 && data[1].ggaData.altitude == 545.4 &&
+			results[2] == RMC_PARSE_SUCCESSFUL_WITH_FIX && data[2].type == NMEA_SENTENCE_VTG &&
+			data[2].vtgData.track_true == 54.7 && data[2].vtgData.speed_kmh == 10.2 &&
+			results[3] == RMC_PARSE_SUCCESSFUL_WITH_FIX && data[3].type == NMEA_SENTENCE_GLL &&
+			data[3].gllData.longitude_e7 == -1231853333 && data[3].gllData.hour == 22 &&
+			results[4] == RMC_PARSE_SUCCESSFUL_WITH_FIX && data[4].type == NMEA_SENTENCE_GSA &&
+			data[4].gsaData.fix_type == 3 && data[4].gsaData.num_satellites == 5 && data[4].gsaData.prn[4] == 24 &&
+			results[5] == RMC_PARSE_SUCCESSFUL_WITH_NO_FIX && data[5].type == NMEA_SENTENCE_GSV &&
+			data[5].gsvData.num_satellites == 4 && data[5].gsvData.satellites[3].azimuth == 228 &&
+			results[6] == RMC_PARSE_FAILED && error[6].field == RMC_ERROR_HEADER &&
+			// NMEA 2.3 RMC: empty magnetic variation, then the mode
+			results[7] == RMC_PARSE_SUCCESSFUL_WITH_FIX && data[7].rmcData.mode == 'A' &&
+			data[7].rmcData.magnetic_var == 0 && data[7].rmcData.latitude_e7 == 440689988 &&
+			data[7].rmcData.longitude_e7 == -1213143372 && data[7].rmcData.epoch_ms == 1484007031000LL &&
+			results[8] == RMC_PARSE_SUCCESSFUL_WITH_FIX && data[8].rmcData.mode == 0 &&
+			data[8].rmcData.magnetic_var == 0 &&
+			results[9] == RMC_PARSE_SUCCESSFUL_WITH_FIX && data[9].rmcData.mode == 'D' &&
+			data[9].rmcData.magnetic_var == 14.2 &&
+			results[10] == RMC_PARSE_SUCCESSFUL_WITH_NO_FIX && data[10].rmcData.mode == 'N' &&
+			results[11] == RMC_PARSE_SUCCESSFUL_WITH_NO_FIX && data[11].rmcData.status == 'V' &&
+			// NMEA 4.10 RMC: the navigational status after the mode
+			results[12] == RMC_PARSE_SUCCESSFUL_WITH_FIX && data[12].rmcData.mode == 'A' &&
+			data[12].rmcData.nav_status == 'V' && data[12].rmcData.latitude_e7 == 440689988 &&
+			data[7].rmcData.nav_status == 0 &&
+			results[13] == RMC_PARSE_SUCCESSFUL_WITH_FIX && data[13].rmcData.mode == 'D' &&
+			data[13].rmcData.nav_status == 'S' && data[13].rmcData.magnetic_var == 14.2 &&
+			results[14] == RMC_PARSE_FAILED && error[14].field == RMC_ERROR_STATUS;
+}
+
+static int test_stream_input(const char *buf, int buf_size, int chunk_size)
+{
+	stream_test_state_t state;
+	nmea_stream_t stream;
+	int i;
+
+	memset(&state, 0, sizeof(state));
+	nmea_stream_init(&stream, on_stream_test_sentence, &state);
+	for (i = 0; i < buf_size; i += chunk_size) {
+		nmea_stream_feed(&stream, buf + i, buf_size - i < chunk_size ? buf_size - i : chunk_size);
+	}
+
+	return state.results[RMC_PARSE_SUCCESSFUL_WITH_FIX] == 1 &&
+			state.results[RMC_PARSE_SUCCESSFUL_WITH_NO_FIX] == 1 &&
+			state.results[RMC_PARSE_FAILED] == 0;
+}
+
+static void on_stream_test_sentence(const nmea_rmc_data_t *data, rmc_parse_result result, void *user_data)
+{
+	stream_test_state_t *state = user_data;
+
+	if (result == RMC_PARSE_SUCCESSFUL_WITH_FIX && data->sec != 42) {
+		result = RMC_PARSE_FAILED;
+	}
+	state->results[result]++;
+}
+
+static int test_stream_failures(const char *buf, int buf_size)
 {
-    char c;
-    int i = 0;
+	nmea_error_counters_t counters;
+	nmea_stream_t stream;
+	int reported = 0;
 
-    do {
-		fread(&c, 1, 1, f);
-		if (feof(f)) 	{	break;	}
-		buf[i++] = c;
-    } while (i < len && c != '\n');
+	memset(&counters, 0, sizeof(counters));
+	nmea_stream_init(&stream, NULL, NULL);
+	nmea_stream_set_diagnostics(&stream, &counters, on_stream_failure, &reported);
+	nmea_stream_feed(&stream, buf, buf_size);
 
-	if (feof(f)) {
-		i++;
+	return reported == 2 &&
+			nmea_error_count(&counters, RMC_ERROR_LONGITUDE) == 1 &&
+			nmea_error_count(&counters, RMC_ERROR_CHECKSUM) == 1 &&
+			nmea_error_count(&counters, RMC_ERROR_LATITUDE) == 0;
+}
+
+static void on_stream_failure(const char *sentence, size_t len, const rmc_error_detail_t *error, void *user_data)
+{
+	int *reported = user_data;
+
+	// the offset points into the reported sentence
+	if (sentence && error->offset < len) {
+		(*reported)++;
 	}
+}
+
+static void on_file_sentence(const nmea_rmc_data_t *data, rmc_parse_result result, void *user_data)
+{
+	file_parse_state_t *state = user_data;
 
-	if (c == '\n') {
-		buf[--i] = '\0';
+	if (state->num_of_fixes >= MAX_FIXES_TO_OUTPUT) {
+		return;
 	}
-	
-    return i;
+
+	state->num_of_sentences++;
+	if (result == RMC_PARSE_SUCCESSFUL_WITH_FIX) {
+		state->num_of_fixes++;
+		fprintf(state->output_stream, "%02d:%02d:%02d, %.6f, %.6f\n", 
+				data->hour, data->min, data->sec,
+				data->latitude, data->longitude);
+	}
+}
+
+static int test_store_round_trip(const nmea_rmc_data_t *fix)
+{
+	static nmea_store_writer_t writer;
+	static nmea_fix_columns_t columns;
+	const nmea_store_block_header_t *header;
+	nmea_store_reader_t reader;
+	nmea_rmc_data_t decoded;
+	char path[] = "/tmp/rmc_store_XXXXXX";
+	int i, ok = 1;
+
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return 0;
+	}
+	close(fd);
+
+	// more than one block
+	nmea_store_create(&writer, path);
+	for (i = 0; i < NMEA_STORE_BLOCK_SIZE + 1; i++) {
+		nmea_store_append(&writer, fix);
+	}
+	nmea_store_close(&writer);
+
+	nmea_store_map(&reader, path);
+	for (i = 0; (header = nmea_store_next_block(&reader)); i++) {
+		ok &= nmea_store_decode_block(header, &columns) == (i == 0 ? NMEA_STORE_BLOCK_SIZE : 1);
+		nmea_fix_columns_get(&columns, 0, &decoded);
+		ok &= decoded.latitude_e7 == fix->latitude_e7 && decoded.longitude_e7 == fix->longitude_e7 &&
+				decoded.hour == fix->hour && decoded.min == fix->min && decoded.sec == fix->sec &&
+				decoded.millisec == fix->millisec && decoded.day == fix->day &&
+				decoded.month == fix->month && decoded.year == fix->year &&
+				decoded.ground_speed == fix->ground_speed && decoded.heading == fix->heading &&
+				decoded.magnetic_var == fix->magnetic_var;
+	}
+	nmea_store_unmap(&reader);
+	unlink(path);
+	ok &= i == 2;
+
+	// a block that fails to be written stays pending
+	if (!nmea_store_create(&writer, "/dev/full")) {
+		nmea_rmc_data_t moved = *fix;
+		int failed = 0;
+
+		for (i = 0; i < NMEA_STORE_BLOCK_SIZE; i++) {
+			moved.latitude_e7 = fix->latitude_e7 + (i * 7919) % 100003;
+			failed += nmea_store_append(&writer, &moved) != 0;
+		}
+		ok &= failed == 1 && writer.pending.count == NMEA_STORE_BLOCK_SIZE;
+		ok &= nmea_store_append(&writer, fix) == -1 && writer.pending.count == NMEA_STORE_BLOCK_SIZE;
+		ok &= nmea_store_close(&writer) == -1;
+	} else {
+		ok = 0;
+	}
+
+	return ok;
+}
+
+static const char *map_input_file(const char *input_file, size_t *len)
+{
+	struct stat st;
+	const char *buf = NULL;
+
+	// map the whole input RMC file
+	int fd = open(input_file, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		printf("Failed to open input file %s!\n", input_file);
+		exit(-1);
+	}
+	if (st.st_size > 0) {
+		buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (buf == MAP_FAILED) {
+			printf("Failed to map input file %s!\n", input_file);
+			exit(-1);
+		}
+		madvise((void *)buf, st.st_size, MADV_SEQUENTIAL);
+	}
+	close(fd);
+
+	*len = st.st_size;
+	return buf;
+}
+
+static void write_fixes(FILE *output_stream, const nmea_rmc_data_t *fixes, const rmc_line_result_t *results, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (results[i].result == RMC_PARSE_SUCCESSFUL_WITH_FIX) {
+			fprintf(output_stream, "%02d:%02d:%02d, %.6f, %.6f\n", 
+					fixes[i].hour, fixes[i].min, fixes[i].sec,
+					fixes[i].latitude, fixes[i].longitude);
+		}
+	}
+}
+
+static void on_parallel_batch(const nmea_rmc_data_t *data, const rmc_line_result_t *results, size_t count, void *user_data)
+{
+	write_fixes(user_data, data, results, count);
+}
+
+static int parse_mapped_file(const char *input_file, const char *output_file)
+{
+	static nmea_rmc_data_t fixes[MAPPED_BATCH_SIZE];
+	static rmc_line_result_t results[MAPPED_BATCH_SIZE];
+	nmea_parse_stats_t stats;
+	size_t len, offset = 0, consumed, n;
+
+	const char *buf = map_input_file(input_file, &len);
+	// open output log file
+	FILE *output_stream = fopen(output_file, "w");
+	if (!output_stream) {
+		printf("Failed to open output file %s!\n", output_file);
+		exit(-2);
+	}
+
+	// go thru the mapped file batch by batch to output valid GPS fix
+	memset(&stats, 0, sizeof(stats));
+	while (offset < len) {
+		n = parse_rmc_buffer_fields(buf + offset, len - offset, RMC_FIELD_MASK_POSITION,
+				fixes, results, MAPPED_BATCH_SIZE, &consumed);
+		write_fixes(output_stream, fixes, results, n);
+		nmea_parse_stats_add(&stats, results, n);
+		offset += consumed;
+	}
+
+	printf("Done!");
+	printf("\tParsed %zu sentences to obtain %zu fixes\n", stats.sentences, stats.fixes);
+	if (buf) {
+		munmap((void *)buf, len);
+	}
+	fclose(output_stream);
+	print_metrics();
+
+	return 0;
+}
+
+static int parse_file_in_parallel(int num_threads, const char *input_file, const char *output_file)
+{
+	nmea_parse_stats_t stats;
+	size_t len;
+
+	const char *buf = map_input_file(input_file, &len);
+	// open output log file
+	FILE *output_stream = fopen(output_file, "w");
+	if (!output_stream) {
+		printf("Failed to open output file %s!\n", output_file);
+		exit(-2);
+	}
+
+	if (parse_rmc_parallel(buf, len, num_threads, on_parallel_batch, output_stream, &stats)) {
+		printf("Failed to start parser threads!\n");
+		exit(-3);
+	}
+
+	printf("Done!");
+	printf("\tParsed %zu sentences to obtain %zu fixes, %zu without fix, %zu failed\n",
+			stats.sentences, stats.fixes, stats.no_fixes, stats.failures);
+	for (int e = RMC_ERROR_NONE + 1; e < RMC_ERROR_CODE_INVALID; e++) {
+		if (stats.errors[e]) {
+			printf("\t\t%zu invalid %s\n", stats.errors[e], rmc_parse_error_name(e));
+		}
+	}
+	if (buf) {
+		munmap((void *)buf, len);
+	}
+	fclose(output_stream);
+	print_metrics();
+
+	return 0;
+}
+
+static int parse_file_in_pipeline(int num_parsers, int num_decoders, const char *input_file, const char *output_file)
+{
+	static char output_buffer[1024 * 1024];
+	nmea_parse_stats_t stats;
+	nmea_source_t source;
+	int fd = STDIN_FILENO;
+
+	if (strcmp(input_file, "-")) {
+		fd = open(input_file, O_RDONLY);
+		if (fd < 0) {
+			printf("Failed to open input file %s!\n", input_file);
+			exit(-1);
+		}
+	}
+	// open output log file
+	FILE *output_stream = fopen(output_file, "w");
+	if (!output_stream) {
+		printf("Failed to open output file %s!\n", output_file);
+		exit(-2);
+	}
+	setvbuf(output_stream, output_buffer, _IOFBF, sizeof(output_buffer));
+
+	if (nmea_source_open(&source, fd, num_decoders)) {
+		printf("Failed to read %s input file %s!%s\n", nmea_source_format_name(source.format), input_file,
+				nmea_source_supported(source.format) ? "" : " Not built in.");
+		exit(-1);
+	}
+
+	if (nmea_pipeline_run_source(&source, num_parsers, RMC_FIELD_MASK_POSITION, on_parallel_batch, output_stream,
+			&stats)) {
+		printf("Failed to run the parser pipeline!\n");
+		exit(-3);
+	}
+
+	printf("Done!");
+	printf("\tParsed %zu sentences to obtain %zu fixes, %zu without fix, %zu failed\n",
+			stats.sentences, stats.fixes, stats.no_fixes, stats.failures);
+	if (source.format != NMEA_SOURCE_PLAIN) {
+		printf("\t%s input of %.1f MB to %.1f MB\n", nmea_source_format_name(source.format),
+				source.bytes_in / 1e6, source.bytes_out / 1e6);
+	}
+	nmea_source_close(&source);
+	if (fd != STDIN_FILENO) {
+		close(fd);
+	}
+	fclose(output_stream);
+	print_metrics();
+
+	return 0;
+}
+
+static int parse_file_to_store(const char *input_file, const char *store_file)
+{
+	static nmea_rmc_data_t fixes[MAPPED_BATCH_SIZE];
+	static rmc_line_result_t results[MAPPED_BATCH_SIZE];
+	static nmea_store_writer_t writer;
+	nmea_parse_stats_t stats;
+	size_t len, offset = 0, consumed, n, i;
+
+	const char *buf = map_input_file(input_file, &len);
+	if (nmea_store_create(&writer, store_file)) {
+		printf("Failed to open output file %s!\n", store_file);
+		exit(-2);
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	while (offset < len) {
+		n = parse_rmc_buffer(buf + offset, len - offset, fixes, results, MAPPED_BATCH_SIZE, &consumed);
+		for (i = 0; i < n; i++) {
+			if (results[i].result == RMC_PARSE_SUCCESSFUL_WITH_FIX && nmea_store_append(&writer, &fixes[i])) {
+				printf("Failed to write output file %s!\n", store_file);
+				exit(-2);
+			}
+		}
+		nmea_parse_stats_add(&stats, results, n);
+		offset += consumed;
+	}
+	if (nmea_store_close(&writer)) {
+		printf("Failed to write output file %s!\n", store_file);
+		exit(-2);
+	}
+
+	printf("Done!");
+	printf("\tParsed %zu sentences to obtain %zu fixes\n", stats.sentences, stats.fixes);
+	if (buf) {
+		munmap((void *)buf, len);
+	}
+
+	return 0;
+}
+
+static int decode_store_file(const char *store_file, const char *output_file)
+{
+	static nmea_fix_columns_t columns;
+	const nmea_store_block_header_t *header;
+	nmea_store_reader_t reader;
+	nmea_rmc_data_t fix;
+	size_t num_of_blocks = 0, num_of_fixes = 0, i;
+
+	if (nmea_store_map(&reader, store_file)) {
+		printf("Failed to open store file %s!\n", store_file);
+		exit(-1);
+	}
+	// open output log file
+	FILE *output_stream = fopen(output_file, "w");
+	if (!output_stream) {
+		printf("Failed to open output file %s!\n", output_file);
+		exit(-2);
+	}
+
+	while ((header = nmea_store_next_block(&reader))) {
+		if (nmea_store_decode_block(header, &columns) < 0) {
+			printf("Corrupted block in %s!\n", store_file);
+			break;
+		}
+		for (i = 0; i < columns.count; i++) {
+			nmea_fix_columns_get(&columns, i, &fix);
+			fprintf(output_stream, "%02d:%02d:%02d, %.6f, %.6f\n", 
+					fix.hour, fix.min, fix.sec, fix.latitude, fix.longitude);
+		}
+		num_of_blocks++;
+		num_of_fixes += columns.count;
+	}
+
+	printf("Done!");
+	printf("\tDecoded %zu blocks to obtain %zu fixes\n", num_of_blocks, num_of_fixes);
+	nmea_store_unmap(&reader);
+	fclose(output_stream);
+
+	return 0;
+}
+
+static void on_archive_fixes(uint32_t vehicle, const nmea_rmc_data_t *fixes, size_t count, void *user_data)
+{
+	archive_query_t *query = user_data;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		const nmea_rmc_data_t *fix = &fixes[i];
+
+		if (query->output_stream) {
+			fprintf(query->output_stream, "20%02d-%02d-%02d %02d:%02d:%02d, %.6f, %.6f, %.3f, %.4f\n",
+					fix->year, fix->month, fix->day, fix->hour, fix->min, fix->sec,
+					fix->latitude, fix->longitude, fix->ground_speed, fix->heading);
+		}
+		if (query->expected) {
+			const nmea_rmc_data_t *expected = &query->expected[query->found + i];
+
+			query->mismatch |= fix->epoch_ms != expected->epoch_ms || fix->latitude_e7 != expected->latitude_e7 ||
+					fix->longitude_e7 != expected->longitude_e7;
+		}
+	}
+	query->found += count;
+}
+
+static int test_archive_queries(void)
+{
+	enum { ARCHIVE_VEHICLES = 20, ARCHIVE_ROUNDS = 300, LONG_TRACK = 10000, ARCHIVE_BATCH = 8192 };
+	static nmea_rmc_data_t fixes[ARCHIVE_VEHICLES][ARCHIVE_ROUNDS], track[LONG_TRACK];
+	static nmea_archive_writer_t writer;
+	static const struct { uint32_t vehicle; int from; int to; } ranges[] = {
+		{ 0, 0, ARCHIVE_ROUNDS - 1 }, { 7, 100, 100 }, { 19, 37, 251 }, { 3, -50, 10 }, { 5, ARCHIVE_ROUNDS, 1000 },
+		{ ARCHIVE_VEHICLES, 1000, 9500 }, { ARCHIVE_VEHICLES, 6280, 6300 }
+	};
+	nmea_archive_reader_t reader;
+	nmea_generator_t gen;
+	archive_query_t query;
+	rmc_error_detail_t error;
+	char path[] = "/tmp/rmc_archive_XXXXXX", sentence[NMEA_GENERATOR_MAX_SENTENCE];
+	const nmea_rmc_data_t *expected;
+	size_t v, i, count, first;
+	int ok = 0, fd, n;
+
+	fd = mkstemp(path);
+	if (fd < 0) {
+		return 0;
+	}
+	close(fd);
+
+	// vehicles reporting together, then a track of more than a block in a batch
+	ASSERT_RMC(!nmea_generator_init(&gen, ARCHIVE_VEHICLES + 1, 1372809500000LL, 22), "generator not allocated ",
+			archive_bailout);
+	ASSERT_RMC(!nmea_archive_create(&writer, path, ARCHIVE_BATCH), "archive not created ", archive_cleanup);
+	for (i = 0; i < ARCHIVE_ROUNDS; i++) {
+		for (v = 0; v < ARCHIVE_VEHICLES; v++) {
+			n = nmea_generator_sentence(&gen, v, sentence);
+			parse_rmc_detail(&fixes[v][i], sentence, n, &error);
+			nmea_archive_append(&writer, v, &fixes[v][i]);
+		}
+	}
+	for (i = 0; i < LONG_TRACK; i++) {
+		n = nmea_generator_sentence(&gen, ARCHIVE_VEHICLES, sentence);
+		parse_rmc_detail(&track[i], sentence, n, &error);
+		nmea_archive_append(&writer, ARCHIVE_VEHICLES, &track[i]);
+	}
+	ASSERT_RMC(!nmea_archive_close(&writer), "archive not written ", archive_cleanup);
+
+	// fixes i of a vehicle are 1 s apart from its first
+	ASSERT_RMC(!nmea_archive_map(&reader, path), "archive not mapped ", archive_cleanup);
+	for (i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+		v = ranges[i].vehicle;
+		expected = v < ARCHIVE_VEHICLES ? fixes[v] : track;
+		first = ranges[i].from < 0 ? 0 : ranges[i].from;
+		count = first < (v < ARCHIVE_VEHICLES ? ARCHIVE_ROUNDS : LONG_TRACK) ? ranges[i].to + 1 - first : 0;
+		memset(&query, 0, sizeof(query));
+		query.expected = expected + first;
+		n = nmea_archive_query(&reader, v, expected[0].epoch_ms + ranges[i].from * 1000LL,
+				expected[0].epoch_ms + ranges[i].to * 1000LL, on_archive_fixes, &query);
+		ASSERT_RMC(n == (int)count && query.found == count && !query.mismatch, "fixes not found ", archive_unmap);
+	}
+	ASSERT_RMC(nmea_archive_query(&reader, ARCHIVE_VEHICLES + 1, INT64_MIN, INT64_MAX, on_archive_fixes, &query) == 0,
+			"unknown vehicle found ", archive_unmap);
+
+	// the one second range of a vehicle decodes a single block
+	i = reader.stats.blocks;
+	nmea_archive_query(&reader, 11, fixes[11][150].epoch_ms, fixes[11][150].epoch_ms, on_archive_fixes, &query);
+	ok = reader.stats.blocks == i + 1;
+
+archive_unmap:
+	nmea_archive_unmap(&reader);
+archive_cleanup:
+	nmea_generator_destroy(&gen);
+archive_bailout:
+	unlink(path);
+	strcat(path, NMEA_ARCHIVE_INDEX_SUFFIX);
+	unlink(path);
+	return ok;
+}
+
+static int query_archive(const char *store_file, uint32_t vehicle, int64_t from_s, int64_t to_s, const char *output_file)
+{
+	nmea_archive_reader_t reader;
+	archive_query_t query;
+	struct timespec start;
+	int n;
+
+	if (nmea_archive_map(&reader, store_file)) {
+		printf("Failed to open store file %s!\n", store_file);
+		exit(-1);
+	}
+	memset(&query, 0, sizeof(query));
+	query.output_stream = fopen(output_file, "w");
+	if (!query.output_stream) {
+		printf("Failed to open output file %s!\n", output_file);
+		exit(-2);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	n = nmea_archive_query(&reader, vehicle, from_s * 1000, to_s * 1000 + 999, on_archive_fixes, &query);
+	double seconds = elapsed_seconds(&start);
+	if (n < 0) {
+		printf("Corrupted archive %s!\n", store_file);
+		exit(-3);
+	}
+
+	printf("Done!");
+	printf("\tFound %d fixes of vehicle %u in %.3f ms, decoding %llu of %zu blocks\n", n, vehicle, seconds * 1e3,
+			(unsigned long long)reader.stats.blocks, reader.num_entries);
+	nmea_archive_unmap(&reader);
+	fclose(query.output_stream);
+
+	return 0;
+}
+
+static int start_generators(generator_thread_t *threads, int num_threads, size_t vehicles, size_t sentences,
+		const unsigned int *rates, void *(*run)(void *))
+{
+	int64_t start_ms = (int64_t)time(NULL) * 1000;
+	int i;
+
+	// a share of the vehicles each, and of the sentences in proportion
+	for (i = 0; i < num_threads; i++) {
+		generator_thread_t *thread = &threads[i];
+		size_t first = vehicles * i / num_threads, last = vehicles * (i + 1) / num_threads;
+
+		if (nmea_generator_init(&thread->gen, last - first, start_ms, i + 1)) {
+			return -1;
+		}
+		nmea_generator_set_rates(&thread->gen, rates[0], rates[1], rates[2]);
+		thread->first_vehicle = first;
+		thread->sentences = sentences * last / vehicles - sentences * first / vehicles;
+	}
+	for (i = 0; i < num_threads; i++) {
+		if (pthread_create(&threads[i].thread, NULL, run, &threads[i])) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void *generate_to_file(void *arg)
+{
+	generator_thread_t *thread = arg;
+	char *chunk = malloc(GENERATOR_CHUNK_SIZE);
+	size_t left = thread->sentences;
+
+	thread->failed = !chunk;
+	while (left && !thread->failed) {
+		uint64_t before = thread->gen.stats.sentences;
+		size_t len = nmea_generator_fill(&thread->gen, chunk, GENERATOR_CHUNK_SIZE, left), done = 0;
+
+		left -= thread->gen.stats.sentences - before;
+
+		// whole chunks, so that the sentences of threads never interleave
+		pthread_mutex_lock(thread->lock);
+		while (done < len) {
+			ssize_t n = write(thread->fd, chunk + done, len - done);
+
+			if (n <= 0) {
+				thread->failed = 1;
+				break;
+			}
+			done += n;
+		}
+		pthread_mutex_unlock(thread->lock);
+	}
+	free(chunk);
+
+	return NULL;
+}
+
+static int generate_fleet_file(size_t vehicles, size_t sentences, int num_threads, const char *output_file,
+		const unsigned int *rates)
+{
+	pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+	generator_thread_t *threads;
+	struct timespec start;
+	uint64_t bytes = 0, no_fixes = 0, corrupted = 0;
+	int fd, i, failed = 0;
+
+	if (num_threads <= 0) {
+		num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if ((size_t)num_threads > vehicles) {
+		num_threads = (int)vehicles;
+	}
+	threads = num_threads > 0 ? calloc(num_threads, sizeof(generator_thread_t)) : NULL;
+	if (!threads) {
+		printf("Failed to allocate generators for %zu vehicles!\n", vehicles);
+		exit(-1);
+	}
+	fd = strcmp(output_file, "-") ? open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644) : STDOUT_FILENO;
+	if (fd < 0) {
+		printf("Failed to open output file %s!\n", output_file);
+		exit(-2);
+	}
+	for (i = 0; i < num_threads; i++) {
+		threads[i].fd = fd;
+		threads[i].lock = &lock;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (start_generators(threads, num_threads, vehicles, sentences, rates, generate_to_file)) {
+		printf("Failed to start %d generators!\n", num_threads);
+		exit(-1);
+	}
+	for (i = 0; i < num_threads; i++) {
+		pthread_join(threads[i].thread, NULL);
+		failed |= threads[i].failed;
+		bytes += threads[i].gen.stats.bytes;
+		no_fixes += threads[i].gen.stats.no_fixes;
+		corrupted += threads[i].gen.stats.corrupted;
+		nmea_generator_destroy(&threads[i].gen);
+	}
+	double seconds = elapsed_seconds(&start);
+
+	if (fd != STDOUT_FILENO) {
+		close(fd);
+	}
+	free(threads);
+	if (failed) {
+		fprintf(stderr, "Failed to write to %s!\n", output_file);
+		exit(-3);
+	}
+	// the sentences may be on stdout
+	fprintf(stderr, "Done!");
+	fprintf(stderr, "\tGenerated %zu sentences of %zu vehicles (%llu without a fix, %llu corrupted) on %d threads\n",
+			sentences, vehicles, (unsigned long long)no_fixes, (unsigned long long)corrupted, num_threads);
+	fprintf(stderr, "\t%.1f MB in %.3f s (%.0f MB/s)\n", bytes / 1e6, seconds, bytes / 1e6 / seconds);
+
+	return 0;
+}
+
+static int test_fleet_generator(void)
+{
+	enum { FLEET_VEHICLES = 50, FLEET_SENTENCES = 20000, TRACK_FIXES = 600 };
+	static char buf[FLEET_SENTENCES * NMEA_GENERATOR_MAX_SENTENCE];
+	size_t results[RMC_PARSE_CODE_INVALID] = { 0 }, len, begin, i;
+	nmea_generator_t gen;
+	nmea_0183_data_t data;
+	nmea_rmc_data_t fix, previous;
+	rmc_error_detail_t error;
+	int ok = 0;
+
+	// 2013-07-02 23:58:20, so that the date rolls over
+	ASSERT_RMC(!nmea_generator_init(&gen, FLEET_VEHICLES, 1372809500000LL, 19), "generator not allocated ", fleet_bailout);
+	nmea_generator_set_rates(&gen, 10, 5, 30);
+	len = nmea_generator_fill(&gen, buf, sizeof(buf), FLEET_SENTENCES);
+	ASSERT_RMC(gen.stats.sentences == FLEET_SENTENCES && gen.stats.bytes == len && buf[len - 1] == '\n',
+			"fill not in whole sentences ", fleet_cleanup);
+	for (i = begin = 0; i < len; i++) {
+		if (buf[i] == '\n') {
+			results[parse_nmea(&data, buf + begin, i + 1 - begin, &error)]++;
+			begin = i + 1;
+		}
+	}
+	ASSERT_RMC(results[RMC_PARSE_FAILED] == gen.stats.corrupted &&
+			results[RMC_PARSE_SUCCESSFUL_WITH_NO_FIX] == gen.stats.no_fixes &&
+			results[RMC_PARSE_SUCCESSFUL_WITH_FIX] == FLEET_SENTENCES - gen.stats.corrupted - gen.stats.no_fixes,
+			"results not as generated ", fleet_cleanup);
+	ASSERT_RMC(gen.stats.corrupted > FLEET_SENTENCES * 4 / 100 && gen.stats.corrupted < FLEET_SENTENCES * 6 / 100 &&
+			gen.stats.no_fixes > FLEET_SENTENCES * 8 / 100 && gen.stats.no_fixes < FLEET_SENTENCES * 11 / 100,
+			"rates not kept ", fleet_cleanup);
+	nmea_generator_destroy(&gen);
+
+	// a vehicle drives as far between its fixes as its speed says
+	ASSERT_RMC(!nmea_generator_init(&gen, 1, 1372809500000LL, 20), "generator not allocated ", fleet_bailout);
+	for (i = 0; i < TRACK_FIXES; i++) {
+		char sentence[NMEA_GENERATOR_MAX_SENTENCE];
+
+		len = nmea_generator_sentence(&gen, 0, sentence);
+		ASSERT_RMC(parse_rmc_detail(&fix, sentence, len, &error) == RMC_PARSE_SUCCESSFUL_WITH_FIX,
+				"track sentence not parsed ", fleet_cleanup);
+		ASSERT_RMC(abs(fix.latitude_e7 - NMEA_GENERATOR_LATITUDE_E7) < NMEA_GENERATOR_SPREAD_E7 + 10000 &&
+				abs(fix.longitude_e7 - NMEA_GENERATOR_LONGITUDE_E7) < NMEA_GENERATOR_SPREAD_E7 + 10000,
+				"vehicle out of the area ", fleet_cleanup);
+		if (i) {
+			double north = (fix.latitude_e7 - previous.latitude_e7) * 0.0111195;
+			double east = (fix.longitude_e7 - previous.longitude_e7) * 0.0111195 * cos(fix.latitude * M_PI / 180);
+
+			ASSERT_RMC(fix.epoch_ms - previous.epoch_ms == NMEA_GENERATOR_INTERVAL_MS, "fixes not 1 s apart ", fleet_cleanup);
+			ASSERT_RMC(fabs(sqrt(north * north + east * east) - fix.ground_speed * 1852 / 3600) < 0.1,
+					"distance not as fast as the speed ", fleet_cleanup);
+		}
+		previous = fix;
+	}
+	ok = fix.day == 3 && fix.month == 7;
+
+fleet_cleanup:
+	nmea_generator_destroy(&gen);
+fleet_bailout:
+	return ok;
+}
+
+static void *scrape_metrics(void *arg)
+{
+	int *state = arg;	// [0] set when the parse is done, [1] set when a snapshot went back
+	nmea_metrics_t snapshot;
+	uint64_t last = 0, now;
+
+	while (!__atomic_load_n(&state[0], __ATOMIC_ACQUIRE)) {
+		nmea_metrics_snapshot(&snapshot);
+		now = nmea_metrics_sentences(&snapshot);
+		if (now < last) {
+			state[1] = 1;
+		}
+		last = now;
+	}
+	return NULL;
+}
+
+static int test_parse_metrics(void)
+{
+	enum { METRICS_SENTENCES = 5000, METRICS_THREADS = 4 };
+	static char buf[METRICS_SENTENCES * NMEA_GENERATOR_MAX_SENTENCE];
+	static const char gga[] = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+	nmea_metrics_t before, after;
+	nmea_parse_stats_t stats;
+	nmea_generator_t gen;
+	nmea_0183_data_t data;
+	rmc_error_detail_t error;
+	pthread_t scraper;
+	int state[2] = { 0, 0 }, ok = 0, e;
+	uint64_t samples = 0;
+	size_t len;
+
+	ASSERT_RMC(!nmea_generator_init(&gen, 100, 1372809500000LL, 21), "generator not allocated ", metrics_bailout);
+	nmea_generator_set_rates(&gen, 10, 5, 0);
+	len = nmea_generator_fill(&gen, buf, sizeof(buf), METRICS_SENTENCES);
+	nmea_generator_destroy(&gen);
+
+	// snapshots taken while the parsers run only ever grow
+	nmea_metrics_snapshot(&before);
+	ASSERT_RMC(!pthread_create(&scraper, NULL, scrape_metrics, state), "scraper not started ", metrics_bailout);
+	ASSERT_RMC(!parse_rmc_parallel(buf, len, METRICS_THREADS, NULL, NULL, &stats), "parsers not started ", metrics_join);
+	ASSERT_RMC(parse_nmea(&data, gga, sizeof(gga) - 1, &error) == RMC_PARSE_SUCCESSFUL_WITH_FIX, "GGA not parsed ",
+			metrics_join);
+	ok = 1;
+metrics_join:
+	__atomic_store_n(&state[0], 1, __ATOMIC_RELEASE);
+	pthread_join(scraper, NULL);
+	nmea_metrics_snapshot(&after);
+	ASSERT_RMC(ok && !state[1], "snapshot went back ", metrics_bailout);
+	ok = 0;
+
+	if (!nmea_metrics_enabled()) {
+		ok = nmea_metrics_sentences(&after) == 0 && after.bytes == 0 && after.threads == 0;
+		goto metrics_bailout;
+	}
+	ASSERT_RMC(after.bytes - before.bytes == len + sizeof(gga) - 1, "bytes not counted ", metrics_bailout);
+	ASSERT_RMC(after.results[RMC_PARSE_SUCCESSFUL_WITH_FIX] - before.results[RMC_PARSE_SUCCESSFUL_WITH_FIX] ==
+			stats.fixes + 1 &&
+			after.results[RMC_PARSE_SUCCESSFUL_WITH_NO_FIX] - before.results[RMC_PARSE_SUCCESSFUL_WITH_NO_FIX] ==
+			stats.no_fixes &&
+			after.results[RMC_PARSE_FAILED] - before.results[RMC_PARSE_FAILED] == stats.failures,
+			"results not counted ", metrics_bailout);
+	for (e = RMC_ERROR_NONE + 1; e < RMC_ERROR_CODE_INVALID; e++) {
+		ASSERT_RMC(after.errors[e] - before.errors[e] == stats.errors[e], "failures not counted ", metrics_bailout);
+	}
+	ASSERT_RMC(after.types[NMEA_SENTENCE_GGA] - before.types[NMEA_SENTENCE_GGA] == 1 &&
+			after.types[NMEA_SENTENCE_RMC] - before.types[NMEA_SENTENCE_RMC] +
+			after.types[NMEA_SENTENCE_UNKNOWN] - before.types[NMEA_SENTENCE_UNKNOWN] == stats.sentences,
+			"types not counted ", metrics_bailout);
+
+	// one sentence in the sample period of each thread is timed, up to where it fails
+	for (e = 0; e < NMEA_METRICS_BUCKETS; e++) {
+		samples += after.latency[NMEA_STAGE_DECODE][e] - before.latency[NMEA_STAGE_DECODE][e];
+	}
+	ok = samples > 0 && samples <= stats.sentences / NMEA_METRICS_SAMPLE_PERIOD + METRICS_THREADS &&
+			nmea_metrics_percentile(&after, NMEA_STAGE_DECODE, 0.99) >=
+			nmea_metrics_percentile(&after, NMEA_STAGE_DECODE, 0.5) &&
+			nmea_metrics_mean(&after, NMEA_STAGE_DECODE) > 0 && after.threads >= 1;
+
+metrics_bailout:
+	return ok;
+}
+
+static void print_metrics(void)
+{
+	static const char *const type_names[NMEA_SENTENCE_CODE_INVALID] = {
+		"unknown", "RMC", "GGA", "VTG", "GLL", "GSA", "GSV"
+	};
+	nmea_metrics_t metrics;
+	int stage, type;
+
+	if (!nmea_metrics_enabled()) {
+		return;
+	}
+	nmea_metrics_snapshot(&metrics);
+	printf("\tMetrics of %zu threads: %llu sentences, %.1f MB\n", metrics.threads,
+			(unsigned long long)nmea_metrics_sentences(&metrics), metrics.bytes / 1e6);
+	for (type = NMEA_SENTENCE_UNKNOWN; type < NMEA_SENTENCE_CODE_INVALID; type++) {
+		if (metrics.types[type]) {
+			printf("\t\t%llu %s\n", (unsigned long long)metrics.types[type], type_names[type]);
+		}
+	}
+	for (stage = NMEA_STAGE_FRAMING; stage < NMEA_STAGE_CODE_INVALID; stage++) {
+		printf("\t\t%-8s mean %.0f ns, p50 < %.0f ns, p99 < %.0f ns\n", nmea_metrics_stage_name(stage),
+				nmea_metrics_mean(&metrics, stage), nmea_metrics_percentile(&metrics, stage, 0.5),
+				nmea_metrics_percentile(&metrics, stage, 0.99));
+	}
+}
+
+static int rewrite_file(int fd, const void *data, size_t len)
+{
+	const char *from = data;
+	ssize_t n;
+
+	if (ftruncate(fd, 0) || lseek(fd, 0, SEEK_SET)) {
+		return -1;
+	}
+	while (len) {
+		n = write(fd, from, len);
+		if (n <= 0) {
+			return -1;
+		}
+		from += n;
+		len -= n;
+	}
+	return lseek(fd, 0, SEEK_SET) ? -1 : 0;
+}
+
+static int check_source(int fd, int num_threads, const char *expected, size_t len)
+{
+	static char chunk[4099];
+	nmea_source_t source;
+	size_t total = 0;
+	ssize_t n;
+	int ok;
+
+	if (lseek(fd, 0, SEEK_SET) || nmea_source_open(&source, fd, num_threads)) {
+		return 0;
+	}
+	// odd sizes, so that reads end inside sentences and compressed blocks
+	while ((n = nmea_source_read(&source, chunk, 1 + (total * 7 + 13) % (sizeof(chunk) - 1))) > 0) {
+		if (total + n > len || memcmp(chunk, expected + total, n)) {
+			break;
+		}
+		total += n;
+	}
+	ok = n == 0 && total == len && source.bytes_out == len && nmea_source_read(&source, chunk, 1) == 0;
+	nmea_source_close(&source);
+
+	return ok;
+}
+
+static int test_compressed_input(void)
+{
+	enum { SOURCE_SENTENCES = 20000, SOURCE_MEMBERS = 2, SOURCE_FRAMES = 5 };
+	static char buf[SOURCE_SENTENCES * NMEA_GENERATOR_MAX_SENTENCE];
+	char path[] = "/tmp/rmc_source_XXXXXX";
+	nmea_parse_stats_t plain_stats;
+	nmea_generator_t gen;
+	nmea_source_t source;
+	unsigned char *packed = NULL;
+	size_t len, packed_cap;
+	int fd, ok = 0;
+#if defined(NMEA_ZLIB) || defined(NMEA_ZSTD)
+	// compressed input is only written when it can be read
+	nmea_parse_stats_t stats;
+	size_t packed_len = 0, i;
+#endif
+
+	ASSERT_RMC(!nmea_generator_init(&gen, 10, 1372809500000LL, 22), "generator not allocated ", source_bailout);
+	nmea_generator_set_rates(&gen, 10, 5, 30);
+	len = nmea_generator_fill(&gen, buf, sizeof(buf), SOURCE_SENTENCES);
+	nmea_generator_destroy(&gen);
+	fd = mkstemp(path);
+	ASSERT_RMC(fd >= 0, "temporary file not created ", source_bailout);
+	unlink(path);
+	packed_cap = len + len / 2 + 4096;
+	packed = malloc(packed_cap);
+	ASSERT_RMC(packed, "buffer not allocated ", source_cleanup);
+
+	// plain text as it is
+	ASSERT_RMC(!rewrite_file(fd, buf, len) && check_source(fd, 1, buf, len), "plain text not read back ", source_cleanup);
+	ASSERT_RMC(!lseek(fd, 0, SEEK_SET) && !nmea_pipeline_run(fd, 2, RMC_FIELD_MASK_POSITION, NULL, NULL, &plain_stats) &&
+			plain_stats.sentences == SOURCE_SENTENCES, "plain text not parsed ", source_cleanup);
+
+	// gzip members one after the other, as of concatenated .gz files
+#ifdef NMEA_ZLIB
+	for (i = 0; i < SOURCE_MEMBERS; i++) {
+		size_t from = len * i / SOURCE_MEMBERS, to = len * (i + 1) / SOURCE_MEMBERS;
+		z_stream strm;
+		int ret;
+
+		memset(&strm, 0, sizeof(strm));
+		ASSERT_RMC(deflateInit2(&strm, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK,
+				"deflate not set up ", source_cleanup);
+		strm.next_in = (unsigned char *)buf + from;
+		strm.avail_in = to - from;
+		strm.next_out = packed + packed_len;
+		strm.avail_out = packed_cap - packed_len;
+		ret = deflate(&strm, Z_FINISH);
+		packed_len = strm.next_out - packed;
+		deflateEnd(&strm);
+		ASSERT_RMC(ret == Z_STREAM_END, "gzip member not written ", source_cleanup);
+	}
+	ASSERT_RMC(!rewrite_file(fd, packed, packed_len) && check_source(fd, 1, buf, len), "gzip not read back ",
+			source_cleanup);
+	ASSERT_RMC(!lseek(fd, 0, SEEK_SET) && !nmea_pipeline_run(fd, 2, RMC_FIELD_MASK_POSITION, NULL, NULL, &stats) &&
+			!memcmp(&stats, &plain_stats, sizeof(stats)), "gzip not parsed as the plain text ", source_cleanup);
+	// a cut member is an error, not an early end
+	ASSERT_RMC(!rewrite_file(fd, packed, packed_len - 100) &&
+			nmea_pipeline_run(fd, 2, RMC_FIELD_MASK_POSITION, NULL, NULL, &stats),
+			"truncated gzip not failed ", source_cleanup);
+#else
+	ASSERT_RMC(!rewrite_file(fd, "\x1f\x8b\x08\x00", 4) && nmea_source_open(&source, fd, 1) &&
+			source.format == NMEA_SOURCE_GZIP && !nmea_source_supported(NMEA_SOURCE_GZIP),
+			"gzip not told apart ", source_cleanup);
+#endif
+
+	// zstd frames, decoded in turn and in parallel
+#ifdef NMEA_ZSTD
+	packed_len = 0;
+	for (i = 0; i < SOURCE_FRAMES; i++) {
+		size_t from = len * i / SOURCE_FRAMES, to = len * (i + 1) / SOURCE_FRAMES;
+		size_t ret = ZSTD_compress(packed + packed_len, packed_cap - packed_len, buf + from, to - from, 3);
+
+		ASSERT_RMC(!ZSTD_isError(ret), "zstd frame not written ", source_cleanup);
+		packed_len += ret;
+	}
+	ASSERT_RMC(!rewrite_file(fd, packed, packed_len) && check_source(fd, 1, buf, len) && check_source(fd, 3, buf, len),
+			"zstd not read back ", source_cleanup);
+	ASSERT_RMC(!lseek(fd, 0, SEEK_SET) && !nmea_source_open(&source, fd, 3), "zstd decoders not started ", source_cleanup);
+	i = nmea_pipeline_run_source(&source, 2, RMC_FIELD_MASK_POSITION, NULL, NULL, &stats);
+	nmea_source_close(&source);
+	ASSERT_RMC(!i && !memcmp(&stats, &plain_stats, sizeof(stats)), "zstd not parsed as the plain text ", source_cleanup);
+	ASSERT_RMC(!rewrite_file(fd, packed, packed_len - 100) && !check_source(fd, 1, buf, len) &&
+			!check_source(fd, 3, buf, len), "truncated zstd not failed ", source_cleanup);
+#else
+	ASSERT_RMC(!rewrite_file(fd, "\x28\xb5\x2f\xfd", 4) && nmea_source_open(&source, fd, 1) &&
+			source.format == NMEA_SOURCE_ZSTD && !nmea_source_supported(NMEA_SOURCE_ZSTD),
+			"zstd not told apart ", source_cleanup);
+#endif
+	ok = 1;
+
+source_cleanup:
+	free(packed);
+	close(fd);
+source_bailout:
+	return ok;
+}
+
+static void raise_fd_limit(void)
+{
+	struct rlimit limit;
+
+	// one descriptor per stream
+	if (!getrlimit(RLIMIT_NOFILE, &limit) && limit.rlim_cur < limit.rlim_max) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+}
+
+static double elapsed_seconds(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void on_server_batch(uint32_t vehicle, const nmea_rmc_data_t *fixes, size_t count, void *user_data)
+{
+	server_state_t *state = (server_state_t *)user_data;
+
+	state->batches++;
+	state->fixes += count;
+	state->last_vehicle = vehicle;
+	if (state->fleet) {
+		nmea_fleet_update(state->fleet, vehicle, &fixes[count - 1]);
+	}
+	if (state->simplify) {
+		static nmea_rmc_data_t kept[NMEA_SERVER_BATCH_SIZE + 1];
+		nmea_simplify(state->simplify, vehicle, fixes, count, kept);
+	}
+	for (size_t i = 0; state->archive && i < count; i++) {
+		if (nmea_archive_append(state->archive, vehicle, &fixes[i])) {
+			printf("Failed to write the archive!\n");
+			exit(-2);
+		}
+	}
+}
+
+static int test_server_streams(const char *buf, int buf_size)
+{
+	nmea_server_t server;
+	server_state_t state = { 0, 0, 0, NULL, NULL, NULL };
+	int pair[2][2], i, n, ok = 1;
+
+	if (nmea_server_init(&server, RMC_FIELD_MASK_ALL, on_server_batch, &state)) {
+		return 0;
+	}
+	for (i = 0; i < 2; i++) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair[i]) || !nmea_server_add(&server, pair[i][0])) {
+			nmea_server_destroy(&server);
+			return 0;
+		}
+	}
+
+	// interleave the two halves of the input on the connections
+	for (n = 0; n < 2; n++) {
+		for (i = 0; i < 2; i++) {
+			int half = buf_size / 2;
+			ok &= write(pair[i][1], buf + n * half, n ? buf_size - half : half) > 0;
+			while (nmea_server_poll(&server, 0) > 0);
+			ok &= state.fixes == (size_t)(n ? i + 1 : 0);
+			ok &= !n || state.last_vehicle == (uint32_t)i;
+		}
+	}
+
+	// end of stream closes a connection, the other one on destroy
+	close(pair[0][1]);
+	while (nmea_server_poll(&server, 0) > 0);
+	ok &= server.stats.closed == 1 && server.stats.active == 1;
+	nmea_server_destroy(&server);
+	close(pair[1][1]);
+
+	return ok && state.batches == 2 && server.stats.sentences == 4 && server.stats.closed == 2;
+}
+
+static int test_fleet_index(const nmea_rmc_data_t *fix)
+{
+	nmea_fleet_t fleet;
+	nmea_fleet_position_t found[8], position;
+	nmea_rmc_data_t moved = *fix;
+	int ok = 1;
+
+	if (nmea_fleet_init(&fleet, 16)) {
+		return 0;
+	}
+	// vehicle 2 is 5 km north of vehicle 1, 3 and 4 face each other across
+	// the antimeridian
+	ok &= nmea_fleet_update(&fleet, 1, fix) == 1;
+	moved.latitude_e7 += 449661;
+	ok &= nmea_fleet_update(&fleet, 2, &moved) == 1;
+	moved.latitude_e7 = 0;
+	moved.longitude_e7 = 1799990000;
+	ok &= nmea_fleet_update(&fleet, 3, &moved) == 1;
+	moved.longitude_e7 = -1799990000;
+	ok &= nmea_fleet_update(&fleet, 4, &moved) == 1;
+	ok &= nmea_fleet_query_radius(&fleet, fix->latitude_e7, fix->longitude_e7, 1000, found, 8) == 1 &&
+			found[0].vehicle == 1;
+	ok &= nmea_fleet_query_radius(&fleet, fix->latitude_e7, fix->longitude_e7, 5100, found, 8) == 2;
+
+	// an older fix is ignored, a newer one moves the vehicle
+	moved.longitude_e7 = 1799995000;
+	moved.epoch_ms = fix->epoch_ms - 1;
+	ok &= nmea_fleet_update(&fleet, 1, &moved) == 0;
+	moved.epoch_ms = fix->epoch_ms + 1;
+	ok &= nmea_fleet_update(&fleet, 1, &moved) == 1;
+	ok &= nmea_fleet_query_radius(&fleet, fix->latitude_e7, fix->longitude_e7, 5100, found, 8) == 1 &&
+			found[0].vehicle == 2;
+	ok &= nmea_fleet_query_radius(&fleet, 0, 1800000000 - 1, 1000, found, 1) == 3;
+	ok &= nmea_fleet_query_box(&fleet, -1000000, 1799000000, 1000000, -1799000000, found, 8) == 3;
+	ok &= nmea_fleet_query_box(&fleet, -1000000, -1799000000, 1000000, 1799000000, found, 8) == 0;
+	ok &= nmea_fleet_get(&fleet, 2, &position) && position.latitude_e7 == fix->latitude_e7 + 449661;
+	// the id past NMEA_VEHICLE_MAX would key a free slot
+	ok &= nmea_fleet_update(&fleet, UINT32_MAX, fix) == -1 && nmea_fleet_get(&fleet, UINT32_MAX, &position) == -1;
+	ok &= !nmea_fleet_get(&fleet, 5, &position) && fleet.vehicles == 4;
+	nmea_fleet_destroy(&fleet);
+
+	return ok;
+}
+
+static int test_packed_fixes(const nmea_rmc_data_t *fix, const char *buf, int buf_size)
+{
+	nmea_fix_batch_t batch;
+	nmea_packed_fix_t packed, copies[3000];
+	nmea_rmc_data_t unpacked, turned = *fix;
+	nmea_parse_stats_t stats;
+	size_t i;
+	int ok = 1;
+
+	nmea_fix_pack(fix, &packed);
+	nmea_fix_unpack(&packed, &unpacked);
+	ok &= packed.epoch_s == 1372760802 && packed.speed == 716 && packed.heading == 15667;
+	ok &= unpacked.latitude_e7 == fix->latitude_e7 && unpacked.longitude_e7 == fix->longitude_e7 &&
+			unpacked.hour == fix->hour && unpacked.min == fix->min && unpacked.sec == fix->sec &&
+			unpacked.day == fix->day && unpacked.month == fix->month && unpacked.year == fix->year &&
+			unpacked.ground_speed == 7.16 && unpacked.heading == 156.67;
+	turned.heading = -10.5;
+	turned.ground_speed = 1000;
+	nmea_fix_pack(&turned, &packed);
+	ok &= packed.heading == 34950 && packed.speed == UINT16_MAX;
+
+	// parsed straight into the columns, then thru packed fixes and back
+	memset(&stats, 0, sizeof(stats));
+	if (nmea_fix_batch_init(&batch, 0)) {
+		return 0;
+	}
+	ok &= nmea_fix_batch_parse(&batch, buf, buf_size, &stats) == 1 && stats.sentences == 2 && stats.no_fixes == 1;
+	nmea_fix_batch_get(&batch, 0, &unpacked);
+	ok &= unpacked.latitude_e7 == fix->latitude_e7 && unpacked.epoch_ms == fix->epoch_ms - fix->millisec;
+	for (i = 0; i < 3000; i++) {
+		nmea_fix_pack(fix, &copies[i]);
+		copies[i].epoch_s += i;
+	}
+	ok &= !nmea_fix_batch_append_packed(&batch, copies, 3000) && batch.count == 3001;
+	ok &= (uintptr_t)batch.speed % NMEA_FIX_BATCH_ALIGN == 0 && (uintptr_t)batch.heading % NMEA_FIX_BATCH_ALIGN == 0;
+	nmea_fix_batch_get_packed(&batch, 1, 3000, copies);
+	for (i = 0; i < 3000; i++) {
+		ok &= copies[i].epoch_s == packed.epoch_s + i && copies[i].latitude_e7 == fix->latitude_e7;
+	}
+	nmea_fix_batch_free(&batch);
+
+	return ok;
+}
+
+static int test_geodesic_kernels(void)
+{
+	enum { GEO_FIXES = 103 };
+	static int32_t latitude_e7[GEO_FIXES], longitude_e7[GEO_FIXES];
+	static uint32_t epoch_s[GEO_FIXES];
+	static double latitude[GEO_FIXES], longitude[GEO_FIXES], time_s[GEO_FIXES];
+	static double ref[4][GEO_FIXES], res[4][GEO_FIXES];
+	nmea_geo_segments_t ref_segments = { ref[0], ref[1], ref[2], ref[3] };
+	nmea_geo_segments_t res_segments = { res[0], res[1], res[2], res[3] };
+	double ref_total, res_total;
+	int kernel, i, j, ok = 1;
+
+	// small steps, then jumps across the globe, the antimeridian and the poles
+	srand(16);
+	for (i = 0; i < GEO_FIXES; i++) {
+		if (i < GEO_FIXES / 2) {
+			latitude_e7[i] = 482299053 + (rand() % 20001 - 10000) * i;
+			longitude_e7[i] = (i % 4 < 2 ? 1799990000 : -1799990000) + rand() % 1001;
+		} else {
+			latitude_e7[i] = (int32_t)(rand() % 1800000001) - 900000000;
+			longitude_e7[i] = (int32_t)(rand() % 1800000001) * (i & 1 ? 1 : -1);
+		}
+		epoch_s[i] = 4000000000u + i - (i == 7);
+		latitude[i] = latitude_e7[i] / 1e7;
+		longitude[i] = longitude_e7[i] / 1e7;
+		time_s[i] = epoch_s[i];
+	}
+	latitude_e7[GEO_FIXES - 1] = 900000000;
+	latitude[GEO_FIXES - 1] = 90;
+
+	nmea_geo_select(NMEA_GEO_KERNEL_SCALAR);
+	ref_total = nmea_geo_track_e7(latitude_e7, longitude_e7, epoch_s, GEO_FIXES, &ref_segments);
+	ok &= isnan(ref[3][6]) && fabs(ref[1][GEO_FIXES - 2] - ref_total) < 1e-6;
+	for (kernel = NMEA_GEO_KERNEL_AVX2; kernel < NMEA_GEO_KERNEL_INVALID; kernel++) {
+		if (!nmea_geo_select(kernel)) {
+			continue;
+		}
+		res_total = nmea_geo_track_e7(latitude_e7, longitude_e7, epoch_s, GEO_FIXES, &res_segments);
+		ok &= fabs(res_total - ref_total) <= 1e-12 * ref_total + 1e-9;
+		for (i = 0; i < GEO_FIXES - 1; i++) {
+			for (j = 0; j < 4; j++) {
+				double tolerance = j == 2 ? 1e-9 : 1e-12 * fabs(ref[j][i]) + 1e-9;
+				double delta = fabs(res[j][i] - ref[j][i]);
+				if (j == 2 && delta > 180) delta = 360 - delta;
+				ok &= j == 3 && isnan(ref[j][i]) ? isnan(res[j][i]) : delta <= tolerance;
+			}
+		}
+		// the same track in degrees
+		res_total = nmea_geo_track(latitude, longitude, time_s, GEO_FIXES, &res_segments);
+		ok &= fabs(res_total - ref_total) <= 1e-12 * ref_total + 1e-9;
+	}
+	nmea_geo_select(NMEA_GEO_KERNEL_AUTO);
+
+	// a quarter of the equator, heading east at a knot
+	double quarter_lat[2] = { 0, 0 }, quarter_lon[2] = { 0, 90 }, quarter_time[2] = { 0, 0 };
+	quarter_time[1] = M_PI / 2 * NMEA_GEO_EARTH_RADIUS / NMEA_GEO_METERS_PER_KNOT_S;
+	ok &= fabs(nmea_geo_track(quarter_lat, quarter_lon, quarter_time, 2, &res_segments) -
+			M_PI / 2 * NMEA_GEO_EARTH_RADIUS) < 1e-6;
+	ok &= fabs(res[2][0] - 90) < 1e-9 && fabs(res[3][0] - 1) < 1e-12;
+
+	return ok;
+}
+
+static int geofence_brute_force(const int32_t *latitude_e7, const int32_t *longitude_e7, size_t count, int32_t y, int32_t x)
+{
+	size_t i;
+	int inside = 0;
+
+	// every edge, same arithmetic as the engine, no antimeridian
+	for (i = 0; i < count; i++) {
+		size_t j = i + 1 < count ? i + 1 : 0;
+		size_t low = latitude_e7[i] < latitude_e7[j] ? i : j, high = low == i ? j : i;
+
+		if (latitude_e7[i] != latitude_e7[j] && latitude_e7[low] <= y && y < latitude_e7[high]) {
+			double dx_dy = (double)((int64_t)longitude_e7[high] - longitude_e7[low]) /
+					(double)((int64_t)latitude_e7[high] - latitude_e7[low]);
+
+			if (x < longitude_e7[low] + (double)(y - latitude_e7[low]) * dx_dy) {
+				inside ^= 1;
+			}
+		}
+	}
+	return inside;
+}
+
+static void on_geofence_event(const nmea_geofence_event_t *event, void *user_data)
+{
+	uint32_t *log = user_data;
+
+	// vehicle, fence, fix and transition packed into one word per event
+	log[1 + log[0]++] = event->vehicle << 24 | event->fence << 8 | (uint32_t)event->fix << 2 | event->transition;
+}
+
+static int test_geofence_engine(void)
+{
+	enum { STAR_VERTICES = 40 };
+	int32_t square_lat[] = { 482000000, 482000000, 482500000, 482500000 };
+	int32_t square_lon[] = { 163000000, 163500000, 163500000, 163000000 };
+	int32_t wrap_lat[] = { 100000000, 100000000, 102000000, 100000000 };
+	int32_t wrap_lon[] = { 1799000000, -1799000000, 1800000000, 1799000000 };
+	int32_t star_lat[STAR_VERTICES], star_lon[STAR_VERTICES];
+	uint32_t vehicles[] = { 1, 2, 1, 1, 2 }, lost = UINT32_MAX;
+	int32_t fix_lat[] = { 481000000, 482100000, 482100000, 482100000, 100500000 };
+	int32_t fix_lon[] = { 161000000, 163100000, 163100000, 161000000, -1799500000 };
+	uint32_t fences[8], log[16] = { 0 };
+	nmea_geofence_t geofence;
+	int i, ok = 1;
+
+	if (!nmea_geofence_init(&geofence, 7, 16) || nmea_geofence_init(&geofence, 0, 16)) {
+		return 0;
+	}
+
+	// a star of random radii, concave, over many cells
+	srand(17);
+	for (i = 0; i < STAR_VERTICES; i++) {
+		double angle = 2 * M_PI * i / STAR_VERTICES, radius = 200000 + rand() % 1800000;
+		star_lat[i] = 482250000 + (int32_t)(radius * sin(angle));
+		star_lon[i] = 163250000 + (int32_t)(radius * cos(angle));
+	}
+	ok &= nmea_geofence_add(&geofence, 10, square_lat, square_lon, 4) == 0;
+	ok &= nmea_geofence_add(&geofence, 20, wrap_lat, wrap_lon, 4) == 0;
+	ok &= nmea_geofence_add(&geofence, 30, star_lat, star_lon, STAR_VERTICES) == 0;
+	ok &= nmea_geofence_add(&geofence, 40, square_lat, square_lon, 2) == -1;
+	ok &= nmea_geofence_build(&geofence) == 0;
+	ok &= nmea_geofence_add(&geofence, 50, square_lat, square_lon, 4) == -1;
+
+	for (i = 0; i < 20000; i++) {
+		int32_t y = 480000000 + rand() % 5000000, x = 161000000 + rand() % 5000000;
+		size_t n = nmea_geofence_contains(&geofence, y, x, fences, 8), k, expect = 0;
+
+		expect += geofence_brute_force(square_lat, square_lon, 4, y, x);
+		expect += geofence_brute_force(star_lat, star_lon, STAR_VERTICES, y, x);
+		ok &= n == expect;
+		for (k = 0; k < n; k++) {
+			ok &= fences[k] == 10 ? geofence_brute_force(square_lat, square_lon, 4, y, x) :
+					geofence_brute_force(star_lat, star_lon, STAR_VERTICES, y, x) && fences[k] == 30;
+		}
+	}
+	ok &= nmea_geofence_contains(&geofence, 100500000, 1799500000, fences, 8) == 1 && fences[0] == 20;
+	ok &= nmea_geofence_contains(&geofence, 100500000, -1799500000, fences, 8) == 1 && fences[0] == 20;
+	ok &= nmea_geofence_contains(&geofence, 100500000, 1790000000, fences, 8) == 0;
+
+	// vehicle 1 outside, into the square and the star, out of the square;
+	// vehicle 2 starts inside both, then crosses to the wrapped triangle
+	int star_holds = geofence_brute_force(star_lat, star_lon, STAR_VERTICES, 482100000, 163100000);
+	int star_left = geofence_brute_force(star_lat, star_lon, STAR_VERTICES, 482100000, 161000000);
+	int star_first = geofence_brute_force(star_lat, star_lon, STAR_VERTICES, 481000000, 161000000);
+	ok &= star_holds && !star_left && !star_first;
+	ok &= nmea_geofence_evaluate(&geofence, vehicles, fix_lat, fix_lon, 5, on_geofence_event, log) == 9;
+	ok &= log[0] == 9 &&
+			log[1] == (2u << 24 | 10 << 8 | 1 << 2 | NMEA_GEOFENCE_ENTER) &&
+			log[2] == (2u << 24 | 30 << 8 | 1 << 2 | NMEA_GEOFENCE_ENTER) &&
+			log[3] == (1u << 24 | 10 << 8 | 2 << 2 | NMEA_GEOFENCE_ENTER) &&
+			log[4] == (1u << 24 | 30 << 8 | 2 << 2 | NMEA_GEOFENCE_ENTER) &&
+			log[5] == (1u << 24 | 10 << 8 | 3 << 2 | NMEA_GEOFENCE_EXIT) &&
+			log[6] == (1u << 24 | 30 << 8 | 3 << 2 | NMEA_GEOFENCE_EXIT) &&
+			log[7] == (2u << 24 | 10 << 8 | 4 << 2 | NMEA_GEOFENCE_EXIT) &&
+			log[8] == (2u << 24 | 20 << 8 | 4 << 2 | NMEA_GEOFENCE_ENTER) &&
+			log[9] == (2u << 24 | 30 << 8 | 4 << 2 | NMEA_GEOFENCE_EXIT);
+
+	// the id past NMEA_VEHICLE_MAX would key a free slot
+	ok &= nmea_geofence_evaluate(&geofence, &lost, &fix_lat[1], &fix_lon[1], 1, on_geofence_event, log) == 0 &&
+			geofence.dropped == 1;
+	nmea_geofence_destroy(&geofence);
+
+	return ok;
+}
+
+static double track_error(const nmea_rmc_data_t *fix, const nmea_rmc_data_t *from, const nmea_rmc_data_t *to)
+{
+	double scale = NMEA_GEO_EARTH_RADIUS * M_PI / 180 / 1e7, cos_lat = cos(from->latitude_e7 * M_PI / 180 / 1e7);
+	double px = (fix->longitude_e7 - from->longitude_e7) * scale * cos_lat, py = (fix->latitude_e7 - from->latitude_e7) * scale;
+	double sx = (to->longitude_e7 - from->longitude_e7) * scale * cos_lat, sy = (to->latitude_e7 - from->latitude_e7) * scale;
+	double length = sx * sx + sy * sy, t = length > 0 ? (px * sx + py * sy) / length : 0;
+
+	// distance from the fix to the segment, in meters
+	t = t < 0 ? 0 : t > 1 ? 1 : t;
+	return hypot(px - t * sx, py - t * sy);
+}
+
+static double max_track_error(const nmea_rmc_data_t *track, size_t count, const nmea_rmc_data_t *kept, size_t n)
+{
+	double worst = 0, error;
+	size_t i, j = 0;
+
+	// every fix against the kept segment spanning its time
+	for (i = 0; i < count; i++) {
+		if (track[i].status != 'A') {
+			continue;
+		}
+		while (j + 2 < n && kept[j + 1].epoch_ms < track[i].epoch_ms) {
+			j++;
+		}
+		error = track_error(&track[i], &kept[j], &kept[j + 1 < n ? j + 1 : j]);
+		worst = error > worst ? error : worst;
+	}
+	return worst;
+}
+
+static int test_track_simplification(const nmea_rmc_data_t *fix)
+{
+	enum { TRACK_FIXES = 3000 };
+	static nmea_rmc_data_t track[TRACK_FIXES], kept[TRACK_FIXES + 2];
+	nmea_simplify_t simplify;
+	double east = 0, north = 0, heading = 0;
+	size_t n = 0, i, j;
+	int ok = 1;
+
+	// a straight road, a turn, a random walk, then parked with jitter
+	srand(18);
+	for (i = 0; i < TRACK_FIXES; i++) {
+		double step = i < 1000 ? 10 : i < 2000 ? 5 + rand() % 10 : 0;
+
+		heading += i == 500 ? M_PI / 2 : i >= 1000 && i < 2000 ? (rand() % 21 - 10) / 100.0 : 0;
+		east += step * cos(heading);
+		north += step * sin(heading);
+		track[i] = *fix;
+		track[i].status = i == 1500 ? 'V' : 'A';
+		track[i].epoch_ms = fix->epoch_ms + 1000 * (int64_t)i;
+		track[i].latitude_e7 = fix->latitude_e7 + (int32_t)((north + rand() % 3 - 1) / 0.0111195);
+		track[i].longitude_e7 = fix->longitude_e7 + (int32_t)((east + rand() % 3 - 1) / 0.0111195 / cos(fix->latitude * M_PI / 180));
+	}
+
+	if (nmea_simplify_init(&simplify, 5, 0, 16)) {
+		return 0;
+	}
+	for (i = 0; i < TRACK_FIXES; i += 7) {
+		n += nmea_simplify(&simplify, 3, &track[i], i + 7 < TRACK_FIXES ? 7 : TRACK_FIXES - i, &kept[n]);
+	}
+	n += nmea_simplify_flush(&simplify, 3, &kept[n]);
+	ok &= n > 3 && n < TRACK_FIXES / 5 && simplify.stats.fixes_out == n && nmea_simplify_ratio(&simplify) > 5;
+	ok &= kept[0].epoch_ms == track[0].epoch_ms;
+	ok &= max_track_error(track, TRACK_FIXES, kept, n) <= 5.01;
+	ok &= nmea_simplify_flush(&simplify, 3, kept) == 0;
+
+	// the id past NMEA_VEHICLE_MAX would key a free slot
+	ok &= nmea_simplify(&simplify, UINT32_MAX, track, 7, kept) == 0 && simplify.stats.dropped == 7;
+	nmea_simplify_destroy(&simplify);
+
+	// out 1 km east and back, then 1 km north, first in three fixes then in 10 m steps: the turns
+	// are kept, the last fix comes out of the flush
+	for (i = 0; i < 304; i++) {
+		j = i < 4 ? i : i - 4;
+		east = i < 4 ? (i == 1) * 1000.0 : j < 100 ? 10.0 * j : j < 200 ? 10.0 * (200 - j) : 0;
+		north = i < 4 ? (i == 3) * 1000.0 : j < 200 ? 0 : 10.0 * (j - 199);
+		track[i] = *fix;
+		track[i].epoch_ms = fix->epoch_ms + 1000 * (int64_t)i;
+		track[i].latitude_e7 = fix->latitude_e7 + (int32_t)(north / 0.0111195);
+		track[i].longitude_e7 = fix->longitude_e7 + (int32_t)(east / 0.0111195 / cos(fix->latitude * M_PI / 180));
+	}
+	if (nmea_simplify_init(&simplify, 10, 0, 16)) {
+		return 0;
+	}
+	n = nmea_simplify(&simplify, 5, track, 4, kept);
+	n += nmea_simplify_flush(&simplify, 5, &kept[n]);
+	ok &= n == 4 && kept[2].epoch_ms == track[2].epoch_ms && max_track_error(track, 4, kept, n) <= 10.01;
+	nmea_simplify_destroy(&simplify);
+
+	if (nmea_simplify_init(&simplify, 10, 0, 16)) {
+		return 0;
+	}
+	n = nmea_simplify(&simplify, 6, &track[4], 300, kept);
+	n += nmea_simplify_flush(&simplify, 6, &kept[n]);
+	ok &= n >= 4 && n <= 6 && kept[n - 1].epoch_ms == track[303].epoch_ms &&
+			max_track_error(&track[4], 300, kept, n) <= 10.01;
+	nmea_simplify_destroy(&simplify);
+
+	// parked for an hour: one fix a minute with a max interval
+	if (nmea_simplify_init(&simplify, 5, 60000, 16)) {
+		return 0;
+	}
+	for (i = 0, n = 0; i < 3600; i++) {
+		track[0].epoch_ms = fix->epoch_ms + 1000 * (int64_t)i;
+		n += nmea_simplify(&simplify, 4, &track[0], 1, kept);
+	}
+	ok &= n == 60;
+	nmea_simplify_destroy(&simplify);
+
+	return ok;
+}
+
+static int serve_streams(const char *address, const char *store_file)
+{
+	static nmea_fleet_position_t nearby[1024];
+	static nmea_archive_writer_t archive;
+	nmea_server_t server;
+	nmea_fleet_t fleet;
+	nmea_simplify_t simplify;
+	nmea_fleet_position_t first;
+	server_state_t state = { 0, 0, 0, &fleet, &simplify, store_file ? &archive : NULL };
+	unsigned int fields = store_file ? RMC_FIELD_MASK_ALL : RMC_FIELD_MASK_POSITION | RMC_FIELD_MASK_TIMESTAMP;
+	struct timespec start;
+	size_t peak = 0;
+	int err;
+
+	raise_fd_limit();
+	if (store_file && nmea_archive_create(&archive, store_file, 0)) {
+		printf("Failed to open output file %s!\n", store_file);
+		exit(-2);
+	}
+	if (nmea_fleet_init(&fleet, SERVER_MAX_VEHICLES) ||
+			nmea_simplify_init(&simplify, SERVER_TOLERANCE_M, 0, SERVER_SIMPLIFIED_VEHICLES) ||
+			nmea_server_init(&server, fields, on_server_batch, &state) ||
+			nmea_server_listen(&server, address)) {
+		printf("Failed to serve on %s!\n", address);
+		exit(-1);
+	}
+
+	// the clock starts with the first connection and stops with the last
+	while (!server.stats.accepted || server.stats.active) {
+		if (nmea_server_poll(&server, -1) < 0) {
+			printf("Failed to poll the connections!\n");
+			exit(-3);
+		}
+		if (server.stats.accepted && !peak) {
+			clock_gettime(CLOCK_MONOTONIC, &start);
+		}
+		peak = server.stats.active > peak ? server.stats.active : peak;
+	}
+	double seconds = elapsed_seconds(&start);
+
+	printf("Done!");
+	printf("\tServed %zu connections, %zu at once, in %.3f s\n", server.stats.accepted, peak, seconds);
+	printf("\tParsed %llu sentences (%.0f/s, %.1f MB/s) to obtain %zu fixes in %zu batches\n",
+			(unsigned long long)server.stats.sentences, server.stats.sentences / seconds,
+			server.stats.bytes / seconds / 1e6, state.fixes, state.batches);
+	for (err = RMC_ERROR_HEADER; err < RMC_ERROR_CODE_INVALID; err++) {
+		if (nmea_error_count(&server.errors, err)) {
+			printf("\t%zu failed on %s\n", nmea_error_count(&server.errors, err), rmc_parse_error_name(err));
+		}
+	}
+	printf("\tParse state of an idle connection: %zu bytes\n", sizeof(nmea_connection_t));
+	if (nmea_fleet_get(&fleet, 0, &first)) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		size_t n = nmea_fleet_query_radius(&fleet, first.latitude_e7, first.longitude_e7, 10000, nearby, 1024);
+		printf("\tIndexed %zu vehicles, %zu within 10 km of vehicle 0 found in %.1f us\n",
+				fleet.vehicles, n, elapsed_seconds(&start) * 1e6);
+	}
+	printf("\tKept %llu of %llu fixes within %d m of the tracks (%.1f:1)\n",
+			(unsigned long long)simplify.stats.fixes_out, (unsigned long long)simplify.stats.fixes_in,
+			SERVER_TOLERANCE_M, nmea_simplify_ratio(&simplify));
+	nmea_server_destroy(&server);
+	nmea_fleet_destroy(&fleet);
+	nmea_simplify_destroy(&simplify);
+	if (store_file) {
+		if (nmea_archive_close(&archive)) {
+			printf("Failed to write output file %s!\n", store_file);
+			exit(-2);
+		}
+		printf("\tArchived the fixes to %s, indexed in %zu blocks\n", store_file, archive.num_entries);
+	}
+	print_metrics();
+
+	return 0;
+}
+
+static void *generate_to_streams(void *arg)
+{
+	generator_thread_t *thread = arg;
+	size_t vehicles = thread->gen.num_vehicles, rounds = thread->sentences / vehicles, n, i;
+
+	// one sentence per stream per round, like receivers reporting together
+	for (n = 0; n < rounds && !thread->failed; n++) {
+		for (i = 0; i < vehicles; i++) {
+			char buffer[NMEA_GENERATOR_MAX_SENTENCE];
+			ssize_t len = nmea_generator_sentence(&thread->gen, i, buffer);
+
+			if (write(thread->fds[thread->first_vehicle + i], buffer, len) != len) {
+				thread->failed = 1;
+				break;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static int load_streams(const char *address, int num_streams, int sentences, int num_threads)
+{
+	// the server parses RMC sentences only
+	unsigned int rates[3] = { GENERATOR_PCT_VOID, GENERATOR_PCT_CORRUPT, 0 };
+	generator_thread_t *threads;
+	int *fds = NULL;
+	struct timespec start;
+	int i, failed = 0;
+
+	if (num_threads <= 0) {
+		num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (num_threads > num_streams) {
+		num_threads = num_streams;
+	}
+	threads = num_threads > 0 ? calloc(num_threads, sizeof(generator_thread_t)) : NULL;
+	if (threads) {
+		fds = calloc(num_streams, sizeof(int));
+	}
+	if (!fds || sentences < 0) {
+		printf("Failed to allocate %d streams!\n", num_streams);
+		exit(-1);
+	}
+	raise_fd_limit();
+	for (i = 0; i < num_streams; i++) {
+		fds[i] = nmea_server_connect(address);
+		if (fds[i] < 0) {
+			printf("Failed to open connection %d to %s!\n", i, address);
+			exit(-2);
+		}
+	}
+	for (i = 0; i < num_threads; i++) {
+		threads[i].fds = fds;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (start_generators(threads, num_threads, num_streams, (size_t)num_streams * sentences, rates,
+			generate_to_streams)) {
+		printf("Failed to start %d generators!\n", num_threads);
+		exit(-1);
+	}
+	for (i = 0; i < num_threads; i++) {
+		pthread_join(threads[i].thread, NULL);
+		failed |= threads[i].failed;
+		nmea_generator_destroy(&threads[i].gen);
+	}
+	double seconds = elapsed_seconds(&start);
+
+	for (i = 0; i < num_streams; i++) {
+		close(fds[i]);
+	}
+	if (failed) {
+		printf("Failed to write to a connection!\n");
+		exit(-3);
+	}
+	printf("Done!");
+	printf("\tSent %llu sentences on %d connections from %d threads in %.3f s (%.0f/s)\n",
+			(unsigned long long)num_streams * sentences, num_streams, num_threads, seconds,
+			(double)num_streams * sentences / seconds);
+	free(threads);
+	free(fds);
+
+	return 0;
 }
 
 /**
@@ -252,4 +2214,3 @@ static int readline(FILE *f, char *buf, int len)
 /*******************************************************************************
 *                          End of File
 *******************************************************************************/
-
@@ -0,0 +1,130 @@
+/** @file
+ *  Provides implementation for the tables of per-vehicle state.
+ *
+ *  A table is a power of two of slots, at least twice the vehicles it holds,
+ *  each starting with the key of its vehicle: the id + 1, so that 0 marks a
+ *  free slot and an all-zero table is empty. A vehicle starts probing at the
+ *  Fibonacci hash of its key and takes the first free slot; slots are never
+ *  given back. The fleet index probes with atomics of its own, the other
+ *  users from one thread with nmea_vehicle_find().
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include "nmea0183_vehicle.h"
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Type & Macro Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Static Function Prototypes
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Static Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported Data Definitions
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern/Exported  Function Definitions
+*******************************************************************************/
+
+/**
+********************************************************************************
+* Number of slots of a table
+* @param  max_vehicles: Most vehicles held
+* @return Slots to allocate, a power of two
+********************************************************************************/
+size_t nmea_vehicle_slots(size_t max_vehicles)
+{
+	size_t slots = 1;
+
+	// at most half of the slots used keeps the probes short
+	while (slots < 2 * max_vehicles) {
+		slots <<= 1;
+	}
+	return slots;
+}
+
+/**
+********************************************************************************
+* Key of a vehicle in its slot
+* @param  vehicle: Vehicle id
+* @return Key of the vehicle, 0 if the id is above NMEA_VEHICLE_MAX
+********************************************************************************/
+uint32_t nmea_vehicle_key(uint32_t vehicle)
+{
+	return vehicle > NMEA_VEHICLE_MAX ? 0 : vehicle + 1;
+}
+
+/**
+********************************************************************************
+* First slot probed for a key
+* @param  key: Key of the vehicle
+* @param  mask: Slots of the table - 1
+* @return Index of the slot
+********************************************************************************/
+size_t nmea_vehicle_home(uint32_t key, size_t mask)
+{
+	return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+/**
+********************************************************************************
+* State of a vehicle, claimed on its first use. Not thread safe.
+* @param  slots: Table of slots, each starting with a uint32_t key
+* @param  slot_size: Size of a slot in bytes
+* @param  mask: Slots of the table - 1
+* @param  vehicle: Vehicle to look up
+* @return Slot of the vehicle, NULL if the id is above NMEA_VEHICLE_MAX or
+*         there is no room left
+********************************************************************************/
+void *nmea_vehicle_find(void *slots, size_t slot_size, size_t mask, uint32_t vehicle)
+{
+	uint32_t key = nmea_vehicle_key(vehicle);
+	size_t slot = nmea_vehicle_home(key, mask), probes;
+
+	if (!key) {
+		return NULL;
+	}
+	for (probes = 0; probes <= mask / 2; probes++) {
+		uint32_t *found = (uint32_t *)((char *)slots + slot * slot_size);
+
+		if (*found == key) {
+			return found;
+		}
+		if (!*found) {
+			*found = key;
+			return found;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End of File
+*******************************************************************************/
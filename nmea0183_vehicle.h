@@ -0,0 +1,58 @@
+/** @file
+ *  Provides prototypes for the open-addressed tables of per-vehicle state
+ *  shared by the fleet index, the geofence engine and the simplification.
+ *
+ */
+
+/** @addtogroup nmea_parser NMEA0183 Parser
+ *  @{
+ */
+
+#ifndef __NMEA0183_VEHICLE_H__
+#define __NMEA0183_VEHICLE_H__
+
+
+/*******************************************************************************
+*                          Include Files
+*******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+*                          C++ Declaration Wrapper
+*******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+*                          Type & Macro Declarations
+*******************************************************************************/
+#define NMEA_VEHICLE_MAX			(UINT32_MAX - 1)	/**< Highest vehicle id; a slot holds id + 1, 0 when free. */
+
+/*******************************************************************************
+*                          Extern Data Declarations
+*******************************************************************************/
+
+/*******************************************************************************
+*                          Extern Function Prototypes
+*******************************************************************************/
+
+size_t nmea_vehicle_slots(size_t max_vehicles);
+uint32_t nmea_vehicle_key(uint32_t vehicle);
+size_t nmea_vehicle_home(uint32_t key, size_t mask);
+void *nmea_vehicle_find(void *slots, size_t slot_size, size_t mask, uint32_t vehicle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/**
+ *	@}		// end of nmea_parser
+ */
+
+/*******************************************************************************
+*                          End File
+********************************************************************************/